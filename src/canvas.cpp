@@ -6,210 +6,206 @@
 #include <QApplication>
 #include <QBitmap>
 #include <QPainter>
+#include <QPaintEngine>
+#include <QScopedValueRollback>
 #include <QTimer>
 #include <QDesktopWidget>
+#include <QSemaphore>
 #include <QSet>
+#include <QThread>
+#include <QThreadPool>
 
 #include "ktlq3polygonscanner.h"
 #include <ktlqt3support/ktlq3scrollview.h>
 
+#include <atomic>
+#include <functional>
+#include <limits>
 #include <numeric>
 
 namespace {
 	static constexpr const bool isCanvasDebugEnabled = false;
-}
-
-//BEGIN class KtlQCanvasClusterizer
-
-/*
-A KtlQCanvasClusterizer groups rectangles (QRects) into non-overlapping rectangles
-by a merging heuristic.
-*/
-KtlQCanvasClusterizer::KtlQCanvasClusterizer(int maxClusters) :
-	clusters(std::make_unique<QRect[]>(maxClusters)),
-	capacity(maxClusters)
-{ }
-
-void KtlQCanvasClusterizer::clear() {
-	count_ = 0;
-}
-
-void KtlQCanvasClusterizer::add(int x, int y) {
-	add(QPointRect{x, y});
-}
-
-void KtlQCanvasClusterizer::add(const QPoint &point) {
-	add(QPointRect{point});
-}
-
-void KtlQCanvasClusterizer::add(int x, int y, int w, int h) {
-	add(QRect(x, y, w, h));
-}
-
-namespace {
-	template <typename... Tt>
-	// TODO : Add enable_if to validate that it's a QRect
-	static int GetCost(const QRect &rect, const Tt &... rects) {
-		// This should end up being the area of rect - sum(area(rects))
-		// Which is cost - cost1 - cost2 - cost3...
-		int cost = GetArea(rect);
-		((cost -= GetArea(rects)), ...);
-		return cost;
-	}
-}
 
-void KtlQCanvasClusterizer::add(const QRect &rect) {
-	const auto biggerRect = rect.adjusted(
-		-1, -1,
-		2, 2
-	);
-
-	for (int cursor : Times{count_}) {
-		if (clusters.get()[cursor].contains(rect)) {
-			// Already wholly contained.
-			return;
-		}
-	}
-
-	const auto resetCosts = []() -> std::pair<int, int> {
-		return { MaxValue<int>, -1 };
-	};
-
-	{
-		auto [lowestCost, cheapest] = resetCosts();
-
-		for (int cursor : Times{count_}) {
-			if (!clusters.get()[cursor].intersects(biggerRect)) {
-				continue;
+	/// Rasterising fewer tiles than this per thread isn't worth starting threads for
+	static constexpr const int minTilesPerThread = 2;
+
+	/**
+	 * Rasterises tiles on a pool thread for KtlQCanvas::renderTiles.
+	 */
+	class TileRasterTask final : public QRunnable {
+		public:
+			TileRasterTask(std::function<void()> rasterTiles, QSemaphore &done) :
+				m_rasterTiles(std::move(rasterTiles)),
+				m_done(done)
+			{}
+
+			void run() override {
+				m_rasterTiles();
+				m_done.release();
 			}
 
-			const auto &clusterRect = clusters.get()[cursor];
-			QRect larger = clusterRect | rect;
-			const int cost = GetCost(larger, clusterRect);
-
-			if (cost >= lowestCost) {
-				continue;
-			}
+		private:
+			std::function<void()> m_rasterTiles;
+			QSemaphore &m_done;
+	};
 
-			bool bad = false;
-			for (int c : Times{count_}) {
-				if (c != cursor && clusters.get()[c].intersects(larger)) {
-					bad = true;
-					break;
+	/**
+	 * A paint engine that draws nothing, but notes whether anything drawn
+	 * with it uses a pixmap (including as a brush texture).
+	 */
+	class PixmapFindingEngine final : public QPaintEngine {
+		public:
+			PixmapFindingEngine() :
+				QPaintEngine(QPaintEngine::AllFeatures)
+			{}
+
+			bool begin(QPaintDevice *) override { return true; }
+			bool end() override { return true; }
+			Type type() const override { return QPaintEngine::User; }
+
+			void updateState(const QPaintEngineState &state) override {
+				const QPaintEngine::DirtyFlags dirty = state.state();
+				if ((dirty & QPaintEngine::DirtyBrush) && state.brush().style() == Qt::TexturePattern) {
+					m_foundPixmap = true;
+				}
+				if ((dirty & QPaintEngine::DirtyPen) && state.pen().brush().style() == Qt::TexturePattern) {
+					m_foundPixmap = true;
+				}
+				if ((dirty & QPaintEngine::DirtyBackground) && state.backgroundBrush().style() == Qt::TexturePattern) {
+					m_foundPixmap = true;
 				}
 			}
 
-			if (!bad) {
-				cheapest = cursor;
-				lowestCost = cost;
-			}
-		}
-
-		if (cheapest >= 0) {
-			clusters.get()[cheapest] |= rect;
-			return;
-		}
-
-		if (count_ < capacity) {
-			clusters.get()[count_++] = rect;
-			return;
-		}
-	}
-
-  // Do cheapest of:
-  //     add to closest cluster
-	//     do cheapest cluster merge, add to new cluster
-
-	int lastCheapest = -1;
-	{
-		auto [lowestCost, cheapest] = resetCosts();
+			void drawPixmap(const QRectF &, const QPixmap &, const QRectF &) override { m_foundPixmap = true; }
+			void drawTiledPixmap(const QRectF &, const QPixmap &, const QPointF &) override { m_foundPixmap = true; }
 
-		for (int cursor : Times{count_}) {
-			const auto &clusterRect = clusters.get()[cursor];
+			// Images are safe on any thread; the defaults would turn them into
+			// pixmaps. Nothing else needs to be looked at.
+			void drawImage(const QRectF &, const QImage &, const QRectF &, Qt::ImageConversionFlags) override {}
+			void drawTextItem(const QPointF &, const QTextItem &) override {}
+			void drawPath(const QPainterPath &) override {}
+			void drawPolygon(const QPointF *, int, PolygonDrawMode) override {}
 
-			QRect larger = clusterRect | rect;
-			const int cost = GetCost(larger, clusterRect);
+			bool foundPixmap() const { return m_foundPixmap; }
 
-			if (cost >= lowestCost) {
-				continue;
-			}
-
-			bool bad = false;
+		private:
+			bool m_foundPixmap = false;
+	};
 
-			for (int c : Times{count_}) {
-				if (c != cursor && clusters.get()[c].intersects(larger)) {
-					bad = true;
-					break;
+	/**
+	 * A paint device for PixmapFindingEngine.
+	 */
+	class PixmapFinder final : public QPaintDevice {
+		public:
+			QPaintEngine *paintEngine() const override { return &m_engine; }
+			bool foundPixmap() const { return m_engine.foundPixmap(); }
+
+		protected:
+			int metric(PaintDeviceMetric metric) const override {
+				switch (metric) {
+					case PdmWidth:
+					case PdmHeight:
+					case PdmWidthMM:
+					case PdmHeightMM:
+						return std::numeric_limits<int>::max() / 2;
+					case PdmNumColors:
+						return std::numeric_limits<int>::max();
+					case PdmDepth:
+						return 32;
+					case PdmDpiX:
+					case PdmDpiY:
+					case PdmPhysicalDpiX:
+					case PdmPhysicalDpiY:
+						return 96;
+					case PdmDevicePixelRatio:
+						return 1;
+					case PdmDevicePixelRatioScaled:
+						return int(devicePixelRatioFScale());
 				}
+				return 0;
 			}
 
-			if (!bad) {
-				cheapest = cursor;
-				lowestCost = cost;
-			}
-		}
+		private:
+			mutable PixmapFindingEngine m_engine;
+	};
 
-		lastCheapest = cheapest;
+	/**
+	 * @return whether playing picture draws any pixmaps. QPixmaps may only be
+	 * used on the GUI thread.
+	 */
+	bool drawsPixmaps(const QPicture &picture) {
+		PixmapFinder finder;
+		QPainter painter(&finder);
+		picture.play(&painter);
+		painter.end();
+		return finder.foundPixmap();
 	}
+}
 
-  // ###
-  // could make an heuristic guess as to whether we need to bother
-  // looking for a cheap merge.
-
-	int lowestCost = MaxValue<int>;
-	int cheapestMerge1 = -1;
-	int cheapestMerge2 = -1;
-
-	for (int merge1 : Times{count_}) {
-		const auto &clusterRect1 = clusters.get()[merge1];
-
-		for (int merge2 : Times{count_}) {
-			if (merge1 == merge2) continue;
-
-			const auto &clusterRect2 = clusters.get()[merge2];
-
-			QRect larger = clusterRect1 | clusterRect2;
+//BEGIN class KtlQCanvasTileCache
+const KtlQCanvasTileCache::Tile * KtlQCanvasTileCache::find(int x, int y) {
+	const auto it = m_tiles.find(key(x, y));
+	if (it == m_tiles.end()) {
+		return nullptr;
+	}
 
-			const int cost = GetCost(larger, clusterRect1, clusterRect2);
+	it->lastUsed = ++m_useCount;
+	return &*it;
+}
 
-			if (cost >= lowestCost) {
-				continue;
+void KtlQCanvasTileCache::insert(int x, int y, const QImage &image) {
+	if (m_tiles.size() >= maxTiles) {
+		auto oldest = m_tiles.begin();
+		for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+			if (it->lastUsed < oldest->lastUsed) {
+				oldest = it;
 			}
+		}
+		m_tiles.erase(oldest);
+	}
 
-			bool bad = false;
+	m_tiles.insert(key(x, y), Tile{image, QRegion{}, ++m_useCount});
+}
 
-			for (int c : Times{count_}) {
-				if (c != merge1 && c != merge2 && clusters.get()[c].intersects(larger)) {
-					bad = true;
-					break;
-				}
-			}
+void KtlQCanvasTileCache::invalidate(const QRect &scaledRect) {
+	const QRect covering = tilesCovering(scaledRect);
+	for (int y = covering.top(); y <= covering.bottom(); ++y) {
+		for (int x = covering.left(); x <= covering.right(); ++x) {
+			const auto it = m_tiles.find(key(x, y));
+			if (it == m_tiles.end()) continue;
 
-			if (!bad) {
-				cheapestMerge1 = merge1;
-				cheapestMerge2 = merge2;
-				lowestCost = cost;
-			}
+			it->dirty += scaledRect & QRect{x * tileSize, y * tileSize, tileSize, tileSize};
 		}
 	}
+}
 
-	if (cheapestMerge1 >= 0) {
-		clusters.get()[cheapestMerge1] |= clusters.get()[cheapestMerge2];
-		clusters.get()[cheapestMerge2] = clusters.get()[count_--];
-	}
-	else {
-		clusters.get()[lastCheapest] |= rect;
-	}
-
-	// NB: clusters do not intersect (or intersection will
-	//     overwrite). This is a result of the above algorithm,
-	//     given the assumption that (x,y) are ordered topleft
-	//     to bottomright.
-	// add explicit x/y ordering to that comment, move it to the top
-	// and rephrase it as pre-/post-conditions.
+QRect KtlQCanvasTileCache::scaledRect(const QRect &area) const {
+	// Rounded outwards, so that every pixel touched by the area is included
+	return QRect{
+		QPoint{
+			int(std::floor(area.left() * m_scale)),
+			int(std::floor(area.top() * m_scale))
+		},
+		QPoint{
+			int(std::ceil((area.right() + 1) * m_scale)),
+			int(std::ceil((area.bottom() + 1) * m_scale))
+		}
+	};
 }
 
-//END class KtlQCanvasClusterizer
+QRect KtlQCanvasTileCache::tilesCovering(const QRect &scaledRect) {
+	return QRect{
+		QPoint{
+			roundDown(scaledRect.left(), tileSize),
+			roundDown(scaledRect.top(), tileSize)
+		},
+		QPoint{
+			roundDown(scaledRect.right(), tileSize),
+			roundDown(scaledRect.bottom(), tileSize)
+		}
+	};
+}
+//END class KtlQCanvasTileCache
 
 int KtlQCanvas::toChunkScaling(int x, int chunkSize) {
 	return roundDown(x, chunkSize);
@@ -355,6 +351,8 @@ void KtlQCanvas::retune(int chunksze, int mxclusters) {
 	for (auto *item : hidden) {
 		item->show();
 	}
+
+	setAllChanged();
 }
 
 void KtlQCanvas::addItem(KtlQCanvasItem *item) {
@@ -404,6 +402,191 @@ void KtlQCanvas::setUpdatePeriod(int ms) {
 // Don't call this unless you know what you're doing.
 // p is in the content's co-ordinate example.
 void KtlQCanvas::drawViewArea(KtlQCanvasView *view, QPainter *p, const QRect &vr) {
+	const QScopedValueRollback<bool> paintingView(m_bPaintingView, true);
+
+	// Tiles under chunks that changed since the last update are out of date.
+	// The views are asked to repaint those parts on the next update().
+	invalidateTiles();
+
+	KtlQCanvasTileCache *cache = tileCache(view);
+	if (!cache) {
+		drawViewAreaDirect(view, p, vr);
+		return;
+	}
+
+	const QPoint origin = tileOrigin(view);
+	const QRect tiles = KtlQCanvasTileCache::tilesCovering(vr.translated(-origin));
+	constexpr const int tileSize = KtlQCanvasTileCache::tileSize;
+
+	// Render all of the missing and dirty tiles together, so that they can
+	// be rasterised in parallel
+	std::vector<KtlQCanvasTileJob> jobs;
+	for (int y = tiles.top(); y <= tiles.bottom(); ++y) {
+		for (int x = tiles.left(); x <= tiles.right(); ++x) {
+			const KtlQCanvasTileCache::Tile *tile = cache->find(x, y);
+			if (tile && tile->dirty.isEmpty()) {
+				p->drawImage(origin + QPoint{x * tileSize, y * tileSize}, tile->image);
+				continue;
+			}
+
+			// Dirty tiles keep their image, and only have the dirty part
+			// painted again
+			KtlQCanvasTileCache::Tile taken = cache->take(x, y);
+			if (taken.image.isNull()) {
+				taken.image = QImage{tileSize, tileSize, QImage::Format_ARGB32_Premultiplied};
+				taken.dirty = QRegion{};
+			}
+
+			jobs.push_back(KtlQCanvasTileJob{
+				QRect{x * tileSize, y * tileSize, tileSize, tileSize},
+				std::move(taken.image),
+				QPicture{},
+				std::move(taken.dirty)
+			});
+		}
+	}
+
+	if (jobs.empty()) return;
+
+	renderTiles(cache->scale(), jobs);
+	for (const KtlQCanvasTileJob &job : jobs) {
+		cache->insert(job.rect.x() / tileSize, job.rect.y() / tileSize, job.image);
+		p->drawImage(origin + job.rect.topLeft(), job.image);
+	}
+}
+
+KtlQCanvasTileCache * KtlQCanvas::tileCache(const KtlQCanvasView *view) {
+	const QMatrix &wm = view->worldMatrix();
+	if (wm.m12() != 0.0 || wm.m21() != 0.0 || wm.m11() != wm.m22() || wm.m11() <= 0.0) {
+		return nullptr;
+	}
+
+	auto &cache = m_tileCaches[wm.m11()];
+	if (!cache) {
+		cache = std::make_unique<KtlQCanvasTileCache>(wm.m11());
+	}
+	return cache.get();
+}
+
+QPoint KtlQCanvas::tileOrigin(const KtlQCanvasView *view) {
+	// The canvas is offset by a whole number of pixels at KTechLab's zoom
+	// levels, but round it in case it isn't
+	const QMatrix &wm = view->worldMatrix();
+	return QPoint{qRound(wm.dx()), qRound(wm.dy())};
+}
+
+void KtlQCanvas::renderTiles(qreal scale, std::vector<KtlQCanvasTileJob> &jobs) {
+	// The canvas area that a job shows, or an empty rect if none
+	auto jobArea = [&](const KtlQCanvasTileJob &job) {
+		const QRect paintRect = job.dirty.isEmpty() ? job.rect : job.dirty.boundingRect();
+		return QRectF{
+			paintRect.x() / scale,
+			paintRect.y() / scale,
+			paintRect.width() / scale,
+			paintRect.height() / scale
+		}.toAlignedRect() & m_size;
+	};
+
+	// Sets up painter (which paints in the pixels of the repaint's scale) to
+	// paint a job's part of the canvas
+	auto beginCanvasArea = [&](QPainter &painter, const KtlQCanvasTileJob &job) {
+		if (!job.dirty.isEmpty()) {
+			painter.setClipRegion(job.dirty);
+		}
+		painter.scale(scale, scale);
+
+		// As in drawViewAreaDirect, the right and bottom edges are only exact
+		// when not scaling
+		painter.setClipRect(
+			(scale == 1.0) ? m_size.adjusted(0, 0, 1, 1) : m_size,
+			job.dirty.isEmpty() ? Qt::ReplaceClip : Qt::IntersectClip
+		);
+	};
+
+	// Clears a job's pixels to the background, returning the painter to use
+	// for the rest of the job
+	auto beginImage = [&](KtlQCanvasTileJob &job, QPainter &painter) {
+		if (job.dirty.isEmpty()) {
+			job.image.fill(bgcolor);
+		}
+
+		painter.begin(&job.image);
+		painter.translate(-job.rect.topLeft());
+		if (!job.dirty.isEmpty()) {
+			painter.setClipRegion(job.dirty);
+			painter.setCompositionMode(QPainter::CompositionMode_Source);
+			painter.fillRect(job.rect, bgcolor);
+			painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+		}
+	};
+
+	const int threads = std::min<int>(QThread::idealThreadCount(), int(jobs.size()) / minTilesPerThread);
+	if (threads <= 1) {
+		// Nothing to share between threads, so paint straight into the images
+		for (KtlQCanvasTileJob &job : jobs) {
+			QPainter painter;
+			beginImage(job, painter);
+
+			const QRect area = jobArea(job);
+			if (area.isEmpty()) continue;
+
+			beginCanvasArea(painter, job);
+			drawCanvasArea(area, &painter);
+		}
+		return;
+	}
+
+	// Items may only be drawn on this thread (some of them use widgets or
+	// change other items while drawing), so record what they draw into each
+	// tile first. Only playing the pictures back, which is where the time
+	// goes, is shared between threads. Pictures with pixmaps in them (widget
+	// grabs, images, cached component glyphs, the background) are still
+	// played on this thread, as pixmaps can't be used on the others.
+	for (KtlQCanvasTileJob &job : jobs) {
+		const QRect area = jobArea(job);
+		if (area.isEmpty()) continue;
+
+		QPainter recorder(&job.picture);
+		beginCanvasArea(recorder, job);
+		drawCanvasArea(area, &recorder);
+		recorder.end();
+
+		job.guiThreadOnly = drawsPixmaps(job.picture);
+	}
+
+	auto rasterTile = [&](KtlQCanvasTileJob &job) {
+		QPainter painter;
+		beginImage(job, painter);
+		if (!job.picture.isNull()) {
+			job.picture.play(&painter);
+		}
+	};
+
+	std::atomic<size_t> next{0};
+	auto rasterTiles = [&]() {
+		for (size_t i = next++; i < jobs.size(); i = next++) {
+			if (!jobs[i].guiThreadOnly) {
+				rasterTile(jobs[i]);
+			}
+		}
+	};
+
+	QSemaphore done;
+	for (int i = 1; i < threads; ++i) {
+		QThreadPool::globalInstance()->start(new TileRasterTask(rasterTiles, done));
+	}
+
+	for (KtlQCanvasTileJob &job : jobs) {
+		if (job.guiThreadOnly) {
+			rasterTile(job);
+		}
+	}
+
+	rasterTiles();
+	done.acquire(threads - 1);
+}
+
+void KtlQCanvas::drawViewAreaDirect(KtlQCanvasView *view, QPainter *p, const QRect &vr) {
 	QPoint tl = view->contentsToViewport(QPoint{0, 0});
 
 	QMatrix wm = view->worldMatrix();
@@ -468,49 +651,99 @@ void KtlQCanvas::advance() {
   qWarning() << "KtlQCanvas::advance: TODO"; // TODO
 }
 
+void KtlQCanvas::invalidateTiles() {
+	// Throw away the tiles of zoom levels that no view is using any more
+	QSet<qreal> scales;
+	for (auto *view : m_viewList) {
+		if (KtlQCanvasTileCache *cache = tileCache(view)) {
+			scales.insert(cache->scale());
+		}
+	}
+	for (auto it = m_tileCaches.begin(); it != m_tileCaches.end();) {
+		if (scales.contains(it->first)) {
+			++it;
+		}
+		else {
+			it = m_tileCaches.erase(it);
+		}
+	}
+
+	if (m_bAllChanged) {
+		m_bAllChanged = false;
+		m_bRepaintAll = true;
+		m_changedChunks.clear();
+
+		for (int i : Times{GetArea(m_chunkSize)}) {
+			chunks.get()[i].takeChange();
+		}
+		for (auto &cache : m_tileCaches) {
+			cache.second->clear();
+		}
+		return;
+	}
+
+	for (const QPoint &changedChunk : m_changedChunks) {
+		if (!validChunk(changedChunk)) continue;
+		chunk(changedChunk.x(), changedChunk.y()).takeChange();
+
+		const QRect area{
+			changedChunk.x() * chunksize,
+			changedChunk.y() * chunksize,
+			chunksize,
+			chunksize
+		};
+
+		for (auto &cachePair : m_tileCaches) {
+			KtlQCanvasTileCache &cache = *cachePair.second;
+			const QRect scaled = cache.scaledRect(area);
+			cache.invalidate(scaled);
+			m_pendingRepaint[cache.scale()] += scaled;
+		}
+		m_bRepaintUncached = true;
+	}
+	m_changedChunks.clear();
+}
+
 /*!
 	Repaints changed areas in all views of the canvas.
  */
 void KtlQCanvas::update() {
-	KtlQCanvasClusterizer clusterizer(m_viewList.count());
-	QList<QRect> doneRects;
-
-	for (auto *view : m_viewList) {
-		QMatrix wm = view->worldMatrix();
-
-		// TODO : There's probably a better way to do this.
-		QRect area(
-			view->contentsX(),
-			view->contentsY(),
-			view->visibleWidth(),
-			view->visibleHeight()
-		);
+	invalidateTiles();
 
-		if (area.width() <= 0 || area.height() <= 0) {
-			continue;
+	if (m_bRepaintAll) {
+		for (auto *view : m_viewList) {
+			view->viewport()->update();
 		}
+	}
+	else {
+		for (auto *view : m_viewList) {
+			KtlQCanvasTileCache *cache = tileCache(view);
+			if (!cache) {
+				if (m_bRepaintUncached) {
+					view->viewport()->update();
+				}
+				continue;
+			}
 
-		if (!wm.isIdentity()) {
-			// r = Visible area of the canvas where there are changes
-			QRect r = changeBounds(view->inverseWorldMatrix().mapRect(area));
-			if (!r.isEmpty()) {
-				// as of my testing, drawing below always fails, so just post for an update event to the widget
-				view->viewport()->update();
-				doneRects.append(r);
+			const auto pending = m_pendingRepaint.find(cache->scale());
+			if (pending == m_pendingRepaint.end()) continue;
+
+			const QRect visible(
+				view->contentsX(),
+				view->contentsY(),
+				view->visibleWidth(),
+				view->visibleHeight()
+			);
+			const QRegion region = pending->second.translated(tileOrigin(view)) & visible;
+			if (!region.isEmpty()) {
+				view->viewport()->update(region.translated(view->contentsToViewport(QPoint{0, 0})));
 			}
 		}
-		else {
-			clusterizer.add(area);
-		}
 	}
 
-	for (int i : Times{clusterizer.count()}) {
-		drawChanges(clusterizer[i]);
-	}
-
-	for (auto &doneRect : doneRects) {
-		setUnchanged(doneRect);
-	}
+	m_bRepaintAll = false;
+	m_bRepaintUncached = false;
+	m_pendingRepaint.clear();
 }
 
 /*!
@@ -519,7 +752,7 @@ void KtlQCanvas::update() {
 	update() is called next.
  */
 void KtlQCanvas::setAllChanged() {
-	setChanged(m_size);
+	m_bAllChanged = true;
 }
 
 /*!
@@ -540,7 +773,7 @@ void KtlQCanvas::setChanged(const QRect &area) {
 
 	for (int x = toChunkScaling(intersectedArea.x()); x < mx; ++x) {
 		for (int y = toChunkScaling(intersectedArea.y()); y < my; ++y) {
-			chunk(x, y).change();
+			markChunkChanged(x, y);
 		}
 	}
 }
@@ -570,76 +803,9 @@ void KtlQCanvas::setUnchanged(const QRect &area) {
 }
 
 
-QRect KtlQCanvas::changeBounds(const QRect &inarea) {
-	const auto intersectedArea = inarea.intersect(m_size);
-
-	const int mx = std::min(
-		toChunkScaling(intersectedArea.x() + intersectedArea.width() + chunksize),
-		m_chunkSize.right()
-	);
-	const int my = std::min(
-		toChunkScaling(intersectedArea.y() + intersectedArea.height() + chunksize),
-		m_chunkSize.bottom()
-	);
-
-	QRect result;
-
-	for (int x = toChunkScaling(intersectedArea.x()); x < mx; ++x) {
-		for (int y = toChunkScaling(intersectedArea.y()); y < my; ++y) {
-			if (chunk(x, y).hasChanged()) {
-				result |= QPointRect{x, y};
-			}
-		}
-	}
-
-	if (!result.isEmpty()) {
-		result.setLeft( result.left() * chunksize );
-		result.setTop( result.top() * chunksize );
-		result.setRight( result.right() * chunksize );
-		result.setBottom( result.bottom() * chunksize );
-		// TODO : err, is this right?
-		result.setRight( result.right() + chunksize );
-		result.setBottom( result.bottom() + chunksize );
-	}
-
-	return result;
-}
-
-/*!
-	Redraws the area \a inarea of the KtlQCanvas.
- */
-void KtlQCanvas::drawChanges(const QRect &inarea) {
-	const auto intersectedArea = inarea.intersect(m_size);
-
-	const int mx = std::min(
-		toChunkScaling(intersectedArea.x() + intersectedArea.width() + chunksize),
-		m_chunkSize.right()
-	);
-	const int my = std::min(
-		toChunkScaling(intersectedArea.y() + intersectedArea.height() + chunksize),
-		m_chunkSize.bottom()
-	);
-
-	KtlQCanvasClusterizer clusters = {maxclusters};
-
-	for (int x = toChunkScaling(intersectedArea.x()); x < mx; ++x) {
-		for (int y = toChunkScaling(intersectedArea.y()); y < my; ++y) {
-			if (chunk(x, y).hasChanged()) {
-				clusters.add(x, y);
-			}
-		}
-	}
-
-	for (int i : Times{clusters.count()}) {
-		QRect elarea = clusters[i];
-		elarea.setRect(
-			elarea.left() * chunksize,
-			elarea.top() * chunksize,
-			// TODO : err, is this right?
-			(elarea.width() * chunksize) + chunksize,
-			(elarea.height() * chunksize) + chunksize
-		);
-		drawCanvasArea(elarea, nullptr);
+void KtlQCanvas::markChunkChanged(int x, int y) {
+	if (chunk(x, y).change()) {
+		m_changedChunks.push_back(QPoint{x, y});
 	}
 }
 
@@ -662,9 +828,42 @@ void KtlQCanvas::drawArea(const QRect &clip, QPainter *painter) {
 	}
 }
 
+void KtlQCanvas::drawArea(const QRect &area, QImage &image) {
+	if (image.depth() != 32 || image.width() < area.width() || image.height() < area.height()) {
+		qWarning() << Q_FUNC_INFO << " can't paint into " << image;
+		return;
+	}
+
+	// The tiles paint straight into their parts of image
+	constexpr const int tileSize = KtlQCanvasTileCache::tileSize;
+	uchar *bits = image.bits();
+	std::vector<KtlQCanvasTileJob> jobs;
+	for (int y = 0; y < area.height(); y += tileSize) {
+		for (int x = 0; x < area.width(); x += tileSize) {
+			const QSize size{
+				std::min(tileSize, area.width() - x),
+				std::min(tileSize, area.height() - y)
+			};
+			jobs.push_back(KtlQCanvasTileJob{
+				QRect{area.topLeft() + QPoint{x, y}, size},
+				QImage{
+					bits + y * image.bytesPerLine() + x * 4,
+					size.width(),
+					size.height(),
+					image.bytesPerLine(),
+					image.format()
+				},
+				QPicture{}
+			});
+		}
+	}
+
+	renderTiles(1.0, jobs);
+}
+
 void KtlQCanvas::drawCanvasArea(const QRect &inarea, QPainter *p) {
-	if ((m_viewList.isEmpty() || !m_viewList.first()) && !p)
-		return; // Nothing to do.
+	if (!p)
+		return; // Views are updated by update() and drawViewArea().
 
 	const auto intersectedArea = inarea.intersect(m_size);
 
@@ -677,49 +876,15 @@ void KtlQCanvas::drawCanvasArea(const QRect &inarea, QPainter *p) {
 		m_chunkSize.bottom()
 	);
 
-  // Stores the region within area that need to be drawn. It is relative
-  // to area.topLeft()  (so as to keep within bounds of 16-bit XRegions)
-	QRegion rgn;
-
 	for (int x = toChunkScaling(intersectedArea.x()); x < mx; ++x) {
 		for (int y = toChunkScaling(intersectedArea.y()); y < my; ++y) {
-			auto &currentChunk = chunk(x, y);
-
-			if (!p) {
-				if (currentChunk.takeChange()) {
-					rgn |= QRegion(
-						x * chunksize - intersectedArea.x(),
-						y * chunksize - intersectedArea.y(),
-						chunksize,
-						chunksize
-					);
-					setNeedRedraw(currentChunk.listPtr());
-				}
-			}
-			else {
-				setNeedRedraw(currentChunk.listPtr());
-			}
+			setNeedRedraw(chunk(x, y).listPtr());
 		}
 	}
 
-	if (p) {
-		drawBackground(*p, intersectedArea);
-		drawChangedItems(*p);
-		drawForeground(*p, intersectedArea);
-		return;
-	}
-
-	QPoint trtr; // keeps track of total translation of rgn
-
-	trtr -= intersectedArea.topLeft();
-
-	for (auto *view : m_viewList) {
-		if (!view->worldMatrix().isIdentity())
-			continue; // Cannot paint those here (see callers).
-
-		// as of my testing, drawing below always fails, so just post for an update event to the widget
-		view->viewport()->update();
-	}
+	drawBackground(*p, intersectedArea);
+	drawChangedItems(*p);
+	drawForeground(*p, intersectedArea);
 }
 
 void KtlQCanvas::setNeedRedraw(const KtlQCanvasItemList *list) {
@@ -754,7 +919,7 @@ void KtlQCanvas::drawChangedItems(QPainter &painter) {
  */
 void KtlQCanvas::setChangedChunk(int x, int y) {
 	if (validChunk(x,y)) {
-		chunk(x, y).change();
+		markChunkChanged(x, y);
 	}
 }
 
@@ -770,7 +935,7 @@ void KtlQCanvas::setChangedChunk(int x, int y) {
  */
 void KtlQCanvas::setChangedChunkContaining(int x, int y) {
 	if (onCanvas(x, y)) {
-		chunkContaining(x, y).change();
+		markChunkChanged(toChunkScaling(x), toChunkScaling(y));
 	}
 }
 
@@ -784,6 +949,7 @@ void KtlQCanvas::setChangedChunkContaining(int x, int y) {
 void KtlQCanvas::addItemToChunk(KtlQCanvasItem *g, int x, int y) {
 	if (validChunk(x, y)) {
 		chunk(x, y).add(g);
+		markChunkChanged(x, y);
 	}
 }
 
@@ -797,6 +963,7 @@ void KtlQCanvas::addItemToChunk(KtlQCanvasItem *g, int x, int y) {
 void KtlQCanvas::removeItemFromChunk(KtlQCanvasItem *g, int x, int y) {
 	if (validChunk(x,y)) {
 		chunk(x, y).remove(g);
+		markChunkChanged(x, y);
 	}
 }
 
@@ -809,7 +976,7 @@ void KtlQCanvas::removeItemFromChunk(KtlQCanvasItem *g, int x, int y) {
  */
 void KtlQCanvas::addItemToChunkContaining(KtlQCanvasItem *g, int x, int y) {
 	if (onCanvas(x, y)) {
-		chunkContaining(x, y).add(g);
+		addItemToChunk(g, toChunkScaling(x), toChunkScaling(y));
 	}
 }
 
@@ -822,7 +989,7 @@ void KtlQCanvas::addItemToChunkContaining(KtlQCanvasItem *g, int x, int y) {
  */
 void KtlQCanvas::removeItemFromChunkContaining(KtlQCanvasItem *g, int x, int y) {
 	if (onCanvas(x, y)) {
-		chunkContaining(x, y).remove(g);
+		removeItemFromChunk(g, toChunkScaling(x), toChunkScaling(y));
 	}
 }
 
@@ -1024,15 +1191,37 @@ void KtlQCanvas::setTile(int x, int y, int tilenum) {
 	}
 }
 
-QList<KtlQCanvasItem *> KtlQCanvas::collisions(const QPoint &p) /* const */ {
+QList<KtlQCanvasItem *> KtlQCanvas::collisions(const QPoint &p) const {
 	return collisions(QPointRect{p});
 }
 
-QList<KtlQCanvasItem *> KtlQCanvas::collisions(const QRect &r) /* const */ {
-	auto i = KtlQCanvasRectangle{r, this}; // TODO verify here, why is crashing ?!
+QList<KtlQCanvasItem *> KtlQCanvas::collisions(const QRect &r) const {
+	// The chunks already index the items by position, so only the items in the
+	// chunks under the rectangle need testing. The rectangle is only used for
+	// the exact tests, so it isn't added to the canvas (which would mark its
+	// chunks as changed on every hover).
+	auto i = KtlQCanvasRectangle{r, nullptr};
 	i.setPen(QPen(Qt::NoPen));
-	i.show(); // doesn't actually show, since we destroy it
-	auto l = i.collisions(true);
+
+	const QRect area = r & rect();
+	if (!area.isValid()) {
+		return {};
+	}
+
+	const int left = toChunkScaling(area.left());
+	const int right = toChunkScaling(area.right());
+	const int top = toChunkScaling(area.top());
+	const int bottom = toChunkScaling(area.bottom());
+
+	QPolygon chunkList((right - left + 1) * (bottom - top + 1));
+	int n = 0;
+	for (int y = top; y <= bottom; ++y) {
+		for (int x = left; x <= right; ++x) {
+			chunkList[n++] = QPoint(x, y);
+		}
+	}
+
+	auto l = collisions(chunkList, &i, true);
 	qSort(l);
 	return l;
 }
@@ -1049,9 +1238,13 @@ QList<KtlQCanvasItem *> KtlQCanvas::collisions(const QPolygon &chunklist, const
 		qDebug() << "end canvas item list";
 	}
 
-  QSet<KtlQCanvasItem *> seen;
+	QSet<KtlQCanvasItem *> seen;
 	QList<KtlQCanvasItem *> result;
 
+	// Items can only collide if their bounding rectangles intersect, which is
+	// much cheaper to check than their areas
+	const QRect itemBounds = exact ? item->boundingRect() : QRect();
+
 	for (int i : Times{chunklist.count()}) {
 		const auto &currentChunk = chunklist[i];
 		const int x = currentChunk.x();
@@ -1068,11 +1261,13 @@ QList<KtlQCanvasItem *> KtlQCanvas::collisions(const QPolygon &chunklist, const
 			if (!canvasItem) continue;
 			if (canvasItem == item) continue;
 
-			if (seen.insert(canvasItem) == seen.end()) {
+			// Items spanning several chunks are only tested once
+			if (seen.contains(canvasItem)) {
 				continue;
 			}
+			seen.insert(canvasItem);
 
-			if (!exact || item->collidesWith(canvasItem)) {
+			if (!exact || (itemBounds.intersects(canvasItem->boundingRect()) && item->collidesWith(canvasItem))) {
 				result.append(canvasItem);
 			}
 
@@ -4,17 +4,22 @@
 
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "ktlqt3support/ktlq3scrollview.h"
 #include <QPixmap>
 #include <QBrush>
 #include <QPen>
+#include <QImage>
 #include <QList>
+#include <QRegion>
 
 #include "canvasitemlist.h"
 
 class KtlQCanvasView;
 class KtlQCanvasChunk;
+class KtlQCanvasTileCache;
+struct KtlQCanvasTileJob;
 
 class KtlQCanvas : public QObject {
 	Q_OBJECT
@@ -73,8 +78,8 @@ class KtlQCanvas : public QObject {
 		void removeItemFromChunkContaining(KtlQCanvasItem *, int x, int y);
 
 		KtlQCanvasItemList allItems() const;
-		QList<KtlQCanvasItem *> collisions( const QPoint & ) /* const */ ;
-		QList<KtlQCanvasItem *> collisions( const QRect & ) /* const */;
+		QList<KtlQCanvasItem *> collisions( const QPoint & ) const;
+		QList<KtlQCanvasItem *> collisions( const QRect & ) const;
 		QList<KtlQCanvasItem *> collisions(
 			const QPolygon &pa,
 			const KtlQCanvasItem *item,
@@ -82,12 +87,31 @@ class KtlQCanvas : public QObject {
 		) const;
 
 		void drawArea(const QRect &, QPainter *p);
+		/**
+		 * Paints area of the canvas into image, with the top left of the area
+		 * at the top left of the image. The area is cut into tiles that are
+		 * rasterised on the thread pool. image must be as large as the area,
+		 * and in one of the 32 bit RGB formats.
+		 */
+		void drawArea(const QRect &area, QImage &image);
 
 		// These are for KtlQCanvasView to call
 		virtual void addView(KtlQCanvasView *);
 		virtual void removeView(KtlQCanvasView *);
 		void drawCanvasArea(const QRect &, QPainter *p);
+		/**
+		 * Paints the contents area r of the view. For views that are only
+		 * zoomed and scrolled (so all of them in KTechLab), this is done by
+		 * copying tiles from the view's zoom level's tile cache, and items
+		 * are only painted into the parts of tiles that have changed since
+		 * they were last painted.
+		 */
 		void drawViewArea( KtlQCanvasView *view, QPainter *p, const QRect &r );
+		/**
+		 * @return whether the canvas is being painted for a view (rather than
+		 * for exporting or printing), for drawBackground and drawForeground.
+		 */
+		bool isPaintingView() const { return m_bPaintingView; }
 
 		// These are for KtlQCanvasItem to call
 		virtual void addItem(KtlQCanvasItem *);
@@ -119,9 +143,39 @@ class KtlQCanvas : public QObject {
 		KtlQCanvasChunk & chunk(int i, int j) const;
 		KtlQCanvasChunk & chunkContaining(int x, int y) const;
 
-		QRect changeBounds(const QRect &inarea);
-		void drawChanges(const QRect &inarea);
+		/**
+		 * Marks chunk (x, y) as changed, and remembers it for the next update.
+		 */
+		void markChunkChanged(int x, int y);
+		/**
+		 * Marks the parts of the tiles under the chunks that changed since
+		 * this was last called as dirty, and remembers them for update() to
+		 * repaint in the views. Doesn't touch the views itself, so it can be
+		 * called before painting.
+		 */
+		void invalidateTiles();
 		void drawChangedItems( QPainter &painter );
+		/**
+		 * Paints a view with a transformation other than zooming and
+		 * scrolling, without the tile caches.
+		 */
+		void drawViewAreaDirect( KtlQCanvasView *view, QPainter *p, const QRect &r );
+		/**
+		 * @return the tile cache for the view's zoom level, or null if the
+		 * view can't use tiles.
+		 */
+		KtlQCanvasTileCache * tileCache( const KtlQCanvasView *view );
+		/**
+		 * Paints the canvas, scaled by scale, into the images of the jobs.
+		 * If there is enough to do, the canvas is recorded on this thread
+		 * and then rasterised on the thread pool; otherwise it is painted
+		 * into the images directly.
+		 */
+		void renderTiles( qreal scale, std::vector<KtlQCanvasTileJob> &jobs );
+		/**
+		 * @return the view contents position of pixel (0, 0) of the tiles.
+		 */
+		static QPoint tileOrigin( const KtlQCanvasView *view );
 		void setNeedRedraw( const KtlQCanvasItemList *list );
 
 		void initTiles(const QPixmap &p, int h, int v, int tilewidth, int tileheight);
@@ -133,6 +187,18 @@ class KtlQCanvas : public QObject {
 		QRect m_size;
 		QRect m_chunkSize;
 		std::unique_ptr<KtlQCanvasChunk[]> chunks;
+		/// Chunks that have changed since the last update
+		std::vector<QPoint> m_changedChunks;
+		/// Whether everything has changed since the last update
+		bool m_bAllChanged = true;
+		/// Tile caches by zoom level
+		std::map<qreal, std::unique_ptr<KtlQCanvasTileCache>> m_tileCaches;
+		/// The pixels (by zoom level) that the views have to repaint on the next update
+		std::map<qreal, QRegion> m_pendingRepaint;
+		/// Whether the views have to be repainted entirely on the next update
+		bool m_bRepaintAll = false;
+		/// Whether views without tiles have to be repainted on the next update
+		bool m_bRepaintUncached = false;
 		QTimer *update_timer = nullptr;
 		std::unique_ptr<ushort[]> grid;
 		QColor bgcolor = Qt::white;
@@ -145,6 +211,7 @@ class KtlQCanvas : public QObject {
 		ushort tileh = 0;
 		bool oneone = false;
 		bool debug_redraw_areas = false;
+		bool m_bPaintingView = false;
 
 		friend void qt_unview(KtlQCanvas *c);
 
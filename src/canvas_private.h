@@ -3,7 +3,10 @@
 #include "pch.hpp"
 
 #include <QBitmap>
+#include <QHash>
 #include <QImage>
+#include <QPicture>
+#include <QRegion>
 
 #include "ktlq3polygonscanner.h"
 
@@ -103,32 +106,6 @@ public:
 	bool repaint_from_moving = false;
 };
 
-class KtlQCanvasClusterizer {
-public:
-	KtlQCanvasClusterizer(int maxClusters);
-
-	void add(int x, int y); // 1x1 rectangle (point)
-	void add(const QPoint &point);
-	void add(int x, int y, int w, int h);
-	void add(const QRect &rect);
-
-	void clear();
-	int count() const { return count_; }
-	const QRect & operator [] (int i) const {
-		assert(i <= capacity);
-		return clusters.get()[i];
-	}
-	QRect & operator [] (int i) {
-		assert(i <= capacity);
-		return clusters.get()[i];
-	}
-
-private:
-	const std::unique_ptr<QRect[]> clusters;
-	int count_ = 0;
-	const int capacity = 0;
-};
-
 class KtlQCanvasItemPtr {
 public:
 	KtlQCanvasItemPtr() = default;
@@ -185,16 +162,20 @@ public:
 
 	void add(KtlQCanvasItem *item) {
 		list.prepend(item);
-		changed = true;
 	}
 
 	void remove(KtlQCanvasItem *item) {
 		list.removeAll(item);
-		changed = true;
 	}
 
-	void change() {
+	/**
+	 * Marks the chunk as changed.
+	 * @return true if it wasn't already.
+	 */
+	bool change() {
+		const auto result = !changed;
 		changed = true;
+		return result;
 	}
 
 	bool hasChanged() const {
@@ -212,6 +193,88 @@ private:
 	bool changed = true;
 };
 
+/**
+Images of the canvas at one scale (zoom level), cut into square tiles and
+shared by all of the views at that scale. Tile (x, y) shows the canvas area
+that the scale maps to the pixels from (x, y) * tileSize to
+(x + 1, y + 1) * tileSize - 1, so that tiles stay valid when the canvas is
+resized or scrolled. When chunks under a tile change, only their pixels are
+marked dirty, and just those are painted again when the tile is next used.
+*/
+class KtlQCanvasTileCache {
+public:
+	static constexpr const int tileSize = 256;
+	/// 64 MiB of tiles, which is several screens' worth
+	static constexpr const int maxTiles = 256;
+
+	struct Tile {
+		QImage image;
+		/// The pixels (at the cache's scale) that are out of date
+		QRegion dirty;
+		uint64 lastUsed = 0;
+	};
+
+	explicit KtlQCanvasTileCache(qreal scale) : m_scale(scale) {}
+
+	qreal scale() const { return m_scale; }
+
+	/**
+	 * @return the tile at (x, y), or null if it has to be rendered.
+	 */
+	const Tile * find(int x, int y);
+	/**
+	 * Removes the tile at (x, y) and returns it (with a null image if there
+	 * wasn't one), so that it can be painted into without copying it.
+	 */
+	Tile take(int x, int y) { return m_tiles.take(key(x, y)); }
+	/**
+	 * Adds the tile at (x, y), throwing away the least recently used tile if
+	 * the cache is full.
+	 */
+	void insert(int x, int y, const QImage &image);
+	/**
+	 * Marks the given pixels (at this scale) as dirty in the tiles that
+	 * cover them.
+	 */
+	void invalidate(const QRect &scaledRect);
+	void clear() { m_tiles.clear(); }
+
+	/**
+	 * @return the pixels (at this scale) that show the given canvas area.
+	 */
+	QRect scaledRect(const QRect &area) const;
+	/**
+	 * @return the (inclusive) range of tiles that cover the given pixels.
+	 */
+	static QRect tilesCovering(const QRect &scaledRect);
+
+private:
+	static quint64 key(int x, int y) {
+		return (quint64(quint32(x)) << 32) | quint32(y);
+	}
+
+	QHash<quint64, Tile> m_tiles;
+	uint64 m_useCount = 0;
+	const qreal m_scale;
+};
+
+/**
+One piece of a canvas repaint. The canvas (at some scale) is painted straight
+into image, or, when the repaint is shared between threads, recorded into
+picture on the GUI thread and then played into image on any thread - unless
+the picture draws pixmaps, which may only be used on the GUI thread.
+*/
+struct KtlQCanvasTileJob {
+	/// The pixels (at the repaint's scale) that image shows
+	QRect rect;
+	QImage image;
+	QPicture picture;
+	/// The pixels of rect to paint, or all of them if this is empty
+	QRegion dirty;
+	/// Whether picture has to be played on the GUI thread
+	bool guiThreadOnly = false;
+};
+
 class KtlQCanvasPolygonScanner : public KtlQ3PolygonScanner {
 	KtlQPolygonalProcessor &processor;
 
@@ -105,6 +105,7 @@ class Text : public GuiPart
 		 * has changed.
 		 */
 		bool setText( const QString &text );
+		QString text() const { return m_text; }
 		QRect recommendedRect() const override;
 		void drawShape ( QPainter &p ) override;
 		/**
@@ -25,6 +25,7 @@
 #include "resizeoverlay.h"
 
 #include "utils.h"
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 
@@ -35,7 +36,9 @@
 #include <ksharedconfig.h>
 
 #include <qcursor.h>
+#include <qguiapplication.h>
 #include <qpainter.h>
+#include <qscreen.h>
 #include <qtimer.h>
 
 // FIXME: This source file is HUUUGE!!!, contains numerous clases, should be broken down.
@@ -911,6 +914,18 @@ CMItemMove::CMItemMove( ItemDocument *itemDocument, CMManager *cmManager )
 {
 	p_flowContainerCandidate = 0l;
 	m_bItemsSnapToGrid = false;
+	m_bMovePending = false;
+	m_dx = m_dy = 0;
+
+	// Pace the moves to the display, rather than to the mouse
+	const QScreen *screen = QGuiApplication::primaryScreen();
+	const qreal refreshRate = (screen && screen->refreshRate() > 0) ? screen->refreshRate() : 60.0;
+
+	m_pFrameTimer = new QTimer(this);
+	m_pFrameTimer->setSingleShot(true);
+	m_pFrameTimer->setTimerType(Qt::PreciseTimer);
+	m_pFrameTimer->setInterval( std::max( 1, int(1000.0 / refreshRate) ) );
+	connect( m_pFrameTimer, SIGNAL(timeout()), this, SLOT(slotApplyPendingMove()) );
 }
 
 CMItemMove::~CMItemMove()
@@ -1046,7 +1061,24 @@ void CMItemMove::scrollCanvasToSelection()
 
 bool CMItemMove::mouseMoved( const EventInfo &eventInfo )
 {
-	QPoint pos = eventInfo.pos;
+	m_pendingPos = eventInfo.pos;
+	m_bMovePending = true;
+
+	// If a frame has passed since the last move, there is no need to wait
+	if ( !m_pFrameTimer->isActive() )
+		slotApplyPendingMove();
+
+	return false;
+}
+
+
+void CMItemMove::slotApplyPendingMove()
+{
+	if ( !m_bMovePending )
+		return;
+	m_bMovePending = false;
+
+	QPoint pos = m_pendingPos;
 
 	QPoint snapPoint = pos;
 	if ( m_bItemsSnapToGrid )
@@ -1099,14 +1131,15 @@ bool CMItemMove::mouseMoved( const EventInfo &eventInfo )
 		p_flowContainerCandidate->setSelected(true);
 	}
 
-	p_itemDocument->requestEvent( ItemDocument::ItemDocumentEvent::ResizeCanvasToItems );
+	// The canvas is resized to the items when the drag ends, as resizing
+	// it (and updating the scrollbars) on every move is far from free
 	p_canvas->update();
 	m_prevPos = pos;
 	m_prevSnapPoint = snapPoint;
 
 // 	scrollCanvasToSelection();
 
-	return false;
+	m_pFrameTimer->start();
 }
 
 
@@ -1116,6 +1149,10 @@ bool CMItemMove::mouseReleased( const EventInfo &eventInfo )
 	if ( eventInfo.isRightClick || eventInfo.isMiddleClick )
 		return false;
 
+	// Finish any move that is waiting for the next frame
+	slotApplyPendingMove();
+	m_pFrameTimer->stop();
+
 	QStringList itemIDs;
 
 	const QPtrList<Item> itemList = p_cnItemSelectList->items();
@@ -1168,6 +1205,8 @@ bool CMItemMove::mouseReleased( const EventInfo &eventInfo )
 
 bool CMItemMove::mousePressedRepeat( const EventInfo & info )
 {
+	slotApplyPendingMove();
+
 	if ( info.isRightClick )
 		p_cnItemSelectList->slotRotateCW();
 	else if ( info.isMiddleClick )
@@ -382,6 +382,8 @@ protected:
 */
 class CMItemMove : public CanvasManipulator
 {
+	Q_OBJECT
+
 public:
 	CMItemMove( ItemDocument *itemDocument, CMManager *cmManager );
 	~CMItemMove() override;
@@ -396,11 +398,23 @@ public:
 	bool mouseReleased( const EventInfo &info ) override;
 	bool mousePressedRepeat( const EventInfo & info ) override;
 
+protected slots:
+	/**
+	 * Moves the selection to the last mouse position given to mouseMoved.
+	 * Mouse moves are only applied once per display frame, so however many
+	 * move events arrive, the items are moved and the canvas is redrawn at
+	 * most that often. The canvas is only resized once the drag ends.
+	 */
+	void slotApplyPendingMove();
+
 protected:
 	void canvasResized( const QRect & oldSize, const QRect & newSize ) override;
 	void scrollCanvasToSelection();
 
 	QPoint m_prevSnapPoint;
+	QPoint m_pendingPos;
+	bool m_bMovePending;
+	QTimer *m_pFrameTimer;
 	bool m_bItemsSnapToGrid; ///< true iff selection contains CNItems
 	int m_dx;
 	int m_dy;
@@ -11,6 +11,77 @@
 #include "cells.h"
 #include "utils.h"
 
+#include <algorithm>
+
+
+//BEGIN class CellQueue
+void CellQueue::clear()
+{
+	if ( m_size > 0 )
+	{
+		for ( size_t i = m_current; i <= m_highest; ++i )
+			m_buckets[i].clear();
+	}
+
+	m_current = 0;
+	m_highest = 0;
+	m_size = 0;
+}
+
+
+void CellQueue::push( unsigned priority, short x, short y )
+{
+	size_t bucket = std::max<size_t>( priority, m_current );
+	if ( bucket >= m_buckets.size() )
+		m_buckets.resize( bucket + 1 );
+
+	m_buckets[bucket].push_back( Entry{ x, y } );
+	m_highest = std::max( m_highest, bucket );
+	++m_size;
+}
+
+
+bool CellQueue::pop( short &x, short &y )
+{
+	if ( m_size == 0 )
+		return false;
+
+	while ( m_buckets[m_current].empty() )
+		++m_current;
+
+	const Entry entry = m_buckets[m_current].back();
+	m_buckets[m_current].pop_back();
+	--m_size;
+
+	x = entry.x;
+	y = entry.y;
+	return true;
+}
+//END class CellQueue
+
+
+//BEGIN class CellSearch
+CellSearch::CellSearch( const QRect &cellsRect ) :
+	m_cellsRect( cellsRect ),
+	m_states( size_t(cellsRect.width()) * size_t(cellsRect.height()) )
+{
+}
+
+
+void CellSearch::begin()
+{
+	if ( ++m_epoch == 0 )
+	{
+		// Wrapped around; make sure no cell can claim to be from the new search
+		for ( State &s : m_states )
+			s.epoch = 0;
+		m_epoch = 1;
+	}
+
+	m_queue.clear();
+}
+//END class CellSearch
+
 
 //BEGIN class Cells
 Cells::Cells(const QRect &canvasRect)
@@ -52,7 +123,8 @@ Cells::Cells(const Cells &c)
 
 Cells::Cells(Cells &&c) :
 	m_cellsRect(c.m_cellsRect),
-	m_cells(c.m_cells)
+	m_cells(c.m_cells),
+	m_searches(std::move(c.m_searches))
 {
 	c.m_cellsRect = {};
 	c.m_cells = nullptr;
@@ -67,6 +139,7 @@ void Cells::init( const QRect & canvasRect )
 		delete [] m_cells;
 	}
 
+	m_searches.clear();
 	m_cellsRect = QRect( roundDown( canvasRect.topLeft(), 8 ), canvasRect.size()/8 ).normalized();
 
 	auto w = m_cellsRect.width();
@@ -81,17 +154,21 @@ void Cells::init( const QRect & canvasRect )
 }
 
 
-void Cells::reset()
+CellSearch & Cells::search()
 {
-	if (!m_cells) return;
+	return workerSearch( -1 );
+}
 
-	auto w = m_cellsRect.width();
-	auto h = m_cellsRect.height();
 
-	for (decltype(w) i = 0; i < w; i++)
-	{
-		for (decltype(h) j = 0; j < h; j++)
-			m_cells[i][j].reset();
-	}
+CellSearch & Cells::workerSearch( int index )
+{
+	const size_t i = index + 1;
+	if ( i >= m_searches.size() )
+		m_searches.resize( i + 1 );
+
+	if ( !m_searches[i] )
+		m_searches[i] = std::make_unique<CellSearch>( m_cellsRect );
+
+	return *m_searches[i];
 }
 //END class Cells
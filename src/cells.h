@@ -12,23 +12,14 @@
 
 #include <limits>
 #include <cassert>
-#include <map>
+#include <cstddef>
+#include <memory>
+#include <vector>
 #include <qrect.h>
 #include "utils.h"
 
 static constexpr const short startCellPos = -(1 << 14);
 
-struct Point
-{
-	short x = startCellPos;
-	short y = startCellPos;
-	short prevX = startCellPos;
-	short prevY = startCellPos;
-};
-
-// Key = cell, data = previous cell, compare = score
-using TempLabelMap = std::multimap<unsigned short, Point>;
-
 /**
 @short Used for mapping out connections
 */
@@ -37,20 +28,6 @@ struct Cell
 	using score_t = unsigned short;
 	static constexpr const auto max_score = std::numeric_limits<score_t>::max();
 
-	/**
-	 * Resets bestScore, prevX, prevY, addedToLabels, it, permanent for
-	 * each cell.
-	 */
-	void reset() {
-		addedToLabels = Cell{}.addedToLabels;
-		permanent = Cell{}.permanent;
-		bestScore = Cell{}.bestScore;
-	}
-
-	/**
-	 * Pointer to the point in the TempLabelMap.
-	 */
-	Point *point = nullptr;
 	/**
 	 * 'Penalty' of using the cell from CNItem.
 	 */
@@ -59,28 +36,110 @@ struct Cell
 	 * 'Penalty' of using the cell from Connector.
 	 */
 	score_t Cpenalty = 0;
-	/**
-	 * Best (lowest) score so far, _the_ best if it is permanent.
-	 */
-	score_t bestScore = max_score;
 	/**
 	 * Number of connectors through that point.
 	 */
 	unsigned short numCon = 0;
-	/**
-	 * Which cell this came from, (startCellPos,startCellPos) if originating
-	 * cell.
-	 */
-	short prevX, prevY;
-	/**
-	 * Whether the score can be improved on.
-	 */
-	bool permanent = false;
-	/**
-	 * Whether the cell has already been added to the list of cells to
-	 * check.
-	 */
-	bool addedToLabels = false;
+};
+
+/**
+@short Priority queue of cells for ConRouter.
+
+The priorities of a route search never drop below that of the last popped
+cell, so cells are kept in one bucket per priority and the queue only ever
+scans forward. Buckets keep their memory between searches.
+*/
+class CellQueue
+{
+	public:
+		/**
+		 * Removes all cells and sets the lowest priority back to zero.
+		 */
+		void clear();
+		bool empty() const { return m_size == 0; }
+		/**
+		 * Adds the cell (x,y). Priorities below that of the last popped cell
+		 * are treated as equal to it.
+		 */
+		void push( unsigned priority, short x, short y );
+		/**
+		 * Removes one of the cells with the lowest priority.
+		 * @return false if the queue is empty.
+		 */
+		bool pop( short &x, short &y );
+
+	private:
+		struct Entry
+		{
+			short x, y;
+		};
+
+		std::vector<std::vector<Entry>> m_buckets;
+		size_t m_current = 0;
+		size_t m_highest = 0;
+		size_t m_size = 0;
+};
+
+/**
+@short State of the route searches of ConRouter over Cells.
+
+This is kept apart from the cell penalties, so that several routes can be
+searched for at once over the same Cells, each with its own CellSearch.
+Each entry remembers the search that last used it, so that starting a new
+search does not need to go over every cell.
+*/
+class CellSearch
+{
+	public:
+		struct State
+		{
+			/**
+			 * Best (lowest) score so far, _the_ best if it is permanent.
+			 */
+			Cell::score_t bestScore;
+			/**
+			 * Which cell this came from, (startCellPos,startCellPos) if
+			 * originating cell.
+			 */
+			short prevX, prevY;
+			/**
+			 * The search that last used this cell.
+			 */
+			unsigned epoch = 0;
+			/**
+			 * Whether the score can be improved on.
+			 */
+			bool permanent;
+		};
+
+		CellSearch( const QRect &cellsRect );
+
+		/**
+		 * Starts a new search, invalidating the state of all cells.
+		 */
+		void begin();
+		/**
+		 * @return the state of the given cell in the current search.
+		 */
+		State & state( int i, int j )
+		{
+			State &s = m_states[ (i - m_cellsRect.left()) * m_cellsRect.height() + (j - m_cellsRect.top()) ];
+			if ( s.epoch != m_epoch ) {
+				s.epoch = m_epoch;
+				s.bestScore = Cell::max_score;
+				s.prevX = s.prevY = startCellPos;
+				s.permanent = false;
+			}
+			return s;
+		}
+
+		CellQueue & queue() { return m_queue; }
+
+	private:
+		QRect m_cellsRect;
+		std::vector<State> m_states;
+		unsigned m_epoch = 0;
+		CellQueue m_queue;
 };
 
 /**
@@ -93,9 +152,16 @@ class Cells
 		Cells(Cells &&);
 		~Cells();
 		/**
-		 * Resets bestScore, prevX, prevY, addedToLabels, it, permanent for each cell
-	 	*/
-		void reset();
+		 * The search state used for routing on the GUI thread.
+		 */
+		CellSearch & search();
+		/**
+		 * Additional search states for routing on other threads. Get them
+		 * on the GUI thread before starting the workers, and don't change
+		 * the cells while they run.
+		 * @param index number of the worker thread.
+		 */
+		CellSearch & workerSearch( int index );
 
 		const QRect & cellsRect() const { return m_cellsRect; }
 
@@ -147,6 +213,7 @@ class Cells
 
 		QRect m_cellsRect;
 		Cell **m_cells = nullptr;
+		std::vector<std::unique_ptr<CellSearch>> m_searches;
 
 	private:
 		Cells(const Cells &);
@@ -12,6 +12,7 @@
 #include "circuitview.h"
 #include "config.h"
 #include "ktechlab.h"
+#include "simulationprofiler.h"
 #include "simulator.h"
 #include "viewiface.h"
 
@@ -19,6 +20,7 @@
 #include <kicon.h>
 #include <klocalizedstring.h>
 #include <kactioncollection.h>
+#include <ktoggleaction.h>
 #include <klocalizedstring.h>
 
 #include <qaction.h>
@@ -41,6 +43,23 @@ CircuitView::CircuitView( CircuitDocument *circuitDocument, ViewContainer *viewC
         ac->addAction(a->objectName(), a);
     }
 
+	//BEGIN Simulation Profiling Actions
+    {
+        KToggleAction *pa = new KToggleAction( QIcon::fromTheme("chronometer"), i18n("Profile Simulation"), ac);
+        pa->setObjectName("simulation_profile");
+        pa->setChecked( SimulationProfiler::self()->isEnabled() );
+        connect(pa, SIGNAL(toggled(bool)), SimulationProfiler::self(), SLOT(setEnabled(bool)));
+        connect(SimulationProfiler::self(), SIGNAL(enabledChanged(bool)), pa, SLOT(setChecked(bool)));
+        ac->addAction(pa->objectName(), pa);
+    }
+    {
+        QAction *pa = new QAction( QIcon::fromTheme("document-export"), i18n("Export Simulation Profile..."), ac);
+        pa->setObjectName("simulation_profile_export");
+        connect(pa, SIGNAL(triggered(bool)), circuitDocument, SLOT(exportProfile()));
+        ac->addAction(pa->objectName(), pa);
+    }
+	//END Simulation Profiling Actions
+
 	//BEGIN Item Control Actions
 	//QAction * ra; // 2017.10.01 - commented unused variable
     {
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace KTechLab {
+	/**
+	 * Fixed size, lock-free queue for passing values from exactly one producer
+	 * thread to exactly one consumer thread. Neither side ever blocks: push
+	 * fails when the queue is full and pop fails when it is empty.
+	 */
+	template <typename T, std::size_t Capacity>
+	class SpscQueue final {
+		static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+		public:
+		/**
+		 * Producer side.
+		 * @return false (and drops value) if the queue is full.
+		 */
+		bool push(const T &value) {
+			const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_head.load(std::memory_order_acquire) == Capacity) {
+				return false;
+			}
+
+			m_items[tail & (Capacity - 1)] = value;
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * Consumer side.
+		 * @return false if the queue is empty, otherwise moves the oldest value to value.
+		 */
+		bool pop(T &value) {
+			const std::size_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tail.load(std::memory_order_acquire)) {
+				return false;
+			}
+
+			value = std::move(m_items[head & (Capacity - 1)]);
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * Empties the queue. Only safe while neither side is being used.
+		 */
+		void clear() {
+			m_head.store(m_tail.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		private:
+		std::array<T, Capacity> m_items;
+		// Kept on separate cache lines so the two threads don't contend
+		alignas(64) std::atomic<std::size_t> m_head = { 0 };
+		alignas(64) std::atomic<std::size_t> m_tail = { 0 };
+	};
+}
@@ -403,17 +403,46 @@ void Connector::rerouteConnector() {
 	if (!startNode() || !endNode()) return;
 
 	updateConnectorPoints(false);
+	mapRoute(p_icnDocument->cells()->search());
+	applyRoute();
+}
+
+
+void Connector::mapRoute(CellSearch &search) {
+	if (!startNode() || !endNode()) return;
 
 	m_conRouter->mapRoute(int(startNode()->x()),
 			      int(startNode()->y()),
 			      int(endNode()->x()),
-                              int(endNode()->y()));
+			      int(endNode()->y()),
+			      search);
+}
+
 
+void Connector::applyRoute() {
 	b_manualPoints = false;
 	updateConnectorPoints(true);
 }
 
 
+int Connector::routePenalty() const {
+	return m_conRouter->routePenalty();
+}
+
+
+bool Connector::routeCrossesItems() const {
+	const Cells *cells = p_icnDocument->cells();
+	if (!cells) return true;
+
+	for (const QPoint &p : *m_conRouter->cellPointList()) {
+		if (cells->haveCell(p.x(), p.y()) && cells->cell(p.x(), p.y()).CIpenalty >= ICNDocument::hs_item)
+			return true;
+	}
+
+	return false;
+}
+
+
 void Connector::translateRoute(int dx, int dy) {
 	updateConnectorPoints(false);
 	m_conRouter->translateRoute(dx, dy);
@@ -527,7 +556,7 @@ QList<QPoint> Connector::connectorPoints(bool reverse) const {
 }
 
 
-void Connector::incrementCurrentAnimation(double deltaTime) {
+bool Connector::incrementCurrentAnimation(double deltaTime) {
 	// The values and equations used in this function have just been developed
 	// empircally to be able to show a nice range of currents while still giving
 	// a good indication of the amount of current flowing
@@ -535,6 +564,8 @@ void Connector::incrementCurrentAnimation(double deltaTime) {
 	double I_min = 1e-4;
 	double sf    = 3.0; // scaling factor
 
+	const int previousOffset = int(m_currentAnimationOffset);
+
 	for (int i = 0; i < m_wires.size(); ++i) {
 		if (!m_wires[i]) continue;
 
@@ -545,6 +576,20 @@ void Connector::incrementCurrentAnimation(double deltaTime) {
 
 		m_currentAnimationOffset += deltaTime * sf * std::pow(prop, 1.3) * sign;
 	}
+
+	// ConnectorLine::drawShape only uses the whole pixels of the offset
+	return int(m_currentAnimationOffset) != previousOffset;
+}
+
+
+bool Connector::voltageColorChanged() {
+	if (!KTLConfig::showVoltageColor()) return false;
+
+	const QRgb color = Component::voltageColor(wire() ? wire()->voltage() : 0.0).rgb();
+	if (color == m_lastVoltageColor) return false;
+
+	m_lastVoltageColor = color;
+	return true;
 }
 //END class Connector
 
@@ -19,6 +19,7 @@
 // #include <q3valuevector.h>
 
 struct Cell;
+class CellSearch;
 class ConnectorData;
 class ConnectorLine;
 class ConRouter;
@@ -161,6 +162,32 @@ public:
 	 */
 	void rerouteConnector();
 
+	/**
+	 * Maps a new route between the nodes using the given search state. This
+	 * only changes the route stored in the connector (and not the cells or
+	 * canvas), so may be called from worker threads while the cells of the
+	 * ICNDocument are left alone. The connector is switched to the new route
+	 * with applyRoute(). Call updateConnectorPoints(false) beforehand.
+	 */
+	void mapRoute(CellSearch &search);
+
+	/**
+	 * Switches the connector to the automatic route found by mapRoute().
+	 */
+	void applyRoute();
+
+	/**
+	 * @returns the sum of the cell penalties along the route.
+	 */
+	int routePenalty() const;
+
+	/**
+	 * @returns whether the route goes through any of the cells covered by
+	 * a CNItem, as added with CNItem::updateConnectorPoints. This is a much
+	 * cheaper test than checking the canvas collisions.
+	 */
+	bool routeCrossesItems() const;
+
 	/**
 	 * Translates the route by the given amoumt. No checking is done to see if
 	 * the translation is useful, etc.
@@ -186,8 +213,16 @@ public:
 	/**
 	 * Increases the currentAnimationOffset according to the current flowing in
 	 * the connector and deltaTime.
+	 * @return whether the animation moved by at least a pixel, and so needs
+	 * to be redrawn.
+	 */
+	bool incrementCurrentAnimation(double deltaTime);
+	/**
+	 * @return whether the colour used to show the voltage of the connector
+	 * has changed since this was last called (always false when voltage
+	 * colouring is off).
 	 */
-	void incrementCurrentAnimation(double deltaTime);
+	bool voltageColorChanged();
 
 signals:
 	void removed(Connector *connector);
@@ -211,6 +246,7 @@ private:
 	bool b_pointsAdded;
 
 	double m_currentAnimationOffset;
+	QRgb m_lastVoltageColor = 0;
 
 	NodeGroup   *p_nodeGroup;
 	CNItem      *p_parentContainer;
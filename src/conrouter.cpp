@@ -16,6 +16,7 @@
 #include <cassert>
 #include <cstdlib>
 #include <cmath>
+#include <algorithm>
 
 ConRouter::ConRouter( ICNDocument *cv )
 {
@@ -155,64 +156,61 @@ QList<QList<QPoint>> ConRouter::dividePoints( uint n ) const
 }
 
 
-void ConRouter::checkACell( int x, int y, Cell *prev, int prevX, int prevY, int nextScore )
+void ConRouter::checkACell( int x, int y, const CellSearch::State &prev, int prevX, int prevY, int nextScore )
 {
 // 	if ( !p_icnDocument->isValidCellReference(x,y) ) return;
 	if ( !cellsPtr->haveCell( x, y ) )
 		return;
 
-	Cell * c = &cellsPtr->cell( x, y );
-	if ( c->permanent )
+	CellSearch::State &s = m_search->state( x, y );
+	if ( s.permanent )
 		return;
 
-	int newScore = nextScore + c->CIpenalty + c->Cpenalty;
+	const Cell &c = cellsPtr->cell( x, y );
+	int newScore = nextScore + c.CIpenalty + c.Cpenalty;
 
 	// Check for changing direction
-	if		( x != prevX && prev->prevX == prevX ) newScore += 5;
-	else if ( y != prevY && prev->prevY == prevY ) newScore += 5;
+	if		( x != prevX && prev.prevX == prevX ) newScore += bendPenalty;
+	else if ( y != prevY && prev.prevY == prevY ) newScore += bendPenalty;
 
-	if ( c->bestScore < newScore )
+	// Don't let the score wrap around on huge canvases
+	newScore = std::min<int>( newScore, Cell::max_score - 1 );
+
+	if ( s.bestScore < newScore )
 		return;
 
 	// We only want to change the previous cell if the score is different,
 	// or the score is the same but this cell allows the connector
 	// to travel in the same direction
 
-	if ( c->bestScore == newScore &&
+	if ( s.bestScore == newScore &&
 		 x != prevX &&
 		 y != prevY ) return;
 
-	c->bestScore = newScore;
-	c->prevX = prevX;
-	c->prevY = prevY;
-
-	if ( !c->addedToLabels ) {
-		c->addedToLabels = true;
-		Point point;
-		point.x = x;
-		point.y = y;
-		point.prevX = prevX;
-		point.prevY = prevY;
-		TempLabelMap::iterator it = tempLabels.insert( std::make_pair(newScore,point) );
-		c->point = &it->second;
-	} else {
-		c->point->prevX = prevX;
-		c->point->prevY = prevY;
-	}
+	const bool improved = s.bestScore != newScore;
+
+	s.bestScore = newScore;
+	s.prevX = prevX;
+	s.prevY = prevY;
+
+	// Cells are queued again when their score improves; the stale entries
+	// are skipped when popped as the cell is then already permanent.
+	if ( improved )
+		m_search->queue().push( newScore + heuristic( x, y ), x, y );
 }
 
 void ConRouter::checkCell( int x, int y )
 {
-	Cell * c = &cellsPtr->cell( x, y );
+	CellSearch::State &s = m_search->state( x, y );
 
-	c->permanent = true;
-	int nextScore = c->bestScore+1;
+	s.permanent = true;
+	int nextScore = s.bestScore+1;
 
 	// Check the surrounding cells (up, left, right, down)
-	checkACell( x, y-1, c, x, y, nextScore );
-	checkACell( x-1, y, c, x, y, nextScore );
-	checkACell( x+1, y, c, x, y, nextScore );
-	checkACell( x, y+1, c, x, y, nextScore );
+	checkACell( x, y-1, s, x, y, nextScore );
+	checkACell( x-1, y, s, x, y, nextScore );
+	checkACell( x+1, y, s, x, y, nextScore );
+	checkACell( x, y+1, s, x, y, nextScore );
 }
 
 
@@ -310,6 +308,12 @@ void ConRouter::translateRoute( int dx, int dy )
 
 
 void ConRouter::mapRoute( int sx, int sy, int ex, int ey )
+{
+	mapRoute( sx, sy, ex, ey, p_icnDocument->cells()->search() );
+}
+
+
+void ConRouter::mapRoute( int sx, int sy, int ex, int ey, CellSearch &search )
 {
 	const int scx = fromCanvas(sx);
 	const int scy = fromCanvas(sy);
@@ -317,6 +321,7 @@ void ConRouter::mapRoute( int sx, int sy, int ex, int ey )
 	const int ecy = fromCanvas(ey);
 
 	cellsPtr = p_icnDocument->cells();
+	m_search = &search;
 
 	if ( !cellsPtr->haveCell( scx, scy ) || !cellsPtr->haveCell( ecx, ecy ) ) {
         qDebug() << Q_FUNC_INFO << "cellPtr doesn't have cells, giving up";
@@ -372,52 +377,53 @@ void ConRouter::mapRoute( int sx, int sy, int ex, int ey )
 		}
 	}
 
-	// It seems we must resort to brute-force route-checking
-	{
-		cellsPtr->reset();
-
-		xcells = p_icnDocument->canvas()->width()/8;
-		ycells = p_icnDocument->canvas()->height()/8;
-
-		// Now to map out the shortest routes to the cells
-		Cell * const startCell = &cellsPtr->cell( ecx, ecy );
-		startCell->permanent = true;
-		startCell->bestScore = 0;
-		startCell->prevX = startCellPos;
-		startCell->prevY = startCellPos;
-
-		tempLabels.clear();
-		checkCell( ecx, ecy );
+	// It seems we must resort to searching for a route
+	searchRoute( scx, scy, ecx, ecy );
 
-		// Daniel: I changed it from a do while to a while otherwise
-		// in rare cases the iterator can end up as end().
-		while ( tempLabels.size() > 0 && !cellsPtr->cell( scx, scy ).permanent )
-		{
-			TempLabelMap::iterator it = tempLabels.begin();
-			checkCell( it->second.x, it->second.y );
-			tempLabels.erase(it);
-		}
+	removeDuplicatePoints();
+}
 
-		// Now, retrace the shortest route from the endcell to get out points :)
-		int x = scx, y = scy;
-		bool ok = true;
 
-		do {
-			m_cellPointList.append( QPoint( x, y ) );
-			int newx = cellsPtr->cell( x, y ).prevX;
-			int newy = cellsPtr->cell( x, y ).prevY;
-			if ( newx == x && newy == y ) {
-				ok = false;
-			}
-			x = newx;
-			y = newy;
-		} while ( cellsPtr->haveCell( x, y ) && (x != startCellPos) && (y != startCellPos) && ok );
+void ConRouter::searchRoute( int scx, int scy, int ecx, int ecy )
+{
+	// The search starts at the end cell so that following the previous cells
+	// back from the start cell gives the points in order
+	m_search->begin();
+	m_targetX = scx;
+	m_targetY = scy;
+
+	CellSearch::State &startState = m_search->state( ecx, ecy );
+	startState.bestScore = 0;
+	startState.prevX = startCellPos;
+	startState.prevY = startCellPos;
+	checkCell( ecx, ecy );
+
+	CellQueue &queue = m_search->queue();
+	short x, y;
+	while ( !m_search->state( scx, scy ).permanent && queue.pop( x, y ) )
+	{
+		if ( !m_search->state( x, y ).permanent )
+			checkCell( x, y );
+	}
 
-		// And append the last point...
+	if ( !m_search->state( scx, scy ).permanent ) {
+		// Shouldn't happen, as all cells are connected
+		qWarning() << Q_FUNC_INFO << "no route found";
+		m_cellPointList.append( QPoint( scx, scy ) );
 		m_cellPointList.append( QPoint( ecx, ecy ) );
+		return;
 	}
 
-	removeDuplicatePoints();
+	// Now, retrace the shortest route from the endcell to get out points :)
+	x = scx;
+	y = scy;
+	while ( x != startCellPos && y != startCellPos )
+	{
+		m_cellPointList.append( QPoint( x, y ) );
+		const CellSearch::State &s = m_search->state( x, y );
+		x = s.prevX;
+		y = s.prevY;
+	}
 }
 
 
@@ -471,6 +477,22 @@ bool ConRouter::checkLineRoute( int scx, int scy, int ecx, int ecy, int maxConSc
 }
 
 
+int ConRouter::routePenalty() const
+{
+	const Cells *cells = p_icnDocument->cells();
+
+	int penalty = 0;
+	for ( const QPoint &point : m_cellPointList )
+	{
+		if ( cells->haveCell( point.x(), point.y() ) ) {
+			const Cell &cell = cells->cell( point.x(), point.y() );
+			penalty += cell.CIpenalty + cell.Cpenalty;
+		}
+	}
+	return penalty;
+}
+
+
 void ConRouter::removeDuplicatePoints()
 {
 	QPoint invalid( -(1<<30), -(1<<30) );
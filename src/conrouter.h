@@ -18,8 +18,9 @@
 #include <qpoint.h>
 #include <qlist.h>
 
+#include <cstdlib>
+
 class ICNDocument;
-struct Cell;
 
 /**
 Abstraction for the routing of a connector.
@@ -41,6 +42,16 @@ public:
 	 * What this class is all about - finding a route, from (sx,sy) to (ex,ey).
 	 */
 	void mapRoute( int sx, int sy, int ex, int ey );
+	/**
+	 * Finds a route using the given search state, which allows routes to be
+	 * mapped on several threads at once (as long as the cells of the
+	 * document don't change meanwhile).
+	 */
+	void mapRoute( int sx, int sy, int ex, int ey, CellSearch &search );
+	/**
+	 * @returns the sum of the penalties of the cells the route goes through.
+	 */
+	int routePenalty() const;
 	/**
 	 * Translates the precalculated routepoints by the given amount
 	 */
@@ -83,17 +94,37 @@ protected:
 	 * Check a line of the ICNDocument cells for a valid route
 	 */
 	bool checkLineRoute( int scx, int scy, int ecx, int ecy, int maxConScore, int maxCIScore );
-	void checkACell( int x, int y, Cell *prev, int prevX, int prevY, int nextScore );
+	/**
+	 * A* search over the cells from (ecx,ecy) to (scx,scy), used when none of
+	 * the simple routes work. Fills m_cellPointList from (scx,scy) back to
+	 * (ecx,ecy).
+	 */
+	void searchRoute( int scx, int scy, int ecx, int ecy );
+	void checkACell( int x, int y, const CellSearch::State &prev, int prevX, int prevY, int nextScore );
 	void checkCell( int x, int y ); // Gets the shortest route from the final cell
+	/**
+	 * Lower bound on the score of a route from (x,y) to the target of the
+	 * current search: one point per cell. This is consistent (it drops by at
+	 * most the score of a step), which the search relies on, as cells are
+	 * never reopened once permanent and the queue can't go back to a lower
+	 * score. Counting a bend for cells out of line with the target would
+	 * break that, as a step that bends can bring the cell in line.
+	 */
+	int heuristic( int x, int y ) const
+	{
+		return std::abs( x - m_targetX ) + std::abs( y - m_targetY );
+	}
+
+	static constexpr const int bendPenalty = 5;
 	/**
 	 * Remove duplicated points from the route
 	 */
 	void removeDuplicatePoints();
 
-	int xcells, ycells;
 	int m_lcx, m_lcy; // Last x / y from mapRoute, if we need a point on the route
 	Cells *cellsPtr;
-	TempLabelMap tempLabels;
+	CellSearch *m_search = nullptr;
+	int m_targetX = 0, m_targetY = 0;
 	ICNDocument *p_icnDocument;
 	QList<QPoint> m_cellPointList;
 };
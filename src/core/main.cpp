@@ -3,6 +3,7 @@
 #include "ktechlab.h"
 #include "diagnosticstyle.h"
 #include "logtofilemsghandler.h"
+#include "startuptrace.h"
 
 #include <KConfig>
 #include <config.h>
@@ -12,6 +13,7 @@
 
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QTimer>
 
 #if defined(__SANITIZE_ADDRESS__)
 #	include <sanitizer/lsan_interface.h>
@@ -124,6 +126,8 @@ namespace {
 }
 
 int main(int argc, char **argv) {
+	StartupTrace::start();
+
 	LogToFileMsgHandler logFileHandler;
 	QApplication app{argc, argv};
 	KLocalizedString::setApplicationDomain(Application::Name);
@@ -152,7 +156,11 @@ int main(int argc, char **argv) {
 		return about;
 	}());
 
-	auto * const ktechlab = new KTechlab;
+	KTechlab *ktechlab;
+	{
+		StartupTrace::Phase phase{"KTechlab"};
+		ktechlab = new KTechlab;
+	}
 
 	{
 		// https://techbase.kde.org/Development/Tutorials/KCmdLineArgs
@@ -173,11 +181,16 @@ int main(int argc, char **argv) {
 		// 2019.10.03 - note: possibly add support for multiple URLs to be opened from
 		//              command line?
 		if (!parser.positionalArguments().isEmpty()) {
+			StartupTrace::Phase phase{"load document"};
 			ktechlab->load(parser.positionalArguments().first());
 		}
 	}
 
-	ktechlab->show();
+	{
+		StartupTrace::Phase phase{"show"};
+		ktechlab->show();
+	}
+	QTimer::singleShot(0, &StartupTrace::finish);
 
 	const int resultCode = app.exec();
 
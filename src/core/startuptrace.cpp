@@ -0,0 +1,68 @@
+#include "startuptrace.h"
+
+#include <QElapsedTimer>
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+	struct TraceState final {
+		QElapsedTimer clock;
+		int depth = 0;
+		bool enabled = false;
+
+		TraceState() {
+			enabled = std::getenv("KTECHLAB_STARTUP_TRACE") != nullptr;
+			clock.start();
+		}
+	};
+
+	static TraceState &state() {
+		static TraceState trace;
+		return trace;
+	}
+
+	static double toMs(qint64 ns) {
+		return double(ns) / 1.0e6;
+	}
+}
+
+StartupTrace::Phase::Phase(const char *name) :
+	m_name(name),
+	m_startNs(state().clock.nsecsElapsed())
+{
+	++state().depth;
+}
+
+StartupTrace::Phase::~Phase() {
+	TraceState &trace = state();
+	--trace.depth;
+	if (!trace.enabled) return;
+
+	const qint64 endNs = trace.clock.nsecsElapsed();
+	std::fprintf(
+		stderr,
+		"startup: %*s%-*s %9.2f ms (at %9.2f ms)\n",
+		trace.depth * 2, "",
+		qMax(0, 32 - trace.depth * 2), m_name,
+		toMs(endNs - m_startNs),
+		toMs(endNs)
+	);
+}
+
+void StartupTrace::start() {
+	state();
+}
+
+bool StartupTrace::isEnabled() {
+	return state().enabled;
+}
+
+void StartupTrace::finish() {
+	TraceState &trace = state();
+	if (!trace.enabled) return;
+
+	std::fprintf(stderr, "startup: ready after %.2f ms\n", toMs(trace.clock.nsecsElapsed()));
+	std::fflush(stderr);
+	trace.enabled = false;
+}
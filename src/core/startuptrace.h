@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QtGlobal>
+
+/**
+ * Times the phases of starting KTechLab, when the KTECHLAB_STARTUP_TRACE
+ * environment variable is set. Each phase is written to stderr as it ends,
+ * indented by how deeply it is nested, and the time to the first idle event
+ * loop is written when finish() is called. Phases ending after that aren't
+ * reported, so they can be left in code that also runs later on.
+ */
+class StartupTrace final {
+public:
+	/**
+	 * Times the scope that it lives in.
+	 */
+	class Phase final {
+	public:
+		explicit Phase(const char *name);
+		~Phase();
+
+		Phase(const Phase &) = delete;
+		Phase &operator=(const Phase &) = delete;
+
+	private:
+		const char *m_name;
+		qint64 m_startNs;
+	};
+
+	/**
+	 * Starts the clock that phases are reported against. Call this first
+	 * thing in main().
+	 */
+	static void start();
+	static bool isEnabled();
+	/**
+	 * Reports the total time since the trace started, and stops tracing.
+	 */
+	static void finish();
+
+private:
+	StartupTrace() = delete;
+};
@@ -21,20 +21,31 @@
 #include "itemdocumentdata.h"
 #include "ktechlab.h"
 #include "pin.h"
+#include "pingraph.h"
+#include "simulationprofiler.h"
 #include "simulator.h"
 #include "subcircuits.h"
 #include "switch.h"
 
 #include <qdebug.h>
+#include <kfiledialog.h>
 #include <kinputdialog.h>
 #include <klocalizedstring.h>
 #include <kmessagebox.h>
 #include <kactionmenu.h>
 #include <kicon.h>
 
+#include <qfile.h>
+#include <qpainter.h>
 #include <qregexp.h>
+#include <qtextstream.h>
 #include <qtimer.h>
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
 #include <ktlconfig.h>
 
 
@@ -60,6 +71,11 @@ CircuitDocument::CircuitDocument( const QString & caption, const char *name )
 	m_updateCircuitsTmr = new QTimer();
 	connect( m_updateCircuitsTmr, SIGNAL(timeout()), this, SLOT(assignCircuits()) );
 
+	m_profileOverlayTmr = new QTimer(this);
+	connect( m_profileOverlayTmr, SIGNAL(timeout()), this, SLOT(updateProfileOverlay()) );
+	connect( SimulationProfiler::self(), SIGNAL(enabledChanged(bool)), this, SLOT(slotProfilingChanged(bool)) );
+	slotProfilingChanged( SimulationProfiler::self()->isEnabled() );
+
 	requestStateSave();
 }
 
@@ -80,7 +96,7 @@ CircuitDocument::~CircuitDocument()
         disconnect( item, SIGNAL(removed(Item*)), this, SLOT(componentRemoved(Item*)) );
         Component *comp = dynamic_cast<Component*>( item );
         if ( comp ) {
-            disconnect( comp, SIGNAL(elementDestroyed(Element*)), this, SLOT(requestAssignCircuits()) );
+            disconnect( comp, SIGNAL(elementDestroyed(Element*)), this, SLOT(componentElementsChanged()) );
         }
     }
 
@@ -242,8 +258,15 @@ void CircuitDocument::update()
 		for (auto &connector : m_connectorList) {
 			if (connector.isNull() || !connector) continue;
 
-			connector->incrementCurrentAnimation( 1.0 / double(KTLConfig::refreshRate()) );
-			connector->updateConnectorLines( animWires );
+			// Only touch the connectors whose appearance visibly changed, so
+			// that idle parts of the circuit cost nothing to redraw.
+			const bool animChanged = animWires &&
+				connector->incrementCurrentAnimation( 1.0 / double(KTLConfig::refreshRate()) );
+			const bool colorChanged = connector->voltageColorChanged();
+
+			if ( animChanged || colorChanged ) {
+				connector->updateConnectorLines( animChanged );
+			}
 		}
 	}
 
@@ -311,8 +334,24 @@ void CircuitDocument::deleteCircuits()
 		delete circuit;
 	}
 	m_circuitList.clear();
+	m_partitions.clear();
 	m_pinList.clear();
 	m_wireList.clear();
+	m_currentSchedule.clear();
+	m_bCurrentScheduleValid = false;
+}
+
+
+void CircuitDocument::pauseCircuits()
+{
+	if (!Simulator::isDestroyedSim()) {
+		for (auto &circuit : m_circuitList) {
+			if (!circuit) continue;
+			Simulator::self()->detachCircuit(circuit);
+		}
+	}
+	m_currentSchedule.clear();
+	m_bCurrentScheduleValid = false;
 }
 
 
@@ -321,7 +360,7 @@ void CircuitDocument::requestAssignCircuits()
 	if (m_bDeleted) {
 			return;
 	}
-	deleteCircuits();
+	pauseCircuits();
 	m_updateCircuitsTmr->stop();
   m_updateCircuitsTmr->setSingleShot( true );
 	m_updateCircuitsTmr->start( 0 /*, true */ );
@@ -352,8 +391,8 @@ void CircuitDocument::componentAdded( Item * item )
 
 	requestAssignCircuits();
 
-	connect( component, SIGNAL(elementCreated(Element*)), this, SLOT(requestAssignCircuits()) );
-	connect( component, SIGNAL(elementDestroyed(Element*)), this, SLOT(requestAssignCircuits()) );
+	connect( component, SIGNAL(elementCreated(Element*)), this, SLOT(componentElementsChanged()) );
+	connect( component, SIGNAL(elementDestroyed(Element*)), this, SLOT(componentElementsChanged()) );
 	connect( component, SIGNAL(removed(Item*)), this, SLOT(componentRemoved(Item*)) );
 
 	// We don't attach the component to the Simulator just yet, as the
@@ -372,6 +411,7 @@ void CircuitDocument::componentRemoved( Item * item )
 
 	m_componentList.removeAll( component );
 	m_toSimulateList.removeAll( component );
+	m_profileShares.remove( component );
 
 	// Check all of the lists and see if it's the component of anything.
 	for (auto it = m_switchList.begin(); it < m_switchList.end();) {
@@ -391,18 +431,63 @@ void CircuitDocument::componentRemoved( Item * item )
 	}
 }
 
+void CircuitDocument::componentElementsChanged()
+{
+	if (auto *component = dynamic_cast<Component *>(sender())) {
+		m_changedComponents.insert(component);
+	}
+	requestAssignCircuits();
+}
+
 // I think this is where the inf0z from cnodes/branches is moved into the midle-layer
 // pins/wires.
 
 void CircuitDocument::calculateConnectorCurrents()
 {
+	// The circuits may refer to removed elements until they are reassigned
+	if (m_updateCircuitsTmr->isActive()) return;
+
 	for (auto &circuit : m_circuitList) {
 		if (!circuit) continue;
 		circuit->updateCurrents();
 	}
 
-	QPtrList<Pin> groundPins;
+	if (!m_bCurrentScheduleValid) {
+		buildConnectorCurrentSchedule();
+	}
+
+	resetConnectorCurrents(nullptr);
+
+	// Tell the components to update their ECNode's currents' from the elements
+	// currents are merged into PINS.
+	for (auto &component : m_componentList) {
+		if (!component) continue;
+		component->setNodalCurrents();
+	}
+
+	// And now for the wires and switches. Every step in the schedule only
+	// depends on currents calculated by the steps before it, so one pass is
+	// enough.
+	for (auto &step : m_currentSchedule) {
+		if (step.object.isNull()) continue;
 
+		switch (step.type) {
+			case CurrentStep::Type::Wire:
+				static_cast<Wire *>(step.object.data())->calculateCurrent();
+				break;
+			case CurrentStep::Type::Switch:
+				static_cast<Switch *>(step.object.data())->calculateCurrent();
+				break;
+			case CurrentStep::Type::GroundPin:
+				static_cast<Pin *>(step.object.data())->calculateCurrentFromWires();
+				break;
+		}
+	}
+}
+
+
+void CircuitDocument::resetConnectorCurrents( QPtrList<Pin> *groundPins )
+{
 	// Tell the Pins to reset their calculated currents to zero
 	m_pinList.removeAll(nullptr);
 
@@ -417,7 +502,9 @@ void CircuitDocument::calculateConnectorCurrents()
 				// (and it has a current of 0 amps)
 			}
 			else if ( pin->getGroundType() == Pin::GroundType::Always ) {
-				groundPins << pin;
+				if (groundPins) {
+					*groundPins << pin;
+				}
 				pin->setCurrentKnown( false );
 			} else {
 				// Child node that is non ground
@@ -425,19 +512,24 @@ void CircuitDocument::calculateConnectorCurrents()
 			}
 	}
 
-	// Tell the components to update their ECNode's currents' from the elements
-	// currents are merged into PINS.
-	for (auto &component : m_componentList) {
-		if (!component) continue;
-		component->setNodalCurrents();
-	}
-
-	// And now for the wires and switches...
 	m_wireList.removeAll(nullptr);
 	for (auto &wire : m_wireList) {
 		if (wire.isNull() || !wire) continue;
 		wire->setCurrentKnown(false);
 	}
+}
+
+
+void CircuitDocument::buildConnectorCurrentSchedule()
+{
+	// Whether a wire, switch or ground pin current can be calculated only
+	// depends on which other currents are known, which in turn only depends
+	// on the circuit topology. So the fixed point iteration is run once here,
+	// recording the order in which the currents become known.
+	m_currentSchedule.clear();
+
+	QPtrList<Pin> groundPins;
+	resetConnectorCurrents(&groundPins);
 
 	m_switchList.removeAll(nullptr);
 
@@ -451,24 +543,28 @@ void CircuitDocument::calculateConnectorCurrents()
 		for (auto it = wires.begin(); it != wires.end();)
 		{
 			auto &wire = *it;
-			if (wire.isNull() || !wire) continue;
-			if (wire->calculateCurrent())
-			{
+			if (wire.isNull() || !wire) {
+				it = wires.erase(it);
+			}
+			else if (wire->calculateCurrent()) {
 				found = true;
+				m_currentSchedule.append({ CurrentStep::Type::Wire, wire.data() });
 				it = wires.erase(it);
 			}
 			else {
-      	++it;
-      }
+				++it;
+			}
 		}
 
 		for (auto it = switches.begin(); it != switches.end();)
 		{
 			auto &sw = *it;
-			if (!sw) continue;
-			if (sw->calculateCurrent())
-			{
+			if (!sw) {
+				it = switches.erase(it);
+			}
+			else if (sw->calculateCurrent()) {
 				found = true;
+				m_currentSchedule.append({ CurrentStep::Type::Switch, sw.data() });
 				it = switches.erase(it);
 			}
 			else {
@@ -479,9 +575,12 @@ void CircuitDocument::calculateConnectorCurrents()
 		//make the ground pins work. Current engine doesn't treat ground explicitly.
 		for (auto it = groundPins.begin(); it != groundPins.end();) {
 			auto &pin = *it;
-			if (pin.isNull() || !pin) continue;
-			if (pin->calculateCurrentFromWires()) {
+			if (pin.isNull() || !pin) {
+				it = groundPins.erase(it);
+			}
+			else if (pin->calculateCurrentFromWires()) {
 				found = true;
+				m_currentSchedule.append({ CurrentStep::Type::GroundPin, pin.data() });
 				it = groundPins.erase(it);
 			}
 			else {
@@ -489,6 +588,8 @@ void CircuitDocument::calculateConnectorCurrents()
 			}
 		}
 	}
+
+	m_bCurrentScheduleValid = true;
 }
 
 
@@ -520,29 +621,111 @@ void CircuitDocument::assignCircuits()
 		}
 	}
 
-	using PinListList = QList<QPtrList<Pin>>;
-
 	// Stage 1: Partition the circuit up into dependent areas (bar splitting
-	// at ground pins)
-	QPtrList<Pin> unassignedPins = m_pinList;
-	PinListList pinListList;
+	// at ground pins), and see which partitions are unchanged since the last
+	// time, so that their circuits can be kept. The pin graph is built once
+	// and used for all of the walks below.
+	const PinGraph graph(m_pinList);
+	const QVector<std::vector<int>> pinPartitions = partitionPins(graph);
+
+	QSet<Pin *> changedPins;
+	for (auto &component : m_changedComponents) {
+		if (!component) continue;
+
+		const NodeInfoMap nodes = component->nodeMap();
+		for (const NodeInfo &info : nodes) {
+			auto *node = dynamic_cast<ECNode *>(info.node);
+			if (!node) continue;
+
+			for (unsigned i = 0; i < node->numPins(); i++) {
+				changedPins.insert(node->pin(i));
+			}
+		}
+	}
+	m_changedComponents.clear();
+
+	// Previous partitions that could still be valid, by fingerprint
+	QHash<uint64, int> oldPartitions;
+	for (int i = 0; i < m_partitions.size(); ++i) {
+		const Partition &partition = m_partitions[i];
+
+		bool valid = true;
+		for (auto &pin : partition.pins) {
+			if (pin.isNull() || changedPins.contains(pin)) {
+				valid = false;
+				break;
+			}
+		}
 
-	while(!unassignedPins.isEmpty()) {
-		QPtrList<Pin> pinList;
-		getPartition(*unassignedPins.begin(), &pinList, &unassignedPins);
-		pinListList.append(pinList);
+		if (valid) {
+			oldPartitions.insert(partition.fingerprint, i);
+		}
 	}
 
-	// Stage 2: Split up each partition into circuits by ground pins
-	for (auto &pinList : pinListList) {
-		splitIntoCircuits(&pinList);
+	QVector<Partition> partitions;
+	partitions.reserve(pinPartitions.size());
+	QVector<bool> keptPartitions(m_partitions.size(), false);
+	QVector<int> newPartitions;
+	QVector<uint64> fingerprints(pinPartitions.size());
+
+	for (int i = 0; i < pinPartitions.size(); ++i) {
+		const auto &ids = pinPartitions[i];
+		const uint64 fingerprint = fingerprints[i] = partitionFingerprint(graph, ids);
+
+		const auto found = oldPartitions.constFind(fingerprint);
+		if (found != oldPartitions.constEnd()) {
+			const Partition &old = m_partitions[found.value()];
+			const auto samePin = [&graph](int id, const QPointer<Pin> &pin) { return graph.pin(id) == pin; };
+			if (std::equal(ids.begin(), ids.end(), old.pins.begin(), old.pins.end(), samePin)) {
+				partitions.append(old);
+				keptPartitions[found.value()] = true;
+				oldPartitions.remove(fingerprint);
+				continue;
+			}
+		}
+
+		newPartitions.append(i);
 	}
 
-	// Stage 3: Initialize the circuits
-	m_circuitList.removeAll(nullptr);
-	for (auto &circuit : m_circuitList) {
-		if (!circuit) continue;
+	// The elements of circuits that are being replaced have to be released
+	// before they can be added to the new circuits
+	for (int i = 0; i < m_partitions.size(); ++i) {
+		if (keptPartitions[i]) continue;
 
+		for (auto *circuit : m_partitions[i].circuits) {
+			if (!Simulator::isDestroyedSim()) {
+				Simulator::self()->detachCircuit(circuit);
+			}
+			delete circuit;
+		}
+	}
+
+	// Stage 2: Split up each new partition into circuits by ground pins
+	QList<Circuit *> newCircuits;
+	m_circuitList.clear();
+	for (int i : newPartitions) {
+		Partition partition;
+		partition.pins.reserve(int(pinPartitions[i].size()));
+		for (int id : pinPartitions[i]) {
+			partition.pins << graph.pin(id);
+		}
+		partition.fingerprint = fingerprints[i];
+
+		splitIntoCircuits(graph, pinPartitions[i]);
+		partition.circuits = m_circuitList;
+		partitions.append(partition);
+
+		newCircuits += m_circuitList;
+		m_circuitList.clear();
+	}
+
+	m_partitions = partitions;
+	for (auto &partition : m_partitions) {
+		m_circuitList += partition.circuits;
+	}
+
+	// Stage 3: Initialize the new circuits
+	for (auto *circuit : newCircuits) {
 		circuit->init();
 	}
 
@@ -554,104 +737,170 @@ void CircuitDocument::assignCircuits()
 		if (!component) continue;
 
 		m_componentList << component;
+		// Elements in circuits that were kept just get the same nodes again
 		component->initElements(0);
 		m_switchList += component->switchList();
 	}
 
-	for (auto &circuit : m_circuitList) {
-		if (!circuit) continue;
-
+	for (auto *circuit : newCircuits) {
 		circuit->createMatrixMap();
 	}
 
-	for (auto &item : m_itemList) {
-		if (!item) continue;
-		auto *component = dynamic_cast<Component*>(item);
-		if (!component) continue;
-
-		component->initElements(1);
+	// This resets the state of the elements, so only for the new circuits
+	// (as Component::initElements(1) would do for every element)
+	for (auto *circuit : newCircuits) {
+		for (auto *element : circuit->elements()) {
+			if (!element) continue;
+			element->add_initial_dc();
+		}
 	}
 
-	for (auto &circuit : m_circuitList) {
-		if (!circuit) continue;
-
+	for (auto *circuit : newCircuits) {
 		circuit->initCache();
+	}
+
+	for (auto *circuit : m_circuitList) {
+		// A kept circuit may have been queued as changed while it was paused
+		Simulator::self()->detachCircuit(circuit);
 		Simulator::self()->attachCircuit(circuit);
 	}
+
+	buildConnectorCurrentSchedule();
 }
 
 
-void CircuitDocument::getPartition( Pin *pin, QPtrList<Pin> *pinList, QPtrList<Pin> *unassignedPins, bool onlyGroundDependent )
+QVector<std::vector<int>> CircuitDocument::partitionPins( const PinGraph &graph )
 {
-	if (!pin || !unassignedPins || !pinList) return;
-
-	unassignedPins->removeAll(pin);
-
-	if (pinList->contains(pin)) return;
-
-	pinList->append(pin);
-
-	const auto localConnectedPins = pin->localConnectedPins();
-	for (auto &pin : localConnectedPins) {
-		if (pin.isNull() || !pin) continue;
-		getPartition(pin, pinList, unassignedPins, onlyGroundDependent);
+	// Union-find over the pins, with path halving and union by size
+	std::vector<int> parent(graph.size());
+	std::vector<int> size(graph.size(), 1);
+	std::iota(parent.begin(), parent.end(), 0);
+
+	const auto find = [&parent](int i) {
+		while (parent[i] != i) {
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	};
+
+	for (int i = 0; i < graph.size(); ++i) {
+		graph.forEachEdge(i, PinGraph::AllEdges, [&](int other) {
+			int a = find(i);
+			int b = find(other);
+			if (a == b) return;
+			if (size[a] < size[b]) std::swap(a, b);
+			parent[b] = a;
+			size[a] += size[b];
+		});
 	}
 
-	const auto groundDependentPins = pin->groundDependentPins();
-	for (auto &pin : groundDependentPins) {
-		if (pin.isNull() || !pin) continue;
-		getPartition(pin, pinList, unassignedPins, onlyGroundDependent);
+	std::vector<int> partitionOfRoot(graph.size(), -1);
+	QVector<std::vector<int>> partitions;
+	for (int i = 0; i < graph.size(); ++i) {
+		const int root = find(i);
+		if (partitionOfRoot[root] == -1) {
+			partitionOfRoot[root] = partitions.size();
+			partitions.append({});
+			partitions.last().reserve(size[root]);
+		}
+		partitions[partitionOfRoot[root]].push_back(i);
 	}
 
-	if (!onlyGroundDependent) {
-		const auto circuitDependentPins = pin->circuitDependentPins();
-		for (auto &pin : circuitDependentPins) {
-			if (pin.isNull() || !pin) continue;
-			getPartition(pin, pinList, unassignedPins, onlyGroundDependent);
-		}
+	const auto byAddress = [&graph](int a, int b) { return graph.pin(a) < graph.pin(b); };
+	for (auto &partition : partitions) {
+		std::sort(partition.begin(), partition.end(), byAddress);
 	}
+
+	return partitions;
 }
 
 
-void CircuitDocument::splitIntoCircuits( QPtrList<Pin> *pinList )
+uint64 CircuitDocument::partitionFingerprint( const PinGraph &graph, const std::vector<int> &ids )
 {
-	if (!pinList) return;
-
-	// First: identify ground
-	QPtrList<Pin> unassignedPins = *pinList;
-	using PinListList = QList<QPtrList<Pin>>;
-	PinListList pinListList;
-
-	while (!unassignedPins.isEmpty()) {
-		QPtrList<Pin> tempPinList;
-		getPartition(*unassignedPins.begin(), &tempPinList, &unassignedPins, true);
-		pinListList.append(tempPinList);
+	uint64 hash = uint64(ids.size());
+	const auto mix = [&hash](uint64 value) {
+		// From splitmix64
+		hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+		hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+		hash ^= hash >> 31;
+	};
+
+	// Neighbours are sorted, as their order doesn't matter
+	std::vector<quintptr> neighbours;
+	const auto mixNeighbours = [&]() {
+		std::sort(neighbours.begin(), neighbours.end());
+		mix(neighbours.size());
+		for (quintptr value : neighbours) {
+			mix(value);
+		}
+	};
+	const auto mixEdges = [&](int id, PinGraph::EdgeType type) {
+		neighbours.clear();
+		graph.forEachEdge(id, type, [&](int other) {
+			neighbours.push_back(quintptr(graph.pin(other)));
+		});
+		mixNeighbours();
+	};
+
+	for (int id : ids) {
+		Pin *pin = graph.pin(id);
+		mix(quintptr(pin));
+		mix(uint64(pin->getGroundType()));
+		mixEdges(id, PinGraph::Local);
+		mixEdges(id, PinGraph::GroundDependent);
+		mixEdges(id, PinGraph::CircuitDependent);
+
+		neighbours.clear();
+		for (auto *element : pin->elements()) {
+			neighbours.push_back(quintptr(element));
+		}
+		mixNeighbours();
 	}
 
-	for (auto &list : pinListList) {
-		Circuit::identifyGround(list);
-	}
+	return hash;
+}
 
-	while (!pinList->isEmpty()) {
-		auto end = pinList->end();
-		auto it = pinList->begin();
 
-		while (
-			it != end &&
-			!(*it).isNull() &&
-			!!(*it) &&
-			(*it)->eqId() == Pin::EquationID::Ground
-		) {
-			++it;
-		}
+void CircuitDocument::splitIntoCircuits( const PinGraph &graph, const std::vector<int> &ids )
+{
+	// First: identify ground
+	graph.forEachGroup(&ids, PinGraph::Local | PinGraph::GroundDependent, [&graph](const std::vector<int> &group) {
+		Circuit::identifyGround(graph, group);
+	});
 
-		if (it == end) break;
+	// Then grow a circuit from each pin that isn't ground or in a circuit
+	// yet, stopping at ground pins (which can be shared between circuits)
+	QSet<int> assigned;
+	assigned.reserve(int(ids.size()));
+	QSet<Element *> elements;
 
-		auto &pin = *it;
-		if (pin.isNull() || !pin) continue;
+	const auto isGround = [&graph](int id) {
+		return graph.pin(id)->eqId() == Pin::EquationID::Ground;
+	};
+
+	for (int start : ids) {
+		if (isGround(start) || assigned.contains(start)) continue;
 
 		Circuitoid circuitoid;
-		recursivePinAdd(pin, &circuitoid, pinList);
+		elements.clear();
+
+		graph.walk(start, PinGraph::AllEdges,
+			[&isGround](int id) { return !isGround(id); },
+			[&](int id) {
+				Pin *pin = graph.pin(id);
+				circuitoid.addPin(pin);
+				if (isGround(id)) return;
+
+				assigned.insert(id);
+				for (auto &element : pin->elements()) {
+					if (!element || elements.contains(element)) continue;
+					elements.insert(element);
+					circuitoid.addElement(element);
+				}
+			}
+		);
 
 		if (!tryAsLogicCircuit(&circuitoid)) {
 			m_circuitList += createCircuit(&circuitoid);
@@ -660,12 +909,12 @@ void CircuitDocument::splitIntoCircuits( QPtrList<Pin> *pinList )
 
 	// Remaining pins are ground; tell them about it
 	// TODO This is a bit hacky....
-	for (auto &pin : *pinList) {
-		if (pin.isNull() || !pin) continue;
+	for (int id : ids) {
+		if (!isGround(id)) continue;
 
+		Pin *pin = graph.pin(id);
 		pin->setVoltage(0.0);
-		auto elements = pin->elements();
-		for (auto &element : elements) {
+		for (auto &element : pin->elements()) {
 			if (!element) continue;
 
 			LogicIn *logicIn = nullptr;
@@ -679,41 +928,6 @@ void CircuitDocument::splitIntoCircuits( QPtrList<Pin> *pinList )
 }
 
 
-void CircuitDocument::recursivePinAdd( Pin *pin, Circuitoid *circuitoid, QPtrList<Pin> *unassignedPins )
-{
-	if (!pin || !circuitoid || !unassignedPins) return;
-
-	if (pin->eqId() != Pin::EquationID::Ground )
-		unassignedPins->removeAll(pin);
-
-	if (circuitoid->contains(pin)) return;
-
-	circuitoid->addPin(pin);
-
-	if (pin->eqId() == Pin::EquationID::Ground) return;
-
-	for (auto &pin : pin->localConnectedPins()) {
-		if (pin.isNull() || !pin) continue;
-		recursivePinAdd(pin, circuitoid, unassignedPins);
-	}
-
-	for (auto &pin : pin->groundDependentPins()) {
-		if (pin.isNull() || !pin) continue;
-		recursivePinAdd(pin, circuitoid, unassignedPins);
-	}
-
-	for (auto &pin : pin->circuitDependentPins()) {
-		if (pin.isNull() || !pin) continue;
-		recursivePinAdd(pin, circuitoid, unassignedPins);
-	}
-
-	for (auto &element : pin->elements()) {
-		if (!element) continue;
-		circuitoid->addElement(element);
-	}
-}
-
-
 bool CircuitDocument::tryAsLogicCircuit( Circuitoid *circuitoid )
 {
 	if (!circuitoid) return false;
@@ -794,10 +1008,8 @@ Circuit *CircuitDocument::createCircuit( Circuitoid *circuitoid )
 		circuit->addPin(pin);
 	}
 
-	for (auto &element : circuitoid->elementList) {
-		if (!element) continue;
-		circuit->addElement(element);
-	}
+	// The circuitoid's elements are already unique and non-null
+	circuit->addElements(circuitoid->elementList);
 
 	return circuit;
 }
@@ -879,4 +1091,158 @@ void CircuitDocument::displayEquations()
 }
 
 
+void CircuitDocument::slotProfilingChanged( bool profiling )
+{
+	if ( profiling )
+	{
+		m_profileOverlayTmr->start( 1000 );
+		return;
+	}
+
+	m_profileOverlayTmr->stop();
+
+	for ( auto it = m_profileShares.constBegin(); it != m_profileShares.constEnd(); ++it )
+		m_canvas->setChanged( it.key()->boundingRect() );
+	m_profileShares.clear();
+	m_profileMaxShare = 0.0;
+}
+
+
+void CircuitDocument::updateProfileOverlay()
+{
+	const auto totals = SimulationProfiler::self()->componentTotals( m_componentList, m_circuitList );
+
+	qint64 totalTime = 0;
+	for ( const SimulationProfiler::Counters &counters : totals )
+		totalTime += counters.nanoseconds;
+
+	QHash<const Component *, double> shares;
+	if ( totalTime > 0 )
+	{
+		for ( auto it = totals.constBegin(); it != totals.constEnd(); ++it )
+		{
+			if ( it->nanoseconds > 0 )
+				shares[it.key()] = double(it->nanoseconds) / double(totalTime);
+		}
+	}
+
+	double maxShare = 0.0;
+	for ( double share : shares )
+		maxShare = std::max( maxShare, share );
+
+	// The colours are relative to the largest share, so if that changed,
+	// all of the components have to be redrawn. Otherwise, only redraw the
+	// components whose share changed enough to show.
+	const bool maxShareChanged = std::abs( maxShare - m_profileMaxShare ) >= 0.001;
+	for ( auto it = shares.constBegin(); it != shares.constEnd(); ++it )
+	{
+		if ( maxShareChanged || std::abs( m_profileShares.value( it.key(), -1.0 ) - it.value() ) >= 0.001 )
+			m_canvas->setChanged( it.key()->boundingRect() );
+	}
+	for ( auto it = m_profileShares.constBegin(); it != m_profileShares.constEnd(); ++it )
+	{
+		if ( !shares.contains( it.key() ) )
+			m_canvas->setChanged( it.key()->boundingRect() );
+	}
+
+	m_profileShares = shares;
+	if ( maxShareChanged )
+		m_profileMaxShare = maxShare;
+}
+
+
+void CircuitDocument::drawOverlay( QPainter &p, const QRect &clip )
+{
+	if ( m_profileShares.isEmpty() || m_profileMaxShare <= 0.0 )
+		return;
+
+	p.save();
+	p.setPen( Qt::NoPen );
+
+	QFont font = p.font();
+	font.setPointSize( 7 );
+	p.setFont( font );
+
+	for ( auto it = m_profileShares.constBegin(); it != m_profileShares.constEnd(); ++it )
+	{
+		const QRect rect = it.key()->boundingRect();
+		if ( !rect.intersects( clip ) )
+			continue;
+
+		// Green for the components taking the least time, through to red for
+		// the one taking the most
+		const double heat = std::min( it.value() / m_profileMaxShare, 1.0 );
+		QColor color = QColor::fromHsvF( (1.0 - heat) / 3.0, 1.0, 1.0 );
+		color.setAlphaF( 0.2 + 0.4 * heat );
+
+		p.setPen( Qt::NoPen );
+		p.setBrush( color );
+		p.drawRect( rect );
+
+		p.setPen( Qt::black );
+		p.drawText( rect, Qt::AlignCenter, QString::number( it.value() * 100.0, 'f', 1 ) + '%' );
+	}
+
+	p.restore();
+}
+
+
+void CircuitDocument::exportProfile()
+{
+	SimulationProfiler *profiler = SimulationProfiler::self();
+
+	if ( profiler->sampledSteps() == 0 )
+	{
+		KMessageBox::sorry( KTechlab::self(), i18n("The simulation has not been profiled yet. Enable \"Profile Simulation\" while the circuit is being simulated first."), i18n("Export Simulation Profile") );
+		return;
+	}
+
+	const QString filter = QString("*.csv|%1").arg( i18n("Comma-Separated Values (*.csv)") );
+	KUrl url = KFileDialog::getSaveUrl( KUrl(), filter, KTechlab::self(), i18n("Export Simulation Profile") );
+	if ( url.isEmpty() )
+		return;
+
+	QFile file( url.toLocalFile() );
+	if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) )
+	{
+		KMessageBox::sorry( KTechlab::self(), i18n("Could not open \"%1\" for writing.", url.toLocalFile()), i18n("Export Simulation Profile") );
+		return;
+	}
+
+	const auto totals = profiler->componentTotals( m_componentList, m_circuitList );
+
+	QList<const Component *> components = totals.keys();
+	std::sort( components.begin(), components.end(), [&totals]( const Component *a, const Component *b ) {
+		return totals[a].nanoseconds > totals[b].nanoseconds;
+	} );
+
+	qint64 totalTime = 0;
+	for ( const SimulationProfiler::Counters &counters : totals )
+		totalTime += counters.nanoseconds;
+
+	const auto quoted = []( QString text ) {
+		return '"' + text.replace( '"', "\"\"" ) + '"';
+	};
+
+	QTextStream stream( &file );
+	stream << "# " << profiler->sampledSteps() << " sampled steps (1 in " << SimulationProfiler::sampleInterval << ")\n";
+	stream << "id,type,name,share (%),sampled time (ms),calls,iterations,LU decompositions\n";
+
+	for ( const Component *component : components )
+	{
+		const SimulationProfiler::Counters &counters = totals[component];
+		const double share = totalTime > 0 ? 100.0 * double(counters.nanoseconds) / double(totalTime) : 0.0;
+
+		stream << quoted( component->id() ) << ','
+			<< quoted( component->type() ) << ','
+			<< quoted( component->name() ) << ','
+			<< QString::number( share, 'f', 2 ) << ','
+			<< QString::number( counters.nanoseconds * 1e-6, 'f', 3 ) << ','
+			<< counters.calls << ','
+			<< counters.iterations << ','
+			<< counters.luCalls << '\n';
+	}
+}
+
+
 #include "moc_circuitdocument.cpp"
@@ -15,19 +15,24 @@ class Element;
 class CircuitICNDocument;
 class KTechlab;
 class Pin;
+class PinGraph;
 class QTimer;
 class Wire;
 
 class KActionMenu;
 
+/**
+The pins and elements of a circuit that is being assigned. Whoever adds them
+makes sure they are unique, so that adding doesn't have to search the lists.
+*/
 class Circuitoid
 {
 public:
 	bool contains( Pin *node ) { return pinList.contains(node); }
 	bool contains( Element *ele ) { return elementList.contains(ele); }
 
-	void addPin( Pin *node ) { if (node && !contains(node)) pinList += node; }
-	void addElement( Element *ele ) { if (ele && !contains(ele)) elementList += ele; }
+	void addPin( Pin *node ) { pinList += node; }
+	void addElement( Element *ele ) { elementList += ele; }
 
 	QPtrList<Pin> pinList;
 	QList<Element *> elementList;
@@ -56,6 +61,11 @@ class CircuitDocument : public CircuitICNDocument
 		int countExtCon( const QPtrList<Item> &cnItemList ) const;
 
 		void update() override;
+		/**
+		 * Draws the simulation profile heat-map over the components while
+		 * the simulation is being profiled.
+		 */
+		void drawOverlay( QPainter &p, const QRect &clip ) override;
 
 	public slots:
 		/**
@@ -63,6 +73,11 @@ class CircuitDocument : public CircuitICNDocument
 		 */
 		void createSubcircuit();
 		void displayEquations();
+		/**
+		 * Asks for a file, and writes the simulation profile of the
+		 * components to it as comma-separated values.
+		 */
+		void exportProfile();
 		void setOrientation0();
 		void setOrientation90();
 		void setOrientation180();
@@ -92,6 +107,18 @@ class CircuitDocument : public CircuitICNDocument
 
 	private slots:
 		void assignCircuits();
+		/**
+		 * Called when a component creates or destroys elements, so that the
+		 * circuits its pins are in are rebuilt even if the pins are still
+		 * connected in the same way.
+		 */
+		void componentElementsChanged();
+		/**
+		 * Recalculates the heat-map from the profiler, and redraws the
+		 * components whose part of it changed.
+		 */
+		void updateProfileOverlay();
+		void slotProfilingChanged( bool profiling );
 
 	private:
 		/**
@@ -105,27 +132,60 @@ class CircuitDocument : public CircuitICNDocument
 		Circuit *createCircuit( Circuitoid *circuitoid );
 
 		/**
-		 * @param pin Current node (will be added, then tested for further
-		 * connections).
-		 * @param pinList List of nodes in current partition.
-		 * @param unassignedPins The pool of all nodes in the CircuitDocument
-		 * waiting for assignment.
-		 * @param onlyGroundDependent if true, then the partition will not use
-		 * circuit-dependent pins to include new pins while growing the
-		 * partition.
+		 * Splits the pins of the graph into sets that depend on each other
+		 * (through wires, switches or components), ignoring ground.
+		 * @return the ids of the pins in each set, sorted by pin address.
 		 */
-		void getPartition(Pin *pin, QPtrList<Pin> *pinList, QPtrList<Pin> *unassignedPins, bool onlyGroundDependent = false);
+		static QVector<std::vector<int>> partitionPins(const PinGraph &graph);
 		/**
-		 * Takes the nodeList (generated by getPartition), splits it at ground nodes,
-		 * and creates circuits from each split.
+		 * @return a hash of the connections, ground types and elements of the
+		 * given pins. See Partition.
 		 */
-		void splitIntoCircuits(QPtrList<Pin> *pinList);
+		static uint64 partitionFingerprint(const PinGraph &graph, const std::vector<int> &ids);
 		/**
-		 * Construct a circuit from the given node, stopping at the groundnodes
+		 * Takes a partition (from partitionPins), splits it at ground pins,
+		 * and creates circuits from each split.
 		 */
-		void recursivePinAdd(Pin *pin, Circuitoid *circuitoid, QPtrList<Pin> *unassignedPins);
+		void splitIntoCircuits(const PinGraph &graph, const std::vector<int> &ids);
 
 		void deleteCircuits();
+		/**
+		 * Detaches all circuits from the simulator until assignCircuits has
+		 * worked out which of them are still valid.
+		 */
+		void pauseCircuits();
+		/**
+		 * Resets the calculated pin and wire currents, and marks which of them
+		 * are known before the wire currents are calculated. If groundPins is
+		 * not null, the pins whose current must be found from their wires are
+		 * appended to it.
+		 */
+		void resetConnectorCurrents( QPtrList<Pin> *groundPins );
+		/**
+		 * Works out the order in which the wire, switch and ground pin currents
+		 * can be calculated, so that calculateConnectorCurrents can do them in a
+		 * single pass. Called whenever the circuits are reassigned.
+		 */
+		void buildConnectorCurrentSchedule();
+
+		/**
+		 * A set of pins that depend on each other (before splitting at ground
+		 * pins), and the circuits made from it. The fingerprint covers the
+		 * connections, ground types and elements of the pins, so when a
+		 * partition has the same pins and fingerprint as on the last call to
+		 * assignCircuits, its circuits can be kept as they are.
+		 */
+		struct Partition {
+			QPtrList<Pin> pins; ///< Sorted by address
+			QList<Circuit *> circuits;
+			uint64 fingerprint = 0;
+		};
+
+		struct CurrentStep {
+			enum class Type : uint8 { Wire, Switch, GroundPin };
+			Type type;
+			QPointer<QObject> object;
+		};
 
 		QTimer *m_updateCircuitsTmr;
 		QList<Circuit *> m_circuitList;
@@ -136,4 +196,16 @@ class CircuitDocument : public CircuitICNDocument
 		QPtrList<Pin> m_pinList;
 		QPtrList<Wire> m_wireList;
 		QPtrList<Switch> m_switchList;
+
+		QVector<Partition> m_partitions;
+		QPtrSet<Component> m_changedComponents; ///< Whose elements changed since the last assignCircuits
+
+		QVector<CurrentStep> m_currentSchedule;
+		bool m_bCurrentScheduleValid = false;
+
+		QTimer *m_profileOverlayTmr;
+		/// The share of the simulation time taken by each component, from 0 to 1
+		QHash<const Component *, double> m_profileShares;
+		/// The largest of m_profileShares when the components were last redrawn
+		double m_profileMaxShare = 0.0;
 };
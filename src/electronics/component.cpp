@@ -15,6 +15,7 @@
 #include "itemdocumentdata.h"
 #include "node.h"
 #include "pin.h"
+#include "simulationprofiler.h"
 #include "simulator.h"
 
 #include "bjt.h"
@@ -41,6 +42,7 @@
 #include <qdebug.h>
 #include <qbitarray.h>
 #include <qpainter.h>
+#include <qpixmapcache.h>
 #include <qwidget.h>
 #include <qmatrix.h>
 
@@ -74,6 +76,7 @@ Component::Component( ICNDocument *icnDocument, bool newItem, const QString &id
 
 Component::~Component()
 {
+    SimulationProfiler::forget(this);
     removeElements();
     if (!Simulator::isDestroyedSim()) {
         Simulator::self()->detachComponent(this);
@@ -181,6 +184,72 @@ void Component::setNodalCurrents()
 }
 
 
+void Component::draw( QPainter &p )
+{
+    // Larger glyphs are not worth caching (and would evict lots of others)
+    static const int maxGlyphArea = 256 * 256;
+
+    const QString shapeKey = m_bDynamicContent ? QString() : glyphKey();
+    const QTransform &world = p.worldTransform();
+
+    // Only raster devices can use the bitmap glyphs; SVG export and printing
+    // have to get the vector drawing
+    const int devType = p.device() ? p.device()->devType() : 0;
+    const bool rasterDevice = devType == QInternal::Widget || devType == QInternal::Image || devType == QInternal::Pixmap;
+
+    if ( shapeKey.isEmpty() || !isVisible() || !rasterDevice || world.type() > QTransform::TxScale ) {
+        CNItem::draw(p);
+        return;
+    }
+
+    const QRect bound = boundingRect();
+    const double scale = world.m11();
+    const QSize size( int(std::ceil(bound.width() * scale)), int(std::ceil(bound.height() * scale)) );
+
+    if ( size.isEmpty() || GetArea(size) > maxGlyphArea || scale != world.m22() ) {
+        CNItem::draw(p);
+        return;
+    }
+
+    // The glyph is drawn relative to the bounding rect, so is the same for all
+    // positions of the component
+    const QPoint offset = bound.topLeft() - QPoint( int(x()), int(y()) );
+    const QString key = QString("ktl-glyph:%1:%2:%3:%4:%5,%6:%7x%8:%9:%10:%11:%12")
+        .arg( shapeKey )
+        .arg( m_angleDegrees )
+        .arg( b_flipped )
+        .arg( isSelected() )
+        .arg( offset.x() ).arg( offset.y() )
+        .arg( bound.width() ).arg( bound.height() )
+        .arg( pen().color().rgba() )
+        .arg( pen().width() )
+        .arg( brush().color().rgba() )
+        .arg( int(scale * 1000.0) );
+
+    QPixmap glyph;
+    if ( !QPixmapCache::find( key, &glyph ) ) {
+        glyph = QPixmap( size );
+        glyph.fill( Qt::transparent );
+
+        QPainter gp;
+        if ( !gp.begin( &glyph ) ) {
+            qWarning() << Q_FUNC_INFO << " painter not active";
+            CNItem::draw(p);
+            return;
+        }
+        gp.setRenderHints( p.renderHints() );
+        gp.scale( scale, scale );
+        gp.translate( -bound.x(), -bound.y() );
+        CNItem::draw( gp );
+        gp.end();
+
+        QPixmapCache::insert( key, glyph );
+    }
+
+    p.drawPixmap( QRectF( bound.x(), bound.y(), size.width() / scale, size.height() / scale ), glyph, QRectF( glyph.rect() ) );
+}
+
+
 void Component::initPainter( QPainter &p )
 {
     CNItem::initPainter(p);
@@ -118,6 +118,24 @@ class Component : public CNItem
 		 * the component is.
 		 */
 		void setNodalCurrents();
+		/**
+		 * Draws the component. Components that provide a glyphKey are blitted
+		 * from a cache of pixmaps rendered by drawShape, instead of being
+		 * painted from scratch every time. This is only done when painting to
+		 * a widget, image or pixmap, so that exported and printed circuits
+		 * stay vector drawings.
+		 */
+		void draw( QPainter &p ) override;
+		/**
+		 * Components whose drawShape only depends on their type, size,
+		 * orientation and a few properties can reinherit this to return a key
+		 * identifying those properties (e.g. the type and whether the
+		 * transistor is NPN or PNP). They are then drawn from the glyph cache,
+		 * and their images in the item selector are cached on disk.
+		 * Components with dynamic content are never cached. The default empty
+		 * key disables caching.
+		 */
+		virtual QString glyphKey() const { return QString(); }
 		/**
 		 * @return pointer to the CircuitDocument that we're in.
 		 */
@@ -253,6 +271,10 @@ class Component : public CNItem
 		 * @return the list of switches that this component uses.
 		 */
 		QPtrList<Switch> switchList() const { return m_switchList; }
+		/**
+		 * @return the elements that this component uses.
+		 */
+		const ElementMapList & elementMapList() const { return m_elementMapList; }
 
 	signals:
 		/**
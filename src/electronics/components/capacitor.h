@@ -33,6 +33,7 @@ public:
 private:
 	void dataChanged() override;
 	void drawShape( QPainter &p ) override;
+	QString glyphKey() const override { return type(); }
 
 	Capacitance * m_capacitance;
 };
@@ -79,8 +79,7 @@ void Demultiplexer::dataChanged()
 
 	if ( hasProperty("numInput") )
 	{
-		m_variantData["numInput"]->deleteLater();
-		m_variantData.remove("numInput");
+		removeProperty("numInput");
 	}
 
 	initPins( dataInt("addressSize") );
@@ -33,6 +33,7 @@ class ECBJT final : public Component
 	protected:
 		void dataChanged() override;
 		void drawShape( QPainter &p ) override;
+		QString glyphKey() const override { return type() + (m_bIsNPN ? ":npn" : ":pnp"); }
 
 		bool m_bIsNPN;
 		BJT * m_pBJT;
@@ -28,6 +28,7 @@ public:
 
 private:
 	void drawShape( QPainter &p ) override;
+	QString glyphKey() const override { return type(); }
 	void dataChanged() override;
 
 	CurrentSource *m_currentSource;
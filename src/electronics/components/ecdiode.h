@@ -21,6 +21,7 @@ public:
 
 protected:
 	void drawShape(QPainter &p) override;
+	QString glyphKey() const override { return type(); }
 	void dataChanged() override;
 
 	Property &saturationCurrent;
@@ -33,6 +33,7 @@ class ECJFET final : public Component
 	protected:
 		void dataChanged() override;
 		void drawShape( QPainter &p ) override;
+		QString glyphKey() const override { return QString("%1:%2").arg( type() ).arg( m_JFET_type ); }
 
 		int m_JFET_type;
 		JFET * m_pJFET;
@@ -37,6 +37,7 @@ class ECMOSFET final : public Component
 	protected:
 		void dataChanged() override;
 		void drawShape( QPainter &p ) override;
+		QString glyphKey() const override { return QString("%1:%2:%3").arg( type() ).arg( m_MOSFET_type ).arg( m_bHaveBodyPin ); }
 
 		bool m_bHaveBodyPin;
 		int m_MOSFET_type;
@@ -28,6 +28,7 @@ class ECOpAmp final : public Component
 
 	protected:
 		void drawShape( QPainter & p ) override;
+		QString glyphKey() const override { return type(); }
 };
 
 #endif
@@ -30,6 +30,7 @@ public:
 private:
 	void dataChanged() override;
 	void drawShape( QPainter &p ) override;
+	QString glyphKey() const override { return type(); }
 	VoltageSource *m_voltageSource;
 	double voltage;
 };
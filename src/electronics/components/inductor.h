@@ -28,6 +28,7 @@ class Inductor final : public Component
 	private:
 		void dataChanged() override;
 		void drawShape( QPainter & p ) override;
+		QString glyphKey() const override { return type(); }
 
 		Inductance * m_pInductance;
 };
@@ -93,7 +93,13 @@ int LED::getBrightness(current_t current, current_t minCurrentV, current_t maxCu
 	return iround<int>(getBrightnessReal(current, minCurrentV, maxCurrentV) * 255.0);
 }
 
+bool LED::contentChanged() const {
+	return iround<int>(brightness * 255.0) != drawnBrightness;
+}
+
 void LED::drawShape(QPainter &p) {
+	drawnBrightness = iround<int>(brightness * 255.0);
+
 	const Point2<int> position = {
 		iround<int>(x()),
 		iround<int>(y())
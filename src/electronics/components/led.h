@@ -26,6 +26,7 @@ public:
 	void dataChanged() override;
 	void stepNonLogic() override;
 	bool doesStepNonLogic() const override { return true; }
+	bool contentChanged() const override;
 
 	static real getBrightnessReal(current_t current, current_t minCurrentV = MinCurrent, current_t maxCurrentV = MaxCurrent);
 	static int getBrightness(current_t current, current_t minCurrentV = MinCurrent, current_t maxCurrentV = MaxCurrent);
@@ -39,4 +40,6 @@ private:
 	Point3<real> color = {0.0, 0.0, 0.0};
 
 	real brightness = 0.0;
+	/** The brightness as last drawn, quantized to the displayed colour steps */
+	int drawnBrightness = -1;
 };
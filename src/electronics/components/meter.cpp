@@ -27,6 +27,7 @@
 Meter::Meter( ICNDocument *icnDocument, bool newItem, const char *id )
 	: Component( icnDocument, newItem, id )
 {
+	m_bDynamicContent = true;
 	b_timerStarted = false;
 	m_timeSinceUpdate = 0.;
 	m_old_value  = 0.;
@@ -79,8 +79,7 @@ void Multiplexer::dataChanged()
 			return;
 		}
 
-		m_variantData["numInput"]->deleteLater();
-		m_variantData.remove("numInput");
+		removeProperty("numInput");
 	}
 
 	initPins( dataInt("addressSize") );
@@ -0,0 +1,635 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "config.h"
+
+#include "asminfo.h"
+#include "canvasitemparts.h"
+#include "docmanager.h"
+#include "ktechlab.h"
+#include "language.h"
+#include "languagemanager.h"
+#include "libraryitem.h"
+#include "microinfo.h"
+#include "microlibrary.h"
+#include "micropackage.h"
+#include "pic14component.h"
+#include "pic14core.h"
+#include "processchain.h"
+#include "projectmanager.h"
+#include "simulator.h"
+
+#include <qdebug.h>
+#include <qfile.h>
+#include <qicon.h>
+#include <klocalizedstring.h>
+#include <kmessagebox.h>
+#include <kstandarddirs.h>
+#include <ktemporaryfile.h>
+#include <qtimer.h>
+
+#include <algorithm>
+#include <cmath>
+
+//BEGIN class PIC14ComponentPin
+PIC14ComponentPin::PIC14ComponentPin( PIC14Component * picComponent, const PicPin &picPin )
+{
+	m_pPICComponent = picComponent;
+	m_pLogicOut = 0l;
+	m_pLogicIn = 0l;
+	m_port = -1;
+	m_bit = picPin.portPosition;
+	m_bOpenDrain = false;
+
+	if ( picPin.portName.startsWith("PORT") && picPin.portName.length() == 5 )
+		m_port = picPin.portName[4].toLatin1() - 'A';
+
+	switch ( picPin.type )
+	{
+		case PicPin::type_input:
+			m_pLogicIn = picComponent->createLogicIn( picComponent->ecNodeWithID(picPin.pinID) );
+			break;
+
+		case PicPin::type_bidir:
+			m_pLogicOut = picComponent->createLogicOut( picComponent->ecNodeWithID(picPin.pinID), false );
+			break;
+
+		case PicPin::type_open:
+			m_pLogicOut = picComponent->createLogicOut( picComponent->ecNodeWithID(picPin.pinID), false );
+			m_pLogicOut->setOutputHighVoltage(0.0);
+			m_bOpenDrain = true;
+			break;
+
+		default:
+			break;
+	}
+
+	if (m_pLogicIn)
+		m_pLogicIn->setCallback( this, (CallbackPtr)(&PIC14ComponentPin::logicCallback) );
+	if (m_pLogicOut)
+	{
+		m_pLogicOut->setCallback( this, (CallbackPtr)(&PIC14ComponentPin::logicCallback) );
+		resetOutput();
+	}
+}
+
+
+PIC14ComponentPin::~PIC14ComponentPin()
+{
+	if (m_pLogicIn)
+		m_pLogicIn->setCallback( 0, (CallbackPtr)0 );
+	if (m_pLogicOut)
+		m_pLogicOut->setCallback( 0, (CallbackPtr)0 );
+}
+
+
+void PIC14ComponentPin::updateOutput( const Pic14Core &core )
+{
+	if ( !m_pLogicOut || m_port < 0 || m_bit < 0 )
+		return;
+
+	const bool isOutput = !((core.portTris(m_port) >> m_bit) & 1);
+	const bool high = (core.portLatch(m_port) >> m_bit) & 1;
+
+	// An input, or an open drain output that is high, doesn't drive the pin
+	m_pLogicOut->setOutputHighConductance( (isOutput && !m_bOpenDrain) ? 0.004 : 0.0 );
+	m_pLogicOut->setOutputLowConductance( isOutput ? 0.004 : 0.0 );
+	if ( isOutput )
+		m_pLogicOut->setHigh(high);
+}
+
+
+void PIC14ComponentPin::updateInput( Pic14Core &core )
+{
+	if ( m_port < 0 )
+		return;
+
+	LogicIn * logic = m_pLogicOut ? m_pLogicOut : m_pLogicIn;
+	if (logic)
+		core.setPinInput( m_port, m_bit, logic->isHigh() );
+}
+
+
+void PIC14ComponentPin::resetOutput()
+{
+	if ( !m_pLogicOut )
+		return;
+
+	m_pLogicOut->setHigh(false);
+	m_pLogicOut->setOutputHighConductance(0.0);
+	m_pLogicOut->setOutputLowConductance(0.0);
+}
+
+
+void PIC14ComponentPin::logicCallback( bool state )
+{
+	if ( Pic14Core * core = m_pPICComponent->core() )
+	{
+		if ( m_port >= 0 )
+			core->setPinInput( m_port, m_bit, state );
+	}
+}
+//END class PIC14ComponentPin
+
+
+
+//BEGIN class PIC14Component
+QString PIC14Component::_def_PIC14Component_fileName = QString::null;
+
+
+Item* PIC14Component::construct( ItemDocument *itemDocument, bool newItem, const char *id )
+{
+	return new PIC14Component( (ICNDocument*)itemDocument, newItem, id );
+}
+
+
+LibraryItem* PIC14Component::libraryItem()
+{
+	QStringList IDs;
+#ifdef NO_GPSIM
+	// Without gpsim, this takes the place of PICComponent so that existing
+	// circuits still load
+	IDs << "ec/pic" << "ec/picitem" << "ec/picitem_18pin";
+	const QString name = "PIC";
+#else
+	IDs << "ec/pic_builtin";
+	const QString name = i18n("PIC (built-in simulator)");
+#endif
+
+	return new LibraryItem(
+		IDs,
+		name,
+		i18n("Integrated Circuits"),
+		"ic2.png",
+		LibraryItem::lit_component,
+		PIC14Component::construct );
+}
+
+
+PIC14Component::PIC14Component( ICNDocument *icnDocument, bool newItem, const char *id )
+	: Component( icnDocument, newItem, id ? id : "pic_builtin" )
+{
+	m_name = i18n("PIC Micro");
+
+	if ( _def_PIC14Component_fileName.isEmpty() )
+		_def_PIC14Component_fileName = i18n("<Enter location of PIC Program>");
+
+	m_bLoadingProgram = false;
+	m_bRunning = false;
+	m_cycleBudget = 0.0;
+	m_cyclesPerUpdate = 0.0;
+
+	addButton( "run", QRect(), QIcon::fromTheme( "media-playback-start" ) );
+	addButton( "pause", QRect(), QIcon::fromTheme( "media-playback-pause" ) );
+	addButton( "reset", QRect(), QIcon::fromTheme( "process-stop" ) );
+	addButton( "reload", QRect(), QIcon::fromTheme( "view-refresh" ) );
+
+	connect( KTechlab::self(), SIGNAL(recentFileAdded(const KUrl &)), this, SLOT(slotUpdateFileList()) );
+
+	connect( ProjectManager::self(),	SIGNAL(projectOpened()),		this, SLOT(slotUpdateFileList()) );
+	connect( ProjectManager::self(),	SIGNAL(projectClosed()),		this, SLOT(slotUpdateFileList()) );
+	connect( ProjectManager::self(),	SIGNAL(projectCreated()),		this, SLOT(slotUpdateFileList()) );
+	connect( ProjectManager::self(),	SIGNAL(subprojectCreated()),	this, SLOT(slotUpdateFileList()) );
+	connect( ProjectManager::self(),	SIGNAL(filesAdded()),			this, SLOT(slotUpdateFileList()) );
+	connect( ProjectManager::self(),	SIGNAL(filesRemoved()),			this, SLOT(slotUpdateFileList()) );
+
+	createProperty( "program", Variant::Type::FileName );
+	property("program")->setCaption( i18n("Program") );
+	QString filter;
+	filter = QString("*.flowcode *.hex *.cod *.asm *.basic *.c|%1").arg(i18n("All Supported Files"));
+	filter += QString("\n*.flowcode|FlowCode (*.flowcode)");
+	filter += QString("\n*.hex|%1 (*.hex)").arg(i18n("Intel HEX File"));
+	filter += QString("\n*.cod|%1 (*.cod)").arg(i18n("Symbol File"));
+	filter += QString("\n*.asm|%1 (*.asm)").arg(i18n("Assembly Code"));
+	filter += QString("\n*.basic *.microbe|Microbe (*.basic, *.microbe)");
+	filter += QString("\n*.c|C (*.c)");
+	filter += QString("\n*|%1").arg(i18n("All Files"));
+	property("program")->setFilter( filter );
+
+	// A hex file doesn't say which PIC it is for, so the user picks it. This
+	// shares its name with the property PICComponent saves the package in.
+	createProperty( "lastPackage", Variant::Type::Select );
+	property("lastPackage")->setCaption( i18n("PIC") );
+	property("lastPackage")->setAllowed( MicroLibrary::self()->microIDs( AsmInfo::PIC14 ) );
+	property("lastPackage")->setValue("P16F84");
+
+	createProperty( "frequency", Variant::Type::Double );
+	property("frequency")->setUnit("Hz");
+	property("frequency")->setCaption( i18n("Clock Frequency") );
+	property("frequency")->setMinValue(1e3);
+	property("frequency")->setMaxValue(64e6);
+	property("frequency")->setValue(4e6);
+
+	slotUpdateFileList();
+	slotUpdateBtns();
+
+	initPackage( 0 );
+}
+
+
+PIC14Component::~PIC14Component()
+{
+	deletePICComponentPins();
+}
+
+
+void PIC14Component::dataChanged()
+{
+	updateCyclesPerUpdate();
+	initPIC(false);
+}
+
+
+void PIC14Component::updateCyclesPerUpdate()
+{
+	// Four clock periods make an instruction cycle
+	m_cyclesPerUpdate = dataDouble("frequency") / 4.0 / LOGIC_UPDATE_RATE;
+}
+
+
+void PIC14Component::initPIC( bool forceReload )
+{
+	const QString picID = dataString("lastPackage");
+	const bool newPIC = (picID != m_picID);
+	if ( newPIC )
+	{
+		MicroInfo * microInfo = MicroLibrary::self()->microInfoWithID(picID);
+		if ( microInfo )
+		{
+			m_picID = picID;
+			initPackage( microInfo );
+		}
+		else
+			qDebug() << Q_FUNC_INFO << " unknown PIC: " << picID;
+	}
+
+	QString newProgram = KUrl( dataString("program") ).path();
+	bool newFile = (m_picFile != newProgram);
+	if ( !newFile && !forceReload && !newPIC )
+		return;
+
+	setRunning(false);
+	m_pCore.reset();
+
+	QString extension = newProgram.right( newProgram.length() - newProgram.lastIndexOf('.') - 1 ).toLower();
+	const bool validType =
+			extension == "flowcode" ||
+			extension == "asm" ||
+			extension == "hex" ||
+			extension == "basic" || extension == "microbe" ||
+			extension == "c" ||
+			(extension == "cod" && QFile::exists( QString(newProgram).replace(".cod",".hex") ));
+
+	if ( newProgram == _def_PIC14Component_fileName || newProgram.isEmpty() )
+		m_picFile = QString::null;
+
+	else if ( !KStandardDirs::exists(newProgram) )
+	{
+		KMessageBox::sorry( 0l, i18n("The file \"%1\" does not exist.", newProgram ) );
+		m_picFile = QString::null;
+	}
+
+	else if ( !validType )
+	{
+		KMessageBox::sorry( 0L, i18n("\"%1\" is not a valid PIC program.\nThe file must exist, and the extension should be \".hex\", \".asm\", \".flowcode\", \".basic\", \".microbe\" or \".c\".\n\".cod\" is allowed, provided that there is a corresponding \".hex\" file.", newProgram) );
+		m_picFile = QString::null;
+	}
+
+	else
+	{
+		m_picFile = newProgram;
+		m_hexFile = createHexFile();
+	}
+
+	slotUpdateBtns();
+}
+
+
+void PIC14Component::deletePICComponentPins()
+{
+	const PIC14ComponentPinMap::iterator picComponentMapEnd = m_picComponentPinMap.end();
+	for ( PIC14ComponentPinMap::iterator it = m_picComponentPinMap.begin(); it != picComponentMapEnd; ++it )
+		delete it.value();
+	m_picComponentPinMap.clear();
+}
+
+
+void PIC14Component::initPackage( MicroInfo * microInfo )
+{
+	MicroPackage * microPackage = microInfo ? microInfo->package() : 0l;
+
+	if ( microPackage )
+	{
+		//BEGIN Get pin IDs
+		QStringList allPinIDs = microPackage->pinIDs();
+		QStringList ioPinIDs = microPackage->pinIDs( PicPin::type_bidir | PicPin::type_input | PicPin::type_open );
+
+		// Now, we make the unwanted pin ids blank, so a pin is not created for them
+		const QStringList::iterator allPinIDsEnd = allPinIDs.end();
+		for ( QStringList::iterator it = allPinIDs.begin(); it != allPinIDsEnd; ++it )
+		{
+			if ( !ioPinIDs.contains(*it) )
+				*it = "";
+		}
+		//END Get pin IDs
+
+
+		//BEGIN Remove old stuff
+		// Remove old text
+		TextMap textMapCopy = m_textMap;
+		const TextMap::iterator textMapEnd = textMapCopy.end();
+		for ( TextMap::iterator it = textMapCopy.begin(); it != textMapEnd; ++it )
+			removeDisplayText(it.key());
+
+		// Remove the old pins
+		deletePICComponentPins();
+
+		// Remove old nodes
+		NodeInfoMap nodeMapCopy = m_nodeMap;
+		const NodeInfoMap::iterator nodeMapEnd = nodeMapCopy.end();
+		for ( NodeInfoMap::iterator it = nodeMapCopy.begin(); it != nodeMapEnd; ++it )
+		{
+			if ( !ioPinIDs.contains(it.key()) )
+				removeNode( it.key() );
+		}
+
+		removeElements();
+		//END Remove old stuff
+
+
+
+		//BEGIN Create new stuff
+		initDIPSymbol( allPinIDs, 80 );
+		initDIP(allPinIDs);
+
+		PicPinMap picPinMap = microPackage->pins( PicPin::type_bidir | PicPin::type_input | PicPin::type_open );
+		const PicPinMap::iterator picPinMapEnd = picPinMap.end();
+		for ( PicPinMap::iterator it = picPinMap.begin(); it != picPinMapEnd; ++it )
+			m_picComponentPinMap[it.key()] = new PIC14ComponentPin( this, it.value() );
+		//END Create new stuff
+
+
+		removeDisplayText( "no_file" );
+		addDisplayText( "picid", QRect(offsetX(), offsetY()-16, width(), 16), microInfo->id() );
+	}
+	else
+	{
+		setSize( -48, -72, 96, 144 );
+		removeDisplayText( "picid" );
+		addDisplayText( "no_file", sizeRect(), i18n("(No\nprogram\nloaded)") );
+	}
+
+
+	//BEGIN Update button positions
+	int leftpos = (width()-88)/2+offsetX();
+	button("run")->setOriginalRect( QRect( leftpos, height()+4+offsetY(), 20, 20 ) );
+	button("pause")->setOriginalRect( QRect( leftpos+23, height()+4+offsetY(), 20, 20 ) );
+	button("reset")->setOriginalRect( QRect( leftpos+46, height()+4+offsetY(), 20, 20 ) );
+	button("reload")->setOriginalRect( QRect( leftpos+69, height()+4+offsetY(), 20, 20 ) );
+	updateAttachedPositioning();
+	//END Update button positions
+}
+
+
+void PIC14Component::slotUpdateFileList()
+{
+	QStringList preFileList = KTechlab::self()->recentFiles();
+
+	QStringList fileList;
+
+	if ( ProjectInfo * info = ProjectManager::self()->currentProject() )
+	{
+		const KUrl::List urls = info->childOutputURLs( ProjectItem::AllTypes, ProjectItem::ProgramOutput );
+		KUrl::List::const_iterator urlsEnd = urls.end();
+		for ( KUrl::List::const_iterator it = urls.begin(); it != urlsEnd; ++it )
+			fileList << (*it).path();
+	}
+
+	const QStringList::iterator end = preFileList.end();
+	for ( QStringList::iterator it = preFileList.begin(); it != end; ++it )
+	{
+		QString file = KUrl(*it).path();
+		if ( (file.endsWith(".flowcode") || file.endsWith(".asm") || file.endsWith(".hex") || file.endsWith(".basic") || file.endsWith(".microbe") ) && !fileList.contains(file) ) {
+			fileList.append(file);
+		}
+	}
+
+	QString fileName = dataString("program");
+
+	property("program")->setAllowed(fileList);
+	property("program")->setValue( fileName.isEmpty() ? _def_PIC14Component_fileName : fileName );
+}
+
+
+void PIC14Component::buttonStateChanged( const QString &id, bool state )
+{
+	if (!state)
+		return;
+
+	if ( id == "reload" )
+	{
+		programReload();
+		return;
+	}
+
+	if (!m_pCore)
+		return;
+
+	if ( id == "run" )
+		setRunning(true);
+
+	else if ( id == "pause" )
+		setRunning(false);
+
+	else if ( id == "reset" )
+	{
+		setRunning(false);
+		m_pCore->reset();
+		m_cycleBudget = 0.0;
+
+		// The reset made all the pins inputs
+		const PIC14ComponentPinMap::iterator end = m_picComponentPinMap.end();
+		for ( PIC14ComponentPinMap::iterator it = m_picComponentPinMap.begin(); it != end; ++it )
+			it.value()->resetOutput();
+		m_pCore->takeOutputsChanged();
+	}
+
+	slotUpdateBtns();
+}
+
+
+void PIC14Component::setRunning( bool run )
+{
+	if ( m_bRunning == run )
+		return;
+
+	m_bRunning = run;
+
+	// Only be stepped while there is something to run
+	if (run)
+		Simulator::self()->attachComponentCallback( this, (VoidCallbackPtr)(&PIC14Component::stepLogic) );
+	else
+		Simulator::self()->detachComponentCallbacks(*this);
+}
+
+
+void PIC14Component::stepLogic()
+{
+	if ( !m_pCore )
+		return;
+
+	// As in GpsimProcessor::executeNext, cycles left over from stopping early
+	// for pin changes are caught up on, but only up to a logic update's worth
+	m_cycleBudget = std::min( m_cycleBudget, m_cyclesPerUpdate ) + m_cyclesPerUpdate;
+	if ( m_cycleBudget <= 0.0 )
+		return;
+
+	m_cycleBudget -= double( m_pCore->run( uint64( std::ceil(m_cycleBudget) ) ) );
+
+	// The circuit has to see the new outputs before the program runs on
+	if ( m_pCore->takeOutputsChanged() )
+		updateOutputs();
+}
+
+
+void PIC14Component::updateOutputs()
+{
+	const PIC14ComponentPinMap::iterator end = m_picComponentPinMap.end();
+	for ( PIC14ComponentPinMap::iterator it = m_picComponentPinMap.begin(); it != end; ++it )
+		it.value()->updateOutput(*m_pCore);
+}
+
+
+bool PIC14Component::mouseDoubleClickEvent ( const EventInfo &eventInfo )
+{
+	Q_UNUSED(eventInfo);
+	if ( m_picFile.isEmpty() || (m_picFile == _def_PIC14Component_fileName) )
+		return false;
+
+	(void) DocManager::self()->openURL(m_picFile);
+
+	return true;
+}
+
+
+QString PIC14Component::createHexFile()
+{
+	m_bLoadingProgram = true;
+	slotUpdateBtns();
+
+	const QString extension = m_picFile.right( m_picFile.length() - m_picFile.lastIndexOf('.') - 1 ).toLower();
+
+	if ( extension == "hex" )
+	{
+		QTimer::singleShot( 0, this, SLOT(slotHexCreationSucceeded()) );
+		return m_picFile;
+	}
+	if ( extension == "cod" )
+	{
+		// We've already checked for the existance of the ".hex" file in initPIC
+		QTimer::singleShot( 0, this, SLOT(slotHexCreationSucceeded()) );
+		return QString(m_picFile).replace(".cod",".hex");
+	}
+
+	QString hexFile;
+	if ( extension == "flowcode" )
+	{
+		KTemporaryFile tmpFile;
+		tmpFile.setSuffix( ".hex" );
+		if (!tmpFile.open()) {
+			qWarning() << " failed to open " << tmpFile.fileName() << " error " << tmpFile.errorString();
+			QTimer::singleShot( 0, this, SLOT(slotHexCreationFailed()) );
+			return QString::null;
+		}
+		hexFile = tmpFile.fileName();
+	}
+	else
+		hexFile = QString(m_picFile).replace( "."+extension, ".hex" );
+
+	ProcessOptions o;
+	o.b_addToProject = false;
+	o.setTargetFile( hexFile );
+	o.setInputFiles( QStringList(m_picFile) );
+	o.setMethod( ProcessOptions::Method::Forget );
+	o.setProcessPath( ProcessOptions::path( ProcessOptions::guessMediaType(m_picFile), ProcessOptions::MediaType::Program ) );
+
+	ProcessChain * pc = LanguageManager::self()->compile(o);
+	connect( pc, SIGNAL(successful()), this, SLOT(slotHexCreationSucceeded()) );
+	connect( pc, SIGNAL(failed()), this, SLOT(slotHexCreationFailed()) );
+
+	return hexFile;
+}
+
+
+void PIC14Component::slotHexCreationSucceeded()
+{
+	m_bLoadingProgram = false;
+
+	std::unique_ptr<Pic14Core> core = std::make_unique<Pic14Core>( Pic14Core::configFor(m_picID) );
+
+	QString error;
+	if ( !core->loadHex( m_hexFile, &error ) )
+	{
+		KMessageBox::sorry( 0l, error );
+		slotUpdateBtns();
+		return;
+	}
+
+	setRunning(false);
+	m_pCore = std::move(core);
+	m_cycleBudget = 0.0;
+	updateCyclesPerUpdate();
+
+	const PIC14ComponentPinMap::iterator end = m_picComponentPinMap.end();
+	for ( PIC14ComponentPinMap::iterator it = m_picComponentPinMap.begin(); it != end; ++it )
+	{
+		it.value()->updateInput(*m_pCore);
+		it.value()->resetOutput();
+	}
+	m_pCore->takeOutputsChanged();
+
+	slotUpdateBtns();
+}
+
+
+void PIC14Component::slotHexCreationFailed()
+{
+	m_bLoadingProgram = false;
+	slotUpdateBtns();
+}
+
+
+void PIC14Component::programReload()
+{
+	setRunning(false);
+	m_pCore.reset();
+
+	initPIC(true);
+
+	slotUpdateBtns();
+}
+
+
+void PIC14Component::slotUpdateBtns()
+{
+	// We can get called after our canvas has been set to NULL
+	if (!canvas())
+		return;
+
+	button("run")->setEnabled( m_pCore && !m_bRunning );
+	button("pause")->setEnabled( m_pCore && m_bRunning );
+	button("reset")->setEnabled( bool(m_pCore) );
+	button("reload")->setEnabled( !m_bLoadingProgram && (dataString("program") != _def_PIC14Component_fileName) );
+
+	canvas()->setChanged( button("run")->boundingRect() );
+	canvas()->setChanged( button("pause")->boundingRect() );
+	canvas()->setChanged( button("reset")->boundingRect() );
+	canvas()->setChanged( button("reload")->boundingRect() );
+}
+//END class PIC14Component
+
+#include "moc_pic14component.cpp"
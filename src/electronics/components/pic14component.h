@@ -0,0 +1,129 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef PIC14COMPONENT_H
+#define PIC14COMPONENT_H
+
+#include "component.h"
+#include "logic.h"
+
+#include <qmap.h>
+
+#include <memory>
+
+class MicroInfo;
+class PIC14Component;
+class PicPin;
+class Pic14Core;
+
+/**
+@short Connects a pin of the PIC14Component to the built-in simulator
+*/
+class PIC14ComponentPin : public CallbackClass
+{
+	public:
+		PIC14ComponentPin( PIC14Component * picComponent, const PicPin &picPin );
+		~PIC14ComponentPin();
+
+		/**
+		 * Updates the LogicOut from the output latch and TRIS bit of the pin.
+		 */
+		void updateOutput( const Pic14Core &core );
+		/**
+		 * Gives the core the current level of the pin.
+		 */
+		void updateInput( Pic14Core &core );
+		/**
+		 * Stops driving the pin, as when the PIC has been reset.
+		 */
+		void resetOutput();
+
+	protected:
+		/**
+		 * Called from our logic pin when the logic changes state.
+		 */
+		void logicCallback( bool state );
+
+		PIC14Component * m_pPICComponent;
+		LogicOut * m_pLogicOut;
+		LogicIn * m_pLogicIn;
+		int m_port; ///< 0 for PORTA, 1 for PORTB, etc; or -1 if not a port pin
+		int m_bit;
+		bool m_bOpenDrain;
+};
+
+typedef QMap< int, PIC14ComponentPin * > PIC14ComponentPinMap;
+
+/**
+@short PIC simulated by KTechLab's own instruction set simulator
+
+Works like PICComponent, but runs the program on a Pic14Core instead of gpsim.
+Programs are loaded from Intel HEX files; other program files are first
+compiled to one. Only the mid-range PICs are supported.
+*/
+class PIC14Component final : public Component
+{
+	Q_OBJECT
+	public:
+		PIC14Component( ICNDocument * icnDocument, bool newItem, const char *id = 0L );
+		~PIC14Component();
+
+		static Item * construct( ItemDocument *itemDocument, bool newItem, const char *id );
+		static LibraryItem * libraryItem();
+
+		virtual void buttonStateChanged( const QString &id, bool state );
+		virtual bool mouseDoubleClickEvent( const EventInfo &eventInfo );
+
+		void programReload();
+		Pic14Core * core() const { return m_pCore.get(); }
+		/**
+		 * Sets up the pins, text, etc for the given PIC type. If info is null,
+		 * then a generic rectangle is displayed.
+		 */
+		void initPackage( MicroInfo * info );
+
+		void stepLogic();
+
+	public slots:
+		void slotUpdateFileList();
+		void slotUpdateBtns();
+
+	protected slots:
+		void slotHexCreationSucceeded();
+		void slotHexCreationFailed();
+
+	protected:
+		void deletePICComponentPins();
+		/**
+		 * Starts compiling the program to a hex file if needed, and connects
+		 * the compile finish signal to slotHexCreationSucceeded.
+		 * @return the hex file that will be loaded.
+		 */
+		QString createHexFile();
+		virtual void dataChanged();
+		/**
+		 * Initializes the PIC from the options the user has selected.
+		 */
+		void initPIC( bool forceReload );
+		void setRunning( bool run );
+		void updateOutputs();
+		void updateCyclesPerUpdate();
+
+		std::unique_ptr<Pic14Core> m_pCore;
+		QString m_picFile; ///< The input program that the user selected
+		QString m_hexFile; ///< The hex file that was generated from m_picFile
+		QString m_picID; ///< The PIC that the current package is for
+		bool m_bLoadingProgram; ///< True between createHexFile being called and the file being created
+		bool m_bRunning;
+		/** Instruction cycles owed to the program; see GpsimProcessor::executeNext */
+		double m_cycleBudget;
+		double m_cyclesPerUpdate;
+		PIC14ComponentPinMap m_picComponentPinMap;
+		static QString _def_PIC14Component_fileName;
+};
+
+#endif
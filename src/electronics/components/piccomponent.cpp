@@ -96,6 +96,13 @@ PICComponent::PICComponent( ICNDocument *icnDocument, bool newItem, const char *
 	filter += QString("\n*|%1").arg(i18n("All Files"));
 	property("program")->setFilter( filter );
 
+	createProperty( "frequency", Variant::Type::Double );
+	property("frequency")->setUnit("Hz");
+	property("frequency")->setCaption( i18n("Clock Frequency") );
+	property("frequency")->setMinValue(1e3);
+	property("frequency")->setMaxValue(64e6);
+	property("frequency")->setValue( GpsimProcessor::defaultFrequency );
+
 	// Used for restoring the pins on file loading before we have had a change
 	// to compile the PIC program
 	createProperty( "lastPackage", Variant::Type::String );
@@ -127,6 +134,8 @@ PICComponent::~PICComponent()
 void PICComponent::dataChanged()
 {
     qDebug() << Q_FUNC_INFO;
+	if ( m_pGpsim )
+		m_pGpsim->setFrequency( dataDouble("frequency") );
 	initPIC(false);
 }
 
@@ -377,6 +386,7 @@ void PICComponent::slotCODCreationSucceeded()
 
 	delete m_pGpsim;
 	m_pGpsim = new GpsimProcessor(m_symbolFile);
+	m_pGpsim->setFrequency( dataDouble("frequency") );
 
 	if ( m_pGpsim->codLoadStatus() == GpsimProcessor::CodSuccess )
 	{
@@ -52,6 +52,7 @@ class PICComponent final : public Component
 		virtual bool mouseDoubleClickEvent( const EventInfo &eventInfo );
 
 		void programReload();
+		GpsimProcessor * gpsim() const { return m_pGpsim; }
 		/**
 		 * Sets up the pins, text, etc for the given PIC type. If info is null,
 		 * then a generic rectangle is displayed (used when no file has been
@@ -11,6 +11,7 @@
 #include "config.h"
 #ifndef NO_GPSIM
 
+#include "gpsimprocessor.h"
 #include "micropackage.h"
 #include "piccomponent.h"
 #include "piccomponentpin.h"
@@ -28,6 +29,7 @@ PICComponentPin::PICComponentPin( PICComponent * picComponent, PicPin picPin )
 	m_pLogicIn = 0l;
 	m_pIOPIN = 0l;
 	m_pStimulusNode = 0l;
+	m_bIsInput = true;
 	Zth = 0.0;
 	Vth = 0.0;
 	
@@ -133,14 +135,25 @@ void PICComponentPin::set_nodeVoltage( double v )
 	if ( !m_pLogicOut || !m_pIOPIN )
 		return;
 	
-	if ( m_pIOPIN->get_direction() == IOPIN::DIR_INPUT )
+	const bool isInput = m_pIOPIN->get_direction() == IOPIN::DIR_INPUT;
+	const bool high = !isInput && m_pIOPIN->getDrivingState();
+
+	if ( isInput != m_bIsInput || (!isInput && high != m_pLogicOut->outputState()) )
+	{
+		// Let the circuit see the change before the PIC runs on
+		if ( GpsimProcessor *gpsim = m_pPICComponent->gpsim() )
+			gpsim->requestSync();
+	}
+	m_bIsInput = isInput;
+
+	if ( isInput )
 	{
 		m_pLogicOut->setOutputHighConductance(0.0);
 		m_pLogicOut->setOutputLowConductance(0.0);
 	}
 	else
 	{
-		m_pLogicOut->setHigh( m_pIOPIN->getDrivingState() );
+		m_pLogicOut->setHigh( high );
 		m_pLogicOut->setOutputHighConductance(m_gOutHigh);
 		m_pLogicOut->setOutputLowConductance(m_gOutLow);
 	}
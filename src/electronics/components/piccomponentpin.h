@@ -62,6 +62,7 @@ class PICComponentPin : public CallbackClass, public stimulus
 		LogicIn * m_pLogicIn;
 		PICComponent * m_pPICComponent;
 		Stimulus_Node * m_pStimulusNode;
+		bool m_bIsInput; ///< Direction of the IOPIN when set_nodeVoltage was last called
 		const QString m_id;
 };
 
@@ -29,6 +29,7 @@ class Resistor final : public Component
 	protected:
 		void dataChanged() override;
 		void drawShape( QPainter & p ) override;
+		QString glyphKey() const override { return type(); }
 
 		Resistance * m_resistance;
 };
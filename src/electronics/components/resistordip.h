@@ -29,6 +29,7 @@ public:
 
 protected:
 	void drawShape( QPainter &p ) override;
+	QString glyphKey() const override { return QString("%1:%2").arg( type() ).arg( m_resistorCount ); }
 	void updateDIPNodePositions();
 	void dataChanged() override;
 	/**
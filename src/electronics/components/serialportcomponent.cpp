@@ -16,6 +16,7 @@
 #include "libraryitem.h"
 #include "pin.h"
 #include "resistance.h"
+#include "simulator.h"
 
 #include <qdebug.h>
 #include <klocalizedstring.h>
@@ -55,6 +56,9 @@ SerialPortComponent::SerialPortComponent( ICNDocument *icnDocument, bool newItem
 	setItemPoints( pa );
 
 	m_pSerialPort = new SerialPort();
+	m_baudRate = B0;
+	m_bUART = false;
+	m_bRDCallback = false;
 
 	ECNode * pin = 0;
 
@@ -62,11 +66,12 @@ SerialPortComponent::SerialPortComponent( ICNDocument *icnDocument, bool newItem
 	pin = createPin( -40,  32,   0, "CD" );
 	addDisplayText( "CD", QRect( -28, 24, 28, 16 ), "CD", true, Qt::AlignLeft | Qt::AlignVCenter );
 	m_pCD = createLogicOut( pin, false  );
+	m_lineNodes[0] = pin;
 
-	// Doesn't work
-// 	pin = createPin( -40,  16,   0, "RD" );
+	// Only in UART mode
+	pin = createPin( -40,  16,   0, "RD" );
 	addDisplayText( "RD", QRect( -28, 8, 28, 16 ), "RD", true, Qt::AlignLeft | Qt::AlignVCenter );
-// 	m_pRD = createLogicOut( pin, false  );
+	m_pRD = createLogicOut( pin, false  );
 
 	// Works
 	pin = createPin( -40,   0,   0, "TD" );
@@ -101,20 +106,28 @@ SerialPortComponent::SerialPortComponent( ICNDocument *icnDocument, bool newItem
 	pin = createPin(  40,  -8, 180, "CTS" );
 	addDisplayText( "CTS", QRect( 0, -16, 28, 16 ), "CTS", true, Qt::AlignRight | Qt::AlignVCenter );
 	m_pCTS = createLogicOut( pin, false  );
+	m_lineNodes[1] = pin;
 
 	// Works
 	pin = createPin(  40, -24, 180, "RI" );
 	addDisplayText( "RI", QRect( 0, -32, 28, 16 ), "RI", true, Qt::AlignRight | Qt::AlignVCenter );
 	m_pRI = createLogicOut( pin, false  );
+	m_lineNodes[2] = pin;
 
 	Variant * v = createProperty( "port", Variant::Type::Combo );
 	v->setAllowed( SerialPort::ports( Port::ExistsAndRW ) );
 	v->setCaption( i18n("Port") );
 
-// 	v = createProperty( "baudRate", Variant::Type::Select );
-// 	v->setAllowed( QStringList::split( ",", "B0,B50,B75,B110,B134,B150,B200,B300,B600,B1200,B1800,B2400,B4800,B9600,B19200,B38400" ) );
-// 	v->setCaption( i18n("Baud rate") );
-// 	v->setValue("B9600");
+	v = createProperty( "mode", Variant::Type::Select );
+	v->setCaption( i18n("Mode") );
+	v->appendAllowed( "lines", i18n("Modem lines") );
+	v->appendAllowed( "uart", i18n("UART") );
+	v->setValue("lines");
+
+	v = createProperty( "baudRate", Variant::Type::Select );
+	v->setAllowed( QString("50,75,110,134,150,200,300,600,1200,1800,2400,4800,9600,19200,38400,57600,115200").split(',') );
+	v->setCaption( i18n("Baud rate") );
+	v->setValue("9600");
 }
 
 
@@ -126,57 +139,43 @@ SerialPortComponent::~SerialPortComponent()
 
 void SerialPortComponent::dataChanged()
 {
-#if 0
-	QString baudString = dataString("baudRate");
-	unsigned baudRate = 0;
-
-	if ( baudString == "B0" )
-		baudRate = B0;
-	else if ( baudString == "B50" )
-		baudRate = B50;
-	else if ( baudString == "B75" )
-		baudRate = B75;
-	else if ( baudString == "B110" )
-		baudRate = B110;
-	else if ( baudString == "B134" )
-		baudRate = B134;
-	else if ( baudString == "B150" )
-		baudRate = B150;
-	else if ( baudString == "B200" )
-		baudRate = B200;
-	else if ( baudString == "B300" )
-		baudRate = B300;
-	else if ( baudString == "B600" )
-		baudRate = B600;
-	else if ( baudString == "B1200" )
-		baudRate = B1200;
-	else if ( baudString == "B1800" )
-		baudRate = B1800;
-	else if ( baudString == "B2400" )
-		baudRate = B2400;
-	else if ( baudString == "B4800" )
-		baudRate = B4800;
-	else if ( baudString == "B9600" )
-		baudRate = B9600;
-	else if ( baudString == "B19200" )
-		baudRate = B19200;
-	else if ( baudString == "B38400" )
-		baudRate = B38400;
-	else
+	const unsigned baud = dataString("baudRate").toUInt();
+	const speed_t baudRate = SerialPort::baudRateConstant( baud );
+	if ( baudRate == B0 )
 	{
-		qCritical() << Q_FUNC_INFO << "Unknown baud rate = \""<<baudString<<"\""<<endl;
+		qCritical() << Q_FUNC_INFO << "Unknown baud rate = \""<<baud<<"\""<<endl;
 		return;
 	}
 
+	const double bitPeriod = double(LOGIC_UPDATE_RATE) / baud;
+	m_tdDecoder.setBitPeriod( bitPeriod );
+	m_rdEncoder.setBitPeriod( bitPeriod );
+
+	const bool uart = dataString("mode") == "uart";
+	if ( uart != m_bUART )
+	{
+		m_bUART = uart;
+		m_tdDecoder.reset();
+		m_rdEncoder.reset();
+		setRDCallback( false );
+		m_pRD->setHigh( uart );
+	}
+
 	initPort( dataString("port"), baudRate );
-#endif
 
-	initPort( dataString("port"), B200 );
+	// TD only controls the break in modem lines mode
+	m_pSerialPort->setPinState( SerialPort::TD, !m_bUART && m_pTD->isHigh() );
 }
 
 
-void SerialPortComponent::initPort( const QString & port, unsigned baudRate )
+void SerialPortComponent::initPort( const QString & port, speed_t baudRate )
 {
+	if ( port == m_portName && baudRate == m_baudRate )
+		return;
+
+	m_portName = port;
+	m_baudRate = baudRate;
+
 	if ( port.isEmpty() )
 	{
 		m_pSerialPort->closePort();
@@ -186,23 +185,85 @@ void SerialPortComponent::initPort( const QString & port, unsigned baudRate )
 	if ( ! m_pSerialPort->openPort( port, baudRate ) )
 	{
 		p_itemDocument->canvas()->setMessage( i18n("Could not open port %1", port ) );
+		// Try again the next time the settings are changed
+		m_portName.clear();
 		return;
 	}
+
+	m_pSerialPort->setPinState( SerialPort::DTR, m_pDTR->isHigh() );
 }
 
 
 void SerialPortComponent::stepNonLogic()
 {
-	m_pCD->setHigh( m_pSerialPort->pinState( SerialPort::CD ) );
-// 	m_pRD->setHigh( m_pSerialPort->pinState( SerialPort::RD ) );
-	m_pCTS->setHigh( m_pSerialPort->pinState( SerialPort::CTS ) );
-	m_pRI->setHigh( m_pSerialPort->pinState( SerialPort::RI ) );
+	// Reading the modem lines means polling the port, so only have it done
+	// while something is connected to them
+	bool linesUsed = false;
+	for ( ECNode *node : m_lineNodes )
+		linesUsed = linesUsed || node->numCon( false, false ) > 0;
+	m_pSerialPort->setWatchLines( linesUsed );
+
+	// The port's I/O thread does the system calls; all we do here is pick
+	// up what it has seen
+	SerialPort::Event event;
+	while ( m_pSerialPort->takeEvent( event ) )
+	{
+		if ( event.type == SerialPort::Event::LinesChanged )
+		{
+			m_pCD->setHigh( m_pSerialPort->pinState( SerialPort::CD ) );
+			m_pCTS->setHigh( m_pSerialPort->pinState( SerialPort::CTS ) );
+			m_pRI->setHigh( m_pSerialPort->pinState( SerialPort::RI ) );
+		}
+		else if ( m_bUART )
+			m_rdEncoder.queue( event.byte );
+	}
+
+	if ( !m_bUART )
+		return;
+
+	const int byte = m_tdDecoder.update( Simulator::self()->time(), m_pTD->isHigh() );
+	if ( byte != -1 )
+		m_pSerialPort->writeByte( byte );
+
+	// Component callbacks cannot be detached from within the logic update
+	// loop, so it is done from here
+	setRDCallback( !m_rdEncoder.isIdle() );
+}
+
+
+void SerialPortComponent::stepRD()
+{
+	m_pRD->setHigh( m_rdEncoder.level( Simulator::self()->time() ) );
+}
+
+
+void SerialPortComponent::setRDCallback( bool attached )
+{
+	if ( attached == m_bRDCallback )
+		return;
+
+	m_bRDCallback = attached;
+	if ( attached )
+		Simulator::self()->attachComponentCallback( this, (VoidCallbackPtr)(&SerialPortComponent::stepRD) );
+	else
+	{
+		Simulator::self()->detachComponentCallbacks(*this);
+		m_pRD->setHigh( m_bUART );
+	}
 }
 
 
 void SerialPortComponent::tdCallback( bool isHigh )
 {
-	m_pSerialPort->setPinState( SerialPort::TD, isHigh );
+	if ( !m_bUART )
+	{
+		m_pSerialPort->setPinState( SerialPort::TD, isHigh );
+		return;
+	}
+
+	const int byte = m_tdDecoder.update( Simulator::self()->time(), isHigh );
+	if ( byte != -1 )
+		m_pSerialPort->writeByte( byte );
 }
 
 
@@ -228,3 +289,115 @@ void SerialPortComponent::drawShape( QPainter & p )
 {
 	drawPortShape( p );
 }
+
+
+//BEGIN class UartDecoder
+int UartDecoder::update( long long time, bool level )
+{
+	int received = -1;
+
+	// The line was at m_level over [m_lastTime, time); sample any bits whose
+	// middle is in there
+	for (;;)
+	{
+		if ( m_bWaitForIdle )
+		{
+			if ( !m_level )
+				break;
+			m_bWaitForIdle = false;
+		}
+
+		if ( !m_bInFrame )
+		{
+			// Frames begin at a falling edge, which is always at m_lastTime
+			if ( m_level )
+				break;
+			m_bInFrame = true;
+			m_frameStart = m_lastTime;
+			m_bit = 0;
+			m_byte = 0;
+		}
+
+		if ( m_frameStart + (m_bit + 0.5) * m_bitPeriod >= time )
+			break;
+
+		if ( m_bit == 0 )
+		{
+			// A glitch rather than a start bit
+			if ( m_level )
+				m_bInFrame = false;
+		}
+		else if ( m_bit <= 8 )
+		{
+			if ( m_level )
+				m_byte |= 1 << (m_bit - 1);
+		}
+		else
+		{
+			m_bInFrame = false;
+			if ( m_level )
+				received = m_byte;
+			else
+				m_bWaitForIdle = true;
+			continue;
+		}
+
+		++m_bit;
+	}
+
+	m_level = level;
+	m_lastTime = time;
+	return received;
+}
+
+
+void UartDecoder::reset()
+{
+	m_level = true;
+	m_bInFrame = false;
+	m_bWaitForIdle = false;
+}
+//END class UartDecoder
+
+
+//BEGIN class UartEncoder
+bool UartEncoder::level( long long time )
+{
+	for (;;)
+	{
+		if ( !m_bInFrame )
+		{
+			if ( m_pending.empty() )
+				return true;
+			m_bInFrame = true;
+			m_frameStart = time;
+			m_byte = m_pending.front();
+			m_pending.pop_front();
+		}
+
+		const int bit = int( (time - m_frameStart) / m_bitPeriod );
+		if ( bit == 0 )
+			return false;
+		if ( bit <= 8 )
+			return m_byte & (1 << (bit - 1));
+		if ( bit == 9 )
+			return true;
+
+		// Send the next byte straight after the stop bit
+		m_bInFrame = false;
+		if ( m_pending.empty() )
+			return true;
+		m_bInFrame = true;
+		m_frameStart += 10 * m_bitPeriod;
+		m_byte = m_pending.front();
+		m_pending.pop_front();
+	}
+}
+
+
+void UartEncoder::reset()
+{
+	m_pending.clear();
+	m_bInFrame = false;
+}
+//END class UartEncoder
@@ -14,9 +14,80 @@
 #include "logic.h"
 #include "component.h"
 
+#include <deque>
+
+#include <termios.h>
+
+class ECNode;
 class SerialPort;
 
 /**
+Turns the logic level of a line into bytes, as received by a UART: idle high,
+a low start bit, 8 data bits (least significant first) and a high stop bit.
+Times are in simulator ticks (1/LOGIC_UPDATE_RATE).
+*/
+class UartDecoder
+{
+	public:
+		void setBitPeriod( double ticks ) { m_bitPeriod = ticks; }
+		/**
+		 * The line has been at its previous level up until time, and is at
+		 * level from then on. Also call this (with the same level)
+		 * periodically, so that the last byte is not held back until the
+		 * next edge.
+		 * @return the byte completed by this, or -1 if none was.
+		 */
+		int update( long long time, bool level );
+		void reset();
+
+	protected:
+		double m_bitPeriod = 1.0;
+		double m_frameStart = 0.0;
+		long long m_lastTime = 0;
+		int m_bit = 0; ///< Next bit to sample; 0 is the start bit, 9 the stop bit
+		uint8 m_byte = 0;
+		bool m_level = true;
+		bool m_bInFrame = false;
+		bool m_bWaitForIdle = false; ///< After a framing error
+};
+
+
+/**
+Generates the logic level of a line sending bytes as a UART, in the same
+format as UartDecoder.
+*/
+class UartEncoder
+{
+	public:
+		void setBitPeriod( double ticks ) { m_bitPeriod = ticks; }
+		void queue( uint8 byte ) { m_pending.push_back( byte ); }
+		/**
+		 * @return the level of the line at the given time, which must not
+		 * be earlier than the time last passed to this.
+		 */
+		bool level( long long time );
+		/**
+		 * @return true if there is nothing being or waiting to be sent.
+		 */
+		bool isIdle() const { return !m_bInFrame && m_pending.empty(); }
+		void reset();
+
+	protected:
+		std::deque<uint8> m_pending;
+		double m_bitPeriod = 1.0;
+		double m_frameStart = 0.0;
+		uint8 m_byte = 0;
+		bool m_bInFrame = false;
+};
+
+
+/**
+Connects the circuit to a serial port of the computer. In the "modem lines"
+mode, TD and DTR set the port's lines (TD as a break) and CD, CTS and RI
+follow the port's lines. In the UART mode, the logic levels on TD are also
+decoded into bytes that are sent at the configured baud rate, and bytes that
+are received are sent on RD.
+
 @author David Saxton
 */
 class SerialPortComponent : public CallbackClass, public Component
@@ -35,7 +106,7 @@ class SerialPortComponent : public CallbackClass, public Component
 		/**
 		 * @param baudRate as defined in <bits/termios.h>
 		 */
-		void initPort( const QString & port, unsigned baudRate );
+		void initPort( const QString & port, speed_t baudRate );
 		void dataChanged() override;
 		void drawShape( QPainter & p ) override;
 
@@ -43,6 +114,11 @@ class SerialPortComponent : public CallbackClass, public Component
 		void dtrCallback( bool isHigh );
 		void dsrCallback( bool isHigh );
 		void rtsCallback( bool isHigh );
+		/**
+		 * Attached to the logic update loop while bytes are being sent on RD.
+		 */
+		void stepRD();
+		void setRDCallback( bool attached );
 
 		LogicIn * m_pTD;
 		LogicIn * m_pDTR;
@@ -50,11 +126,19 @@ class SerialPortComponent : public CallbackClass, public Component
 // 		LogicIn * m_pRTS;
 
 		LogicOut * m_pCD;
-// 		LogicOut * m_pRD;
+		LogicOut * m_pRD;
 		LogicOut * m_pCTS;
 		LogicOut * m_pRI;
+		/// The nodes of CD, CTS and RI
+		ECNode * m_lineNodes[3];
 
 		SerialPort * m_pSerialPort;
+		UartDecoder m_tdDecoder;
+		UartEncoder m_rdEncoder;
+		QString m_portName;
+		speed_t m_baudRate;
+		bool m_bUART;
+		bool m_bRDCallback;
 };
 
 #endif
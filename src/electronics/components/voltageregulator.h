@@ -44,6 +44,7 @@ class VoltageRegulator final : public Component
 	private:
 		void dataChanged() override;
 		void drawShape( QPainter &p ) override;
+		QString glyphKey() const override { return type(); }
 
 		// Input.
 		// Output.
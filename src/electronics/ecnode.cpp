@@ -78,20 +78,25 @@ void ECNode::setNodeChanged()
 {
 	if ( !canvas() || numPins() != 1 ) return;
 
-	auto &pin = m_pins[0];
+	const quint64 key = voltageDisplayKey();
 
-	double v = pin->voltage();
-	double i = pin->current();
-
-	if ( v != m_prevV || i != m_prevI ) {
+	if ( key != m_prevDisplayKey ) {
 		auto r = boundingRect();
 		canvas()->setChanged(r);
-		m_prevV = v;
-		m_prevI = i;
+		m_prevDisplayKey = key;
 	}
 }
 
 
+quint64 ECNode::voltageDisplayKey() const
+{
+	if ( !m_bShowVoltageColor ) return 0;
+
+	const double v = m_pins[0]->voltage();
+	return Component::voltageColor(v).rgb();
+}
+
+
 void ECNode::setParentItem( CNItem * parentItem )
 {
 	Node::setParentItem(parentItem);
@@ -67,6 +67,10 @@ class ECNode : public Node
 		void setShowVoltageBars( bool show ) { m_bShowVoltageBars = show; }
 		bool showVoltageColor() const { return m_bShowVoltageColor; }
 		void setShowVoltageColor( bool show ) { m_bShowVoltageColor = show; }
+		/**
+		 * Invalidates the node on the canvas if the voltage/current indicators
+		 * it draws have visibly changed since it was last invalidated.
+		 */
 		void setNodeChanged();
 
 		/**
@@ -145,8 +149,14 @@ class ECNode : public Node
 		QPtrList<Connector> m_connectorList;
 		PinVector m_pins;
 		KtlQCanvasRectangle * m_pinPoint = nullptr;
-		double m_prevV = 0;
-		double m_prevI = 0;
+		/**
+		 * @return a value that changes whenever the way the voltage and current
+		 * at the pin are drawn changes (e.g. the voltage colour or the length
+		 * of the voltage bar). Used by setNodeChanged to skip invisible changes.
+		 */
+		virtual quint64 voltageDisplayKey() const;
+
+		quint64 m_prevDisplayKey = 0;
 		bool m_bShowVoltageBars;
 		bool m_bShowVoltageColor;
 
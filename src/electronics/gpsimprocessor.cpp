@@ -21,9 +21,13 @@
 #include "processchain.h"
 #include "simulator.h"
 
+#include <algorithm>
 #include <cassert>
 
+#include <qdatastream.h>
+#include <qdatetime.h>
 #include <qdebug.h>
+#include <qfileinfo.h>
 #include <klocalizedstring.h>
 #include <kmessagebox.h>
 #include <ktemporaryfile.h>
@@ -42,6 +46,10 @@
 #include "gpsim/sim_context.h"
 
 bool bDoneGpsimInit = false;
+
+// Identifies the source-line cache written next to the symbol file
+static constexpr const quint32 lineCacheMagic = 0x4B544C44; // "KTLD"
+static constexpr const quint32 lineCacheVersion = 1;
 bool bUseGUI = true;
 // extern "C" void initialize_gpsim();
 // void initialize_gpsim(void);
@@ -82,7 +90,11 @@ GpsimProcessor::GpsimProcessor( QString symbolFile, QObject *parent )
 		bDoneGpsimInit = true;
 	}
 
-	m_bCanExecuteNextCycle = true;
+	m_cycleBudget = 0.0;
+	m_frequency = defaultFrequency;
+	m_cyclesPerUpdate = m_frequency / 4.0 / LOGIC_UPDATE_RATE;
+	m_nextRegisterUpdate = 0;
+	m_bSyncRequested = false;
 	m_bIsRunning = false;
 	m_pPicProcessor = 0l;
 	m_codLoadStatus = CodUnknown;
@@ -132,6 +144,7 @@ GpsimProcessor::GpsimProcessor( QString symbolFile, QObject *parent )
 
 	if ( codLoadStatus() == CodSuccess )
 	{
+		m_pPicProcessor->set_frequency( m_frequency );
 		m_pRegisterMemory = new RegisterSet( m_pPicProcessor );
 		m_pDebugger[0] = new GpsimDebugger( GpsimDebugger::AsmDebugger, this );
 		m_pDebugger[1] = new GpsimDebugger( GpsimDebugger::HLLDebugger, this );
@@ -233,43 +246,72 @@ void GpsimProcessor::setRunning( bool run )
 }
 
 
+void GpsimProcessor::setFrequency( double frequency )
+{
+	if ( frequency <= 0.0 || frequency == m_frequency )
+		return;
+
+	m_frequency = frequency;
+	m_cyclesPerUpdate = m_frequency / 4.0 / LOGIC_UPDATE_RATE;
+
+	if ( m_pPicProcessor )
+		m_pPicProcessor->set_frequency( m_frequency );
+}
+
+
 void GpsimProcessor::executeNext()
 {
 	if ( !m_bIsRunning )
 		return;
 
-	if ( !m_bCanExecuteNextCycle )
-	{
-		m_bCanExecuteNextCycle = true;
-		return;
-	}
+	// Cycles left over from stopping early for pin changes are caught up on,
+	// but only up to a logic update's worth, so that a program changing pins
+	// more often than the circuit updates doesn't build up an endless backlog
+	m_cycleBudget = std::min( m_cycleBudget, m_cyclesPerUpdate ) + m_cyclesPerUpdate;
+	m_bSyncRequested = false;
 
-	unsigned long long beforeExecuteCount = get_cycles().get();
+	Cycle_Counter &cycles = get_cycles();
 
-	if(get_bp().have_interrupt())
+	while ( m_cycleBudget > 0.0 )
 	{
-		m_pPicProcessor->interrupt();
-	}
-	else
-	{
-		m_pPicProcessor->step_one(false); // Don't know what the false is for; gpsim ignores its value anyway
+		const unsigned long long beforeExecuteCount = cycles.get();
 
-		// Some instructions take more than one cycle to execute, so ignore next cycle if this was the case
-		if ( (get_cycles().get() - beforeExecuteCount) > 1 )
-			m_bCanExecuteNextCycle = false;
-	}
+		if ( get_bp().have_interrupt() )
+			m_pPicProcessor->interrupt();
+		else
+			m_pPicProcessor->step_one(false); // Don't know what the false is for; gpsim ignores its value anyway
+
+		// Some instructions take more than one cycle to execute
+		const unsigned long long executed = cycles.get() - beforeExecuteCount;
+		m_cycleBudget -= (executed > 0) ? double(executed) : 1.0;
+
+		currentDebugger()->checkForBreak();
 
-	currentDebugger()->checkForBreak();
+		// A breakpoint stops us, and a pin change must reach the circuit
+		// before the program sees its effect on other pins
+		if ( !m_bIsRunning )
+		{
+			m_cycleBudget = 0.0;
+			break;
+		}
+		if ( m_bSyncRequested )
+			break;
+	}
 
-	// Let's also update the values of RegisterInfo every 25 milliseconds
-	if ( (beforeExecuteCount % 10000) == 0 )
+	// Let's also update the values of RegisterInfo every 10000 cycles
+	if ( cycles.get() >= m_nextRegisterUpdate )
+	{
 		registerMemory()->update();
+		m_nextRegisterUpdate = cycles.get() + 10000;
+	}
 }
 
 
 void GpsimProcessor::reset()
 {
 	bool wasRunning = isRunning();
+	m_cycleBudget = 0.0;
+	m_nextRegisterUpdate = 0;
 	m_pPicProcessor->reset(SIM_RESET);
 	setRunning(false);
 	if (!wasRunning)
@@ -466,15 +508,7 @@ GpsimDebugger::GpsimDebugger( Type type, GpsimProcessor * gpsim )
 	connect( m_pGpsim, SIGNAL(runningStatusChanged(bool )), this, SLOT(gpsimRunningStatusChanged(bool )) );
 
 	if ( type == HLLDebugger )
-	{
-		const QStringList sourceFileList = m_pGpsim->sourceFileList();
-		QStringList::const_iterator sflEnd = sourceFileList.end();
-		for ( QStringList::const_iterator it = sourceFileList.begin(); it != sflEnd; ++it )
-		{
-			AsmParser p(*it);
-			p.parse(this);
-		}
-	}
+		loadSourceLineMap();
 
 	initAddressToLineMap();
 }
@@ -534,6 +568,111 @@ void GpsimDebugger::associateLine( const QString & sourceFile, int sourceLine, c
 }
 
 
+void GpsimDebugger::loadSourceLineMap()
+{
+	const QStringList sourceFileList = m_pGpsim->sourceFileList();
+	if ( readLineCache(sourceFileList) )
+		return;
+
+	m_sourceLineMap.clear();
+	QStringList::const_iterator sflEnd = sourceFileList.end();
+	for ( QStringList::const_iterator it = sourceFileList.begin(); it != sflEnd; ++it )
+	{
+		AsmParser p(*it);
+		p.parse(this);
+	}
+
+	writeLineCache(sourceFileList);
+}
+
+
+QString GpsimDebugger::lineCacheFile() const
+{
+	QString file = m_pGpsim->m_symbolFile;
+	if ( file.endsWith(".cod") )
+		file.chop(4);
+	return file + ".ktldebug";
+}
+
+
+bool GpsimDebugger::readLineCache( const QStringList & assemblyFiles )
+{
+	QFile file( lineCacheFile() );
+	if ( !file.open(QIODevice::ReadOnly) )
+		return false;
+
+	QDataStream stream( &file );
+	stream.setVersion( QDataStream::Qt_5_0 );
+
+	quint32 magic, version, fileCount;
+	stream >> magic >> version >> fileCount;
+	if ( magic != lineCacheMagic || version != lineCacheVersion || fileCount != quint32(assemblyFiles.size()) )
+		return false;
+
+	// The cache is only good if it was made from exactly these assembly files
+	for ( const QString & assemblyFile : assemblyFiles )
+	{
+		QString path;
+		qint64 size, modified;
+		stream >> path >> size >> modified;
+
+		const QFileInfo info(assemblyFile);
+		if ( path != assemblyFile || size != info.size() || modified != info.lastModified().toMSecsSinceEpoch() )
+			return false;
+	}
+
+	quint32 count;
+	stream >> count;
+
+	SourceLineMap sourceLineMap;
+	for ( quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i )
+	{
+		QString asmFile, sourceFile;
+		qint32 asmLine, sourceLine;
+		stream >> asmFile >> asmLine >> sourceFile >> sourceLine;
+		sourceLineMap.insert( SourceLine( asmFile, asmLine ), SourceLine( sourceFile, sourceLine ) );
+	}
+
+	if ( stream.status() != QDataStream::Ok )
+		return false;
+
+	m_sourceLineMap = sourceLineMap;
+	return true;
+}
+
+
+void GpsimDebugger::writeLineCache( const QStringList & assemblyFiles ) const
+{
+	QFile file( lineCacheFile() );
+	if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) )
+	{
+		qWarning() << Q_FUNC_INFO << "Could not write" << file.fileName();
+		return;
+	}
+
+	QDataStream stream( &file );
+	stream.setVersion( QDataStream::Qt_5_0 );
+
+	stream << lineCacheMagic << lineCacheVersion << quint32(assemblyFiles.size());
+	for ( const QString & assemblyFile : assemblyFiles )
+	{
+		const QFileInfo info(assemblyFile);
+		stream << assemblyFile << qint64(info.size()) << qint64(info.lastModified().toMSecsSinceEpoch());
+	}
+
+	stream << quint32(m_sourceLineMap.size());
+	SourceLineMap::const_iterator slmEnd = m_sourceLineMap.end();
+	for ( SourceLineMap::const_iterator it = m_sourceLineMap.begin(); it != slmEnd; ++it )
+		stream << it.key().fileName() << qint32(it.key().line()) << it.value().fileName() << qint32(it.value().line());
+
+	if ( stream.status() != QDataStream::Ok || !file.flush() )
+	{
+		qWarning() << Q_FUNC_INFO << "Could not write" << file.fileName();
+		file.remove();
+	}
+}
+
+
 void GpsimDebugger::initAddressToLineMap()
 {
 	m_addressSize = m_pGpsim->programMemorySize();
@@ -607,6 +746,20 @@ void GpsimDebugger::initAddressToLineMap()
 				delete debugLine;
 		}
 	}
+
+	updateAddressFlags();
+}
+
+
+void GpsimDebugger::updateAddressFlags()
+{
+	m_addressFlags.assign( m_addressSize, 0 );
+
+	for ( unsigned i = 0; i < m_addressSize; ++i )
+	{
+		if ( DebugLine * dl = m_addressToLineMap[i] )
+			m_addressFlags[i] = HasLine | (dl->isBreakpoint() ? IsBreakpoint : 0);
+	}
 }
 
 
@@ -620,6 +773,8 @@ void GpsimDebugger::setBreakpoints( const QString & path, const IntList & lines
 
 		dl->setBreakpoint( lines.contains( dl->line() ) );
 	}
+
+	updateAddressFlags();
 }
 
 
@@ -634,6 +789,8 @@ void GpsimDebugger::setBreakpoint( const QString & path, int line, bool isBreakp
 					( line == m_addressToLineMap[i]->line() ) )
 			m_addressToLineMap[i]->setBreakpoint(isBreakpoint);
 	}
+
+	updateAddressFlags();
 }
 
 
@@ -665,7 +822,13 @@ void GpsimDebugger::emitLineReached()
 
 void GpsimDebugger::checkForBreak()
 {
-	DebugLine * currentLine = m_addressToLineMap[ m_pGpsim->picProcessor()->pc->get_value() ];
+	const unsigned pc = m_pGpsim->picProcessor()->pc->get_value();
+
+	// Unless we are stepping, only a breakpoint on this address can stop us
+	if ( m_stackLevelLowerBreak < 0 && !(m_addressFlags[pc] & IsBreakpoint) )
+		return;
+
+	DebugLine * currentLine = m_addressToLineMap[pc];
 	int currentStackLevel = int( m_pGpsim->picProcessor()->stack->pointer & m_pGpsim->picProcessor()->stack->stack_mask );
 
 	bool ontoNextLine = m_pBreakFromOldLine != currentLine;
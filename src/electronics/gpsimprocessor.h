@@ -22,6 +22,8 @@
 #include <qlist.h>
 #include <QVector>
 
+#include <vector>
+
 class DebugLine;
 class GpsimProcessor;
 class MicroInfo;
@@ -223,13 +225,39 @@ class GpsimDebugger : public QObject
 		void gpsimRunningStatusChanged( bool isRunning );
 
 	protected:
+		/**
+		 * Per program address flags, kept alongside m_addressToLineMap so that
+		 * checkForBreak usually only has to look at one byte.
+		 */
+		enum AddressFlag
+		{
+			HasLine = 1 << 0,
+			IsBreakpoint = 1 << 1
+		};
+
 		void initAddressToLineMap();
+		/**
+		 * Recalculates m_addressFlags from m_addressToLineMap.
+		 */
+		void updateAddressFlags();
+		/**
+		 * Fills m_sourceLineMap from the source-line markers in the assembly
+		 * files, using the cache next to the symbol file if it is up to date.
+		 */
+		void loadSourceLineMap();
+		/**
+		 * @return the file that the source-line associations are cached in.
+		 */
+		QString lineCacheFile() const;
+		bool readLineCache( const QStringList & assemblyFiles );
+		void writeLineCache( const QStringList & assemblyFiles ) const;
 		void stackStep( int dl );
 		void emitLineReached();
 
 		int m_stackLevelLowerBreak; // Set by step-over, for when the stack level decreases to the one given
 		SourceLine m_previousAtLineEmit; // Used for working out whether we should emit a new line reached signal
 		DebugLine ** m_addressToLineMap;
+		std::vector<uint8> m_addressFlags;
 		DebugLine * m_pBreakFromOldLine;
 		GpsimProcessor * m_pGpsim;
 		Type m_type;
@@ -303,10 +331,27 @@ class GpsimProcessor : public QObject
 		 */
 		bool isRunning() const { return m_bIsRunning; }
 		/**
-		 * Execute the next program instruction. If we are not in a running
-		 * mode, then this function will do nothing.
+		 * Execute the program instructions due in this logic update (one
+		 * instruction cycle per logic update at the default 4MHz). The
+		 * instructions are run in one batch, which stops early if a pin of
+		 * the PIC changes state or a breakpoint is reached; cycles that are
+		 * left over are run in the next logic update. If we are not in a
+		 * running mode, then this function will do nothing.
 		 */
 		void executeNext();
+		/**
+		 * Called (by PICComponentPin) when an output pin of the PIC has
+		 * changed state, so that executeNext lets the circuit catch up before
+		 * running any further instructions.
+		 */
+		void requestSync() { m_bSyncRequested = true; }
+		/**
+		 * Sets the oscillator frequency of the PIC, in Hz. The PIC executes
+		 * one instruction cycle for every four oscillator cycles.
+		 */
+		void setFrequency( double frequency );
+		double frequency() const { return m_frequency; }
+		static constexpr const double defaultFrequency = 4e6;
 		/**
 		 * Reset all parts of the simulation. Gpsim will not run until
 		 * setRunning(true) is called. Breakpoints are not affected.
@@ -377,12 +422,23 @@ class GpsimProcessor : public QObject
 		GpsimDebugger * m_pDebugger[2]; // Asm, HLL
 
 		/**
-		 * We are called effectively for each cycle of the cycle of the
-		 * processor. This value is used as some instructions (e.g. goto) take
-		 * two cycles to execute, and so we must ignore one cycle to ensure
-		 * realtime simulation.
+		 * Instruction cycles that are due to be executed. This goes up by
+		 * m_cyclesPerUpdate with each logic update, and down by the number of
+		 * cycles each instruction took (some instructions, e.g. goto, take two
+		 * cycles to execute). It may go negative, in which case the next
+		 * logic updates are skipped to ensure realtime simulation.
+		 */
+		double m_cycleBudget;
+		/**
+		 * Instruction cycles per logic update, from the oscillator frequency.
+		 */
+		double m_cyclesPerUpdate;
+		double m_frequency;
+		/**
+		 * Processor cycle at which the register memory is next updated.
 		 */
-		bool m_bCanExecuteNextCycle;
+		unsigned long long m_nextRegisterUpdate;
+		bool m_bSyncRequested;
 
 	private:
 		bool m_bIsRunning;
@@ -68,6 +68,11 @@ class Pin final : public QObject {
 		 * connected to via a switch.
 		 */
 		void setSwitchConnected(Pin *pin, bool isConnected);
+		/**
+		 * The pins that this pin is connected to via closed switches.
+		 * @see localConnectedPins
+		 */
+		const QPtrSet<Pin> & switchConnectedPins() const { return m_switchConnectedPins; }
 		/**
 		 * After calculating the nodal voltages in the circuit, this function should
 		 * be called to tell the pin what its voltage is.
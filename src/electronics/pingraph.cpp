@@ -0,0 +1,73 @@
+#include "pingraph.h"
+#include "pin.h"
+#include "wire.h"
+
+#include <algorithm>
+
+//BEGIN class PinGraph
+void PinGraph::addPin( Pin *pin ) {
+	if (!pin || m_ids.contains(pin)) {
+		return;
+	}
+
+	m_ids.insert(pin, size());
+	m_pins.push_back(pin);
+}
+
+void PinGraph::addEdge( Pin *target, EdgeType type ) {
+	const int targetId = id(target);
+	if (targetId == -1) {
+		return;
+	}
+
+	m_targets.push_back(targetId);
+	m_edgeTypes.push_back(type);
+}
+
+void PinGraph::buildEdges( uint8 edgeTypes ) {
+	m_offsets.resize(m_pins.size() + 1);
+	m_marks.assign(m_pins.size(), 0);
+	m_stack.reserve(m_pins.size());
+
+	for (int i = 0; i < size(); ++i) {
+		m_offsets[i] = int(m_targets.size());
+		Pin *pin = m_pins[i];
+
+		// The same as Pin::localConnectedPins, without building the list
+		if (edgeTypes & Local) {
+			for (auto &wire : pin->inputWireList()) {
+				if (wire) addEdge(wire->startPin(), Local);
+			}
+			for (auto &wire : pin->outputWireList()) {
+				if (wire) addEdge(wire->endPin(), Local);
+			}
+			for (auto &other : pin->switchConnectedPins()) {
+				addEdge(other, Local);
+			}
+		}
+
+		if (edgeTypes & GroundDependent) {
+			for (auto &other : pin->groundDependentPins()) {
+				addEdge(other, GroundDependent);
+			}
+		}
+
+		if (edgeTypes & CircuitDependent) {
+			for (auto &other : pin->circuitDependentPins()) {
+				addEdge(other, CircuitDependent);
+			}
+		}
+	}
+
+	m_offsets[size()] = int(m_targets.size());
+}
+
+uint32 PinGraph::newEpoch() const {
+	if (++m_epoch == 0) {
+		// Wrapped around, so old marks could be mistaken for new ones
+		std::fill(m_marks.begin(), m_marks.end(), 0);
+		m_epoch = 1;
+	}
+	return m_epoch;
+}
+//END class PinGraph
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include <QHash>
+
+#include <vector>
+
+class Pin;
+
+/**
+@short Flat adjacency structure over a set of pins, for assigning circuits.
+
+The pins are given dense ids (in the order they were added), and the pins
+that each one is connected to or depends on are stored as ids in one array,
+so walking the pin graph needs neither the temporary lists built by
+Pin::localConnectedPins nor sets of guarded pointers. Edges to pins outside
+the graph are left out.
+
+Walks are iterative, so long chains of pins can't overflow the stack. The
+walks reuse buffers held by the graph, so a graph must not be walked from
+several threads at once.
+*/
+class PinGraph final {
+	public:
+		enum EdgeType : uint8 {
+			Local = 1 << 0, ///< Wires and closed switches; see Pin::localConnectedPins
+			GroundDependent = 1 << 1, ///< See Pin::groundDependentPins
+			CircuitDependent = 1 << 2, ///< See Pin::circuitDependentPins
+			AllEdges = Local | GroundDependent | CircuitDependent
+		};
+
+		/**
+		 * Builds the graph of the given pins with the edges of the given types.
+		 * Null and repeated pins are skipped.
+		 */
+		template <typename Pins>
+		explicit PinGraph( const Pins &pins, uint8 edgeTypes = AllEdges ) {
+			m_pins.reserve(pins.size());
+			m_ids.reserve(pins.size());
+			for (const auto &pin : pins) {
+				addPin(pin);
+			}
+			buildEdges(edgeTypes);
+		}
+
+		int size() const { return int(m_pins.size()); }
+		Pin * pin( int id ) const { return m_pins[id]; }
+		/**
+		 * @return the id of the given pin, or -1 if it is not in the graph.
+		 */
+		int id( Pin *pin ) const { return m_ids.value(pin, -1); }
+
+		/**
+		 * Calls edge(target) for every edge of the given types from the pin.
+		 */
+		template <typename Edge>
+		void forEachEdge( int id, uint8 edgeTypes, Edge edge ) const {
+			for (int e = m_offsets[id]; e < m_offsets[id + 1]; ++e) {
+				if (m_edgeTypes[e] & edgeTypes) {
+					edge(m_targets[e]);
+				}
+			}
+		}
+
+		/**
+		 * Calls visit(id) once for every pin reachable from start along edges
+		 * of the given types, including start. Edges are not followed out of
+		 * pins for which expand(id) returns false (those pins are still
+		 * visited). Neither function may walk the graph itself.
+		 */
+		template <typename Expand, typename Visit>
+		void walk( int start, uint8 edgeTypes, Expand expand, Visit visit ) const {
+			walk(start, edgeTypes, [](int) { return true; }, expand, visit);
+		}
+
+		/**
+		 * Splits the pins in starts (or all pins, if starts is null) into
+		 * groups: taking each pin that isn't in a group yet, the pins reachable
+		 * from it along edges of the given types that aren't in a group yet.
+		 * Calls group(ids) with each group; it may walk the graph.
+		 */
+		template <typename Group>
+		void forEachGroup( const std::vector<int> *starts, uint8 edgeTypes, Group group ) const {
+			std::vector<bool> grouped(m_pins.size(), false);
+			std::vector<int> ids;
+
+			const auto visitFrom = [&](int start) {
+				if (grouped[start]) return;
+				ids.clear();
+				walk(
+					start,
+					edgeTypes,
+					[&grouped](int id) { return !grouped[id]; },
+					[](int) { return true; },
+					[&ids](int id) { ids.push_back(id); }
+				);
+				for (int id : ids) {
+					grouped[id] = true;
+				}
+				group(ids);
+			};
+
+			if (starts) {
+				for (int start : *starts) visitFrom(start);
+			}
+			else {
+				for (int start = 0; start < size(); ++start) visitFrom(start);
+			}
+		}
+
+	private:
+		void addPin( Pin *pin );
+		void buildEdges( uint8 edgeTypes );
+		void addEdge( Pin *target, EdgeType type );
+		uint32 newEpoch() const;
+
+		/**
+		 * As the public walk, but pins for which enter(id) returns false are
+		 * not gone to from other pins.
+		 */
+		template <typename Enter, typename Expand, typename Visit>
+		void walk( int start, uint8 edgeTypes, Enter &&enter, Expand &&expand, Visit &&visit ) const {
+			const uint32 epoch = newEpoch();
+			m_stack.clear();
+			m_stack.push_back(start);
+			m_marks[start] = epoch;
+
+			while (!m_stack.empty()) {
+				const int id = m_stack.back();
+				m_stack.pop_back();
+
+				visit(id);
+				if (!expand(id)) continue;
+
+				forEachEdge(id, edgeTypes, [&](int target) {
+					if (m_marks[target] == epoch || !enter(target)) return;
+					m_marks[target] = epoch;
+					m_stack.push_back(target);
+				});
+			}
+		}
+
+		std::vector<Pin *> m_pins;
+		QHash<Pin *, int> m_ids;
+		/// The edges of pin i are m_targets[m_offsets[i]] to m_targets[m_offsets[i + 1] - 1]
+		std::vector<int> m_offsets;
+		std::vector<int> m_targets;
+		std::vector<uint8> m_edgeTypes;
+
+		/// A pin has been reached by the current walk if its mark is the walk's epoch
+		mutable std::vector<uint32> m_marks;
+		mutable uint32 m_epoch = 0;
+		mutable std::vector<int> m_stack;
+};
@@ -120,6 +120,23 @@ void PinNode::drawShape( QPainter & p )
 }
 
 
+quint64 PinNode::voltageDisplayKey() const
+{
+	quint64 key = ECNode::voltageDisplayKey();
+
+	if ( m_bShowVoltageBars && pin() )
+	{
+		const double v = pin()->voltage();
+		const int length = calcLength( v );
+		const int thickness = (length != 0) ? calcThickness( calcIProp( pin()->current() ) ) : 0;
+
+		key ^= (quint64(quint8(length)) << 32) | (quint64(quint8(thickness)) << 40);
+	}
+
+	return key;
+}
+
+
 void PinNode::initPoints()
 {
 	int l = - m_length;
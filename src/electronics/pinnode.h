@@ -34,6 +34,7 @@ public:
 	
 protected:
 	void initPoints() override;
+	quint64 voltageDisplayKey() const override;
 };
 
 #endif
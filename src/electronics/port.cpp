@@ -19,6 +19,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
@@ -51,8 +52,11 @@ QStringList Port::ports( unsigned probeResult )
 
 //BEGIN class SerialPort
 SerialPort::SerialPort()
+	: m_bStopping(false), m_bWatchLines(false), m_overruns(0)
 {
 	m_file = -1;
+	m_wakePipe[0] = m_wakePipe[1] = -1;
+	m_lines = 0;
 }
 
 
@@ -66,71 +70,50 @@ void SerialPort::setPinState( Pin pin, bool state )
 {
 	if ( m_file == -1 )
 		return;
-	
-	int flags = -1;
-	
+
 	switch ( pin )
 	{
 		case TD:
-			ioctl( m_file, state ? TIOCSBRK : TIOCCBRK, 0 );
-			return;
-			
 		case DTR:
-			flags = TIOCM_DTR;
-			break;
-			
 		case DSR:
-			flags = TIOCM_DSR;
-			break;
-			
 		case RTS:
-			flags = TIOCM_RTS;
 			break;
-			
+
 		case CD:
 		case RD:
 		case GND:
 		case CTS:
 		case RI:
-			break;
+			qCritical() << Q_FUNC_INFO << "Bad pin " << pin << endl;
+			return;
 	};
-	
-	if ( flags == -1 )
-	{
-		qCritical() << Q_FUNC_INFO << "Bad pin " << pin << endl;
-		return;
-	}
-	
-	if ( ioctl( m_file, state ? TIOCMBIS : TIOCMBIC, & flags ) == -1 )
-		qCritical() << Q_FUNC_INFO << "Could not set pin " << pin << " errno = " << errno << endl;
+
+	pushCommand( Command{ Command::SetPin, 0, state, pin } );
 }
 
 
-bool SerialPort::pinState( Pin pin )
+bool SerialPort::pinState( Pin pin ) const
 {
-	if ( m_file == -1 )
-		return false;
-	
 	int mask = 0;
-	
+
 	switch ( pin )
 	{
 		case CD:
 			mask = TIOCM_CD;
 			break;
-			
+
 		case RD:
 			mask = TIOCM_SR;
 			break;
-			
+
 		case CTS:
 			mask = TIOCM_CTS;
 			break;
-			
+
 		case RI:
 			mask = TIOCM_RI;
 			break;
-			
+
 		case TD:
 		case DTR:
 		case GND:
@@ -138,24 +121,202 @@ bool SerialPort::pinState( Pin pin )
 		case RTS:
 			break;
 	}
-	
+
 	if ( mask == 0 )
 	{
 		qCritical() << Q_FUNC_INFO << "Bad pin " << pin << endl;
 		return false;
 	}
-	
-	int bits = 0;
-	if ( ioctl( m_file, TIOCMGET, & bits ) == -1 )
-	{
-		qCritical() << Q_FUNC_INFO << "Could not read pin" << pin << " errno = " << errno << endl;
+
+	return m_lines & mask;
+}
+
+
+void SerialPort::setWatchLines( bool watch )
+{
+	if ( m_bWatchLines.exchange( watch, std::memory_order_release ) == watch )
+		return;
+
+	if ( m_file != -1 )
+		wakeIoThread();
+}
+
+
+void SerialPort::writeByte( uint8 byte )
+{
+	if ( m_file == -1 )
+		return;
+
+	pushCommand( Command{ Command::WriteByte, byte, false, TD } );
+}
+
+
+bool SerialPort::takeEvent( Event & event )
+{
+	if ( m_file == -1 || !m_events.pop( event ) )
 		return false;
+
+	if ( event.type == Event::LinesChanged )
+		m_lines = event.lines;
+
+	return true;
+}
+
+
+void SerialPort::pushCommand( const Command & command )
+{
+	if ( !m_commands.push( command ) )
+	{
+		qWarning() << Q_FUNC_INFO << "Serial port is not keeping up; dropped command";
+		return;
 	}
-	
-	return bits & mask;
+
+	wakeIoThread();
+}
+
+
+void SerialPort::wakeIoThread()
+{
+	const char wake = 0;
+	if ( write( m_wakePipe[1], & wake, 1 ) == -1 && errno != EAGAIN )
+		qCritical() << Q_FUNC_INFO << "Could not wake I/O thread, errno = " << errno << endl;
 }
 
-		
+
+bool SerialPort::postEvent( const Event & event )
+{
+	return m_events.push( event );
+}
+
+
+void SerialPort::runCommand( const Command & command, std::vector<uint8> & txPending )
+{
+	if ( command.type == Command::WriteByte )
+	{
+		txPending.push_back( command.byte );
+		return;
+	}
+
+	int flags = 0;
+
+	switch ( command.pin )
+	{
+		case TD:
+			ioctl( m_file, command.state ? TIOCSBRK : TIOCCBRK, 0 );
+			return;
+
+		case DTR:
+			flags = TIOCM_DTR;
+			break;
+
+		case DSR:
+			flags = TIOCM_DSR;
+			break;
+
+		case RTS:
+			flags = TIOCM_RTS;
+			break;
+
+		default:
+			return;
+	}
+
+	// Pseudo-terminals have no modem lines, so don't complain about them
+	if ( ioctl( m_file, command.state ? TIOCMBIS : TIOCMBIC, & flags ) == -1 && errno != ENOTTY && errno != EINVAL )
+		qCritical() << Q_FUNC_INFO << "Could not set pin " << command.pin << " errno = " << errno << endl;
+}
+
+
+void SerialPort::ioLoop()
+{
+	// Pseudo-terminals (and some USB adapters) have no modem lines, in which
+	// case reading them fails and we stop trying. TIOCMIWAIT is not used as
+	// it cannot be interrupted to handle commands or to stop, so the lines
+	// are polled, but only while someone is watching them.
+	bool haveLines = true;
+	int lines = -1;
+
+	std::vector<uint8> txPending;
+	uint8 buffer[256];
+
+	pollfd fds[2];
+	fds[0].fd = m_file;
+	fds[1].fd = m_wakePipe[0];
+	fds[1].events = POLLIN;
+
+	while ( !m_bStopping.load( std::memory_order_acquire ) )
+	{
+		Command command;
+		while ( m_commands.pop( command ) )
+			runCommand( command, txPending );
+
+		if ( fds[0].fd == -1 )
+			txPending.clear();
+		else if ( !txPending.empty() )
+		{
+			const ssize_t written = write( m_file, txPending.data(), txPending.size() );
+			if ( written > 0 )
+				txPending.erase( txPending.begin(), txPending.begin() + written );
+			else if ( written == -1 && errno != EAGAIN && errno != EINTR )
+			{
+				qCritical() << Q_FUNC_INFO << "Could not write to port, errno = " << errno << endl;
+				txPending.clear();
+			}
+		}
+
+		const bool pollLines = haveLines && fds[0].fd != -1 && m_bWatchLines.load( std::memory_order_acquire );
+		if ( pollLines )
+		{
+			int bits = 0;
+			if ( ioctl( m_file, TIOCMGET, & bits ) == -1 )
+				haveLines = false;
+			else if ( bits != lines && postEvent( Event{ Event::LinesChanged, 0, bits } ) )
+				lines = bits;
+		}
+		else
+		{
+			// Report the lines again when watching starts
+			lines = -1;
+		}
+
+		fds[0].events = POLLIN | (txPending.empty() ? 0 : POLLOUT);
+		if ( poll( fds, 2, (pollLines && haveLines) ? LinePollInterval : -1 ) == -1 )
+		{
+			if ( errno == EINTR )
+				continue;
+			qCritical() << Q_FUNC_INFO << "poll failed, errno = " << errno << endl;
+			return;
+		}
+
+		if ( fds[1].revents & POLLIN )
+		{
+			while ( read( m_wakePipe[0], buffer, sizeof(buffer) ) > 0 )
+				;
+		}
+
+		if ( fds[0].revents & POLLIN )
+		{
+			const ssize_t count = read( m_file, buffer, sizeof(buffer) );
+			for ( ssize_t i = 0; i < count; ++i )
+			{
+				if ( !postEvent( Event{ Event::ByteReceived, buffer[i], 0 } ) )
+					m_overruns.fetch_add( 1, std::memory_order_relaxed );
+			}
+		}
+
+		if ( fds[0].revents & (POLLHUP | POLLERR | POLLNVAL) )
+		{
+			// E.g. the other end of a pseudo-terminal was closed. Stop
+			// watching the port (which would otherwise wake us up constantly)
+			// but keep handling commands until we are told to stop.
+			qWarning() << Q_FUNC_INFO << "Port hung up";
+			fds[0].fd = -1;
+			txPending.clear();
+		}
+	}
+}
+
+
 Port::ProbeResult SerialPort::probe( const QString & port )
 {
 	int file = open( port.toAscii(), O_NOCTTY | O_NONBLOCK | O_RDONLY );
@@ -176,26 +337,47 @@ Port::ProbeResult SerialPort::probe( const QString & port )
 bool SerialPort::openPort( const QString & port, speed_t baudRate )
 {
 	closePort();
-	
+
 	m_file = open( port.toAscii(), O_NOCTTY | O_NONBLOCK | O_RDWR );
 	if ( m_file == -1 )
 	{
 		qCritical() << Q_FUNC_INFO << "Could not open port " << port << endl;
 		return false;
 	}
-	
+
+	if ( pipe( m_wakePipe ) == -1 )
+	{
+		qCritical() << Q_FUNC_INFO << "Could not create pipe, errno = " << errno << endl;
+		close( m_file );
+		m_file = -1;
+		return false;
+	}
+
+	for ( int fd : m_wakePipe )
+		fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+
 	termios state;
 	tcgetattr( m_file, & state );
-	
+
 	// Save the previous state for restoration in close.
 	m_previousState = state;
-	
+
 	state.c_iflag = IGNBRK | IGNPAR;
 	state.c_oflag = 0;
-	state.c_cflag = baudRate | CS8 | CREAD | CLOCAL;
+	state.c_cflag = CS8 | CREAD | CLOCAL;
 	state.c_lflag = 0;
+	state.c_cc[VMIN] = 1;
+	state.c_cc[VTIME] = 0;
+	cfsetispeed( & state, baudRate );
+	cfsetospeed( & state, baudRate );
 	tcsetattr( m_file, TCSANOW, & state );
-	
+
+	m_lines = 0;
+	m_commands.clear();
+	m_events.clear();
+	m_bStopping.store( false, std::memory_order_relaxed );
+	m_ioThread = std::thread( & SerialPort::ioLoop, this );
+
 	return true;
 }
 
@@ -204,12 +386,46 @@ void SerialPort::closePort()
 {
 	if ( m_file == -1 )
 		return;
-	
+
+	m_bStopping.store( true, std::memory_order_release );
+	wakeIoThread();
+	m_ioThread.join();
+
 	ioctl( m_file, TIOCCBRK, 0 );
 	usleep(1);
 	tcsetattr( m_file, TCSANOW, & m_previousState );
 	close( m_file );
+	close( m_wakePipe[0] );
+	close( m_wakePipe[1] );
 	m_file = -1;
+	m_wakePipe[0] = m_wakePipe[1] = -1;
+	m_lines = 0;
+}
+
+
+speed_t SerialPort::baudRateConstant( unsigned baudRate )
+{
+	switch ( baudRate )
+	{
+		case 50: return B50;
+		case 75: return B75;
+		case 110: return B110;
+		case 134: return B134;
+		case 150: return B150;
+		case 200: return B200;
+		case 300: return B300;
+		case 600: return B600;
+		case 1200: return B1200;
+		case 1800: return B1800;
+		case 2400: return B2400;
+		case 4800: return B4800;
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		default: return B0;
+	}
 }
 
 
@@ -11,8 +11,14 @@
 #ifndef PORT_H
 #define PORT_H
 
+#include "common/spscqueue.hpp"
+
 #include <qstringlist.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include <termios.h>
 
 /**
@@ -41,7 +47,15 @@ class Port
 
 
 /**
-Abstraction for a serial port, allowing control over individual pins.
+Abstraction for a serial port, allowing control over individual pins or
+transferring bytes.
+
+While the port is open, a thread does all of the I/O on it: it applies pin
+changes and writes bytes queued by setPinState and writeByte, watches the
+modem lines (while setWatchLines is on) and reads received bytes. What it sees
+is posted as Events to be picked up with takeEvent. Both directions go through lock-free queues, so
+none of the functions below make system calls on the simulation's behalf
+(except to wake up the thread).
 
 @author David Saxton
  */
@@ -60,21 +74,69 @@ class SerialPort : public Port
 			CTS		= 8, // Clear to send
 			RI		= 9 // Ring indicator
 		};
-		
+
+		struct Event
+		{
+			enum Type : uint8
+			{
+				LinesChanged,	// The modem input lines changed; see pinState
+				ByteReceived	// byte was read from the port
+			};
+
+			Type type;
+			uint8 byte;
+			int lines; ///< TIOCM_* bits, for LinesChanged
+		};
+
+		/** Maximum number of events or commands that can be waiting */
+		static constexpr const uintsz QueueCapacity = 4096;
+		/** How often the modem lines are read while watched, in milliseconds */
+		static constexpr const int LinePollInterval = 1;
+
 		SerialPort();
 		~SerialPort() override;
-		
+
 		/**
-		 * Writes state (high or low) to the given pin.
+		 * Queues writing state (high or low) to the given pin. TD is set by
+		 * sending a break while it is high.
 		 */
 		void setPinState( Pin pin, bool state );
-		bool pinState( Pin pin );
-		
+		/**
+		 * @return the state of the given input pin, as of the last
+		 * Event::LinesChanged returned by takeEvent.
+		 */
+		bool pinState( Pin pin ) const;
+		/**
+		 * Sets whether the I/O thread reads the modem lines. Most serial
+		 * ports can only be polled for them, so this should only be on while
+		 * something is using CD, CTS or RI. Off by default.
+		 */
+		void setWatchLines( bool watch );
+		/**
+		 * Queues a byte to be sent at the port's baud rate.
+		 */
+		void writeByte( uint8 byte );
+		/**
+		 * Takes the oldest event posted by the I/O thread.
+		 * @return false if there are no events waiting.
+		 */
+		bool takeEvent( Event & event );
+		/**
+		 * @return the number of received bytes that were dropped because
+		 * they were not taken in time.
+		 */
+		uint64 overruns() const { return m_overruns.load( std::memory_order_relaxed ); }
+
 		static ProbeResult probe( const QString & port );
 		/**
 		 * @see Port::ports
 		 */
 		static QStringList ports( unsigned probeResult );
+		/**
+		 * @return the termios constant for the given baud rate (e.g. B9600 for
+		 * 9600), or B0 if the rate is not supported.
+		 */
+		static speed_t baudRateConstant( unsigned baudRate );
 		/**
 		 * Opens the given port.
 		 * @return if the port could be opened.
@@ -85,13 +147,50 @@ class SerialPort : public Port
 		 * Closes any currently open port.
 		 */
 		void closePort();
-		
+
 	protected:
+		struct Command
+		{
+			enum Type : uint8 { SetPin, WriteByte };
+
+			Type type;
+			uint8 byte; ///< For WriteByte
+			bool state; ///< For SetPin
+			Pin pin; ///< For SetPin
+		};
+
+		void pushCommand( const Command & command );
+		void wakeIoThread();
+		/**
+		 * Run by the I/O thread until closePort.
+		 */
+		void ioLoop();
+		/**
+		 * Called from the I/O thread to carry out a command. Bytes to be
+		 * written are appended to txPending.
+		 */
+		void runCommand( const Command & command, std::vector<uint8> & txPending );
+		/**
+		 * Called from the I/O thread; returns false if the queue is full.
+		 */
+		bool postEvent( const Event & event );
+
 		/// Read in on port open; restored on port close
 		termios m_previousState;
-		
+
 		/// File descriptor for the port.
 		int m_file;
+		/// Writing to m_wakePipe[1] wakes up the I/O thread
+		int m_wakePipe[2];
+		/// Modem line bits, from the last LinesChanged event taken
+		int m_lines;
+
+		std::thread m_ioThread;
+		std::atomic<bool> m_bStopping;
+		std::atomic<bool> m_bWatchLines;
+		std::atomic<uint64> m_overruns;
+		KTechLab::SpscQueue<Command, QueueCapacity> m_commands;
+		KTechLab::SpscQueue<Event, QueueCapacity> m_events;
 };
 
 
@@ -6,14 +6,58 @@
 #include "matrix.h"
 #include "nonlinear.h"
 #include "pin.h"
+#include "pingraph.h"
 #include "reactive.h"
+#include "simulationprofiler.h"
 #include "wire.h"
 
 #include <cmath>
 #include <map>
 #include <algorithm>
 
-using PinVectorMap = std::multimap<int, QPtrVector<Pin>>;
+using PinVectorMap = std::multimap<int, std::vector<Pin *>>;
+
+namespace {
+	/**
+	 * Splits the pins into groups that are directly connected to each other,
+	 * keyed by the number of pins that the group's pins are circuit-dependent
+	 * on.
+	 * @param ids the pins to group, or null for all pins in the graph.
+	 * @param groundCount if not null, incremented for each group that has a
+	 * ground pin.
+	 */
+	static PinVectorMap groupConnectedPins( const PinGraph &graph, const std::vector<int> *ids, int *groundCount ) {
+		PinVectorMap eqs;
+		std::vector<Pin *> associated;
+
+		graph.forEachGroup(ids, PinGraph::Local, [&](const std::vector<int> &group) {
+			std::vector<Pin *> nodes;
+			nodes.reserve(group.size());
+			associated.clear();
+			bool foundGround = false;
+
+			for (int id : group) {
+				Pin *pin = graph.pin(id);
+				nodes.push_back(pin);
+				foundGround |= (pin->eqId() == Pin::EquationID::Ground);
+
+				for (auto &dependent : pin->circuitDependentPins()) {
+					if (dependent) associated.push_back(dependent);
+				}
+			}
+
+			std::sort(associated.begin(), associated.end());
+			const auto associatedCount = std::unique(associated.begin(), associated.end()) - associated.begin();
+
+			if (foundGround && groundCount) {
+				++*groundCount;
+			}
+			eqs.insert(std::make_pair(int(associatedCount), std::move(nodes)));
+		});
+
+		return eqs;
+	}
+}
 
 //BEGIN class Circuit
 Circuit::Circuit() :
@@ -21,6 +65,10 @@ Circuit::Circuit() :
 	LogicCacheBase_(std::make_unique<LogicCacheNode>())
 {}
 
+Circuit::~Circuit() {
+	SimulationProfiler::forget(this);
+}
+
 void Circuit::addPin( Pin *node ) {
 	PinSet_.insert(node);
 }
@@ -31,12 +79,16 @@ void Circuit::addElement( Element *element ) {
 	ElementList_.append(element);
 }
 
+void Circuit::addElements( const QList<Element *> &elements ) {
+	ElementList_ += elements;
+}
+
 bool Circuit::contains( Pin *pin ) {
 	return PinSet_.contains(pin);
 }
 
 // static function
-int Circuit::identifyGround(const QPtrList<Pin> &nodeList, int &highest) {
+int Circuit::identifyGround(const PinGraph &graph, const std::vector<int> &ids, int &highest) {
 	// What this function does:
 	// We are given a list of pins. First, we divide them into groups of pins
 	// that are directly connected to each other (e.g. through wires or
@@ -51,20 +103,8 @@ int Circuit::identifyGround(const QPtrList<Pin> &nodeList, int &highest) {
 
 	int curHighest = Pin::GroundType::Never;
 
-	auto nodeSet = QPtrSet<Pin>::fromList(nodeList);
-	nodeSet.remove(nullptr);
-
 	// Now to give all the Pins ids
-	PinVectorMap eqs;
-	while (!nodeSet.isEmpty()) {
-		QPtrSet<Pin> associated;
-		QPtrVector<Pin> nodes;
-		Pin *node = *nodeSet.begin();
-		recursivePinAdd(node, nodeSet, associated, nodes);
-		if (!nodes.empty()) {
-			eqs.insert(std::make_pair(associated.size(), nodes));
-		}
-	}
+	const PinVectorMap eqs = groupConnectedPins(graph, &ids, nullptr);
 
 	// Now, we want to look through the associated Pins,
 	// to find the ones with the highest "Ground Priority". Anything with a lower
@@ -128,21 +168,8 @@ void Circuit::init() {
 
 	// Now to give all the Pins ids
 	int groundCount = 0;
-	PinVectorMap eqs;
-	QPtrSet<Pin> unassignedNodes = PinSet_;
-	unassignedNodes.remove(nullptr);
-
-	while (!unassignedNodes.isEmpty()) {
-		QPtrSet<Pin> associated;
-		QPtrVector<Pin> nodes;
-		Pin *node = *unassignedNodes.begin();
-		if (recursivePinAdd(node, unassignedNodes, associated, nodes)) {
-			groundCount++;
-		}
-		if (!nodes.isEmpty()) {
-			eqs.insert(std::make_pair(associated.size(), nodes));
-		}
-	}
+	const PinGraph graph(PinSet_, PinGraph::Local);
+	const PinVectorMap eqs = groupConnectedPins(graph, nullptr, &groundCount);
 
 	const auto countCNodes = eqs.size() - groundCount;
 
@@ -317,15 +344,21 @@ void Circuit::cacheAndUpdate() {
 		return;
 	}
 
+	SimulationProfiler::Counters *counters = SimulationProfiler::self()->counters(this);
+
 	if (ElementSet_->containsNonLinear()) {
-		ElementSet_->doNonLinear(
+		const int iterations = ElementSet_->doNonLinear(
 			150,
 			1.0e-10,
 			1.0e-13
 		);
+		if (counters) {
+			counters->iterations += iterations;
+			counters->luCalls += iterations;
+		}
 	}
-	else {
-		ElementSet_->doLinear(true);
+	else if (ElementSet_->doLinear(true) && counters) {
+		++counters->luCalls;
 	}
 
 	node->data = ElementSet_->x();
@@ -336,31 +369,6 @@ void Circuit::createMatrixMap() {
 	ElementSet_->createMatrixMap();
 }
 
-bool Circuit::recursivePinAdd(Pin *node, QPtrSet<Pin> &unassignedNodes, QPtrSet<Pin> &associated, QPtrVector<Pin> &nodes) {
-	if (!node || !unassignedNodes.remove(node))
-		return false;
-
-	bool foundGround = (node->eqId() == Pin::EquationID::Ground);
-
-	const auto &circuitDependentPins = node->circuitDependentPins();
-	associated.reserve(associated.size() + circuitDependentPins.size());
-	for (auto &pin : circuitDependentPins) {
-		associated.insert(pin);
-	}
-
-	nodes.append(node);
-
-	const auto localConnectedPins = node->localConnectedPins();
-	nodes.reserve(nodes.size() + localConnectedPins.size());
-
-	// TODO : Rewrite this into a loop to avoid stack recursion
-	for (auto &pin : localConnectedPins) {
-		foundGround |= recursivePinAdd(pin, unassignedNodes, associated, nodes);
-	}
-
-	return foundGround;
-}
-
 void Circuit::doNonLogic() {
 	if (NonLogicCount_ <= 0)
 		return;
@@ -377,15 +385,23 @@ void Circuit::doNonLogic() {
 
 	stepReactive();
 
+	SimulationProfiler::Counters *counters = SimulationProfiler::self()->counters(this);
+
 	if (ElementSet_->containsNonLinear()) {
-		ElementSet_->doNonLinear(
+		const int iterations = ElementSet_->doNonLinear(
 			10,
 			1.0e-9,
 			1.0e-12
 		);
+		if (counters) {
+			counters->iterations += iterations;
+			counters->luCalls += iterations;
+		}
 		updateNodalVoltages();
 	}
 	else if (ElementSet_->doLinear(true)) {
+		if (counters)
+			++counters->luCalls;
 		updateNodalVoltages();
 	}
 }
@@ -10,12 +10,14 @@
 #include "math/quickvector.h"
 
 #include <memory>
+#include <vector>
 
 class CircuitDocument;
 class Wire;
 class Pin;
 class Element;
 class LogicOut;
+class PinGraph;
 
 /**
 Usage of this class (usually invoked from CircuitDocument):
@@ -42,12 +44,18 @@ class Circuit final {
 
 public:
 	Circuit();
-	~Circuit() = default;
+	~Circuit();
 
 	void addPin(Pin *node);
 	void addElement(Element *element);
+	/**
+	 * Adds elements that are not already in the circuit (without the check
+	 * for that which addElement does).
+	 */
+	void addElements(const QList<Element *> &elements);
 
 	bool contains(Pin *pin);
+	const QList<Element *> & elements() const { return ElementList_; }
 	bool containsNonLinear() const { return ElementSet_->containsNonLinear(); }
 
 	void init();
@@ -74,17 +82,18 @@ public:
 
 	void createMatrixMap();
 	/**
-		* This will identify the ground node and non-ground nodes in the given set.
+		* This will identify the ground node and non-ground nodes in the given set
+		* of pins (ids in graph, which must have the local connections).
 		* Ground will be given the eqId -1, non-ground of 0.
 		* @param highest The highest ground type of the groundnodes found. If no
 		ground nodes were found, this will be (GroundType::Never-1).
 		* @returns the number of ground nodes. If all nodes are at or below the
 		* 			GroundType::Never threshold, then this will be zero.
 		*/
-	static int identifyGround(const QPtrList<Pin> &nodeList, int &highest);
-	static int identifyGround(const QPtrList<Pin> &nodeList) {
+	static int identifyGround(const PinGraph &graph, const std::vector<int> &ids, int &highest);
+	static int identifyGround(const PinGraph &graph, const std::vector<int> &ids) {
 		int highest = 0;
-		return identifyGround(nodeList, highest);
+		return identifyGround(graph, ids, highest);
 	}
 
 	void setNextChanged(Circuit *circuit, int chain) { NextChanged_[chain] = circuit; }
@@ -102,10 +111,6 @@ protected:
 		* Step the reactive elements.
 		*/
 	void stepReactive();
-	/**
-		* Returns true if any of the nodes are ground
-		*/
-	static bool recursivePinAdd(Pin *node, QPtrSet<Pin> &unassignedNodes, QPtrSet<Pin> &associated, QPtrVector<Pin> &nodes);
 
 	QPtrSet<Pin> PinSet_;
 	QList<Element *> ElementList_;
@@ -90,9 +90,10 @@ Diode::IG Diode::calcIG(voltage_t V, bool conductance) const {
 	IG result;
 
 	if ( V >= (-3.0 * N * V_T) ) {
-		result.current = diodeCurrent( V, I_S, N ) + (g_tiny * V);
+		const auto e = diodeExp( V, N );
+		result.current = I_S * (e - 1.0) + (g_tiny * V);
 		if (conductance)
-			result.conductance = diodeConductance( V, I_S, N ) + g_tiny;
+			result.conductance = I_S * e / (N * V_T) + g_tiny;
 	}
 	else if ( V_B == 0 || V >= -V_B ) {
 		auto a = (3.0 * N * V_T) / (V * M_E);
@@ -10,7 +10,9 @@
 
 #include "element.h"
 #include "elementset.h"
+#include "simulationprofiler.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include <qdebug.h>
@@ -32,10 +34,13 @@ Element::Element()
 	
 	m_numCBranches = 0;
 	m_numCNodes = 0;
+
+	updateStampEntries();
 }
 
 Element::~ Element()
 {
+	SimulationProfiler::forget(this);
 }
 
 void Element::resetCurrents()
@@ -136,11 +141,70 @@ bool Element::updateStatus()
 		resetCurrents();
 	}
 
+	updateStampEntries();
+
 	// And return the status :-)
 // 	qDebug() << "Element::updateStatus(): Setting b_status to "<<(b_status?"true":"false")<<" this="<<this<<endl;
 	return b_status;
 }
 
+void Element::updateStampEntries()
+{
+	m_temp = 0.0;
+	m_changedFrom = 0;
+
+	Matrix *matrix = (p_eSet && (p_eSet->cnodeCount() + p_eSet->cbranchCount() > 0)) ? &p_eSet->matrix() : 0;
+	double *b = matrix ? (double*)p_eSet->b() : 0;
+
+	// Row/column of each node and branch in the matrix, or -1 if not there
+	int nodeRow[MAX_CNODES];
+	int branchRow[MAX_CBRANCHES];
+	unsigned int firstRow = matrix ? p_eSet->cnodeCount() + p_eSet->cbranchCount() : 0;
+
+	for ( int i = 0; i < MAX_CNODES; i++ )
+	{
+		nodeRow[i] = (matrix && p_cnode[i] && !p_cnode[i]->isGround) ? int(p_cnode[i]->n()) : -1;
+		if ( nodeRow[i] >= 0 )
+			firstRow = std::min( firstRow, unsigned(nodeRow[i]) );
+	}
+
+	for ( int i = 0; i < MAX_CBRANCHES; i++ )
+	{
+		branchRow[i] = (matrix && p_cbranch[i]) ? int(p_eSet->cnodeCount() + p_cbranch[i]->n()) : -1;
+		if ( branchRow[i] >= 0 )
+			firstRow = std::min( firstRow, unsigned(branchRow[i]) );
+	}
+
+	if ( matrix )
+		m_changedFrom = Matrix::changedFrom( firstRow, firstRow );
+
+	auto entry = [&]( int row, int col ) {
+		return (row >= 0 && col >= 0) ? matrix->entry( row, col ) : &m_temp;
+	};
+
+	for ( int i = 0; i < MAX_CNODES; i++ )
+	{
+		for ( int j = 0; j < MAX_CNODES; j++ )
+			m_entryG[i][j] = entry( nodeRow[i], nodeRow[j] );
+
+		for ( int j = 0; j < MAX_CBRANCHES; j++ )
+		{
+			m_entryB[i][j] = entry( nodeRow[i], branchRow[j] );
+			m_entryC[j][i] = entry( branchRow[j], nodeRow[i] );
+		}
+
+		m_entryI[i] = (nodeRow[i] >= 0) ? &b[ nodeRow[i] ] : &m_temp;
+	}
+
+	for ( int i = 0; i < MAX_CBRANCHES; i++ )
+	{
+		for ( int j = 0; j < MAX_CBRANCHES; j++ )
+			m_entryD[i][j] = entry( branchRow[i], branchRow[j] );
+
+		m_entryV[i] = (branchRow[i] >= 0) ? &b[ branchRow[i] ] : &m_temp;
+	}
+}
+
 double Element::cbranchCurrent( const int branch )
 {
 	if ( !b_status || branch<0 || branch>=m_numCBranches ) return 0.;
@@ -224,46 +224,62 @@ protected:
 	bool b_status;
 
 private:
+	/**
+	 * Resolves where the matrix and b vector entries used by this element are
+	 * stored, so that stamping doesn't have to look up the nodes. Entries
+	 * involving ground (or nodes that aren't set) go to m_temp.
+	 */
+	void updateStampEntries();
+
 	bool b_componentDeleted;
 	double m_temp;
+
+	double *m_entryG[MAX_CNODES][MAX_CNODES];
+	double *m_entryB[MAX_CNODES][MAX_CBRANCHES];
+	double *m_entryC[MAX_CBRANCHES][MAX_CNODES];
+	double *m_entryD[MAX_CBRANCHES][MAX_CBRANCHES];
+	double *m_entryI[MAX_CNODES];
+	double *m_entryV[MAX_CBRANCHES];
+	/// Where the LU decomposition must be redone from when this element stamps the matrix
+	unsigned int m_changedFrom;
 };
 
 
 double &Element::A_g( uint i, uint j )
 {
-	if(p_cnode[i]->isGround || p_cnode[j]->isGround) return m_temp;
-	return p_eSet->matrix().g( p_cnode[i]->n(), p_cnode[j]->n() );
+	p_eSet->matrix().setChangedFrom( m_changedFrom );
+	return *m_entryG[i][j];
 }
 
 double &Element::A_b( uint i, uint j )
 {
-	if ( p_cnode[i]->isGround ) return m_temp;
-	return p_eSet->matrix().b( p_cnode[i]->n(), p_cbranch[j]->n() );
+	p_eSet->matrix().setChangedFrom( m_changedFrom );
+	return *m_entryB[i][j];
 }
 
 double &Element::A_c( uint i, uint j )
 {
-	if ( p_cnode[j]->isGround ) return m_temp;
-	return p_eSet->matrix().c( p_cbranch[i]->n(), p_cnode[j]->n() );
+	p_eSet->matrix().setChangedFrom( m_changedFrom );
+	return *m_entryC[i][j];
 }
 
 double &Element::A_d( uint i, uint j )
 {
-	return p_eSet->matrix().d( p_cbranch[i]->n(), p_cbranch[j]->n() );
+	p_eSet->matrix().setChangedFrom( m_changedFrom );
+	return *m_entryD[i][j];
 }
 
 
 double &Element::b_i( uint i )
 {
-	if ( p_cnode[i]->isGround )
-		return m_temp;
-
-	return p_eSet->b()[ p_cnode[i]->n() ];
+	p_eSet->b().isChanged = true;
+	return *m_entryI[i];
 }
 
 double & Element::b_v( uint i )
 {
-	return p_eSet->b()[ p_eSet->cnodeCount() + p_cbranch[i]->n() ];
+	p_eSet->b().isChanged = true;
+	return *m_entryV[i];
 }
 
 #endif
@@ -18,6 +18,7 @@
 
 #include <qdebug.h>
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <cassert>
@@ -34,9 +35,10 @@ ElementSet::ElementSet( Circuit * circuit, const int n, const int m )
 		p_A = new Matrix( m_cn, m_cb );
 		p_b = new QuickVector(tmp);
 		p_x = new QuickVector(tmp);
+		p_xPrev = new QuickVector(tmp);
 	} else {
 		p_A = 0;
-		p_x = p_b = 0;
+		p_x = p_b = p_xPrev = 0;
 	}
 
 	m_cnodes = new CNode*[m_cn];
@@ -74,6 +76,7 @@ ElementSet::~ElementSet()
 	if(p_A) delete p_A;
 	if(p_b) delete p_b;
 	if(p_x) delete p_x;
+	if(p_xPrev) delete p_xPrev;
 }
 
 
@@ -120,9 +123,9 @@ void ElementSet::createMatrixMap()
 }
 
 
-void ElementSet::doNonLinear( int maxIterations, double maxErrorV, double maxErrorI )
+int ElementSet::doNonLinear( int maxIterations, double maxErrorV, double maxErrorI )
 {
-	QuickVector *p_x_prev = new QuickVector(p_x);
+	*p_xPrev = *p_x;
 
 	// And now tell the cnodes and cbranches about their new voltages & currents
 	updateInfo();
@@ -130,22 +133,20 @@ void ElementSet::doNonLinear( int maxIterations, double maxErrorV, double maxErr
 	const QList<NonLinear *>::iterator end = m_cnonLinearList.end();
 
 	int k = 0;
-	do {
+	while ( true ) {
 		// Tell the nonlinear elements to update its J, A and b from the newly calculated x
 		for ( QList<NonLinear *>::iterator it = m_cnonLinearList.begin(); it != end; ++it )
 			(*it)->update_dc();
 
-		*p_x = *p_b;  // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
-
 		p_A->performLU();
-		p_A->fbSub(p_x);
+		p_A->fbSub(*p_b, p_x);
 		updateInfo();
 
 		// Now, check for convergence
 		bool converged = true;
 		for ( unsigned i = 0; i < m_cn; ++i )
 		{
-			double diff = std::abs( (*p_x_prev)[i] - (*p_x)[i] );
+			double diff = std::abs( (*p_xPrev)[i] - (*p_x)[i] );
 			if ( diff > maxErrorI )
 			{
 				converged = false;
@@ -155,7 +156,7 @@ void ElementSet::doNonLinear( int maxIterations, double maxErrorV, double maxErr
 		if ( converged ) {
 			for ( unsigned i = m_cn; i < m_cn+m_cb; ++i )
 			{
-				double diff = std::abs( (*p_x_prev)[i] - (*p_x)[i] );
+				double diff = std::abs( (*p_xPrev)[i] - (*p_x)[i] );
 				if ( diff > maxErrorV )
 				{
 					converged = false;
@@ -164,13 +165,15 @@ void ElementSet::doNonLinear( int maxIterations, double maxErrorV, double maxErr
 			}
 		}
 
-		*p_x_prev = *p_x; // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+		++k;
+		if ( converged || k >= maxIterations ) break;
 
-		if ( converged ) break;
+		// The next solve overwrites all of x, so rather than copying x to
+		// x_prev, just swap them around
+		std::swap( p_x, p_xPrev );
 	}
-	while ( ++k < maxIterations );
 
-    delete p_x_prev;
+	return k;
 }
 
 
@@ -182,10 +185,7 @@ bool ElementSet::doLinear( bool performLU )
 	if (performLU)
 		p_A->performLU();
 
-	*p_x = *p_b;   // <<< why does this code work, when I try it, I always get the default shallow copy.
-
-
-	p_A->fbSub(p_x);
+	p_A->fbSub(*p_b, p_x);
 	updateInfo();
 	p_b->isChanged = false;
 
@@ -80,8 +80,10 @@ public:
 	/**
 	 * Solves for nonlinear elements, or just does linear if it doesn't contain
 	 * any nonlinear.
+	 * @return the number of Newton-Raphson iterations (each one an LU
+	 * decomposition) that were done
 	 */
-	void doNonLinear( int maxIterations, double maxErrorV = 1e-9, double maxErrorI = 1e-12 );
+	int doNonLinear( int maxIterations, double maxErrorV = 1e-9, double maxErrorI = 1e-12 );
 	/**
 	 * Solves for linear and logic elements.
 	 * @returns true if anything changed
@@ -114,6 +116,7 @@ private:
 	Matrix *p_A;
 	QuickVector *p_x;
 	QuickVector *p_b;
+	QuickVector *p_xPrev; ///< x from the previous nonlinear iteration
 // end calc engine stuff.
 
 	QList<Element *> m_elementList;
@@ -206,17 +206,22 @@ void JFET::calcIg( double V_GS, double V_GD, double V_DS,
 	double beta = m_jfetSettings.beta;
 	double I_S = m_jfetSettings.I_S;
 	double N = m_jfetSettings.N;
-	double N_R = m_jfetSettings.N_R;
-	
+	double Vt = N * V_T;
+
+	// The recombination diodes have a saturation current of zero, and so
+	// carry no current; they are left out.
+
 	// GS diode
 	double g_tiny = (V_GS < (- 10 * V_T * N)) ? I_S : 0;
-	*g_GS = diodeConductance( V_GS, I_S, N ) + diodeConductance( V_GS, 0, N_R ) + g_tiny;
-	*I_GS = diodeCurrent( V_GS, I_S, N ) + diodeCurrent( V_GS, 0, N_R ) + g_tiny * V_GS;
+	double e = diodeExp( V_GS, N );
+	*g_GS = I_S * e / Vt + g_tiny;
+	*I_GS = I_S * (e - 1) + g_tiny * V_GS;
 
 	// GD diode
 	g_tiny = (V_GD < (- 10 * V_T * N)) ? I_S : 0;
-	*g_GD = diodeConductance( V_GD, I_S, N ) + diodeConductance( V_GD, 0, N_R ) + g_tiny;
-	*I_GD = diodeCurrent( V_GD, I_S, N ) + diodeCurrent( V_GD, 0, N_R ) + (g_tiny * V_GD);
+	e = diodeExp( V_GD, N );
+	*g_GD = I_S * e / Vt + g_tiny;
+	*I_GD = I_S * (e - 1) + (g_tiny * V_GD);
 
 	double V_GST = V_GS - V_Th;
 	double V_GDT = V_GD - V_Th;
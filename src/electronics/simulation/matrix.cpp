@@ -14,6 +14,7 @@
 
 #include <cassert>
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <vector>
@@ -34,6 +35,8 @@ Matrix::Matrix( CUI n, CUI m )
 
 	for ( unsigned int i=0; i<size; i++ )
 		m_inMap[i] = i;
+
+	max_k = 0;
 }
 
 Matrix::~Matrix()
@@ -77,17 +80,24 @@ void Matrix::performLU()
 
 	// Copy the affected segment to LU
 	for ( uint i=max_k; i<n; i++ ) {
-		for ( uint j=max_k; j<n; j++ ) {
-			(*m_lu)[i][j] = (*m_mat)[i][j];
-		}
+		std::copy( (*m_mat)[i] + max_k, (*m_mat)[i] + n, (*m_lu)[i] + max_k );
 	}
 
-	// LU decompose the matrix, and store result back in matrix
+	// LU decompose the matrix, and store result back in matrix. Rows and
+	// columns before max_k haven't changed, so neither have their parts of L
+	// and U; those only need applying to the changed segment.
 	for ( uint k=0; k<n-1; k++ ) {
 
-		double * const lu_K_K = &(*m_lu)[k][k];
-		unsigned foo = std::max(k,max_k)+1;
+		if ( k < max_k ) {
+			for ( uint i=max_k; i<n; i++ ) {
+				const double lu_I_K = (*m_lu)[i][k];
+				if ( std::abs(lu_I_K) > 1e-12 )
+					m_lu->partialSAF(k, i, max_k, -lu_I_K);
+			}
+			continue;
+		}
 
+		double * const lu_K_K = &(*m_lu)[k][k];
 
 // detect singular matrixes...
 		if ( std::abs(*lu_K_K) < 1e-10 ) {
@@ -98,14 +108,14 @@ void Matrix::performLU()
 		}
 // #############
 
-		for ( uint i= foo; i<n; i++ ) {
+		for ( uint i=k+1; i<n; i++ ) {
 			(*m_lu)[i][k] /= *lu_K_K;
 		}
 
-		for ( uint i=std::max(k,max_k)+1; i<n; i++ ) {
+		for ( uint i=k+1; i<n; i++ ) {
 			const double lu_I_K = (*m_lu)[i][k];
 			if ( std::abs(lu_I_K) > 1e-12 )	{
-				m_lu->partialSAF(k, i, foo, -lu_I_K);
+				m_lu->partialSAF(k, i, k+1, -lu_I_K);
 			}
 		}
 	}
@@ -114,41 +124,36 @@ void Matrix::performLU()
 }
 
 void Matrix::fbSub( QuickVector* b )
+{
+	fbSub( *b, b );
+}
+
+void Matrix::fbSub( const QuickVector &b, QuickVector *x )
 {
 	unsigned int size = m_mat->numRows();
+	if ( size == 0 ) return;
 
 	for ( uint i=0; i<size; i++ )
 	{
-		m_y[m_inMap[i]] = (*b)[i];
+		m_y[m_inMap[i]] = b[i];
 	}
 
 	// Forward substitution
 	for ( uint i = 1; i<size; i++ )
 	{
-		double sum = 0;
-		for ( unsigned int j=0; j<i; j++ )
-		{
-			sum += (*m_lu)[i][j]*m_y[j];
-		}
-		m_y[i] -= sum;
+		m_y[i] -= m_lu->dotRow( i, m_y, 0, i );
 	}
 
 	// Back substitution
 	m_y[size - 1] /= (*m_lu)[size - 1][size - 1];
 	for ( int i = size - 2; i >= 0; i-- )
 	{
-		double sum = 0;
-		for ( uint j=i+1; j<size; j++ )
-		{
-			sum += (*m_lu)[i][j]*m_y[j];
-		}
-		m_y[i] -= sum;
+		m_y[i] -= m_lu->dotRow( i, m_y, i+1, size );
 		m_y[i] /= (*m_lu)[i][i];
 	}
 
 // I think we don't need to reverse the mapping because we only permute rows, not columns.
-	for ( uint i=0; i<size; i++ )
-		(*b)[i] = m_y[i];
+	std::copy( m_y, m_y + size, (double*)*x );
 }
 
 void Matrix::multiply(const QuickVector *rhs, QuickVector *result )
@@ -60,6 +60,11 @@ public:
 	 * with the solution returned in x.
 	 */
 	void fbSub( QuickVector* x );
+	/**
+	 * Like fbSub above, but leaves b alone and writes the solution to x,
+	 * saving copying b to x first.
+	 */
+	void fbSub( const QuickVector &b, QuickVector *x );
 	/**
 	 * Prints the matrix to stdout
 	 */
@@ -84,6 +89,27 @@ public:
 	}
 
 	double g( CUI i, CUI j ) const { return (*m_mat)[m_inMap[i]][j]; }
+	/**
+	 * Returns where the element at row i, col j is stored, for writing to it
+	 * directly. Rows are never swapped once elements have been added, so this
+	 * stays valid for the life of the matrix. Unlike g, this does not mark
+	 * the matrix as changed; call setChangedFrom for that.
+	 */
+	double *entry( CUI i, CUI j ) { return &(*m_mat)[m_inMap[i]][j]; }
+	/**
+	 * Marks the LU decomposition as needing to be redone from row and column
+	 * k onwards. This is what g does, for the smaller of i and j.
+	 */
+	void setChangedFrom( CUI k ) { if ( k < max_k ) max_k = k; }
+	/**
+	 * The row and column to pass to setChangedFrom after changing the element
+	 * at row i, col j.
+	 */
+	static unsigned int changedFrom( CUI i, CUI j )
+	{
+		const unsigned int k = (i < j) ? i : j;
+		return (k > 0) ? k-1 : 0;
+	}
 
 	double& b( CUI i, CUI j ) { return g( i, j+m_n ); }
 	double& c( CUI i, CUI j ) { return g( i+m_n, j ); }
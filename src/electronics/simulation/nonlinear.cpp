@@ -7,13 +7,8 @@
 static constexpr const double KTL_MAX_DOUBLE = 1.7976931348623157e+308;///< 7fefffff ffffffff
 static const int KTL_MAX_EXPONENT = int( std::log(KTL_MAX_DOUBLE) );
 
-double NonLinear::diodeCurrent( double v, double I_S, double N ) const {
-	return I_S * (std::exp( std::min( v / (N * V_T), double(KTL_MAX_EXPONENT) ) ) - 1);
-}
-
-double NonLinear::diodeConductance( double v, double I_S, double N ) const {
-	const double Vt = V_T * N;
-	return I_S * std::exp( std::min( v / Vt, double(KTL_MAX_EXPONENT) ) ) / Vt;
+double NonLinear::diodeExp( double v, double N ) const {
+	return std::exp( std::min( v / (N * V_T), double(KTL_MAX_EXPONENT) ) );
 }
 
 double NonLinear::diodeVoltage( double V, double V_prev, double N, double V_lim ) const {
@@ -55,7 +50,7 @@ void NonLinear::diodeJunction( double V, double I_S, double N, double &I, double
 		g = +I_S * 3 * a / V;
 	}
 	else {
-		double e = std::exp( std::min( V / Vt, double(KTL_MAX_EXPONENT) ) );
+		double e = diodeExp( V, N );
 		I = I_S * (e - 1);
 		g = I_S * e / Vt;
 	}
@@ -146,7 +141,7 @@ void NonLinear::mosDiodeJunction( double V, double I_S, double N, double &I, dou
 		_I = _g * V;
 	}
 	else {
-		double e = std::exp( std::min ( V / Vt, double(KTL_MAX_EXPONENT) ) );
+		double e = diodeExp( V, N );
 		_I = I_S * (e - 1.0);
 		_g = I_S * e / Vt;
 	}
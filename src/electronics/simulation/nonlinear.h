@@ -19,14 +19,11 @@ class NonLinear : public Element {
 
 	protected:
 		/**
-		 * The diode current.
+		 * The exponential in Schockley's equation, exp(v / (N * V_T)), limited
+		 * so that it stays finite. The diode current is I_S * (e - 1), and
+		 * its conductance I_S * e / (N * V_T).
 		 */
-		double diodeCurrent( double v, double I_S, double N ) const;
-		/**
-		 * Conductance of the diode - the derivative of Schockley's
-		 * approximation.
-		 */
-		double diodeConductance( double v, double I_S, double N ) const;
+		double diodeExp( double v, double N ) const;
 		/**
 		 * Limits the diode voltage to prevent divergence in the nonlinear
 		 * iterations.
@@ -547,7 +547,7 @@ Variant * FlowPart::createProperty( const QString & id, Variant::Type type )
 			if ( MicroSettings * settings = m_pFlowCodeDocument->microSettings() )
 				v->setAllowed( settings->variableNames() );
 		}
-		connect( property(id), SIGNAL(valueChanged(QVariant, QVariant )), this, SLOT(varNameChanged(QVariant, QVariant )) );
+		connect( v->notifier(), SIGNAL(valueChanged(QVariant, QVariant )), this, SLOT(varNameChanged(QVariant, QVariant )) );
 	}
 	else
 		slotUpdateFlowPartVariables();
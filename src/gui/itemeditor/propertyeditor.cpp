@@ -657,7 +657,7 @@ void PropertyEditor::fill()
         {
             PropertyEditorItem  *itemPropValue = new PropertyEditorItem( m_topItem, v );
             itemPropValue->setText( v->displayString() );
-            connect( v, SIGNAL(valueChanged( QVariant, QVariant )), itemPropValue, SLOT(propertyValueChanged()) );
+            connect( v->notifier(), SIGNAL(valueChanged( QVariant, QVariant )), itemPropValue, SLOT(propertyValueChanged()) );
             itemPropValue->updateValue();
             setItem(nextRow, 1, itemPropValue);
         }
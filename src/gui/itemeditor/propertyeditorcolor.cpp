@@ -33,7 +33,7 @@ PropertyEditorColor::PropertyEditorColor( QWidget * parent, Property * property,
 	setWidget(m_pColorCombo);
 
 	connect( m_pColorCombo, SIGNAL(activated(const QColor&)), this, SLOT(valueChanged(const QColor&)) );
-	connect( property, SIGNAL(valueChanged( const QColor& )), m_pColorCombo, SLOT(setColor(const QColor &)) );
+	connect( property->notifier(), SIGNAL(valueChanged( const QColor& )), m_pColorCombo, SLOT(setColor(const QColor &)) );
 }
 
 
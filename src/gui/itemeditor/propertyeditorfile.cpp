@@ -43,7 +43,7 @@ PropertyEditorFile::PropertyEditorFile( QWidget * parent, Property * property, c
 	setWidget(m_lineedit);
 
 	connect( m_button, SIGNAL(clicked()), this, SLOT(selectFile()) );
-	connect( property, SIGNAL(valueChanged( const QString& )), m_lineedit, SLOT(setText(const QString &)) );
+	connect( property->notifier(), SIGNAL(valueChanged( const QString& )), m_lineedit, SLOT(setText(const QString &)) );
 }
 
 
@@ -41,7 +41,7 @@ PropertyEditorInput::PropertyEditorInput( QWidget * parent, Property * property,
 	setWidget(m_lineedit);
 
 	connect( m_lineedit, SIGNAL(textChanged(const QString &)), this, SLOT(slotTextChanged(const QString &)));
-	connect( m_property, SIGNAL(valueChanged( const QString& )), m_lineedit, SLOT(setText(const QString &)) );
+	connect( m_property->notifier(), SIGNAL(valueChanged( const QString& )), m_lineedit, SLOT(setText(const QString &)) );
 }
 
 
@@ -98,7 +98,7 @@ PropertyEditorSpin::PropertyEditorSpin( QWidget * parent, Property * property, c
 
 	setWidget( m_spinBox, m_spinBox->editor() );
 	connect( m_spinBox, SIGNAL(valueChanged( int )), this, SLOT(valueChange( int )));
-	connect( m_property, SIGNAL(valueChanged( int )), m_spinBox, SLOT(setValue( int )) );
+	connect( m_property->notifier(), SIGNAL(valueChanged( int )), m_spinBox, SLOT(setValue( int )) );
 }
 
 
@@ -151,7 +151,7 @@ PropertyEditorDblSpin::PropertyEditorDblSpin( QWidget * parent, Property * prope
 
 	setWidget( m_spinBox, m_spinBox->editor());
 	connect( m_spinBox, SIGNAL(valueChanged(double)), this, SLOT(valueChange(double)));
-	connect( m_property, SIGNAL(valueChanged( double )), m_spinBox, SLOT(setValue( double )) );
+	connect( m_property->notifier(), SIGNAL(valueChanged( double )), m_spinBox, SLOT(setValue( double )) );
 }
 
 
@@ -177,7 +177,7 @@ PropertyEditorBool::PropertyEditorBool( QWidget * parent, Property * property, c
 	m_toggle->resize(width(), height());
 
 	connect( m_toggle, SIGNAL(toggled(bool)), this, SLOT(setState(bool)));
-	connect( m_property, SIGNAL(valueChanged( bool )), m_toggle, SLOT(setChecked(bool)) );
+	connect( m_property->notifier(), SIGNAL(valueChanged( bool )), m_toggle, SLOT(setChecked(bool)) );
 
 	if(property->value().toBool())
 		m_toggle->setChecked(true);
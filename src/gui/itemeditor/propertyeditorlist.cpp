@@ -137,7 +137,7 @@ PropertyEditorList::PropertyEditorList( QWidget * parent, Property * property, c
 	setWidget(box, m_combo->lineEdit());
 
 	connect( m_combo, SIGNAL(activated( const QString & )), this, SLOT(valueChanged( const QString & )) );
-	connect( m_property, SIGNAL(valueChanged( const QString& )), m_combo, SLOT(setCurrentItem( const QString & )) );
+	connect( m_property->notifier(), SIGNAL(valueChanged( const QString& )), m_combo, SLOT(setCurrentItem( const QString & )) );
 }
 
 
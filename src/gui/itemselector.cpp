@@ -86,6 +86,7 @@ ItemSelector::ItemSelector( QWidget *parent, const char *name )
 // 	connect( this, SIGNAL(executed(K3ListViewItem*) ), this, SLOT(slotItemExecuted(K3ListViewItem*)) );
 	connect( this, SIGNAL(itemClicked(QTreeWidgetItem*,int)), this, SLOT(slotItemClicked(QTreeWidgetItem*,int)) );
 	connect( this, SIGNAL(itemDoubleClicked(QTreeWidgetItem*,int)), this, SLOT(slotItemDoubleClicked(QTreeWidgetItem*,int)) );
+	connect( this, SIGNAL(itemExpanded(QTreeWidgetItem*)), this, SLOT(slotItemExpanded(QTreeWidgetItem*)) );
 // 	connect( this, SIGNAL(contextMenuRequested(Q3ListViewItem*, const QPoint&, int )), this,
 //              SLOT(slotContextMenuRequested(Q3ListViewItem*, const QPoint&, int )) ); // 2018.08.12 - use signal from below
     setContextMenuPolicy(Qt::CustomContextMenu);
@@ -109,7 +110,6 @@ void ItemSelector::clear()
 
 void ItemSelector::addItem( const QString & caption, const QString & id, const QString & _category, const QPixmap & icon, bool removable )
 {
-    qDebug() << Q_FUNC_INFO << "id=" << id;
 	ILVItem *parentItem = 0L;
 
 	QString category = _category;
@@ -164,7 +164,10 @@ void ItemSelector::addItem( const QString & caption, const QString & id, const Q
 
 	ILVItem *item = new ILVItem( parentItem, id );
 	//item->setPixmap( 0, icon );  // 2018.08.12 - replaced with line below
-    item->setIcon( 0, QIcon(icon) );
+	if ( !icon.isNull() )
+		item->setIcon( 0, QIcon(icon) );
+	else if ( parentItem->isExpanded() )
+		setLibraryIcon( item );
 	item->setText( 0, caption );
     //item->setDragEnabled(true); // 2018.08.12 - replaced with line below
     item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsDragEnabled);
@@ -172,6 +175,27 @@ void ItemSelector::addItem( const QString & caption, const QString & id, const Q
 }
 
 
+void ItemSelector::slotItemExpanded( QTreeWidgetItem *category )
+{
+	for ( int i = 0; i < category->childCount(); ++i )
+		setLibraryIcon( category->child(i) );
+}
+
+
+void ItemSelector::setLibraryIcon( QTreeWidgetItem *item )
+{
+	if ( !item->icon(0).isNull() )
+		return;
+
+	const QString id = item->data( 0, ILVItem::DataRole_ID ).toString();
+	if ( id.isEmpty() )
+		return; // A category
+
+	if ( LibraryItem *libraryItem = itemLibrary()->libraryItem(id) )
+		item->setIcon( 0, QIcon( libraryItem->icon16() ) );
+}
+
+
 void ItemSelector::writeOpenStates()
 {
 	//KConfig *config = kapp->config();
@@ -432,7 +456,7 @@ ComponentSelector::ComponentSelector( KateMDI::ToolView * parent )
 	for ( LibraryItemList::iterator it = items->begin(); it != end; ++it )
 	{
 		if ( (*it)->type() == LibraryItem::lit_component )
-			addItem( (*it)->name(), (*it)->activeID(), (*it)->category(), (*it)->icon16() );
+			addItem( (*it)->name(), (*it)->activeID(), (*it)->category() );
 	}
 }
 //END class ComponentSelector
@@ -466,7 +490,7 @@ FlowPartSelector::FlowPartSelector( KateMDI::ToolView * parent )
 	for ( LibraryItemList::iterator it = items->begin(); it != end; ++it )
 	{
 		if ( (*it)->type() == LibraryItem::lit_flowpart )
-			addItem( (*it)->name(), (*it)->activeID(), (*it)->category(), (*it)->icon16() );
+			addItem( (*it)->name(), (*it)->activeID(), (*it)->category() );
 	}
 }
 //END class FlowPartSelector
@@ -498,7 +522,7 @@ MechanicsSelector::MechanicsSelector( QWidget *parent )
 	{
 		if ( (*it)->type() == LibraryItem::lit_mechanical )
 		{
-			addItem( (*it)->name(), (*it)->activeID(), (*it)->category(), (*it)->icon16() );
+			addItem( (*it)->name(), (*it)->activeID(), (*it)->category() );
 		}
 	}
 }
@@ -77,7 +77,9 @@ class ItemSelector : public QTreeWidget /* K3ListView */
 		 * @param caption The displayed text
 		 * @param id A unique identification for when it is dragged or activated
 		 * @param category The category it is in, eg "Integrated Circuits
-		 * @param icon The icon to be displayed to the left of the text
+		 * @param icon The icon to be displayed to the left of the text. If
+		 * none is given, the icon of the item library's item with the id is
+		 * shown, which is loaded when the item's category is first opened.
 		 * @param removable Whether the user can right-click on the item and select Remove
 		 */
 		void addItem( const QString & caption, const QString & id, const QString & category, const QPixmap & icon = QPixmap(), bool removable = false );
@@ -120,8 +122,17 @@ class ItemSelector : public QTreeWidget /* K3ListView */
 		void slotItemSelected( );
 		void slotItemClicked(  QTreeWidgetItem *item, int );
 		void slotItemDoubleClicked( QTreeWidgetItem*, int );
+		/**
+		 * Gives the items in the category their item library icons.
+		 */
+		void slotItemExpanded( QTreeWidgetItem *category );
 
 	private:
+		/**
+		 * Sets the icon of the item to that of the item library's item with
+		 * the same id, unless it has an icon already.
+		 */
+		static void setLibraryIcon( QTreeWidgetItem *item );
 		/**
 		 * @return a dragobject encoding the currently selected component item.
 		 */
@@ -13,6 +13,7 @@
 #include "oscilloscopeview.h"
 #include "probe.h"
 #include "probepositioner.h"
+#include "probetracewriter.h"
 #include "simulator.h"
 #include "ktechlab.h"
 
@@ -21,9 +22,11 @@
 #include <kconfig.h>
 #include <kconfiggroup.h>
 #include <kdebug.h>
+#include <kfiledialog.h>
 #include <kglobal.h>
 #include <kiconloader.h>
 #include <klocalizedstring.h>
+#include <kmessagebox.h>
 #include <knuminput.h>
 
 
@@ -75,11 +78,13 @@ Oscilloscope::Oscilloscope( KateMDI::ToolView * parent)
 // 	b_isPaused = false;
 	m_zoomLevel = 0.5;
 	m_pSimulator = Simulator::self();
+	m_pTraceWriter = 0;
 
 	horizontalScroll->setSingleStep(32);
 	horizontalScroll->setPageStep( oscilloscopeView->width());
 
 	connect( resetBtn, SIGNAL(clicked()), this, SLOT(reset()));
+	connect( recordBtn, SIGNAL(clicked()), this, SLOT(slotToggleRecording()));
 	connect( zoomSlider, SIGNAL(valueChanged(int)), this, SLOT(slotZoomSliderChanged(int)));
 	connect( horizontalScroll, SIGNAL(valueChanged(int)), this, SLOT(slotSliderValueChanged(int)));
 
@@ -100,6 +105,10 @@ Oscilloscope::Oscilloscope( KateMDI::ToolView * parent)
 
 Oscilloscope::~Oscilloscope()
 {
+	const ProbeDataMap::iterator end = m_probeDataMap.end();
+	for( ProbeDataMap::iterator it = m_probeDataMap.begin(); it != end; ++it)
+		(*it)->setTraceWriter(0);
+	delete m_pTraceWriter;
     m_pSelf = NULL;
 }
 
@@ -117,6 +126,63 @@ void Oscilloscope::slotTogglePause()
 }
 
 
+void Oscilloscope::slotToggleRecording()
+{
+	const ProbeDataMap::iterator end = m_probeDataMap.end();
+
+	if( m_pTraceWriter)
+	{
+		for( ProbeDataMap::iterator it = m_probeDataMap.begin(); it != end; ++it)
+			(*it)->setTraceWriter(0);
+
+		// Flushes the remaining samples and waits for the writer thread
+		delete m_pTraceWriter;
+		m_pTraceWriter = 0;
+		recordBtn->setChecked(false);
+		return;
+	}
+
+	recordBtn->setChecked(false);
+
+	if( m_probeDataMap.isEmpty())
+	{
+		KMessageBox::sorry( this, i18n("There are no probes to record."));
+		return;
+	}
+
+	const QString filter = QString("*.vcd|%1\n*.ktltrace|%2")
+		.arg( i18n("Value Change Dump (*.vcd)"))
+		.arg( i18n("KTechLab Trace (*.ktltrace)"));
+	KUrl url = KFileDialog::getSaveUrl( KUrl(), filter, this, i18n("Record Probe Data"));
+	if( url.isEmpty())
+		return;
+
+	const QString fileName = url.toLocalFile();
+	ProbeTraceWriter * writer = new ProbeTraceWriter( fileName, ProbeTraceWriter::formatForFile(fileName));
+
+	for( ProbeDataMap::iterator it = m_probeDataMap.begin(); it != end; ++it)
+	{
+		const ProbeTraceWriter::ProbeKind kind = m_logicProbeDataMap.contains(it.key())
+			? ProbeTraceWriter::ProbeKind::Logic
+			: ProbeTraceWriter::ProbeKind::Floating;
+		writer->addProbe( it.key(), kind, (*it)->name());
+	}
+
+	if(!writer->open())
+	{
+		delete writer;
+		KMessageBox::sorry( this, i18n("Could not open \"%1\" for writing.", fileName));
+		return;
+	}
+
+	m_pTraceWriter = writer;
+	for( ProbeDataMap::iterator it = m_probeDataMap.begin(); it != end; ++it)
+		(*it)->setTraceWriter(m_pTraceWriter);
+
+	recordBtn->setChecked(true);
+}
+
+
 int Oscilloscope::sliderTicksPerSecond() const
 {
 	return int(1e4);
@@ -180,6 +246,7 @@ ProbeData * Oscilloscope::registerProbe( Probe * probe)
 	}
 
 	m_probeDataMap[id] = probeData;
+	probeData->setName( probe->id());
 
 	if(!m_oldestProbe) {
 		m_oldestProbe = probeData;
@@ -206,6 +273,7 @@ void Oscilloscope::unregisterProbe( int id)
 	m_floatingProbeDataMap.remove(id);
 
 	bool oldestDestroyed = it.value() == m_oldestProbe;
+	it.value()->setTraceWriter(0);
 
 	if( it != m_probeDataMap.end())
 		m_probeDataMap.erase(it);
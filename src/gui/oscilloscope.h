@@ -33,6 +33,7 @@ class KTechlab;
 class Oscilloscope;
 class Probe;
 class ProbeData;
+class ProbeTraceWriter;
 class VoltageProbe;
 class QTimer;
 namespace KateMDI { class ToolView; }
@@ -158,6 +159,11 @@ class Oscilloscope : public QWidget, public Ui::OscilloscopeWidget
 		 * Pause the data capture (e.g. user clicked on pause button)
 		 */
 		void slotTogglePause();
+		/**
+		 * Start streaming the probe data to a trace file chosen by the user,
+		 * or stop if already recording.
+		 */
+		void slotToggleRecording();
 	
 	protected:
 		void getOldestProbe();
@@ -172,6 +178,7 @@ class Oscilloscope : public QWidget, public Ui::OscilloscopeWidget
 		FloatingProbeDataMap m_floatingProbeDataMap;
 		
 		Simulator * m_pSimulator;
+		ProbeTraceWriter * m_pTraceWriter;
 		
 	protected slots:
 		void updateScrollbars();
@@ -299,15 +299,6 @@ void OscilloscopeView::drawLogicData( QPainter & p)
 	const LogicProbeDataMap::iterator end = Oscilloscope::self()->m_logicProbeDataMap.end();
 	for( LogicProbeDataMap::iterator it = Oscilloscope::self()->m_logicProbeDataMap.begin(); it != end; ++it)
 	{
-		// When searching for the next logic value to display, we look along
-		// until there is a recorded point which is at least one pixel along
-		// If we are zoomed out far, there might be thousands of data points
-		// between each pixel. It is time consuming searching for the next point
-		// to display one at a time, so we record the average number of data points
-		// between pixels ( = deltaAt / totalDeltaAt)
-		int64_t deltaAt = 1;
-		int totalDeltaAt = 1;
-
 		LogicProbeData * probe = it.value();
 
 		vector<LogicDataPoint> *data = probe->m_data;
@@ -315,6 +306,8 @@ void OscilloscopeView::drawLogicData( QPainter & p)
 
 		const int midHeight = Oscilloscope::self()->probePositioner->probePosition(probe);
 		const int64_t timeOffset = Oscilloscope::self()->scrollTime();
+		const int highY = midHeight - int(m_halfOutputHeight);
+		const int lowY = midHeight + int(m_halfOutputHeight);
 
 		// Draw the horizontal line indicating the midpoint of our output
 		p.setPen( QColor( 228, 228, 228));
@@ -323,65 +316,46 @@ void OscilloscopeView::drawLogicData( QPainter & p)
 		// Set the pen colour according to the colour the user has selected for the probe
 		p.setPen( probe->color());
 
-		// The smallest time step that will display in our oscilloscope
-		const int minTimeStep = int(LOGIC_UPDATE_RATE/pixelsPerSecond);
-
-		int64_t at = probe->findPos(timeOffset);
-		const int64_t maxAt = probe->m_data->size();
-		int64_t prevTime = (*data)[at].time;
-		int prevX = (at > 0) ? 0 : int((prevTime - timeOffset)*(pixelsPerSecond/LOGIC_UPDATE_RATE));
-		bool prevHigh = (*data)[at].value;
-		int prevY = midHeight + int(prevHigh ? -m_halfOutputHeight : +m_halfOutputHeight);
-
-		while ( at < maxAt) {
-			// Search for the next pos which will show up at our zoom level
-			int64_t previousAt = at;
-			int64_t dAt = deltaAt / totalDeltaAt;
+		// Simulator time covered by one pixel column
+		const double ticksPerPixel = LOGIC_UPDATE_RATE/pixelsPerSecond;
 
-			while ( (dAt > 1) && (at < maxAt) && ( (int64_t((*data)[at].time) - prevTime) != minTimeStep))
-			{
-				// Search forwards until we overshoot
-				while ( at < maxAt && ( int64_t((*data)[at].time) - prevTime) < minTimeStep)
-					at += dAt;
-				dAt /= 2;
-
-				// Search backwards until we undershoot
-				while ( (at < maxAt) && ( int64_t((*data)[at].time) - prevTime) > minTimeStep)
-				{
-					at -= dAt;
-					if( at < 0)
-						at = 0;
-				}
-				dAt /= 2;
-			}
+		const uint64_t maxAt = data->size();
+		uint64_t at = probe->findPosAfter( timeOffset, 0);
+		int prevX = 0;
+		if( at == 0)
+		{
+			prevX = int((int64_t((*data)[0].time) - timeOffset)/ticksPerPixel);
+			at = 1;
+		}
+		bool prevHigh = (*data)[at-1].value;
+		int prevY = prevHigh ? highY : lowY;
 
-			// Possibly increment the value of at found by one (or more if this is the first go)
-			while ( (previousAt == at) || ((at < maxAt) && ( int64_t((*data)[at].time) - prevTime) < minTimeStep))
-				at++;
+		// Jump from one occupied pixel column to the next. All the points in a
+		// column are summarised by the probe's min/max pyramid, so the cost
+		// depends on the number of columns rather than the number of points.
+		while( at < maxAt)
+		{
+			const int x = int((int64_t((*data)[at].time) - timeOffset)/ticksPerPixel);
+			if( x > width()) break;
 
-			if( at >= maxAt) break;
+			const uint64_t columnEnd = timeOffset + uint64_t(std::ceil((x+1)*ticksPerPixel));
+			uint64_t next = probe->findPosAfter( columnEnd, at);
+			if( next == at) next = at+1;
 
-			// Update the average values
-			deltaAt += at - previousAt;
-			totalDeltaAt++;
+			// Include the value carried into this column from the previous one
+			const bool mixed = probe->hasTransition( at-1, next);
+			const bool nextHigh = (*data)[next-1].value;
+			at = next;
 
-			bool nextHigh = (*data)[at].value;
-			if( nextHigh == prevHigh) continue;
+			if(!mixed) continue;
 
-			int64_t nextTime = (*data)[at].time;
-			int nextX = int((nextTime - timeOffset)*(pixelsPerSecond/LOGIC_UPDATE_RATE));
-			int nextY = midHeight + int(nextHigh ? -m_halfOutputHeight : +m_halfOutputHeight);
-
-			p.drawLine( prevX, prevY, nextX, prevY);
-			p.drawLine( nextX, prevY, nextX, nextY);
+			p.drawLine( prevX, prevY, x, prevY);
+			p.drawLine( x, highY, x, lowY);
 
 			prevHigh = nextHigh;
-			prevTime = nextTime;
-			prevX = nextX;
-			prevY = nextY;
-
-			if( nextX > width()) break;
-		};
+			prevX = x;
+			prevY = prevHigh ? highY : lowY;
+		}
 
 		// If we could not draw right to the end; it is because we exceeded
 		// maxAt
@@ -417,8 +391,47 @@ void OscilloscopeView::drawFloatingData(QPainter &p)
 		// Set the pen colour according to the colour the user has selected for the probe
 		p.setPen( probe->color());
 
-		int64_t at = probe->findPos(timeOffset);
+		const double samplesPerPixel = LINEAR_UPDATE_RATE/pixelsPerSecond;
 		const int64_t maxAt = probe->m_data->size();
+
+		if( samplesPerPixel > 1.0)
+		{
+			// Zoomed out: draw each pixel column as a vertical line spanning the
+			// min/max of its samples, looked up in the probe's pyramid so that
+			// the cost does not grow with the amount of recorded data.
+			const double firstSample = double(timeOffset - int64_t(probe->resetTime()))*LINEAR_UPDATE_RATE/LOGIC_UPDATE_RATE;
+			int prevX = -1;
+			int prevY = 0;
+
+			for( int x = 0; x <= width(); ++x)
+			{
+				int64_t begin = int64_t(std::floor(firstSample + x*samplesPerPixel));
+				int64_t end = int64_t(std::floor(firstSample + (x+1)*samplesPerPixel));
+				if( begin < 0) begin = 0;
+				if( end > maxAt) end = maxAt;
+				if( begin >= maxAt) break;
+				if( begin >= end) continue;
+
+				// Include the previous sample so that neighbouring columns join up
+				const MinMaxPyramid<float>::Entry e = probe->range( (begin>0) ? begin-1 : begin, end);
+
+				double v = e.max;
+				const int maxY = v_to_y;
+				v = e.min;
+				const int minY = v_to_y;
+				p.drawLine( x, maxY, x, minY);
+
+				v = (*data)[end-1];
+				prevY = v_to_y;
+				prevX = x;
+			}
+
+			if( prevX >= 0 && prevX < width() && maxAt > 0)
+				p.drawLine( prevX, prevY, width(), prevY);
+			continue;
+		}
+
+		int64_t at = probe->findPos(timeOffset);
 		if(at > maxAt) at = maxAt;
 		int64_t prevTime = probe->toTime(at);
 
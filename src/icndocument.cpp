@@ -31,6 +31,39 @@
 #include <qclipboard.h>
 #include <qtimer.h>
 #include <QApplication>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace {
+	/**
+	 * Maps connector routes on a pool thread for ICNDocument::rerouteConnectors.
+	 */
+	class ConnectorRouteTask final : public QRunnable
+	{
+		public:
+			ConnectorRouteTask( std::function<void(CellSearch &)> mapRoutes, CellSearch &search, QSemaphore &done ) :
+				m_mapRoutes( std::move(mapRoutes) ),
+				m_search( search ),
+				m_done( done )
+			{}
+
+			void run() override
+			{
+				m_mapRoutes( m_search );
+				m_done.release();
+			}
+
+		private:
+			std::function<void(CellSearch &)> m_mapRoutes;
+			CellSearch &m_search;
+			QSemaphore &m_done;
+	};
+}
 
 
 //BEGIN class ICNDocument
@@ -698,6 +731,18 @@ void ICNDocument::rerouteInvalidatedConnectors()
 	// We only ever need to add the connector points for CNItem's when we're about to reroute...
 	addAllItemConnectorPoints();
 
+	// The cells know where all of the CNItems are; so if there is nothing
+	// else on the canvas, a route that keeps out of the cells covered by items
+	// cannot collide with any items
+	bool allItemsInCells = true;
+	for ( Item *item : m_itemList )
+	{
+		if ( item && !dynamic_cast<CNItem*>(item) ) {
+			allItemsInCells = false;
+			break;
+		}
+	}
+
 	// List of connectors which are to be determined to need rerouting (and whose routes aren't controlled by NodeGroups)
 	QPtrList<Connector> connectorRerouteList;
 
@@ -733,7 +778,7 @@ void ICNDocument::rerouteInvalidatedConnectors()
 			}
 
 			// Test to see if the route intersects any Items (we ignore if it is a manual route)
-			if ( !needsRerouting && !connector->usesManualPoints() ) {
+			if ( !needsRerouting && !connector->usesManualPoints() && (!allItemsInCells || connector->routeCrossesItems()) ) {
 
 				const auto collisions = connector->collisions(true);
 				const auto collisionsEnd = collisions.end();
@@ -773,8 +818,7 @@ void ICNDocument::rerouteInvalidatedConnectors()
 	for ( QPtrList<NodeGroup>::iterator it = nodeGroupRerouteList.begin(); it != nodeGroupRerouteEnd; ++it )
 		(*it)->updateRoutes();
 
-	for ( QPtrList<Connector>::iterator it = connectorRerouteList.begin(); it != connectorRerouteEnd; ++it )
-		(*it)->rerouteConnector();
+	rerouteConnectors( connectorRerouteList );
 
 	for ( QPtrList<Connector>::iterator it = m_connectorList.begin(); it != connectorListEnd; ++it )
 	{
@@ -783,6 +827,63 @@ void ICNDocument::rerouteInvalidatedConnectors()
 }
 
 
+void ICNDocument::rerouteConnectors( const QPtrList<Connector> &connectors )
+{
+	// Don't bother with threads for a handful of connectors
+	static constexpr const int minConnectorsPerThread = 4;
+
+	std::vector<Connector*> batch;
+	batch.reserve( connectors.size() );
+	for ( Connector *connector : connectors )
+	{
+		if ( !connector || !connector->isVisible() || connector->nodeGroup() || !connector->startNode() || !connector->endNode() )
+			continue;
+
+		connector->updateConnectorPoints(false);
+		batch.push_back(connector);
+	}
+
+	const int threads = std::min<int>( QThread::idealThreadCount(), int(batch.size()) / minConnectorsPerThread );
+	if ( threads <= 1 )
+	{
+		for ( Connector *connector : batch )
+			connector->rerouteConnector();
+		return;
+	}
+
+	// Map all of the routes at once, against the cells as they are now. This
+	// thread does its share too, and the cells are not changed until all
+	// routes have been mapped.
+	std::vector<int> penalties( batch.size() );
+	std::atomic<size_t> next{0};
+	auto mapRoutes = [&]( CellSearch &search ) {
+		for ( size_t i = next++; i < batch.size(); i = next++ )
+		{
+			batch[i]->mapRoute(search);
+			penalties[i] = batch[i]->routePenalty();
+		}
+	};
+
+	QSemaphore done;
+	for ( int i = 1; i < threads; ++i )
+		QThreadPool::globalInstance()->start( new ConnectorRouteTask( mapRoutes, m_cells->workerSearch(i), done ) );
+
+	mapRoutes( m_cells->search() );
+	done.acquire( threads - 1 );
+
+	// Routes mapped at the same time could not avoid each other. So apply
+	// them in order, mapping again those that now pass through or next to
+	// a connector applied before them.
+	for ( size_t i = 0; i < batch.size(); ++i )
+	{
+		Connector *connector = batch[i];
+		if ( connector->routePenalty() != penalties[i] )
+			connector->mapRoute( m_cells->search() );
+		connector->applyRoute();
+	}
+}
+
+
 void ICNDocument::deleteSelection()
 {
 	// End whatever editing mode we are in, as we don't want to start editing
@@ -249,6 +249,12 @@ protected:
 	 * This only needs to be called when connector(s) need routing.
 	 */
 	void addAllItemConnectorPoints();
+	/**
+	 * Reroutes the given connectors (which must not be controlled by
+	 * NodeGroups). Larger batches have their routes mapped on several
+	 * threads at once; used by rerouteInvalidatedConnectors.
+	 */
+	void rerouteConnectors( const QPtrList<Connector> &connectors );
 
 	void fillContextMenu( const QPoint &pos ) override;
 	/**
@@ -72,10 +72,8 @@ Item::~Item()
 
 	KtlQCanvasPolygon::hide();
 
-	const VariantDataMap::iterator variantDataEnd = m_variantData.end();
-	for ( VariantDataMap::iterator it = m_variantData.begin(); it != variantDataEnd; ++it )
-		delete it.value();
 	m_variantData.clear();
+	m_properties.clear();
 }
 
 
@@ -613,13 +611,16 @@ QColor Item::dataColor( const QString & id ) const
 
 Variant * Item::createProperty( const QString & id, Variant::Type type )
 {
-	if ( !m_variantData.contains(id) )
-	{
-		m_variantData[id] = new Variant( id, type );
-		connect( m_variantData[id], SIGNAL(valueChanged(QVariant,QVariant)), this, SLOT(propertyChangedInitial()) );
-	}
+	VariantDataMap::const_iterator it = m_variantData.constFind(id);
+	if ( it != m_variantData.constEnd() )
+		return it.value();
 
-	return m_variantData[id];
+	// Every item of a type has the same property ids, so share their strings
+	const QString sharedId = Variant::sharedId(id);
+	m_properties.push_back( std::make_unique<Variant>( this, sharedId, type ) );
+	Variant * variant = m_properties.back().get();
+	m_variantData.insert( sharedId, variant );
+	return variant;
 }
 
 Variant & Item::createPropertyRef(const QString &id, Variant::Type type) {
@@ -629,8 +630,9 @@ Variant & Item::createPropertyRef(const QString &id, Variant::Type type) {
 
 Variant * Item::property( const QString & id ) const
 {
-	if ( m_variantData.contains(id) )
-		return m_variantData[id];
+	VariantDataMap::const_iterator it = m_variantData.constFind(id);
+	if ( it != m_variantData.constEnd() )
+		return it.value();
 
 	qCritical() << Q_FUNC_INFO << " No such property with id " << id << endl;
 	// TODO return something saner. Like a sentinel value.
@@ -648,9 +650,21 @@ bool Item::hasProperty( const QString & id ) const
 }
 
 
+void Item::removeProperty( const QString & id )
+{
+	m_variantData.remove(id);
+}
+
+
 void Item::finishedCreation( )
 {
 	m_bDoneCreation = true;
+
+	// The properties have now been set up, so their metadata can be shared
+	// with the other items of our type
+	for ( Variant * variant : std::as_const(m_variantData) )
+		variant->shareSchema( m_type );
+
 	dataChanged();
 }
 
@@ -20,7 +20,9 @@
 #include <QPointer>
 
 #include <cmath>
+#include <memory>
 #include <type_traits>
+#include <vector>
 
 class Document;
 class EventInfo;
@@ -117,6 +119,12 @@ public:
 	Property * property( const QString & id ) const;
 	Property & propertyRef( const QString & id ) const;
 	bool hasProperty( const QString & id ) const;
+	/**
+	 * Removes the property from variantMap(), e.g. one that is only read
+	 * from old files. It is kept until the item is destroyed, as an editor
+	 * may still be showing it.
+	 */
+	void removeProperty( const QString & id );
 
 	/**
 	 * Whether or not we can resize the item
@@ -132,10 +140,15 @@ public:
 	 * since this function was last called. If your item doesn't move, yet still
 	 * continously changes what is being displayed (such as a seven segment
 	 * display or a lamp), then set m_bDynamicContent to be true in the
-	 * constructor or reinherit this to return true when the contents of the
-	 * item have changed since this function was last called.
+	 * constructor, and reinherit this to return true only when the contents
+	 * of the item have changed since this function was last called.
 	 */
 	virtual bool contentChanged() const { return m_bDynamicContent; }
+	/**
+	 * Returns whether the item needs to be polled with contentChanged on
+	 * every update. Only items with m_bDynamicContent set are polled.
+	 */
+	bool hasDynamicContent() const { return m_bDynamicContent; }
 	/**
 	 * Returns a identifier for the CNItem, which is unique on the ICNDocument
 	 */
@@ -347,6 +360,7 @@ protected:
 	QTimer * m_pPropertyChangedTimer; ///< Single show timer for one a property changes
 
 	friend class ItemLibrary;
+	friend class Variant;
 
 	int m_baseZ;
 	bool m_bIsRaised;
@@ -355,6 +369,8 @@ protected:
 	bool m_bDynamicContent;
 	QRect m_sizeRect;
 	VariantDataMap m_variantData;
+	/// Owns the properties, in the order that they were created
+	std::vector<std::unique_ptr<Variant>> m_properties;
 };
 
 #endif
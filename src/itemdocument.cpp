@@ -148,6 +148,7 @@ bool ItemDocument::registerItem(Item *item)
 	requestEvent( ItemDocument::ItemDocumentEvent::ResizeCanvasToItems );
 
 	m_itemList[ item->id() ] = item;
+	m_bDynamicItemListDirty = true;
 	connect( item, SIGNAL(selectionChanged()), this, SIGNAL(selectionChanged()) );
 	itemAdded(item);
 	return true;
@@ -514,7 +515,7 @@ void ItemDocument::slotUpdateConfiguration()
 
 KtlQCanvasItem* ItemDocument::itemAtTop( const QPoint &pos ) const
 {
-	auto list = m_canvas->collisions( QRect( pos.x()-1, pos.y()-1, 3, 3 ) ); // note: m_canvas is actually modified here
+	auto list = m_canvas->collisions( QRect( pos.x()-1, pos.y()-1, 3, 3 ) );
 	auto it = list.begin();
 	const auto end = list.end();
 
@@ -944,7 +945,7 @@ void ItemDocument::exportToImage()
 	saveArea = m_canvas->rect();
 
 	if ( type == "PNG" || type == "BMP" )
-		outputImage = new QPixmap( saveArea.size() );
+		outputImage = new QImage( saveArea.size(), QImage::Format_ARGB32_Premultiplied );
 	else if ( type == "SVG" ) {
 		setSVGExport(true);
 		outputImage = new QPicture();
@@ -979,7 +980,7 @@ void ItemDocument::exportToImage()
 		if( type == "SVG" )
 			saveResult = dynamic_cast<QPicture*>(outputImage)->save( url.path(), type.toLatin1().data());
 		else {
-			QImage img = dynamic_cast<QPixmap*>(outputImage)->toImage();
+			const QImage &img = *static_cast<QImage*>(outputImage);
             if ( saveArea.x() < 0 ) {
                 cropArea.translate( - saveArea.x(), 0 );
             }
@@ -993,7 +994,7 @@ void ItemDocument::exportToImage()
 	} else {
 		if ( type=="SVG" )
 			saveResult = dynamic_cast<QPicture*>(outputImage)->save( url.path(), type.toLatin1().data() );
-		else	saveResult = dynamic_cast<QPixmap*>(outputImage)->save( url.path(), type.toLatin1().data() );
+		else	saveResult = static_cast<QImage*>(outputImage)->save( url.path(), type.toLatin1().data() );
 	}
 
 	//if(saveResult == true)	KMessageBox::information( this, i18n("Sucessfully exported to \"%1\"", url.filename() ), i18n("Image Export") );
@@ -1009,6 +1010,16 @@ void ItemDocument::exportToImage()
 
 void ItemDocument::exportToImageDraw( const QRect &saveArea, QPaintDevice &pDev) {
     qDebug() << Q_FUNC_INFO << " saveArea " << saveArea;
+
+    // Images are painted in tiles on the thread pool; anything else (i.e. the
+    // QPicture for SVG) has to be painted in one go
+    if ( pDev.devType() == QInternal::Image ) {
+        m_canvas->setBackgroundPixmap(QPixmap());
+        m_canvas->drawArea( saveArea, static_cast<QImage&>(pDev) );
+        updateBackground();
+        return;
+    }
+
     //QPainter p(outputImage); // 2016.05.03 - explicitly initialize painter
     QPainter p;
     const bool isBeginSuccess = p.begin(&pDev);
@@ -1148,11 +1159,24 @@ void ItemDocument::slotUpdateZOrdering()
 
 void ItemDocument::update( )
 {
-	ItemMap::iterator end = m_itemList.end();
-	for ( ItemMap::iterator it = m_itemList.begin(); it != end; ++it )
+	// Items only learn whether they have dynamic content once fully
+	// constructed (after registration), so the list is rebuilt lazily here.
+	if ( m_bDynamicItemListDirty )
 	{
-		if ( (*it)->contentChanged() )
-			(*it)->setChanged();
+		m_dynamicItemList.clear();
+		ItemMap::iterator end = m_itemList.end();
+		for ( ItemMap::iterator it = m_itemList.begin(); it != end; ++it )
+		{
+			if ( *it && (*it)->hasDynamicContent() )
+				m_dynamicItemList << *it;
+		}
+		m_bDynamicItemListDirty = false;
+	}
+
+	for ( auto &item : m_dynamicItemList )
+	{
+		if ( item && item->contentChanged() )
+			item->setChanged();
 	}
 }
 
@@ -1363,6 +1387,9 @@ void Canvas::drawForeground ( QPainter &p, const QRect & clip )
 		return;
 	}
 
+	if ( isPaintingView() )
+		p_itemDocument->drawOverlay( p, clip );
+
 	if ( !m_pMessageTimeout->isActive() )
 		return;
 
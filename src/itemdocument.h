@@ -228,6 +228,12 @@ class ItemDocument : public Document
 		 * Called from Canvas (when KtlQCanvas::advance is called).
 		 */
 		virtual void update();
+		/**
+		 * Called from Canvas after the items have been drawn, to draw
+		 * anything that goes on top of them in the given area of a view. It
+		 * isn't called when exporting or printing.
+		 */
+		virtual void drawOverlay( QPainter &p, const QRect &clip ) { Q_UNUSED(p); Q_UNUSED(clip); }
 
 	/**
 	 * Returns a unique id, for use in requestStateSave
@@ -378,6 +384,9 @@ public slots:
 
 		QPtrList<Item>	 m_itemDeleteList;
 		ItemMap		 m_itemList;
+		/// Items with dynamic content, polled in update()
+		QPtrList<Item> m_dynamicItemList;
+		bool m_bDynamicItemListDirty = true;
 
 		QString		 m_fileExtensionInfo; // For displaying in the save file dialog
 
@@ -311,7 +311,7 @@ QWidget * ItemInterface::configWidget()
 				connectMapWidget( box, SIGNAL(editTextChanged(const QString &)));
 				connectMapWidget( box, SIGNAL(activated(const QString &)));
 
-				connect( *vait, SIGNAL(valueChangedStrAndTrue(const QString &, bool)),
+				connect( vait.value()->notifier(), SIGNAL(valueChangedStrAndTrue(const QString &, bool)),
                          box, SLOT(setCurrentItem(const QString &, bool)) );
 
 				editWidget = box;
@@ -342,7 +342,7 @@ QWidget * ItemInterface::configWidget()
 				connectMapWidget( box, SIGNAL(returnPressed(const QString &)));
 				connectMapWidget( box, SIGNAL(activated(const QString &)));
 
-				connect( *vait, SIGNAL(valueChanged(const QString &)), box, SLOT(setEditText(const QString &)) );
+				connect( vait.value()->notifier(), SIGNAL(valueChanged(const QString &)), box, SLOT(setEditText(const QString &)) );
 
 				editWidget = urlreq;
 				break;
@@ -356,7 +356,7 @@ QWidget * ItemInterface::configWidget()
 				m_stringLineEditMap[vait.key()] = edit;
 				editWidget = edit;
 
-				connect( *vait, SIGNAL(valueChanged(const QString &)), edit, SLOT(setText(const QString &)) );
+				connect( vait.value()->notifier(), SIGNAL(valueChanged(const QString &)), edit, SLOT(setText(const QString &)) );
 
 				break;
 			}
@@ -369,7 +369,7 @@ QWidget * ItemInterface::configWidget()
 				m_intSpinBoxMap[vait.key()] = spin;
 				editWidget = spin;
 
-				connect( *vait, SIGNAL(valueChanged(int)), spin, SLOT(setValue(int)) );
+				connect( vait.value()->notifier(), SIGNAL(valueChanged(int)), spin, SLOT(setValue(int)) );
 
 				break;
 			}
@@ -381,7 +381,7 @@ QWidget * ItemInterface::configWidget()
 				m_doubleSpinBoxMap[vait.key()] = spin;
 				editWidget = spin;
 
-				connect( *vait, SIGNAL(valueChanged(double)), spin, SLOT(setValue(double)) );
+				connect( vait.value()->notifier(), SIGNAL(valueChanged(double)), spin, SLOT(setValue(double)) );
 
 				break;
 			}
@@ -395,7 +395,7 @@ QWidget * ItemInterface::configWidget()
 				connectMapWidget( colorBox, SIGNAL(activated(const QColor &)));
 				m_colorComboMap[vait.key()] = colorBox;
 
-				connect( *vait, SIGNAL(valueChanged(const QColor &)), colorBox, SLOT(setColor(const QColor &)) );
+				connect( vait.value()->notifier(), SIGNAL(valueChanged(const QColor &)), colorBox, SLOT(setColor(const QColor &)) );
 
 				editWidget = colorBox;
 				break;
@@ -409,7 +409,7 @@ QWidget * ItemInterface::configWidget()
 				connectMapWidget( box, SIGNAL(toggled(bool)));
 				m_boolCheckMap[vait.key()] = box;
 
-				connect( *vait, SIGNAL(valueChanged(bool)), box, SLOT(setChecked(bool)) );
+				connect( vait.value()->notifier(), SIGNAL(valueChanged(bool)), box, SLOT(setChecked(bool)) );
 
 				editWidget = box;
 				break;
@@ -19,6 +19,7 @@
 #include "libraryitem.h"
 #include "node.h"
 #include "pinmapping.h"
+#include "startuptrace.h"
 #include "subcircuits.h"
 
 #include <qapplication.h>
@@ -32,6 +33,8 @@
 #include <kglobal.h>
 
 #include <qbitmap.h>
+#include <qcryptographichash.h>
+#include <qdatetime.h>
 #include "qdebug.h"
 #include <qdir.h>
 #include <qfile.h>
@@ -40,6 +43,8 @@
 #include <qpixmap.h>
 #include <qpushbutton.h>
 #include <qregexp.h>
+#include <qsavefile.h>
+#include <qstandardpaths.h>
 #include <qtimer.h>
 
 #include <cassert>
@@ -96,6 +101,7 @@
 #include "multiinputgate.h"
 #include "multiplexer.h"
 #include "parallelportcomponent.h"
+#include "pic14component.h"
 #include "piccomponent.h"
 #include "pushswitch.h"
 #include "probe.h"
@@ -134,17 +140,35 @@
 //END Item includes
 
 
+namespace {
+	/**
+	 * Bump this when componentImage or the drawing code of the components
+	 * changes, so that images drawn the old way aren't used. A new release
+	 * (or a different Qt, which may draw differently) doesn't need this.
+	 */
+	static constexpr const int componentImageCacheFormat = 2;
+	/// Cached component images not used for this long are removed
+	static constexpr const int componentImageCacheMaxAgeDays = 60;
+	/// Only this many of the most recently used component images are kept
+	static constexpr const int componentImageCacheMaxFiles = 2000;
+}
+
+
 KLocalizedString ItemLibrary::m_emptyItemDescription = ki18n("This help item does not yet exist for the %1 language. Help out with KTechlab by creating one via the \"Edit\" button.");
 
 
 ItemLibrary::ItemLibrary()
 {
+	StartupTrace::Phase phase{"ItemLibrary"};
+
 	addFlowParts();
 	addComponents();
 	addMechanics();
 	addDrawParts();
 
-	loadItemDescriptions();
+	// Create an entry for the current language; its descriptions are read
+	// when they are first needed
+	m_itemDescriptions[ QLocale::languageToString(QLocale().language()) ];
 }
 
 
@@ -218,6 +242,7 @@ void ItemLibrary::addComponents()
 #ifndef NO_GPSIM
 	addLibraryItem( PICComponent::libraryItem() );
 #endif
+	addLibraryItem( PIC14Component::libraryItem() );
 
 	// Connections
 	addLibraryItem( ParallelPortComponent::libraryItem() );
@@ -383,7 +408,7 @@ Item * ItemLibrary::createItem( const QString &id, ItemDocument *itemDocument, b
 }
 
 
-QImage ItemLibrary::componentImage( Component * component, const uint maxSize )
+QImage ItemLibrary::componentImage( Component * component )
 {
 	// Default orientation for painting
 	const int angleDegrees = component->angleDegrees();
@@ -407,10 +432,31 @@ QImage ItemLibrary::componentImage( Component * component, const uint maxSize )
 		bound.setRight( bound.right()-(dy/2) );
 	}
 
-	const bool cache = ((bound.width()*bound.height()) > (int)maxSize);
-	QString type;
-	if ( cache && m_imageMap.contains(component->type()) )
-		return m_imageMap[component->type()];
+	const QString key = componentImageKey( component, bound );
+	if ( !key.isEmpty() )
+	{
+		QImage im = m_imageMap.value( key );
+		if ( im.isNull() )
+		{
+			const QString dir = componentImageCacheDirectory();
+			if ( !dir.isEmpty() && im.load( dir + key + ".png", "PNG" ) )
+			{
+				m_imageMap[key] = im;
+
+				// The modification time is when it was last used, for pruning
+				QFile file( dir + key + ".png" );
+				if ( file.open( QIODevice::ReadWrite ) )
+					file.setFileTime( QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime );
+			}
+		}
+
+		if ( !im.isNull() )
+		{
+			component->setAngleDegrees( angleDegrees );
+			component->setFlipped( flipped );
+			return im;
+		}
+	}
 
 	// Create pixmap big enough to contain CNItem and surrounding nodes
 	// and copy the button grab to it
@@ -522,8 +568,18 @@ QImage ItemLibrary::componentImage( Component * component, const uint maxSize )
 	//im = im.smoothScale( 50, 50, Qt::ScaleMin ); //2018.12.01
     im = im.scaled( QSize( 50, 50 ), Qt::KeepAspectRatio, Qt::SmoothTransformation );
 
-	if (cache)
-		m_imageMap[component->type()] = im;
+	if ( !key.isEmpty() )
+	{
+		m_imageMap[key] = im;
+
+		const QString dir = componentImageCacheDirectory();
+		if ( !dir.isEmpty() )
+		{
+			QSaveFile file( dir + key + ".png" );
+			if ( !file.open( QIODevice::WriteOnly ) || !im.save( &file, "PNG" ) || !file.commit() )
+				qWarning() << Q_FUNC_INFO << "Could not save component image to \"" << file.fileName() << "\"";
+		}
+	}
 
 	// Restore original orientation
 	component->setAngleDegrees( angleDegrees );
@@ -532,6 +588,86 @@ QImage ItemLibrary::componentImage( Component * component, const uint maxSize )
 	return im;
 }
 
+QString ItemLibrary::componentImageKey( Component * component, const QRect & bound )
+{
+	// Only components that say what their shape depends on can be cached;
+	// others (e.g. switches, drawn from whether they are pressed) are drawn
+	// every time
+	const QString glyphKey = component->glyphKey();
+	if ( component->hasDynamicContent() || glyphKey.isEmpty() )
+		return QString();
+
+	// Everything else that componentImage draws
+	QString description = QString::fromLatin1("%1|%2,%3|%4x%5|0,0|50")
+		.arg( glyphKey )
+		.arg( bound.x() - int(component->x()) )
+		.arg( bound.y() - int(component->y()) )
+		.arg( bound.width() )
+		.arg( bound.height() );
+
+	const NodeInfoMap nodes = component->nodeMap();
+	for ( NodeInfoMap::const_iterator it = nodes.begin(); it != nodes.end(); ++it )
+		description += QString::fromLatin1("|n:%1").arg( it.key() );
+
+	const TextMap text = component->textMap();
+	for ( TextMap::const_iterator it = text.begin(); it != text.end(); ++it )
+	{
+		if ( it.value() )
+			description += QString::fromLatin1("|t:%1=%2").arg( it.key() ).arg( it.value()->text() );
+	}
+
+	return QString::fromLatin1( QCryptographicHash::hash( description.toUtf8(), QCryptographicHash::Sha1 ).toHex() );
+}
+
+
+QString ItemLibrary::componentImageCacheDirectory()
+{
+	if ( !m_componentImageCacheDir.isNull() )
+		return m_componentImageCacheDir;
+
+	m_componentImageCacheDir = QString::fromLatin1("");
+
+	const QString version = QString::fromLatin1("%1-%2-qt%3")
+		.arg( QString::fromLatin1( VERSION ) )
+		.arg( componentImageCacheFormat )
+		.arg( QString::fromLatin1( qVersion() ) );
+	QDir root( QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/componentimages" );
+
+	// Components may be drawn differently by other versions
+	const QStringList versions = root.entryList( QDir::Dirs | QDir::NoDotAndDotDot );
+	for ( const QString & other : versions )
+	{
+		if ( other != version )
+			QDir( root.filePath( other ) ).removeRecursively();
+	}
+
+	if ( !root.mkpath( version ) )
+	{
+		qWarning() << Q_FUNC_INFO << "Could not create component image cache in \"" << root.path() << "\"";
+		return m_componentImageCacheDir;
+	}
+
+	m_componentImageCacheDir = root.filePath( version ) + '/';
+	pruneComponentImageCache( m_componentImageCacheDir );
+	return m_componentImageCacheDir;
+}
+
+
+void ItemLibrary::pruneComponentImageCache( const QString & dir )
+{
+	// Newest first
+	const QFileInfoList files = QDir( dir ).entryInfoList( QStringList( QString::fromLatin1("*.png") ), QDir::Files, QDir::Time );
+	const QDateTime oldest = QDateTime::currentDateTimeUtc().addDays( -componentImageCacheMaxAgeDays );
+
+	for ( int i = 0; i < files.size(); ++i )
+	{
+		const QFileInfo & info = files[i];
+		if ( i >= componentImageCacheMaxFiles || info.lastModified().toUTC() < oldest )
+			QFile::remove( info.filePath() );
+	}
+}
+
+
 QPixmap ItemLibrary::itemIconFull( const QString &id )
 {
 	LibraryItemList::iterator end = m_items.end();
@@ -580,6 +716,7 @@ bool ItemLibrary::haveDescription( QString type, const QString & language ) cons
 		type.remove( 0, 1 );
 	}
 
+	loadItemDescriptions( language );
 	if ( !m_itemDescriptions[ language ].contains( type ) )
 	{
 		return libraryItem( type );
@@ -597,11 +734,13 @@ QString ItemLibrary::description( QString type, const QString & language ) const
 		type.remove( 0, 1 );
 	}
 
+	loadItemDescriptions( language );
 	QString current = m_itemDescriptions[ language ][ type ];
 
 	if ( current.isEmpty() )
 	{
 		// Try english-language description
+		loadItemDescriptions( QString::fromLatin1("en_US") );
 		current = m_itemDescriptions[ QString::fromLatin1("en_US") ][ type ];
 		if ( current.isEmpty() )
 			return emptyItemDescription( language );
@@ -626,6 +765,8 @@ bool ItemLibrary::setDescription( QString type, const QString & description, con
 		type.remove( 0, 1 );
 	}
 
+	// The other descriptions in the language are saved too
+	loadItemDescriptions( language );
 	m_itemDescriptions[ language ][ type ] = description;
 	return saveDescriptions( language );
 }
@@ -673,62 +814,55 @@ QString ItemLibrary::itemDescriptionsFile( const QString & language ) const
 }
 
 
-void ItemLibrary::loadItemDescriptions()
+void ItemLibrary::loadItemDescriptions( const QString & language ) const
 {
-	// Create an entry for the default language (American English)
-	// and the current language
-//     KLocale * locale = KLocale::global();
-// 	m_itemDescriptions[ locale->defaultLanguage() ];
-// 	m_itemDescriptions[ locale->language() ];
+	if ( m_loadedDescriptionLanguages.contains( language ) )
+		return;
+	m_loadedDescriptionLanguages << language;
 
-	m_itemDescriptions[ QLocale::languageToString(QLocale().language()) ];
+	QStringMap & descriptions = m_itemDescriptions[ language ];
 
-	const QStringList languages = descriptionLanguages();
-	QStringList::const_iterator end = languages.end();
-	for ( QStringList::const_iterator it = languages.begin(); it != end; ++it )
+	QString url = itemDescriptionsFile( language );
+
+	QFile file( url );
+	if ( !file.open( QIODevice::ReadOnly ) )
 	{
-		QString url = itemDescriptionsFile( *it );
+		qWarning() << Q_FUNC_INFO << "Could not open file \"" << url << "\"" << endl;
+		return;
+	}
 
-		QFile file( url );
-		if ( !file.open( QIODevice::ReadOnly ) )
+	QTextStream stream( & file );
+
+	QString type;
+	QString description;
+	while ( !stream.atEnd() )
+	{
+		QString line = stream.readLine();
+		if ( line.startsWith( QString::fromLatin1("<!-- item: ") ) )
 		{
-			qWarning() << Q_FUNC_INFO << "Could not open file \"" << url << "\"" << endl;
-			continue;
-		}
+			// Save the previous description
+			if ( !type.isEmpty() )
+				descriptions[ type ] = description.trimmed();
 
-		QTextStream stream( & file );
+			line.remove( QString::fromLatin1("<!-- item: ") );
+			line.remove( QString::fromLatin1(" -->") );
 
-		QString type;
-		QString description;
-		while ( !stream.atEnd() )
-		{
-			QString line = stream.readLine();
-			if ( line.startsWith( QString::fromLatin1("<!-- item: ") ) )
+			type = line.trimmed();
+			if ( type.startsWith(QString::fromLatin1("/")) )
 			{
-				// Save the previous description
-				if ( !type.isEmpty() )
-					m_itemDescriptions[ *it ][ type ] = description.trimmed();
-
-				line.remove( QString::fromLatin1("<!-- item: ") );
-				line.remove( QString::fromLatin1(" -->") );
-
-				type = line.trimmed();
-				if ( type.startsWith(QString::fromLatin1("/")) )
-				{
-					// Possibly change e.g. "/ec/capacitor" to "ec/capacitor"
-					type.remove( 0, 1 );
-				}
-
-				description = QString::null;
-			} else description += line + '\n';
-		}
-
-		// Save the previous description
-		if ( !type.isEmpty() )
-			m_itemDescriptions[ *it ][ type ] = description.trimmed();
+				// Possibly change e.g. "/ec/capacitor" to "ec/capacitor"
+				type.remove( 0, 1 );
+			}
 
-		file.close();
+			description = QString::null;
+		} else description += line + '\n';
 	}
+
+	// Save the previous description
+	if ( !type.isEmpty() )
+		descriptions[ type ] = description.trimmed();
+
+	file.close();
 }
 
 #include "moc_itemlibrary.cpp"
@@ -61,14 +61,13 @@ class ItemLibrary : public QObject
 		 */
 		Item * createItem( const QString &id, ItemDocument * itemDocument, bool newItem, const char *newId = 0L, bool finishCreation = true );
 		/**
-		 * Returns an image of the given component. As QPixmap::toImage is
-		 * a slow function, this will cache the result and return that for large
-		 * images.
+		 * Returns an image of the given component in its default orientation.
+		 * Unless the component has dynamic content, the image is cached in
+		 * memory and on disk (for this version of KTechLab), keyed by what it
+		 * shows, so it is normally only drawn once.
 		 * @param component A pointer to the Component.
-		 * @param maxSize The maximum size (in pixels) before the image is
-		 * cached.
 		 */
-		QImage componentImage( Component * component, const uint maxSize = 36000 );
+		QImage componentImage( Component * component );
 		/**
 		 * Does similar to that above, but will not be able to return a description
 		 * if there is none saved on file (instead of the above, which falls back to
@@ -120,7 +119,33 @@ class ItemLibrary : public QObject
 		 * writing).
 		 */
 		bool saveDescriptions( const QString & language );
-		void loadItemDescriptions();
+		/**
+		 * Reads the item descriptions for the language from file, unless they
+		 * have been read already. Descriptions are only read when first
+		 * needed, to save time when starting.
+		 */
+		void loadItemDescriptions( const QString & language ) const;
+		/**
+		 * @return the key that componentImage caches the image of the
+		 * component (with the given bounding rect, in its default
+		 * orientation) under, or an empty string if it can't be cached (it
+		 * has dynamic content or no Component::glyphKey).
+		 */
+		static QString componentImageKey( Component * component, const QRect & bound );
+		/**
+		 * @return the directory (ending in a slash) of the on-disk cache of
+		 * component images, or an empty string if there isn't one. The cache
+		 * directories of other versions of KTechLab, of Qt or of the cache
+		 * format are removed, and the cache pruned, the first time this is
+		 * called.
+		 */
+		QString componentImageCacheDirectory();
+		/**
+		 * Removes the images in the cache directory that haven't been used
+		 * for a while, and the least recently used ones past a maximum
+		 * count.
+		 */
+		static void pruneComponentImageCache( const QString & dir );
 		void addComponents();
 		void addFlowParts();
 		void addMechanics();
@@ -129,8 +154,10 @@ class ItemLibrary : public QObject
 		ItemLibrary();
 	
 		LibraryItemList m_items;
-		ImageMap m_imageMap;
-		QStringMapMap m_itemDescriptions; // (Language, type) <--> description
+		ImageMap m_imageMap; // Component image key <--> image
+		QString m_componentImageCacheDir;
+		mutable QStringMapMap m_itemDescriptions; // (Language, type) <--> description
+		mutable QStringList m_loadedDescriptionLanguages;
 		static KLocalizedString m_emptyItemDescription; // Description template for when a description does not yet exist
 	
 		friend ItemLibrary * itemLibrary();
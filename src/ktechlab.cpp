@@ -33,6 +33,7 @@
 #include "recentfilesaction.h"
 #include "scopescreen.h"
 #include "settingsdlg.h"
+#include "startuptrace.h"
 #include "subcircuits.h"
 #include "symbolviewer.h"
 #include "textdocument.h"
@@ -79,9 +80,6 @@ KTechlab *KTechlab::m_pSelf = nullptr;
 KTechlab::KTechlab() : KateMDI::MainWindow(nullptr, "KTechlab") {
 	m_pSelf = this;
 
-	QTime ct;
-	ct.start();
-
 	if ( QFontInfo( m_itemFont ).pixelSize() > 11 ) {
 		// It has to be > 11, not > 12, as (I think) pixelSize() rounds off the actual size
 		m_itemFont.setPixelSize(12);
@@ -92,12 +90,27 @@ KTechlab::KTechlab() : KateMDI::MainWindow(nullptr, "KTechlab") {
 
 	setMinimumSize( 400, 400 );
 
-	setupTabWidget();
-	setupToolDocks();
-	setupActions();
-	setupView();
-  KSharedConfigPtr cfg = KGlobal::config();
-	readPropertiesInConfig( cfg.data() );
+	{
+		StartupTrace::Phase phase{"setupTabWidget"};
+		setupTabWidget();
+	}
+	{
+		StartupTrace::Phase phase{"setupToolDocks"};
+		setupToolDocks();
+	}
+	{
+		StartupTrace::Phase phase{"setupActions"};
+		setupActions();
+	}
+	{
+		StartupTrace::Phase phase{"setupView"};
+		setupView();
+	}
+	{
+		StartupTrace::Phase phase{"readPropertiesInConfig"};
+		KSharedConfigPtr cfg = KGlobal::config();
+		readPropertiesInConfig( cfg.data() );
+	}
 }
 
 
@@ -197,11 +210,19 @@ void KTechlab::setupToolDocks() {
 		i18n("Components")
 	);
   tv->setObjectName("ComponentSelector-ToolView");
-	ComponentSelector::self(tv);
+	{
+		StartupTrace::Phase phase{"ComponentSelector"};
+		ComponentSelector::self(tv);
+	}
 
 	// Create an instance of the subcircuits interface, now that we have created the component selector
 	subcircuits();
-	Subcircuits::loadSubcircuits();
+	// Nothing needs the user's subcircuits to be in the component selector
+	// before the window is shown
+	QTimer::singleShot( 0, [] {
+		StartupTrace::Phase phase{"loadSubcircuits"};
+		Subcircuits::loadSubcircuits();
+	} );
 
 	pm.load( KStandardDirs::locate( "appdata", "icons/flowcode.png" ) );
 	tv = createToolView(
@@ -211,7 +232,10 @@ void KTechlab::setupToolDocks() {
 		i18n("Flow Parts")
 	);
   tv->setObjectName("FlowPartSelector-ToolView");
-	FlowPartSelector::self(tv);
+	{
+		StartupTrace::Phase phase{"FlowPartSelector"};
+		FlowPartSelector::self(tv);
+	}
 
 #ifdef MECHANICS
 	pm.load( KStandardDirs::locate( "appdata", "icons/mechanics.png" ) );
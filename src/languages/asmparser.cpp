@@ -15,9 +15,78 @@
 #include <qdebug.h>
 
 #include <qfile.h>
-#include <qregexp.h>
 #include <qstringlist.h>
 
+// Called for every line of what can be very large assembly files (such as
+// those generated by SDCC), so these scan the line by hand rather than
+// building regular expressions for it.
+namespace {
+	/**
+	 * @return the text before the first semicolon or space, trimmed.
+	 */
+	QString firstColumn( const QString &line )
+	{
+		const int length = line.length();
+		for ( int i = 0; i < length; ++i ) {
+			const QChar c = line[i];
+			if ( c == ';' || c == ' ' )
+				return line.left(i).trimmed();
+		}
+		return line;
+	}
+
+	bool matchesNoCase( const QString &line, int pos, const char *word )
+	{
+		for ( ; *word; ++word, ++pos ) {
+			if ( pos >= line.length() || line[pos].toLower() != QLatin1Char(*word) )
+				return false;
+		}
+		return true;
+	}
+
+	int skipSpace( const QString &line, int pos )
+	{
+		while ( pos < line.length() && line[pos].isSpace() )
+			++pos;
+		return pos;
+	}
+
+	/**
+	 * Looks for the first "list p = " in the line.
+	 * @return the PIC id that follows it, or an empty string if there isn't
+	 * one.
+	 */
+	QString listedPicID( const QString &line )
+	{
+		const int length = line.length();
+		for ( int start = 0; start + 4 < length; ++start ) {
+			if ( !matchesNoCase( line, start, "list" ) )
+				continue;
+
+			int pos = start + 4;
+			if ( pos >= length || !line[pos].isSpace() )
+				continue;
+
+			pos = skipSpace( line, pos );
+			if ( !matchesNoCase( line, pos, "p" ) )
+				continue;
+
+			pos = skipSpace( line, pos + 1 );
+			if ( pos >= length || line[pos] != '=' )
+				continue;
+
+			const int idStart = skipSpace( line, pos + 1 );
+			int idEnd = idStart;
+			while ( idEnd < length && (line[idEnd].isLetterOrNumber() || line[idEnd] == '_') )
+				++idEnd;
+
+			// Only the first "list p =" counts, even if no id follows it
+			return line.mid( idStart, idEnd - idStart );
+		}
+		return QString();
+	}
+}
+
 AsmParser::AsmParser( const QString &url )
 	: m_url(url)
 {
@@ -53,26 +122,18 @@ bool AsmParser::parse( GpsimDebugger * debugger )
 	while ( !stream.atEnd() ) {
 		const QString line = stream.readLine().trimmed();
 		if ( m_type != Type::Relocatable ) {
-			QString col0 = line.section( QRegExp("[; ]"), 0, 0 );
-			col0 = col0.trimmed();
-			if ( nonAbsoluteOps.contains(col0) )
+			if ( nonAbsoluteOps.contains( firstColumn(line) ) )
 				m_type = Type::Relocatable;
 		}
 
 		if ( !m_bContainsRadix ) {
-			if ( line.contains( QRegExp("^RADIX[\\s]*") ) || line.contains( QRegExp("^radix[\\s]*") ) )
+			if ( line.startsWith("RADIX") || line.startsWith("radix") )
 				m_bContainsRadix = true;
 		}
 
 		if ( m_picID.isEmpty() ) {
-			// We look for "list p = ", and "list p = picid ", and subtract the positions / lengths away from each other to get the picid text position
-			QRegExp fullRegExp("[lL][iI][sS][tT][\\s]+[pP][\\s]*=[\\s]*[\\d\\w]+");
-			QRegExp halfRegExp("[lL][iI][sS][tT][\\s]+[pP][\\s]*=[\\s]*");
-
-			int startPos = fullRegExp.indexIn(line);
-			if ( (startPos != -1) && (startPos == halfRegExp.indexIn(line)) )
-			{
-				m_picID = line.mid( startPos + halfRegExp.matchedLength(), fullRegExp.matchedLength() - halfRegExp.matchedLength() );
+			m_picID = listedPicID(line);
+			if ( !m_picID.isEmpty() ) {
 				m_picID = m_picID.toUpper();
 				if ( !m_picID.startsWith("P") )
 					m_picID.prepend("P");
@@ -23,7 +23,7 @@ LibraryItem::LibraryItem( QStringList idList, const QString &name, const QString
 	m_icon_full = icon;
 	m_type = type;
 	createItem = _createItem;
-	createIcon16();
+	m_bIconsLoaded = false;
 }
 
 
@@ -32,10 +32,10 @@ LibraryItem::LibraryItem( QStringList idList, const QString &name, const QString
 	m_idList = idList;
 	m_name = name;
 	m_category = category;
-	m_icon_full.load( KStandardDirs::locate( "appdata", "icons/"+iconName ) );
+	m_iconName = iconName;
 	m_type = type;
 	createItem = _createItem;
-	createIcon16();
+	m_bIconsLoaded = false;
 }
 
 
@@ -46,7 +46,7 @@ LibraryItem::LibraryItem( QStringList idList, const QString &name, const QString
 	m_category = category;
 	m_type = type;
 	createItem = _createItem;
-	createIcon16();
+	m_bIconsLoaded = false;
 }
 
 
@@ -55,8 +55,29 @@ LibraryItem::~LibraryItem()
 }
 
 
-void LibraryItem::createIcon16()
+QPixmap LibraryItem::iconFull() const
 {
+	loadIcons();
+	return m_icon_full;
+}
+
+
+QPixmap LibraryItem::icon16() const
+{
+	loadIcons();
+	return m_icon_16;
+}
+
+
+void LibraryItem::loadIcons() const
+{
+	if ( m_bIconsLoaded )
+		return;
+	m_bIconsLoaded = true;
+
+	if ( !m_iconName.isEmpty() )
+		m_icon_full.load( KStandardDirs::locate( "appdata", "icons/"+m_iconName ) );
+
 	if ( m_icon_full.isNull() )
 		m_icon_full = KIconLoader::global()->loadIcon( "null", KIconLoader::Small );
 	
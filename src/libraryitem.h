@@ -47,20 +47,26 @@ class LibraryItem
 		QStringList allIDs() const { return m_idList; }
 		QString name() const { return m_name; }
 		QString category() const { return m_category; }
-		QPixmap iconFull() const { return m_icon_full; }
-		QPixmap icon16() const { return m_icon_16; }
+		/**
+		 * The icons are loaded the first time that either is asked for, as
+		 * loading the icons of every item slows down starting KTechLab.
+		 */
+		QPixmap iconFull() const;
+		QPixmap icon16() const;
 		createItemPtr createItemFnPtr() const { return createItem; }
 		int type() const { return m_type; }
 	
 	protected:
-		void createIcon16();
+		void loadIcons() const;
 	
 	private:
 		QStringList m_idList;
 		QString m_name;
 		QString m_category;
-		QPixmap m_icon_full;
-		QPixmap m_icon_16;
+		QString m_iconName;
+		mutable QPixmap m_icon_full;
+		mutable QPixmap m_icon_16;
+		mutable bool m_bIconsLoaded;
 		createItemPtr createItem;
 		int m_type;
 };
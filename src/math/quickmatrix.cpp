@@ -12,24 +12,21 @@ bool QuickMatrix::isSquare() const {
 	return rows == columns;
 }
 
-QuickMatrix::type ** QuickMatrix::allocate() const {
+QuickMatrix::type * QuickMatrix::allocate() {
+	constexpr int rowAlignment = alignment / int(sizeof(type));
+	stride = (columns + rowAlignment - 1) / rowAlignment * rowAlignment;
+
 	if (rows <= 0 || columns <= 0) {
 		return nullptr;
 	}
 
-	auto **newValues = new type*[rows];
-	for (int i : Times{rows}) {
-		newValues[i] = new type[columns];
-	}
-	return newValues;
+	const size_t size = size_t(rows) * size_t(stride) * sizeof(type);
+	return static_cast<type *>(::operator new[](size, std::align_val_t{alignment}));
 }
 
 void QuickMatrix::release() {
 	if (!values) return;
-	for (int i : Times{rows}) {
-		delete [] values[i];
-	}
-	delete [] values;
+	::operator delete[](values, std::align_val_t{alignment});
 	values = nullptr;
 }
 
@@ -38,9 +35,10 @@ QuickMatrix QuickMatrix::transposeSquare() const {
 
 	for (int i : Times{columns}) {
 		for (int j : Times{rows}) {
-			newmat.values[i][j] = 0;
+			type &sum = newmat[i][j];
+			sum = 0;
 			for (int k : Times{rows}) {
-				newmat.values[i][j] += values[k][i] * values[k][j];
+				sum += (*this)[k][i] * (*this)[k][j];
 			}
 		}
 	}
@@ -57,7 +55,7 @@ QuickVector QuickMatrix::transposeMult(const QuickVector &operandvec) const {
 	for (int i : Times{columns}) {
 		type sum = 0;
 		for (int j : Times{rows}) {
-			sum += values[j][i] * operandvec[j];
+			sum += (*this)[j][i] * operandvec[j];
 		}
 		ret[i] = sum;
 	}
@@ -80,11 +78,13 @@ QuickMatrix::QuickMatrix(int rows) :
 QuickMatrix::QuickMatrix(QuickMatrix &&old) :
 	values(old.values),
 	rows(old.rows),
-	columns(old.columns)
+	columns(old.columns),
+	stride(old.stride)
 {
 	old.values = nullptr;
 	old.rows = 0;
 	old.columns = 0;
+	old.stride = 0;
 }
 
 QuickMatrix::QuickMatrix(const QuickMatrix &old) :
@@ -97,8 +97,8 @@ QuickMatrix::QuickMatrix(const QuickMatrix *old) :
 {
 	values = allocate();
 
-	for (int j : Times{rows}) {
-		memcpy(values[j], old->values[j], columns * sizeof(type)); // fastest method. =)
+	if (values) {
+		memcpy(values, old->values, size_t(rows) * size_t(stride) * sizeof(type)); // fastest method. =)
 	}
 }
 
@@ -109,7 +109,7 @@ QuickMatrix::~QuickMatrix() {
 QuickMatrix::type QuickMatrix::at(int row, int column) const {
 	if (!values || row >= rows || column >= columns) return NAN;
 
-	return values[row][column];
+	return (*this)[row][column];
 }
 
 QuickMatrix::type QuickMatrix::multstep(int row, int pos, int col) const {
@@ -117,38 +117,63 @@ QuickMatrix::type QuickMatrix::multstep(int row, int pos, int col) const {
 }
 
 QuickMatrix::type QuickMatrix::multRowCol(int row, int col, int lim) const {
+	if (!values || row >= rows || col >= columns || lim > rows || lim > columns) return NAN;
+
+	const type *arow = (*this)[row];
+	const type *column = values + col;
+
 	type sum = 0;
 	for (int i : Times{lim}) {
-		sum += at(row, i) * at(i, col);
+		sum += arow[i] * column[i * stride];
 	}
 	return sum;
 }
 
+QuickMatrix::type QuickMatrix::dotRow(int row, const type *vec, int from, int to) const {
+	const type * __restrict arow = (*this)[row];
+	const type * __restrict b = vec;
+
+	// Four separate sums, so that the additions don't all wait on each other
+	// and the compiler can keep them in one vector register
+	type sum[4] = { 0, 0, 0, 0 };
+	int j = from;
+	for (; j + 4 <= to; j += 4) {
+		for (int k : Times{4}) {
+			sum[k] += arow[j + k] * b[j + k];
+		}
+	}
+	for (; j < to; ++j) {
+		sum[0] += arow[j] * b[j];
+	}
+
+	return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
 bool QuickMatrix::atPut(int row, int column, const type val) {
 	if (!values || row >= rows || column >= columns) return false;
 
-	values[row][column] = val;
+	(*this)[row][column] = val;
 	return true;
 }
 
 bool QuickMatrix::atAdd(int row, int column, const type val) {
 	if (!values || row >= rows || column >= columns) return false;
 
-	values[row][column] += val;
+	(*this)[row][column] += val;
 	return true;
 }
 
 bool QuickMatrix::swapRows(int rowA, int rowB) {
 	if (!values || rowA >= rows || rowB >= rows) return false;
 
-	std::swap(values[rowA], values[rowB]);
+	std::swap_ranges((*this)[rowA], (*this)[rowA] + columns, (*this)[rowB]);
 	return true;
 }
 
 bool QuickMatrix::scaleRow(int row, const type scalor) {
 	if (!values || row >= rows) return false;
 
-	type *arow = values[row];
+	type *arow = (*this)[row];
 	for (int j : Times{columns}) {
 		arow[j] *= scalor;
 	}
@@ -158,7 +183,7 @@ bool QuickMatrix::scaleRow(int row, const type scalor) {
 QuickMatrix::type QuickMatrix::rowsum(int row) const {
 	if (!values || row >= rows) return false;
 
-	const type *arow = values[row];
+	const type *arow = (*this)[row];
 
 	type sum = 0.0;
 	for (int j : Times{columns}) {
@@ -171,7 +196,7 @@ QuickMatrix::type QuickMatrix::rowsum(int row) const {
 double QuickMatrix::absrowsum(int row) const {
 	if (!values || row >= rows) return false;
 
-	const type *arow = values[row];
+	const type *arow = (*this)[row];
 
 	type sum = 0.0;
 
@@ -186,8 +211,8 @@ double QuickMatrix::absrowsum(int row) const {
 bool QuickMatrix::scaleAndAdd(int rowA, int rowB, const type scalor) {
 	if (!values || rowA >= rows || rowB >= rows) return false;
 
-	const type *arow = values[rowA];
-	type *brow = values[rowB];
+	const type *arow = (*this)[rowA];
+	type *brow = (*this)[rowB];
 
 	for (int j : Times{columns}) {
 		brow[j] += arow[j] * scalor;
@@ -204,10 +229,19 @@ bool QuickMatrix::partialScaleAndAdd(int rowA, int rowB, const type scalor) {
 bool QuickMatrix::partialSAF(int rowA, int rowB, int from, const type scalor) {
 	if (!values || rowA >= rows || rowB >= rows || from >= columns) return false;
 
-	const type *arow = values[rowA];
-	type *brow = values[rowB];
+	if (rowA == rowB) {
+		type *row = (*this)[rowA];
+		for (int j : Range{from, columns}) {
+			row[j] += row[j] * scalor;
+		}
+		return true;
+	}
+
+	// Distinct rows never overlap, which lets the compiler vectorize this
+	const type * __restrict arow = (*this)[rowA];
+	type * __restrict brow = (*this)[rowB];
 
-	for (int j : Range{from, columns}) {
+	for (int j = from; j < columns; ++j) {
 		brow[j] += arow[j] * scalor;
 	}
 
@@ -218,7 +252,7 @@ QuickVector QuickMatrix::normalizeRows() const {
 	QuickVector ret = QuickVector{columns};
 
 	for (int j : Times{rows}) {
-		const type *row = values[j];
+		const type *row = (*this)[j];
 		int max_loc = 0;
 
 		for (int i : Times{columns}) {
@@ -245,7 +279,7 @@ QuickVector QuickMatrix::operator * (const QuickVector &operandvec) const {
 	for (int i : Times{rows}) {
 		type sum = 0;
 		for (int j : Times{columns}) {
-			sum += values[i][j] * operandvec[j];
+			sum += (*this)[i][j] * operandvec[j];
 		}
 		ret[i] = sum;
 	}
@@ -258,7 +292,7 @@ QuickMatrix & QuickMatrix::operator += (const QuickMatrix &operandmat) {
 
 	for (int i : Times{rows}) {
 		for (int j : Times{columns}) {
-			values[i][j] += operandmat.values[i][j];
+			(*this)[i][j] += operandmat[i][j];
 		}
 	}
 
@@ -274,9 +308,9 @@ QuickMatrix QuickMatrix::operator * (const QuickMatrix &operandmat) const {
 		for (int j : Times{operandmat.columns}) {
 			type sum = 0;
 			for (int k : Times{columns}) {
-				sum += values[i][k] * operandmat.values[k][j];
+				sum += (*this)[i][k] * operandmat[k][j];
 			}
-			ret.values[i][j] = sum;
+			ret[i][j] = sum;
 		}
 	}
 
@@ -286,16 +320,15 @@ QuickMatrix QuickMatrix::operator * (const QuickMatrix &operandmat) const {
 void QuickMatrix::dumpToAux() const {
 	for (int j : Times{rows}) {
 		for (int i : Times{columns}) {
-			cout << values[j][i] << ' ';
+			cout << (*this)[j][i] << ' ';
 		}
 		cout << endl;
 	}
 }
 
 void QuickMatrix::fillWithZero() {
-	for (int j : Times{rows}) {
-		memset(values[j], 0, columns * sizeof(type)); // fastest method. =)
-	}
+	if (!values) return;
+	memset(values, 0, size_t(rows) * size_t(stride) * sizeof(type)); // fastest method. =)
 }
 
 // sets the diagonal to a constant.
@@ -304,7 +337,7 @@ QuickMatrix & QuickMatrix::operator = (const type y) {
 	auto size = std::min(columns, rows);
 
 	for (int i : Times{size}) {
-		values[i][i] = y;
+		(*this)[i][i] = y;
 	}
 	return *this;
 }
@@ -315,10 +348,12 @@ QuickMatrix & QuickMatrix::operator = (QuickMatrix &&othermat) {
 	values = othermat.values;
 	rows = othermat.rows;
 	columns = othermat.columns;
+	stride = othermat.stride;
 
 	othermat.values = nullptr;
 	othermat.rows = 0;
 	othermat.columns = 0;
+	othermat.stride = 0;
 
 	return *this;
 }
@@ -22,11 +22,18 @@ public:
 
 	bool isSquare() const;
 
-	type *& operator [] (const int row) { return values[row]; }
-	const type * operator [] ( const int row) const { return values[row]; }
+	// Rows are stored one after another in a single allocation, each
+	// starting on an alignment boundary; see rowStride().
+	type * operator [] (const int row) { return values + row * stride; }
+	const type * operator [] ( const int row) const { return values + row * stride; }
 
 	int numRows() const { return rows; };
 	int numColumns() const { return columns; };
+	/**
+	 * Distance in elements between the starts of consecutive rows. This is at
+	 * least numColumns(), padded so that every row is aligned for SIMD loads.
+	 */
+	int rowStride() const { return stride; }
 
 	bool scaleRow(int row, const type scalor);
 	bool addRowToRow(int rowA, int rowB);
@@ -39,6 +46,11 @@ public:
 // operations that would otherwise require millions of at()'s
 	type multstep(int row, int pos, int col) const;
 	type multRowCol(int row, int col, int lim) const;
+	/**
+	 * Returns the sum of row[j] * vec[j] for j from "from" up to (but not
+	 * including) "to".
+	 */
+	type dotRow(int row, const type *vec, int from, int to) const;
 
 	QuickMatrix transposeSquare() const; // Multiplies self by transpose.
 	QuickVector transposeMult(const QuickVector &operandvec) const;
@@ -64,10 +76,14 @@ public:
 	void dumpToAux() const;
 
 private :
+	/// Alignment of each row, in bytes (a cache line, and enough for AVX-512)
+	static constexpr const int alignment = 64;
+
 	void release();
-	type ** allocate() const;
+	type * allocate();
 
-	type **values = nullptr;
+	type *values = nullptr;
 	int rows = 0;
 	int columns = 0;
+	int stride = 0;
 };
@@ -11,6 +11,7 @@
 #include "chassiscircular2.h"
 
 #include "libraryitem.h"
+#include "mechanicssimulation.h"
 
 #include <klocalizedstring.h>
 #include <qpainter.h>
@@ -78,25 +79,34 @@ void ChassisCircular2::itemResized()
 }
 
 
-void ChassisCircular2::advance( int phase )
+bool ChassisCircular2::applyForces( MechanicsSimulation *simulation, int body )
 {
-	if ( phase != 1 )
-		return;
+	const double speed1 = 60.; // pixels per second
+	const double speed2 = 160.; // pixels per second
+	// Time (in seconds) for the wheels to bring the chassis up to speed
+	const double response = 0.05;
 	
-	double speed1 = 60.; // pixels per second
-	double speed2 = 160.; // pixels per second
+	const double dt = MechanicsSimulation::timeStep;
+	m_theta1 = normalizeAngle( m_theta1 + (speed1*dt)/m_wheel1Pos.width() );
+	m_theta2 = normalizeAngle( m_theta2 + (speed2*dt)/m_wheel2Pos.width() );
 	
-	m_theta1 = normalizeAngle( m_theta1 + (speed1/1000.)/m_wheel1Pos.width() );
-	m_theta2 = normalizeAngle( m_theta2 + (speed2/1000.)/m_wheel2Pos.width() );
-	
-	const double d1 = speed1/1000.;
-	const double d2 = speed2/1000.;
 	const double sep = m_wheel2Pos.center().y()-m_wheel1Pos.center().y();
+	if ( sep <= 0. )
+		return false;
+	
+	// The wheels drive the chassis towards the velocity given by their speeds
+	const double angle = simulation->angle(body);
+	const double speed = (speed1+speed2)/2.;
+	const Vector2D velocity = simulation->velocity(body);
+	const double massFactor = simulation->mass(body)/response;
+	simulation->addForce( body,
+			massFactor * (speed*std::cos(angle) - velocity.x),
+			massFactor * (speed*std::sin(angle) - velocity.y) );
+	
+	const double omega = (speed2-speed1)/sep;
+	simulation->addTorque( body, simulation->momentOfInertia(body)/response * (omega - simulation->angularVelocity(body)) );
 	
-	double dtheta = std::atan( (d2-d1)/sep ); // Change in orientation of chassis
-	double moveAngle = absolutePosition().angle()+dtheta/2;
-	rotateBy(dtheta);
-	moveBy( ((d1+d2)/2.)*std::cos(moveAngle), ((d1+d2)/2.)*std::sin(moveAngle) );
+	return true;
 }
 
 
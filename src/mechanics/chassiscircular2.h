@@ -26,7 +26,7 @@ public:
 	static Item* construct( ItemDocument *itemDocument, bool newItem, const char *id );
 	static LibraryItem *libraryItem();
 
-	virtual void advance( int phase );
+	bool applyForces( MechanicsSimulation *simulation, int body ) override;
 
 protected:
 	void itemResized() override;
@@ -132,6 +132,8 @@ void MechanicsDocument::deleteSelection()
 
 bool MechanicsDocument::registerItem( KtlQCanvasItem *qcanvasItem )
 {
+	if ( m_mechanicsSimulation )
+		m_mechanicsSimulation->bodiesChanged();
 	return ItemDocument::registerItem(qcanvasItem);
 }
 
@@ -170,6 +172,9 @@ void MechanicsDocument::flushDeleteList()
 		(*it)->setCanvas(0l);
 		delete *it;
 	}
+
+	if ( m_mechanicsSimulation )
+		m_mechanicsSimulation->bodiesChanged();
 }
 
 
@@ -41,6 +41,7 @@ public:
 	void selectAll() override;
 	ItemGroup *selectList() const override;
 	MechanicsItem *mechanicsItemWithID( const QString &id );
+	MechanicsSimulation *mechanicsSimulation() const { return m_mechanicsSimulation; }
 	Item* addItem( const QString &id, const QPoint &p, bool newItem ) override;
 
 	/**
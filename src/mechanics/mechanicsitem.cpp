@@ -11,6 +11,7 @@
 #include "itemdocumentdata.h"
 #include "mechanicsitem.h"
 #include "mechanicsdocument.h"
+#include "mechanicssimulation.h"
 
 #include <qdebug.h>
 #include <klocalizedstring.h>
@@ -92,6 +93,9 @@ void MechanicsItem::dataChanged()
 	m_mechanicsInfo.mass = dataDouble("mass");
 	m_mechanicsInfo.momentOfInertia = dataDouble("moi");
 	updateMechanicsInfoCombined();
+
+	if ( p_mechanicsDocument && p_mechanicsDocument->mechanicsSimulation() )
+		p_mechanicsDocument->mechanicsSimulation()->bodiesChanged();
 }
 
 
@@ -123,6 +127,9 @@ void MechanicsItem::reparented( Item *oldItem, Item *newItem )
 	}
 
 	updateCanvasPoints();
+
+	if ( p_mechanicsDocument && p_mechanicsDocument->mechanicsSimulation() )
+		p_mechanicsDocument->mechanicsSimulation()->bodiesChanged();
 }
 
 
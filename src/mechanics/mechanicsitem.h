@@ -18,6 +18,7 @@ class LibraryItem;
 class MechanicsItem;
 // class MechanicsItemOverlayItem;
 class MechanicsDocument;
+class MechanicsSimulation;
 typedef QList<MechanicsItem*> MechanicsItemList;
 
 /**
@@ -167,6 +168,14 @@ public:
 	 * whether this item is allowed to be distorted, inverted, resized, etc.
 	 */
 	QRect maxInnerRectangle( const QRect &outerRect ) const;
+	/**
+	 * Called by the MechanicsSimulation before every step if this item is
+	 * simulated as a rigid body (i.e. it has no mechanics parent), so that it
+	 * can push itself about with MechanicsSimulation::addForce and addTorque.
+	 * @param body the index of this item's body in the simulation
+	 * @returns true if a force was applied, which keeps the body awake
+	 */
+	virtual bool applyForces( MechanicsSimulation *simulation, int body ) { Q_UNUSED(simulation); Q_UNUSED(body); return false; }
 
 	ItemData itemData() const override;
 
@@ -12,16 +12,55 @@
 #include "mechanicsitem.h"
 #include "mechanicssimulation.h"
 
-#include <cmath>
+#include <qhash.h>
+#include <qrect.h>
 #include <qtimer.h>
 
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Interval of the timer that steps the simulation, in milliseconds
+	static constexpr const int advanceInterval = 20;
+	// Don't try to catch up on more than this much time (e.g. after a stall)
+	static constexpr const double maxCatchUpTime = 0.1;
+
+	// Fraction of velocity lost per second, from rolling friction
+	static constexpr const double linearDamping = 2.0;
+	static constexpr const double angularDamping = 4.0;
+
+	// Bounciness of collisions, between 0 and 1
+	static constexpr const double restitution = 0.2;
+	// Fraction of the overlap of colliding bodies that is corrected per step
+	static constexpr const double positionCorrection = 0.8;
+	// Overlap (in pixels) that is allowed, to stop resting contacts jittering
+	static constexpr const double allowedOverlap = 0.5;
+	// Overlap beyond allowedOverlap that is left alone, so that correcting
+	// the position comes to an end rather than getting ever smaller
+	static constexpr const double correctionSlop = 0.05;
+
+	// A body is at rest when slower than these for restStepsToSleep steps
+	static constexpr const double restSpeed = 0.5; // pixels per second
+	static constexpr const double restAngularSpeed = 0.01; // radians per second
+	static constexpr const int restStepsToSleep = 40;
+
+	// Items are moved on the canvas only if they have moved by more than this
+	static constexpr const double writeBackEpsilon = 1e-3;
+}
+
+
+//BEGIN class MechanicsSimulation
 MechanicsSimulation::MechanicsSimulation( MechanicsDocument *mechanicsDocument )
 	: QObject(mechanicsDocument)
 {
 	p_mechanicsDocument = mechanicsDocument;
+	m_accumulatedTime = 0.;
+	m_bBodiesChanged = true;
+	m_bWritingBack = false;
+
 	m_advanceTmr = new QTimer(this);
 	connect( m_advanceTmr, SIGNAL(timeout()), this, SLOT(slotAdvance()) );
-	m_advanceTmr->start(20); // it is not implemented anyway, so don't hog the CPU
+	wake();
 }
 
 
@@ -30,92 +69,417 @@ MechanicsSimulation::~MechanicsSimulation()
 }
 
 
-void MechanicsSimulation::slotAdvance()
+void MechanicsSimulation::bodiesChanged()
 {
-// 	if ( p_mechanicsDocument && p_mechanicsDocument->canvas() )
-// 		p_mechanicsDocument->canvas()->advance();
+	m_bBodiesChanged = true;
+	wake();
 }
 
 
-RigidBody::RigidBody( MechanicsDocument *mechanicsDocument )
+void MechanicsSimulation::wake()
 {
-	p_mechanicsDocument = mechanicsDocument;
-	p_overallParent = 0l;
+	for ( int &rest : m_bodies.restSteps )
+		rest = 0;
+
+	if ( m_advanceTmr->isActive() )
+		return;
+
+	m_accumulatedTime = 0.;
+	m_clock.start();
+	m_advanceTmr->start(advanceInterval);
 }
 
 
-RigidBody::~RigidBody()
+bool MechanicsSimulation::isSleeping() const
 {
+	return !m_advanceTmr->isActive();
 }
 
 
-bool RigidBody::addMechanicsItem( MechanicsItem *item )
+double MechanicsSimulation::mass( int body ) const
 {
-	if ( !item || m_mechanicsItemList.contains(item) )
-		return false;
+	return (m_bodies.invMass[body] > 0.) ? 1. / m_bodies.invMass[body] : 0.;
+}
 
-	m_mechanicsItemList.append(item);
-	findOverallParent();
-	return true;
+
+double MechanicsSimulation::momentOfInertia( int body ) const
+{
+	return (m_bodies.invInertia[body] > 0.) ? 1. / m_bodies.invInertia[body] : 0.;
 }
 
 
-void RigidBody::moveBy( double dx, double dy )
+void MechanicsSimulation::slotAdvance()
 {
-	if (overallParent())
-		overallParent()->moveBy( dx, dy );
+	if ( !p_mechanicsDocument )
+	{
+		m_advanceTmr->stop();
+		return;
+	}
+
+	if ( m_bBodiesChanged )
+		rebuildBodies();
+
+	m_accumulatedTime = std::min( m_accumulatedTime + m_clock.restart() / 1000., maxCatchUpTime );
+
+	while ( m_accumulatedTime >= timeStep )
+	{
+		m_accumulatedTime -= timeStep;
+		step();
+	}
+
+	writeBack();
+
+	bool awake = false;
+	for ( int rest : m_bodies.restSteps )
+	{
+		if ( rest < restStepsToSleep )
+		{
+			awake = true;
+			break;
+		}
+	}
+
+	// Stop waking up the CPU when nothing is moving
+	if ( !awake )
+		m_advanceTmr->stop();
+}
+
+
+void MechanicsSimulation::slotItemMoved()
+{
+	if ( !m_bWritingBack )
+		bodiesChanged();
+}
+
+
+void MechanicsSimulation::Bodies::clear()
+{
+	resize(0);
 }
 
 
-void RigidBody::rotateBy( double dtheta )
+void MechanicsSimulation::Bodies::resize( int count )
 {
-	if (overallParent())
-		overallParent()->rotateBy(dtheta);
+	item.resize(count);
+	for ( std::vector<double> *array : { &x, &y, &angle, &vx, &vy, &omega, &invMass, &invInertia, &fx, &fy, &torque, &comX, &comY, &radius, &boxX, &boxY, &halfWidth, &halfHeight } )
+		array->resize( count, 0. );
+	restSteps.resize( count, 0 );
 }
 
 
-bool RigidBody::findOverallParent()
+void MechanicsSimulation::rebuildBodies()
 {
-	p_overallParent = 0l;
-	if ( m_mechanicsItemList.isEmpty() )
-		return false;
+	m_bBodiesChanged = false;
 
-	m_mechanicsItemList.removeAll(0l);
+	// Keep the velocities of bodies that are still around
+	QHash< MechanicsItem*, int > oldIndex;
+	for ( int i = 0; i < m_bodies.size(); ++i )
+	{
+		if ( m_bodies.item[i] )
+			oldIndex[ m_bodies.item[i] ] = i;
+	}
+	Bodies oldBodies = m_bodies;
 
-	const MechanicsItemList::iterator end = m_mechanicsItemList.end();
-	for ( MechanicsItemList::iterator it = m_mechanicsItemList.begin(); it != end; ++it )
+	MechanicsItemList items;
+	const QPtrList<Item> itemList = p_mechanicsDocument->itemList();
+	for ( const QPointer<Item> &item : itemList )
 	{
-		MechanicsItem *parentItem = *it;
-		MechanicsItem *parentCandidate = dynamic_cast<MechanicsItem*>((*it)->parentItem());
+		MechanicsItem *mechanicsItem = dynamic_cast<MechanicsItem*>((Item*)item);
+		if ( mechanicsItem && !dynamic_cast<MechanicsItem*>(mechanicsItem->parentItem()) )
+			items << mechanicsItem;
+	}
+
+	m_bodies.clear();
+	m_bodies.resize( items.size() );
 
-		while (parentCandidate)
+	for ( int i = 0; i < items.size(); ++i )
+	{
+		MechanicsItem *item = items[i];
+		const CombinedMechanicsInfo *info = item->mechanicsInfoCombined();
+		const PositionInfo position = item->absolutePosition();
+
+		m_bodies.item[i] = item;
+
+		// An item without attached children has its center of mass at its origin
+		const bool haveCOM = std::isfinite(info->x) && std::isfinite(info->y);
+		const double comX = haveCOM ? info->x : 0.;
+		const double comY = haveCOM ? info->y : 0.;
+		const double cosA = std::cos( position.angle() );
+		const double sinA = std::sin( position.angle() );
+
+		m_bodies.comX[i] = comX;
+		m_bodies.comY[i] = comY;
+		m_bodies.x[i] = position.x() + cosA * comX - sinA * comY;
+		m_bodies.y[i] = position.y() + sinA * comX + cosA * comY;
+		m_bodies.angle[i] = position.angle();
+		m_bodies.invMass[i] = (info->mass > 0.) ? 1. / info->mass : 0.;
+		m_bodies.invInertia[i] = (info->momentOfInertia > 0.) ? 1. / info->momentOfInertia : 0.;
+
+		const QRect rect = item->sizeRect();
+		double radiusSquared = 0.;
+		for ( const QPoint &corner : { rect.topLeft(), rect.topRight(), rect.bottomLeft(), rect.bottomRight() } )
 		{
-			parentItem = parentCandidate;
-			parentCandidate = dynamic_cast<MechanicsItem*>(parentItem->parentItem());
+			const double dx = corner.x() - comX;
+			const double dy = corner.y() - comY;
+			radiusSquared = std::max( radiusSquared, dx*dx + dy*dy );
 		}
+		m_bodies.radius[i] = std::sqrt(radiusSquared);
 
-		if ( !p_overallParent )
-			// Must be the first item to test
-			p_overallParent = parentItem;
+		const QRectF box( rect );
+		m_bodies.boxX[i] = box.center().x() - comX;
+		m_bodies.boxY[i] = box.center().y() - comY;
+		m_bodies.halfWidth[i] = box.width() / 2.;
+		m_bodies.halfHeight[i] = box.height() / 2.;
 
-		if ( p_overallParent != parentItem )
+		auto old = oldIndex.constFind(item);
+		if ( old != oldIndex.constEnd() )
 		{
-			p_overallParent = 0l;
-			return false;
+			m_bodies.vx[i] = oldBodies.vx[*old];
+			m_bodies.vy[i] = oldBodies.vy[*old];
+			m_bodies.omega[i] = oldBodies.omega[*old];
 		}
+		else
+			connect( item, SIGNAL(moved()), this, SLOT(slotItemMoved()), Qt::UniqueConnection );
 	}
-	return true;
 }
 
 
-void RigidBody::updateRigidBodyInfo()
+void MechanicsSimulation::step()
 {
-	if (!p_overallParent)
+	const int count = m_bodies.size();
+
+	std::fill( m_bodies.fx.begin(), m_bodies.fx.end(), 0. );
+	std::fill( m_bodies.fy.begin(), m_bodies.fy.end(), 0. );
+	std::fill( m_bodies.torque.begin(), m_bodies.torque.end(), 0. );
+
+	for ( int i = 0; i < count; ++i )
+	{
+		MechanicsItem *item = m_bodies.item[i];
+		if ( item && item->applyForces( this, i ) )
+			m_bodies.restSteps[i] = 0;
+	}
+
+	integrate();
+	collide();
+
+	for ( int i = 0; i < count; ++i )
+	{
+		const double speedSquared = m_bodies.vx[i] * m_bodies.vx[i] + m_bodies.vy[i] * m_bodies.vy[i];
+		const bool atRest = speedSquared < restSpeed * restSpeed && std::abs(m_bodies.omega[i]) < restAngularSpeed;
+
+		if ( !atRest )
+			m_bodies.restSteps[i] = 0;
+		else if ( m_bodies.restSteps[i] < restStepsToSleep )
+			++m_bodies.restSteps[i];
+	}
+}
+
+
+void MechanicsSimulation::integrate()
+{
+	const int count = m_bodies.size();
+	const double linearDecay = std::exp( -linearDamping * timeStep );
+	const double angularDecay = std::exp( -angularDamping * timeStep );
+
+	double * const x = m_bodies.x.data();
+	double * const y = m_bodies.y.data();
+	double * const angle = m_bodies.angle.data();
+	double * const vx = m_bodies.vx.data();
+	double * const vy = m_bodies.vy.data();
+	double * const omega = m_bodies.omega.data();
+	const double * const invMass = m_bodies.invMass.data();
+	const double * const invInertia = m_bodies.invInertia.data();
+	const double * const fx = m_bodies.fx.data();
+	const double * const fy = m_bodies.fy.data();
+	const double * const torque = m_bodies.torque.data();
+
+	// Semi-implicit Euler: the velocities are updated first, and the new
+	// velocities are used to update the positions
+	for ( int i = 0; i < count; ++i )
+	{
+		vx[i] = (vx[i] + fx[i] * invMass[i] * timeStep) * linearDecay;
+		vy[i] = (vy[i] + fy[i] * invMass[i] * timeStep) * linearDecay;
+		omega[i] = (omega[i] + torque[i] * invInertia[i] * timeStep) * angularDecay;
+
+		x[i] += vx[i] * timeStep;
+		y[i] += vy[i] * timeStep;
+		angle[i] += omega[i] * timeStep;
+	}
+}
+
+
+void MechanicsSimulation::collide()
+{
+	const int count = m_bodies.size();
+	if ( count < 2 )
 		return;
 
-	m_mass = p_overallParent->mechanicsInfoCombined()->mass;
-	m_momentOfInertia = p_overallParent->mechanicsInfoCombined()->momentOfInertia;
+	// Broadphase: sort by the left edge of the bounding circles, so that only
+	// bodies whose extents along the x axis overlap are tested against each other
+	m_sweepOrder.resize(count);
+	for ( int i = 0; i < count; ++i )
+		m_sweepOrder[i] = i;
+
+	const std::vector<double> &x = m_bodies.x;
+	const std::vector<double> &radius = m_bodies.radius;
+	std::sort( m_sweepOrder.begin(), m_sweepOrder.end(), [&]( int a, int b ) {
+		return x[a] - radius[a] < x[b] - radius[b];
+	});
+
+	for ( int si = 0; si < count; ++si )
+	{
+		const int a = m_sweepOrder[si];
+		const double maxX = x[a] + radius[a];
+
+		for ( int sj = si + 1; sj < count; ++sj )
+		{
+			const int b = m_sweepOrder[sj];
+			if ( x[b] - radius[b] > maxX )
+				break;
+
+			// Bodies that are both asleep stay where they are
+			if ( m_bodies.restSteps[a] >= restStepsToSleep && m_bodies.restSteps[b] >= restStepsToSleep )
+				continue;
+
+			const double invMassSum = m_bodies.invMass[a] + m_bodies.invMass[b];
+			if ( invMassSum == 0. )
+				continue;
+
+			// Narrowphase
+			double nx, ny;
+			const double overlap = boxOverlap( a, b, nx, ny );
+			if ( overlap <= 0. )
+				continue;
+
+			// Stop the bodies moving into each other. Bodies that are only
+			// touching, or drifting together slower than a body at rest, are
+			// left alone so that they can fall asleep.
+			bool resolved = false;
+			const double approachSpeed = (m_bodies.vx[b] - m_bodies.vx[a]) * nx + (m_bodies.vy[b] - m_bodies.vy[a]) * ny;
+			if ( approachSpeed < -restSpeed )
+			{
+				const double impulse = -(1. + restitution) * approachSpeed / invMassSum;
+				m_bodies.vx[a] -= impulse * m_bodies.invMass[a] * nx;
+				m_bodies.vy[a] -= impulse * m_bodies.invMass[a] * ny;
+				m_bodies.vx[b] += impulse * m_bodies.invMass[b] * nx;
+				m_bodies.vy[b] += impulse * m_bodies.invMass[b] * ny;
+				resolved = true;
+			}
+
+			// And push them apart, so that they don't sink into each other
+			const double excess = overlap - allowedOverlap;
+			if ( excess > correctionSlop )
+			{
+				const double correction = positionCorrection * excess / invMassSum;
+				m_bodies.x[a] -= correction * m_bodies.invMass[a] * nx;
+				m_bodies.y[a] -= correction * m_bodies.invMass[a] * ny;
+				m_bodies.x[b] += correction * m_bodies.invMass[b] * nx;
+				m_bodies.y[b] += correction * m_bodies.invMass[b] * ny;
+				resolved = true;
+			}
+
+			if ( resolved )
+			{
+				m_bodies.restSteps[a] = 0;
+				m_bodies.restSteps[b] = 0;
+			}
+		}
+	}
+}
+
+
+double MechanicsSimulation::boxOverlap( int a, int b, double &nx, double &ny ) const
+{
+	struct Box
+	{
+		double x, y;
+		// Unit vectors along the width and height
+		double ux, uy, vx, vy;
+		double halfWidth, halfHeight;
+	};
+
+	auto box = [this]( int i ) {
+		const double cosA = std::cos( m_bodies.angle[i] );
+		const double sinA = std::sin( m_bodies.angle[i] );
+		Box box;
+		box.x = m_bodies.x[i] + cosA * m_bodies.boxX[i] - sinA * m_bodies.boxY[i];
+		box.y = m_bodies.y[i] + sinA * m_bodies.boxX[i] + cosA * m_bodies.boxY[i];
+		box.ux = cosA;
+		box.uy = sinA;
+		box.vx = -sinA;
+		box.vy = cosA;
+		box.halfWidth = m_bodies.halfWidth[i];
+		box.halfHeight = m_bodies.halfHeight[i];
+		return box;
+	};
+
+	const Box boxA = box(a);
+	const Box boxB = box(b);
+	const double dx = boxB.x - boxA.x;
+	const double dy = boxB.y - boxA.y;
+
+	double minOverlap = -1.;
+	for ( const Box *axisBox : { &boxA, &boxB } )
+	{
+		for ( int axis = 0; axis < 2; ++axis )
+		{
+			const double ax = axis ? axisBox->vx : axisBox->ux;
+			const double ay = axis ? axisBox->vy : axisBox->uy;
+
+			// Half the extent of each box along the axis
+			const double extentA = boxA.halfWidth * std::abs( boxA.ux * ax + boxA.uy * ay ) + boxA.halfHeight * std::abs( boxA.vx * ax + boxA.vy * ay );
+			const double extentB = boxB.halfWidth * std::abs( boxB.ux * ax + boxB.uy * ay ) + boxB.halfHeight * std::abs( boxB.vx * ax + boxB.vy * ay );
+			const double separation = dx * ax + dy * ay;
+			const double overlap = extentA + extentB - std::abs(separation);
+
+			// Separated along this axis
+			if ( overlap <= 0. )
+				return overlap;
+
+			if ( minOverlap < 0. || overlap < minOverlap )
+			{
+				minOverlap = overlap;
+				const double sign = (separation < 0.) ? -1. : 1.;
+				nx = ax * sign;
+				ny = ay * sign;
+			}
+		}
+	}
+
+	return minOverlap;
+}
+
+
+void MechanicsSimulation::writeBack()
+{
+	m_bWritingBack = true;
+
+	for ( int i = 0; i < m_bodies.size(); ++i )
+	{
+		MechanicsItem *item = m_bodies.item[i];
+		if ( !item )
+			continue;
+
+		const PositionInfo position = item->absolutePosition();
+
+		const double angle = m_bodies.angle[i];
+		const double cosA = std::cos(angle);
+		const double sinA = std::sin(angle);
+		const double originX = m_bodies.x[i] - (cosA * m_bodies.comX[i] - sinA * m_bodies.comY[i]);
+		const double originY = m_bodies.y[i] - (sinA * m_bodies.comX[i] + cosA * m_bodies.comY[i]);
+
+		if ( std::abs( angle - position.angle() ) > writeBackEpsilon )
+			item->rotateBy( angle - position.angle() );
+
+		const double dx = originX - position.x();
+		const double dy = originY - position.y();
+		if ( std::abs(dx) > writeBackEpsilon || std::abs(dy) > writeBackEpsilon )
+			item->moveBy( dx, dy );
+	}
+
+	m_bWritingBack = false;
 }
+//END class MechanicsSimulation
 
 
 Vector2D::Vector2D()
@@ -129,11 +493,5 @@ double Vector2D::length() const
 	return std::sqrt( x*x + y*y );
 }
 
-RigidBodyState::RigidBodyState()
-{
-	angularMomentum = 0.;
-}
-
-
 
 #include "moc_mechanicssimulation.cpp"
@@ -11,12 +11,16 @@
 #ifndef MECHANICSSIMULATION_H
 #define MECHANICSSIMULATION_H
 
+#include <qelapsedtimer.h>
 #include <qpointer.h>
 #include <qobject.h>
 #include <qlist.h>
 
+#include <vector>
+
 class MechanicsItem;
 class MechanicsDocument;
+class QTimer;
 typedef QList<MechanicsItem*> MechanicsItemList;
 
 
@@ -28,106 +32,140 @@ class Vector2D
 {
 public:
 	Vector2D();
-	
+	Vector2D( double _x, double _y ) : x(_x), y(_y) {}
+
 	double length() const;
 	double lengthSquared() const { return x*x + y*y; }
-	
+
 	double x;
 	double y;
 };
 
 
 /**
-@short State of a rigid body, in an inertial MechanicsDocument frame
-@author David Saxton
-*/
-class RigidBodyState
-{
-public:
-	RigidBodyState();
-	
-	Vector2D linearMomentum;
-	double angularMomentum;
-	Vector2D position; // Position of center of mass
-};
-		
+Simulates the MechanicsItems of a MechanicsDocument as rigid bodies.
+
+Every MechanicsItem without a mechanics parent is one body, with the mass,
+moment of inertia and center of mass given by its combined mechanics info (so
+attached children move with it). Bodies are advanced in fixed time steps with
+a semi-implicit Euler integrator, and are pushed apart when their (rotated)
+bounding rectangles collide. Pairs that may collide are found with a sweep
+of their bounding circles along the x axis.
+
+The body state is kept as a structure of arrays, so that the integrator runs
+over contiguous memory. Bodies that have come to rest fall asleep, and once
+they all have, the simulation stops its timer until something changes.
 
-/**
 @author David Saxton
 */
 class MechanicsSimulation : public QObject
 {
 Q_OBJECT
 public:
-    MechanicsSimulation( MechanicsDocument *mechanicsDocument );
-    ~MechanicsSimulation() override;
-	
-	MechanicsDocument* mechanicsDocument() const { return p_mechanicsDocument; }
-
-protected slots:
-	void slotAdvance();
-	
-protected:
-	QPointer<MechanicsDocument> p_mechanicsDocument;
-	QTimer *m_advanceTmr;
-};
+	MechanicsSimulation( MechanicsDocument *mechanicsDocument );
+	~MechanicsSimulation() override;
 
+	/** Length of one simulation step, in seconds */
+	static constexpr const double timeStep = 0.005;
 
-/**
-Rigid body with mass, inertia, etc. Collection of mechanics items with
-functionality for moving them about, rotating, etc. Only one mother-parent
-(has no parent itself, all other items are descendents) allowed.
-@short Rigid body, handles MechanicsItems
-@author David Saxton
-*/
-class RigidBody
-{
-public:
-	RigidBody( MechanicsDocument *mechanicsDocument );
-	~RigidBody();
-	
+	MechanicsDocument* mechanicsDocument() const { return p_mechanicsDocument; }
+	/**
+	 * Call when bodies have been added, removed, attached to each other or
+	 * had their mass changed. The bodies are gathered again before the next
+	 * step, and the simulation is woken up.
+	 */
+	void bodiesChanged();
 	/**
-	 * 
+	 * Starts stepping the simulation again if it was asleep.
 	 */
-	void advance( int phase, double delta );
+	void wake();
 	/**
-	 * Add the MechanicsItem to the entity.
-	 * @returns true iff successful in adding
+	 * @return true if all bodies are at rest, so nothing is being simulated.
 	 */
-	bool addMechanicsItem( MechanicsItem *item );
+	bool isSleeping() const;
+
 	/**
-	 * Pointer to the mother MechanicsItem.
+	 * The following are for use by MechanicsItem::applyForces. Positions and
+	 * velocities are in canvas pixels, and angles are in radians.
 	 */
-	MechanicsItem *overallParent() const { return p_overallParent; }
+	Vector2D velocity( int body ) const { return Vector2D( m_bodies.vx[body], m_bodies.vy[body] ); }
+	double angularVelocity( int body ) const { return m_bodies.omega[body]; }
+	double angle( int body ) const { return m_bodies.angle[body]; }
+	double mass( int body ) const;
+	double momentOfInertia( int body ) const;
+	void addForce( int body, double fx, double fy ) { m_bodies.fx[body] += fx; m_bodies.fy[body] += fy; }
+	void addTorque( int body, double torque ) { m_bodies.torque[body] += torque; }
+
+protected slots:
+	void slotAdvance();
 	/**
-	 * Updates the mass and the moment of inertia info
+	 * Called when a body's item has moved. Unless the move was made by the
+	 * simulation itself (i.e. the user dragged the item), the bodies are
+	 * gathered again.
 	 */
-	void updateRigidBodyInfo();
-	
+	void slotItemMoved();
+
 protected:
 	/**
-	 * Attempt to find the overall parent.
-	 * @returns false iff unsucessful (including if there are no MechanicsItems present)
+	 * The state of all bodies, one entry per body in each array.
+	 */
+	struct Bodies
+	{
+		std::vector< QPointer<MechanicsItem> > item;
+		// Center of mass and orientation
+		std::vector<double> x, y, angle;
+		std::vector<double> vx, vy, omega;
+		std::vector<double> invMass, invInertia;
+		// Forces accumulated for the current step
+		std::vector<double> fx, fy, torque;
+		// Center of mass relative to the item's origin, in the item's frame
+		std::vector<double> comX, comY;
+		// Radius of the bounding circle about the center of mass
+		std::vector<double> radius;
+		// Center of the bounding rectangle relative to the center of mass,
+		// and its half width and height, in the item's frame
+		std::vector<double> boxX, boxY, halfWidth, halfHeight;
+		// Number of steps that the body has been at rest for
+		std::vector<int> restSteps;
+
+		int size() const { return int(item.size()); }
+		void clear();
+		void resize( int count );
+	};
+
+	/**
+	 * Gathers the bodies from the document, keeping the velocities of those
+	 * that were already being simulated.
 	 */
-	bool findOverallParent();
+	void rebuildBodies();
+	void step();
+	void integrate();
 	/**
-	 * Move the set of MechanicsItems by the given amount
+	 * Stops bodies that are moving into each other, and pushes apart those
+	 * that overlap by more than a little. Pairs of bodies that are both
+	 * asleep are skipped.
 	 */
-	void moveBy( double dx, double dy );
+	void collide();
 	/**
-	 * Rotate the set of MechanicsItems by the given amount about the center of
-	 * mass.
-	 * @param dtheta Rotate amount in radians
+	 * Finds the smallest overlap of the bounding rectangles of the bodies,
+	 * with the separating axis test.
+	 * @param nx, ny set to the direction (from a to b) to separate them in
+	 * @return the overlap, or zero or less if the rectangles don't overlap
 	 */
-	void rotateBy( double dtheta );
-	
-	MechanicsItemList m_mechanicsItemList;
-	MechanicsItem *p_overallParent;
-	MechanicsDocument *p_mechanicsDocument;
-	
-	RigidBodyState m_rigidBodyState;
-	double m_mass;
-	double m_momentOfInertia;
+	double boxOverlap( int a, int b, double &nx, double &ny ) const;
+	/**
+	 * Moves the items to the simulated positions of their bodies.
+	 */
+	void writeBack();
+
+	Bodies m_bodies;
+	std::vector<int> m_sweepOrder;
+	QPointer<MechanicsDocument> p_mechanicsDocument;
+	QTimer *m_advanceTmr;
+	QElapsedTimer m_clock;
+	double m_accumulatedTime;
+	bool m_bBodiesChanged;
+	bool m_bWritingBack;
 };
 
 #endif
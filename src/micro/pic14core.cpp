@@ -0,0 +1,792 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "pic14core.h"
+
+#include <klocalizedstring.h>
+
+#include <qfile.h>
+#include <qtextstream.h>
+
+#include <algorithm>
+
+namespace {
+	static constexpr const uint16 ErasedWord = 0x3FFF;
+
+	struct DeviceConfig {
+		const char *prefix;
+		uint16 programWords;
+		bool mirrorBank0;
+	};
+
+	// Matched against the start of the id, so that e.g. P16F84A uses the P16F84 entry
+	static constexpr const DeviceConfig deviceConfigs[] = {
+		{ "P16F84", 1024, true },
+		{ "P16C84", 1024, true },
+		{ "P16F83", 512, true },
+		{ "P16CR84", 1024, true },
+		{ "P16CR83", 512, true },
+		{ "P16F627", 1024, false },
+		{ "P16F628", 2048, false },
+		{ "P16F648", 4096, false },
+		{ "P16F870", 2048, false },
+		{ "P16F871", 2048, false },
+		{ "P16F872", 2048, false },
+		{ "P16F873", 4096, false },
+		{ "P16F874", 4096, false },
+		{ "P16F876", 8192, false },
+		{ "P16F877", 8192, false },
+	};
+
+	static inline bool bitSet( uint8 value, int bit ) {
+		return (value >> bit) & 1;
+	}
+}
+
+//BEGIN class Pic14Core
+Pic14Core::Config Pic14Core::configFor( const QString &id ) {
+	for (const DeviceConfig &device : deviceConfigs) {
+		if (id.startsWith(QLatin1String(device.prefix), Qt::CaseInsensitive)) {
+			Config config;
+			config.programWords = device.programWords;
+			config.mirrorBank0 = device.mirrorBank0;
+			return config;
+		}
+	}
+	return Config();
+}
+
+Pic14Core::Pic14Core( const Config &config ) :
+	m_config(config),
+	m_pcMask(config.programWords - 1)
+{
+	m_pins.fill(0);
+	setProgram({});
+}
+
+bool Pic14Core::loadHex( const QString &fileName, QString *error ) {
+	auto fail = [error]( const QString &message ) {
+		if (error) {
+			*error = message;
+		}
+		return false;
+	};
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return fail(i18n("Could not open %1 for reading.", fileName));
+	}
+
+	std::vector<uint16> words(m_config.programWords, ErasedWord);
+	uint32 upperAddress = 0;
+	int lineNumber = 0;
+
+	QTextStream stream(&file);
+	while (!stream.atEnd()) {
+		const QString line = stream.readLine().trimmed();
+		++lineNumber;
+		if (line.isEmpty()) {
+			continue;
+		}
+
+		// :LLAAAATT<data>CC
+		if (!line.startsWith(':') || line.length() < 11 || (line.length() % 2) == 0) {
+			return fail(i18n("Invalid record on line %1 of %2.", lineNumber, fileName));
+		}
+
+		std::vector<uint8> record;
+		record.reserve((line.length() - 1) / 2);
+		for (int i = 1; i < line.length(); i += 2) {
+			bool ok;
+			record.push_back(uint8(line.midRef(i, 2).toUInt(&ok, 16)));
+			if (!ok) {
+				return fail(i18n("Invalid record on line %1 of %2.", lineNumber, fileName));
+			}
+		}
+
+		const uintsz dataLength = record[0];
+		if (record.size() != dataLength + 5) {
+			return fail(i18n("Invalid record length on line %1 of %2.", lineNumber, fileName));
+		}
+
+		uint8 checksum = 0;
+		for (uint8 byte : record) {
+			checksum += byte;
+		}
+		if (checksum != 0) {
+			return fail(i18n("Checksum mismatch on line %1 of %2.", lineNumber, fileName));
+		}
+
+		const uint32 address = (uint32(record[1]) << 8) | record[2];
+		const uint8 *data = &record[4];
+
+		switch (record[3]) {
+			case 0x00: // Data
+				for (uintsz i = 0; i < dataLength; ++i) {
+					const uint32 byteAddress = upperAddress + address + i;
+					const uint32 wordAddress = byteAddress >> 1;
+					if (wordAddress >= words.size()) {
+						continue;
+					}
+					uint16 &word = words[wordAddress];
+					if (byteAddress & 1) {
+						word = (word & 0x00FF) | (uint16(data[i]) << 8);
+					}
+					else {
+						word = (word & 0xFF00) | data[i];
+					}
+				}
+				break;
+
+			case 0x01: // End of file
+				setProgram(words);
+				return true;
+
+			case 0x04: // Extended linear address
+				if (dataLength != 2) {
+					return fail(i18n("Invalid record length on line %1 of %2.", lineNumber, fileName));
+				}
+				upperAddress = ((uint32(data[0]) << 8) | data[1]) << 16;
+				break;
+
+			default:
+				// Segment addresses and start addresses don't apply to PICs
+				break;
+		}
+	}
+
+	return fail(i18n("%1 has no end of file record.", fileName));
+}
+
+void Pic14Core::setProgram( const std::vector<uint16> &words ) {
+	m_program.assign(m_config.programWords, decode(ErasedWord));
+	const uintsz count = std::min<uintsz>(words.size(), m_program.size());
+	for (uintsz i = 0; i < count; ++i) {
+		m_program[i] = decode(words[i]);
+	}
+	reset();
+}
+
+void Pic14Core::reset() {
+	m_ram.fill(0);
+	m_stack.fill(0);
+	m_latch.fill(0);
+
+	m_ram[STATUS] = (1 << TO) | (1 << PD);
+	m_ram[OPTION_REG] = 0xFF;
+	for (int port = 0; port < PortCount; ++port) {
+		m_ram[TRISA + port] = 0xFF;
+	}
+
+	m_cycles = 0;
+	m_pc = ResetVector;
+	m_w = 0;
+	m_stackPointer = 0;
+	m_prescaler = 0;
+	m_timer0Inhibit = 0;
+	m_bSleeping = false;
+	m_bBranched = false;
+	m_bOutputsChanged = true;
+}
+
+Pic14Core::Instruction Pic14Core::decode( uint16 word ) {
+	word &= 0x3FFF;
+
+	Instruction ins;
+
+	switch (word >> 12) {
+		case 0: { // Byte oriented file register operations
+			static constexpr const Op byteOps[16] = {
+				Op::MOVWF, Op::CLRF, Op::SUBWF, Op::DECF,
+				Op::IORWF, Op::ANDWF, Op::XORWF, Op::ADDWF,
+				Op::MOVF, Op::COMF, Op::INCF, Op::DECFSZ,
+				Op::RRF, Op::RLF, Op::SWAPF, Op::INCFSZ
+			};
+
+			ins.toFile = word & 0x80;
+			ins.arg = word & 0x7F;
+			ins.op = byteOps[(word >> 8) & 0xF];
+
+			if (ins.op == Op::CLRF && !ins.toFile) {
+				ins.op = Op::CLRW;
+			}
+			else if (ins.op == Op::MOVWF && !ins.toFile) {
+				switch (word) {
+					case 0x0008: ins.op = Op::RETURN; break;
+					case 0x0009: ins.op = Op::RETFIE; break;
+					case 0x0062: ins.op = Op::OPTION; break;
+					case 0x0063: ins.op = Op::SLEEP; break;
+					case 0x0064: ins.op = Op::CLRWDT; break;
+					case 0x0065:
+					case 0x0066:
+					case 0x0067:
+						ins.op = Op::TRIS;
+						ins.arg = word & 0x7;
+						break;
+					default: ins.op = Op::NOP; break;
+				}
+			}
+		} break;
+
+		case 1: { // Bit oriented file register operations
+			static constexpr const Op bitOps[4] = { Op::BCF, Op::BSF, Op::BTFSC, Op::BTFSS };
+			ins.op = bitOps[(word >> 10) & 0x3];
+			ins.bit = (word >> 7) & 0x7;
+			ins.arg = word & 0x7F;
+		} break;
+
+		case 2: // CALL and GOTO
+			ins.op = (word & 0x0800) ? Op::GOTO : Op::CALL;
+			ins.arg = word & 0x07FF;
+			break;
+
+		case 3: { // Literal operations
+			static constexpr const Op literalOps[16] = {
+				Op::MOVLW, Op::MOVLW, Op::MOVLW, Op::MOVLW,
+				Op::RETLW, Op::RETLW, Op::RETLW, Op::RETLW,
+				Op::IORLW, Op::ANDLW, Op::XORLW, Op::NOP,
+				Op::SUBLW, Op::SUBLW, Op::ADDLW, Op::ADDLW
+			};
+			ins.op = literalOps[(word >> 8) & 0xF];
+			ins.arg = word & 0xFF;
+		} break;
+	}
+
+	return ins;
+}
+
+uint16 Pic14Core::bankAddress( uint16 f ) const {
+	return (uint16((m_ram[STATUS] >> RP0) & 0x3) << 7) | f;
+}
+
+uint16 Pic14Core::resolve( uint16 address ) const {
+	const uint16 reg = address & 0x7F;
+	uint16 bank = address >> 7;
+
+	switch (reg) {
+		case INDF:
+		case PCL:
+		case STATUS:
+		case FSR:
+		case PCLATH:
+		case INTCON:
+			return reg;
+
+		case TMR0:
+		case PORTB:
+			// Banks 2 and 3 repeat TMR0 / OPTION_REG and PORTB / TRISB
+			return ((bank & 1) << 7) | reg;
+
+		default:
+			break;
+	}
+
+	if (m_config.mirrorBank0) {
+		bank &= 1;
+		if (bank == 1 && reg >= 0x0C) {
+			return reg;
+		}
+	}
+	else if (reg >= 0x70) {
+		return reg;
+	}
+
+	return (bank << 7) | reg;
+}
+
+uint8 Pic14Core::readFile( uint16 f ) {
+	return readAddress(bankAddress(f));
+}
+
+void Pic14Core::writeFile( uint16 f, uint8 value ) {
+	writeAddress(bankAddress(f), value);
+}
+
+uint8 Pic14Core::readAddress( uint16 address ) {
+	const uint16 resolved = resolve(address);
+
+	switch (resolved) {
+		case INDF: {
+			const uint16 target = (uint16(bitSet(m_ram[STATUS], IRP)) << 8) | m_ram[FSR];
+			// Reading INDF through itself gives 0
+			return (resolve(target) == INDF) ? 0 : readAddress(target);
+		}
+
+		case PCL:
+			return uint8(m_pc);
+
+		case PORTA:
+		case PORTB:
+		case PORTC:
+		case PORTD:
+		case PORTE: {
+			const int port = resolved - PORTA;
+			const uint8 tris = m_ram[TRISA + port];
+			return (m_latch[port] & ~tris) | (m_pins[port] & tris);
+		}
+
+		default:
+			return m_ram[resolved];
+	}
+}
+
+void Pic14Core::writeAddress( uint16 address, uint8 value ) {
+	const uint16 resolved = resolve(address);
+
+	switch (resolved) {
+		case INDF: {
+			const uint16 target = (uint16(bitSet(m_ram[STATUS], IRP)) << 8) | m_ram[FSR];
+			if (resolve(target) != INDF) {
+				writeAddress(target, value);
+			}
+		} break;
+
+		case TMR0:
+			m_ram[TMR0] = value;
+			if (!bitSet(m_ram[OPTION_REG], PSA)) {
+				m_prescaler = 0;
+			}
+			m_timer0Inhibit = 2;
+			break;
+
+		case PCL:
+			m_ram[PCL] = value;
+			m_pc = ((uint16(m_ram[PCLATH] & 0x1F) << 8) | value) & m_pcMask;
+			m_bBranched = true;
+			break;
+
+		case STATUS: {
+			// TO and PD can't be written to
+			static constexpr const uint8 readOnly = (1 << TO) | (1 << PD);
+			m_ram[STATUS] = (value & ~readOnly) | (m_ram[STATUS] & readOnly);
+		} break;
+
+		case PORTA:
+		case PORTB:
+		case PORTC:
+		case PORTD:
+		case PORTE: {
+			const int port = resolved - PORTA;
+			if (m_latch[port] != value) {
+				m_latch[port] = value;
+				m_bOutputsChanged = true;
+			}
+		} break;
+
+		case TRISA:
+		case TRISB:
+		case TRISC:
+		case TRISD:
+		case TRISE:
+			if (m_ram[resolved] != value) {
+				m_ram[resolved] = value;
+				m_bOutputsChanged = true;
+			}
+			break;
+
+		default:
+			m_ram[resolved] = value;
+			break;
+	}
+}
+
+uint8 Pic14Core::peekRegister( uint16 address ) const {
+	const uint16 resolved = resolve(address);
+	if (resolved == PCL) {
+		return uint8(m_pc);
+	}
+	if (resolved >= PORTA && resolved <= PORTE) {
+		const int port = resolved - PORTA;
+		const uint8 tris = m_ram[TRISA + port];
+		return (m_latch[port] & ~tris) | (m_pins[port] & tris);
+	}
+	return m_ram[resolved];
+}
+
+uint8 Pic14Core::portTris( int port ) const {
+	return m_ram[TRISA + port];
+}
+
+bool Pic14Core::takeOutputsChanged() {
+	const bool changed = m_bOutputsChanged;
+	m_bOutputsChanged = false;
+	return changed;
+}
+
+void Pic14Core::setFlag( StatusBit bit, bool set ) {
+	if (set) {
+		m_ram[STATUS] |= (1 << bit);
+	}
+	else {
+		m_ram[STATUS] &= ~(1 << bit);
+	}
+}
+
+void Pic14Core::store( const Instruction &ins, uint8 result ) {
+	if (ins.toFile) {
+		writeFile(ins.arg, result);
+	}
+	else {
+		m_w = result;
+	}
+}
+
+void Pic14Core::push( uint16 address ) {
+	// The stack is circular; overflowing it silently overwrites the oldest entry
+	m_stack[m_stackPointer] = address;
+	m_stackPointer = (m_stackPointer + 1) % StackDepth;
+}
+
+uint16 Pic14Core::pop() {
+	m_stackPointer = (m_stackPointer + StackDepth - 1) % StackDepth;
+	return m_stack[m_stackPointer];
+}
+
+void Pic14Core::jump( uint16 address ) {
+	m_pc = address & m_pcMask;
+	m_bBranched = true;
+}
+
+bool Pic14Core::interruptPending() const {
+	const uint8 intcon = m_ram[INTCON];
+	// The T0IF, INTF and RBIF flags line up with their enable bits shifted by 3
+	return (intcon & (intcon >> 3) & 0x7) != 0;
+}
+
+void Pic14Core::incrementTimer0() {
+	const uint8 option = m_ram[OPTION_REG];
+	if (!bitSet(option, PSA)) {
+		const uint16 rate = 2 << (option & 0x7);
+		if (++m_prescaler < rate) {
+			return;
+		}
+		m_prescaler = 0;
+	}
+
+	if (++m_ram[TMR0] == 0) {
+		m_ram[INTCON] |= (1 << T0IF);
+	}
+}
+
+void Pic14Core::clockTimer0( unsigned cycles ) {
+	if (bitSet(m_ram[OPTION_REG], T0CS)) {
+		// Counting edges on RA4/T0CKI instead
+		return;
+	}
+
+	for (unsigned i = 0; i < cycles; ++i) {
+		if (m_timer0Inhibit) {
+			--m_timer0Inhibit;
+		}
+		else {
+			incrementTimer0();
+		}
+	}
+}
+
+void Pic14Core::setPinInput( int port, int bit, bool high ) {
+	if (port < 0 || port >= PortCount || bit < 0 || bit > 7) {
+		return;
+	}
+
+	const uint8 mask = 1 << bit;
+	const bool wasHigh = m_pins[port] & mask;
+	if (wasHigh == high) {
+		return;
+	}
+
+	if (high) {
+		m_pins[port] |= mask;
+	}
+	else {
+		m_pins[port] &= ~mask;
+	}
+
+	const uint8 option = m_ram[OPTION_REG];
+	const bool isInput = m_ram[TRISA + port] & mask;
+
+	if (port == 0 && bit == 4) {
+		// RA4/T0CKI: T0SE selects the falling edge
+		if (bitSet(option, T0CS) && high != bitSet(option, T0SE)) {
+			incrementTimer0();
+		}
+	}
+	else if (port == 1 && bit == 0) {
+		// RB0/INT: INTEDG selects the rising edge
+		if (high == bitSet(option, INTEDG)) {
+			m_ram[INTCON] |= (1 << INTF);
+		}
+	}
+	else if (port == 1 && bit >= 4 && isInput) {
+		m_ram[INTCON] |= (1 << RBIF);
+	}
+}
+
+unsigned Pic14Core::step() {
+	if (m_bSleeping) {
+		if (!interruptPending()) {
+			++m_cycles;
+			return 1;
+		}
+		m_bSleeping = false;
+	}
+
+	if (bitSet(m_ram[INTCON], GIE) && interruptPending()) {
+		m_ram[INTCON] &= ~(1 << GIE);
+		push(m_pc);
+		m_pc = InterruptVector;
+		m_cycles += 2;
+		clockTimer0(2);
+		return 2;
+	}
+
+	const Instruction &ins = m_program[m_pc];
+	m_pc = (m_pc + 1) & m_pcMask;
+	m_bBranched = false;
+
+	auto skip = [this]() {
+		m_pc = (m_pc + 1) & m_pcMask;
+		m_bBranched = true;
+	};
+
+	switch (ins.op) {
+		case Op::ADDWF: {
+			const uint8 f = readFile(ins.arg);
+			const unsigned result = unsigned(f) + m_w;
+			setFlag(C, result > 0xFF);
+			setFlag(DC, ((f & 0xF) + (m_w & 0xF)) > 0xF);
+			setZero(uint8(result));
+			store(ins, uint8(result));
+		} break;
+
+		case Op::ANDWF: {
+			const uint8 result = readFile(ins.arg) & m_w;
+			setZero(result);
+			store(ins, result);
+		} break;
+
+		case Op::CLRF:
+			writeFile(ins.arg, 0);
+			setFlag(Z, true);
+			break;
+
+		case Op::CLRW:
+			m_w = 0;
+			setFlag(Z, true);
+			break;
+
+		case Op::COMF: {
+			const uint8 result = ~readFile(ins.arg);
+			setZero(result);
+			store(ins, result);
+		} break;
+
+		case Op::DECF: {
+			const uint8 result = readFile(ins.arg) - 1;
+			setZero(result);
+			store(ins, result);
+		} break;
+
+		case Op::DECFSZ: {
+			const uint8 result = readFile(ins.arg) - 1;
+			store(ins, result);
+			if (result == 0) {
+				skip();
+			}
+		} break;
+
+		case Op::INCF: {
+			const uint8 result = readFile(ins.arg) + 1;
+			setZero(result);
+			store(ins, result);
+		} break;
+
+		case Op::INCFSZ: {
+			const uint8 result = readFile(ins.arg) + 1;
+			store(ins, result);
+			if (result == 0) {
+				skip();
+			}
+		} break;
+
+		case Op::IORWF: {
+			const uint8 result = readFile(ins.arg) | m_w;
+			setZero(result);
+			store(ins, result);
+		} break;
+
+		case Op::MOVF: {
+			const uint8 result = readFile(ins.arg);
+			setZero(result);
+			store(ins, result);
+		} break;
+
+		case Op::MOVWF:
+			writeFile(ins.arg, m_w);
+			break;
+
+		case Op::NOP:
+			break;
+
+		case Op::RLF: {
+			const uint8 f = readFile(ins.arg);
+			const uint8 result = (f << 1) | (m_ram[STATUS] & (1 << C));
+			setFlag(C, f & 0x80);
+			store(ins, result);
+		} break;
+
+		case Op::RRF: {
+			const uint8 f = readFile(ins.arg);
+			const uint8 result = (f >> 1) | ((m_ram[STATUS] & (1 << C)) << 7);
+			setFlag(C, f & 0x01);
+			store(ins, result);
+		} break;
+
+		case Op::SUBWF: {
+			const uint8 f = readFile(ins.arg);
+			const uint8 result = f - m_w;
+			// C and DC are set when there is no borrow
+			setFlag(C, f >= m_w);
+			setFlag(DC, (f & 0xF) >= (m_w & 0xF));
+			setZero(result);
+			store(ins, result);
+		} break;
+
+		case Op::SWAPF: {
+			const uint8 f = readFile(ins.arg);
+			store(ins, uint8((f << 4) | (f >> 4)));
+		} break;
+
+		case Op::XORWF: {
+			const uint8 result = readFile(ins.arg) ^ m_w;
+			setZero(result);
+			store(ins, result);
+		} break;
+
+		case Op::BCF:
+			writeFile(ins.arg, readFile(ins.arg) & ~(1 << ins.bit));
+			break;
+
+		case Op::BSF:
+			writeFile(ins.arg, readFile(ins.arg) | (1 << ins.bit));
+			break;
+
+		case Op::BTFSC:
+			if (!bitSet(readFile(ins.arg), ins.bit)) {
+				skip();
+			}
+			break;
+
+		case Op::BTFSS:
+			if (bitSet(readFile(ins.arg), ins.bit)) {
+				skip();
+			}
+			break;
+
+		case Op::ADDLW: {
+			const uint8 k = ins.arg;
+			const unsigned result = unsigned(k) + m_w;
+			setFlag(C, result > 0xFF);
+			setFlag(DC, ((k & 0xF) + (m_w & 0xF)) > 0xF);
+			m_w = uint8(result);
+			setZero(m_w);
+		} break;
+
+		case Op::ANDLW:
+			m_w &= ins.arg;
+			setZero(m_w);
+			break;
+
+		case Op::CALL:
+			push(m_pc);
+			jump((uint16(m_ram[PCLATH] & 0x18) << 8) | ins.arg);
+			break;
+
+		case Op::CLRWDT:
+			// There is no watchdog timer to clear
+			m_ram[STATUS] |= (1 << TO) | (1 << PD);
+			break;
+
+		case Op::GOTO:
+			jump((uint16(m_ram[PCLATH] & 0x18) << 8) | ins.arg);
+			break;
+
+		case Op::IORLW:
+			m_w |= ins.arg;
+			setZero(m_w);
+			break;
+
+		case Op::MOVLW:
+			m_w = ins.arg;
+			break;
+
+		case Op::RETFIE:
+			m_ram[INTCON] |= (1 << GIE);
+			jump(pop());
+			break;
+
+		case Op::RETLW:
+			m_w = ins.arg;
+			jump(pop());
+			break;
+
+		case Op::RETURN:
+			jump(pop());
+			break;
+
+		case Op::SLEEP:
+			m_ram[STATUS] = (m_ram[STATUS] | (1 << TO)) & ~(1 << PD);
+			m_bSleeping = true;
+			break;
+
+		case Op::SUBLW: {
+			const uint8 k = ins.arg;
+			setFlag(C, k >= m_w);
+			setFlag(DC, (k & 0xF) >= (m_w & 0xF));
+			m_w = k - m_w;
+			setZero(m_w);
+		} break;
+
+		case Op::XORLW:
+			m_w ^= ins.arg;
+			setZero(m_w);
+			break;
+
+		case Op::OPTION:
+			m_ram[OPTION_REG] = m_w;
+			break;
+
+		case Op::TRIS:
+			if (ins.arg >= 5) {
+				writeAddress(TRISA + (ins.arg - 5), m_w);
+			}
+			break;
+	}
+
+	const unsigned cycles = m_bBranched ? 2 : 1;
+	m_cycles += cycles;
+	clockTimer0(cycles);
+	return cycles;
+}
+
+uint64 Pic14Core::run( uint64 maxCycles ) {
+	uint64 cycles = 0;
+	while (cycles < maxCycles) {
+		if (m_bSleeping && !interruptPending()) {
+			// Nothing can happen until an input changes
+			m_cycles += maxCycles - cycles;
+			return maxCycles;
+		}
+
+		cycles += step();
+		if (m_bOutputsChanged) {
+			break;
+		}
+	}
+	return cycles;
+}
+//END class Pic14Core
@@ -0,0 +1,226 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pch.hpp"
+
+#include <qstring.h>
+
+#include <array>
+#include <vector>
+
+/**
+@short Instruction set simulator for the mid-range (14 bit core) PICs.
+
+Simulates the core (all 35 instructions, banked and indirect register access,
+the 8 level stack and interrupts), timer 0 with its prescaler, the RB0/INT
+and PORTB change interrupts, and the I/O ports PORTA to PORTE. The program is
+decoded into a table of instructions when it is loaded, so executing an
+instruction is a single switch on the decoded operation.
+
+The core doesn't know about the circuit: the owner feeds the level of the
+input pins in with setPinInput, and reads the output latches and TRIS
+registers back after run() when outputsChanged() says they have changed.
+
+@author KTechLab developers
+*/
+class Pic14Core
+{
+	public:
+		static constexpr const int PortCount = 5;
+		static constexpr const int StackDepth = 8;
+		static constexpr const uint16 ResetVector = 0x0000;
+		static constexpr const uint16 InterruptVector = 0x0004;
+
+		/**
+		 * Addresses of the special function registers. Those in bank 1 have
+		 * bit 7 set.
+		 */
+		enum Register : uint16
+		{
+			INDF = 0x00,
+			TMR0 = 0x01,
+			PCL = 0x02,
+			STATUS = 0x03,
+			FSR = 0x04,
+			PORTA = 0x05,
+			PORTB = 0x06,
+			PORTC = 0x07,
+			PORTD = 0x08,
+			PORTE = 0x09,
+			PCLATH = 0x0A,
+			INTCON = 0x0B,
+			OPTION_REG = 0x81,
+			TRISA = 0x85,
+			TRISB = 0x86,
+			TRISC = 0x87,
+			TRISD = 0x88,
+			TRISE = 0x89
+		};
+
+		enum StatusBit { C = 0, DC = 1, Z = 2, PD = 3, TO = 4, RP0 = 5, RP1 = 6, IRP = 7 };
+		enum IntconBit { RBIF = 0, INTF = 1, T0IF = 2, RBIE = 3, INTE = 4, T0IE = 5, PEIE = 6, GIE = 7 };
+		enum OptionBit { PS0 = 0, PSA = 3, T0SE = 4, T0CS = 5, INTEDG = 6, RBPU = 7 };
+
+		/**
+		 * The parts of a device that matter to the core.
+		 */
+		struct Config
+		{
+			/** Size of the program memory in words (a power of two) */
+			uint16 programWords = 8192;
+			/**
+			 * Whether the general purpose registers of bank 0 also appear in
+			 * bank 1, and only two banks exist (as on the 16F84). Otherwise,
+			 * addresses 0x70 to 0x7F are shared by all four banks.
+			 */
+			bool mirrorBank0 = false;
+		};
+
+		/**
+		 * @return the configuration for the PIC with the given id (e.g.
+		 * "P16F84"); unknown ids get the largest mid-range configuration.
+		 */
+		static Config configFor( const QString &id );
+
+		explicit Pic14Core( const Config &config );
+
+		/**
+		 * Loads the program from an Intel HEX file, as written by gpasm, and
+		 * resets the processor. Data outside of the program memory (such as
+		 * the configuration word) is ignored.
+		 * @param error if not null, set to a description of what went wrong.
+		 * @return false if the file could not be read or parsed.
+		 */
+		bool loadHex( const QString &fileName, QString *error = nullptr );
+		/**
+		 * Sets the program memory to the given words and resets the
+		 * processor.
+		 */
+		void setProgram( const std::vector<uint16> &words );
+		/**
+		 * Power-on reset. The program and the levels of the input pins are
+		 * kept.
+		 */
+		void reset();
+
+		/**
+		 * Executes the next instruction, or enters the interrupt routine if an
+		 * interrupt is pending.
+		 * @return the number of instruction cycles taken.
+		 */
+		unsigned step();
+		/**
+		 * Executes instructions until at least maxCycles instruction cycles
+		 * have been used, or until the output pins change.
+		 * @return the number of instruction cycles taken.
+		 */
+		uint64 run( uint64 maxCycles );
+
+		/**
+		 * Sets the level seen on an input pin.
+		 * @param port 0 for PORTA, 1 for PORTB, etc.
+		 */
+		void setPinInput( int port, int bit, bool high );
+		/**
+		 * @return the output latch of the given port.
+		 */
+		uint8 portLatch( int port ) const { return m_latch[port]; }
+		/**
+		 * @return the TRIS register of the given port; set bits are inputs.
+		 */
+		uint8 portTris( int port ) const;
+		/**
+		 * @return true if the levels or directions of the output pins have
+		 * changed since the last call to takeOutputsChanged.
+		 */
+		bool outputsChanged() const { return m_bOutputsChanged; }
+		bool takeOutputsChanged();
+
+		/**
+		 * @return the value of a register, without the side effects of reading
+		 * it from the program (e.g. for INDF or the ports).
+		 */
+		uint8 peekRegister( uint16 address ) const;
+		uint16 pc() const { return m_pc; }
+		uint8 w() const { return m_w; }
+		uint64 cycles() const { return m_cycles; }
+		bool isSleeping() const { return m_bSleeping; }
+
+	private:
+		enum class Op : uint8
+		{
+			ADDWF, ANDWF, CLRF, CLRW, COMF, DECF, DECFSZ, INCF, INCFSZ, IORWF,
+			MOVF, MOVWF, NOP, RLF, RRF, SUBWF, SWAPF, XORWF,
+			BCF, BSF, BTFSC, BTFSS,
+			ADDLW, ANDLW, CALL, CLRWDT, GOTO, IORLW, MOVLW, RETFIE, RETLW,
+			RETURN, SLEEP, SUBLW, XORLW,
+			OPTION, TRIS
+		};
+
+		/**
+		 * A decoded program word.
+		 */
+		struct Instruction
+		{
+			Op op = Op::NOP;
+			/** Store the result in the file register, rather than W */
+			bool toFile = false;
+			/** Bit number for the bit operations */
+			uint8 bit = 0;
+			/** File register address, literal or jump target */
+			uint16 arg = 0;
+		};
+
+		static Instruction decode( uint16 word );
+
+		/**
+		 * @return the address in m_ram of the given register in the current
+		 * bank, following the mirroring of the device.
+		 */
+		uint16 bankAddress( uint16 f ) const;
+		uint16 resolve( uint16 address ) const;
+		uint8 readFile( uint16 f );
+		void writeFile( uint16 f, uint8 value );
+		uint8 readAddress( uint16 address );
+		void writeAddress( uint16 address, uint8 value );
+
+		void setFlag( StatusBit bit, bool set );
+		void setZero( uint8 result ) { setFlag( Z, result == 0 ); }
+		void store( const Instruction &ins, uint8 result );
+		void push( uint16 address );
+		uint16 pop();
+		void jump( uint16 address );
+
+		bool interruptPending() const;
+		void clockTimer0( unsigned cycles );
+		void incrementTimer0();
+
+		Config m_config;
+		uint16 m_pcMask;
+		std::vector<Instruction> m_program;
+
+		/** Four banks of 128 registers */
+		std::array<uint8, 512> m_ram;
+		std::array<uint16, StackDepth> m_stack;
+		std::array<uint8, PortCount> m_latch;
+		std::array<uint8, PortCount> m_pins;
+
+		uint64 m_cycles = 0;
+		uint16 m_pc = ResetVector;
+		uint8 m_w = 0;
+		uint8 m_stackPointer = 0;
+		/** Timer 0 prescaler count */
+		uint16 m_prescaler = 0;
+		/** Cycles for which timer 0 doesn't count after being written to */
+		uint8 m_timer0Inhibit = 0;
+		bool m_bSleeping = false;
+		/** Whether the current instruction changed the flow of the program */
+		bool m_bBranched = false;
+		bool m_bOutputsChanged = false;
+};
@@ -10,13 +10,15 @@
 
 #include "oscilloscopedata.h"
 #include "oscilloscope.h"
+#include "probetracewriter.h"
 
 using namespace std;
 
 //BEGIN class ProbeData
 ProbeData::ProbeData( int id)
 	: m_id(id), m_drawPosition(0.5),
-	m_resetTime(Simulator::self()->time()), m_color(Qt::black)
+	m_resetTime(Simulator::self()->time()), m_color(Qt::black),
+	m_pTraceWriter(0)
 {}
 
 ProbeData::~ProbeData()
@@ -40,8 +42,12 @@ LogicProbeData::LogicProbeData( int id)
 }
 
 void LogicProbeData::addDataPoint( LogicDataPoint data) {
+    if (m_pTraceWriter) {
+        m_pTraceWriter->addLogicSample( m_id, data.time, data.value);
+    }
     if (m_data->size() < MAX_PROBE_DATA_SIZE) {
         m_data->push_back(data);
+        m_pyramid.append( m_data->size() - 1, data.value);
     }
 }
 
@@ -57,6 +63,7 @@ void LogicProbeData::eraseData()
 
 	delete m_data;
 	m_data = new vector<LogicDataPoint>;
+	m_pyramid.clear();
 
 	m_resetTime = Simulator::self()->time();
 
@@ -98,6 +105,24 @@ uint64_t LogicProbeData::findPos( uint64_t time) const
 
 	return pos;
 }
+
+uint64_t LogicProbeData::findPosAfter( uint64_t time, uint64_t from) const
+{
+	const vector<LogicDataPoint>::const_iterator begin = m_data->begin() + std::min<uint64_t>( from, m_data->size());
+	vector<LogicDataPoint>::const_iterator it = std::lower_bound( begin, m_data->end(), time,
+		[]( const LogicDataPoint & point, uint64_t t) { return point.time < t; });
+	return it - m_data->begin();
+}
+
+bool LogicProbeData::hasTransition( uint64_t begin, uint64_t end) const
+{
+	if( end > m_data->size()) end = m_data->size();
+	if( begin + 1 >= end) return false;
+
+	const MinMaxPyramid<uint8_t>::Entry e = m_pyramid.range( begin, end,
+		[this]( uint64_t i) { return uint8_t((*m_data)[i].value); });
+	return e.min != e.max;
+}
 //END class LogicProbeData
 
 
@@ -106,14 +131,20 @@ FloatingProbeData::FloatingProbeData( int id)
 	: ProbeData(id)
 {
 	m_data = new vector<float>;
+	m_samplesAdded = 0;
 	m_scaling = Linear;
 	m_upperAbsValue = 10.0;
 	m_lowerAbsValue = 0.1;
 }
 
 void FloatingProbeData::addDataPoint( float data) {
+    if (m_pTraceWriter) {
+        m_pTraceWriter->addFloatingSample( m_id, toTime(m_samplesAdded), data);
+    }
+    ++m_samplesAdded;
     if (m_data->size() < MAX_PROBE_DATA_SIZE) {
         m_data->push_back(data);
+        m_pyramid.append( m_data->size() - 1, data);
     }
 }
 
@@ -121,6 +152,8 @@ void FloatingProbeData::eraseData()
 {
 	delete m_data;
 	m_data = new vector<float>;
+	m_pyramid.clear();
+	m_samplesAdded = 0;
 
 	m_resetTime = Simulator::self()->time();
 }
@@ -140,6 +173,11 @@ uint64_t FloatingProbeData::findPos( uint64_t time) const
 	return at;
 }
 
+MinMaxPyramid<float>::Entry FloatingProbeData::range( uint64_t begin, uint64_t end) const
+{
+	return m_pyramid.range( begin, end, [this]( uint64_t i) { return (*m_data)[i]; });
+}
+
 uint64_t FloatingProbeData::toTime(uint64_t at) const
 {
 	return uint64_t(m_resetTime + (at * LOGIC_UPDATE_RATE * LINEAR_UPDATE_PERIOD));
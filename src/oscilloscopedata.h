@@ -14,8 +14,11 @@
 #include <qcolor.h>
 #include <qobject.h>
 #include <stdint.h>
+#include <algorithm>
 #include <vector>
 
+class ProbeTraceWriter;
+
 #define DATA_CHUNK_SIZE (8192/sizeof(T))
 
 /*
@@ -32,6 +35,119 @@
 #define MAX_PROBE_DATA_SIZE     ( 1 * 1024 * 1024 )
 // TODO ^ should be configurable
 
+/** log2 of the number of entries merged into one entry of the next level up */
+#define PROBE_PYRAMID_SHIFT 3
+
+/**
+Incrementally maintained min/max summary ("mipmap") of a sequence of samples.
+Level k holds one entry per 2^(PROBE_PYRAMID_SHIFT*(k+1)) consecutive samples,
+so the extremes of any range can be found by looking at no more than a few
+entries per level, however long the range is.
+ */
+template <typename T>
+class MinMaxPyramid
+{
+	public:
+		struct Entry
+		{
+			T min;
+			T max;
+
+			void merge( const Entry & other) {
+				min = std::min( min, other.min);
+				max = std::max( max, other.max);
+			}
+		};
+
+		void clear() { m_levels.clear(); }
+		/**
+		 * Adds the sample that was just stored at index at. Samples must be
+		 * appended in order, starting from 0.
+		 */
+		void append( uint64_t at, T value);
+		/**
+		 * @returns the min/max of the samples [begin, end), where end must not
+		 * exceed the number of appended samples. raw(i) must return sample i;
+		 * it is only used for the unaligned head and tail of the range.
+		 */
+		template <typename Raw>
+		Entry range( uint64_t begin, uint64_t end, Raw raw) const;
+
+	protected:
+		std::vector< std::vector<Entry> > m_levels;
+};
+
+template <typename T>
+void MinMaxPyramid<T>::append( uint64_t at, T value)
+{
+	uint64_t block = at;
+	for( size_t level = 0; ; ++level)
+	{
+		block >>= PROBE_PYRAMID_SHIFT;
+
+		if( level == m_levels.size())
+		{
+			if( level == 0) {
+				m_levels.emplace_back();
+			} else {
+				// A new level is only worth having once the level below has more
+				// than one entry; it is seeded from that level, which already
+				// includes value.
+				const std::vector<Entry> & below = m_levels[level-1];
+				if( below.size() <= 1) break;
+
+				std::vector<Entry> entries;
+				for( size_t i = 0; i < below.size(); ++i)
+				{
+					if( (i >> PROBE_PYRAMID_SHIFT) == entries.size())
+						entries.push_back( below[i]);
+					else
+						entries.back().merge( below[i]);
+				}
+				m_levels.push_back( entries);
+				continue;
+			}
+		}
+
+		std::vector<Entry> & entries = m_levels[level];
+		if( block == entries.size())
+			entries.push_back( Entry{ value, value});
+		else
+			entries[block].merge( Entry{ value, value});
+	}
+}
+
+template <typename T>
+template <typename Raw>
+typename MinMaxPyramid<T>::Entry MinMaxPyramid<T>::range( uint64_t begin, uint64_t end, Raw raw) const
+{
+	Entry result{ raw(begin), raw(begin)};
+	uint64_t at = begin + 1;
+
+	while( at < end)
+	{
+		// Take the coarsest entry that starts at at and lies entirely in the range
+		int level = -1;
+		uint64_t span = 1;
+		while( size_t(level+1) < m_levels.size())
+		{
+			const uint64_t nextSpan = span << PROBE_PYRAMID_SHIFT;
+			if( (at % nextSpan) != 0 || at + nextSpan > end) break;
+			span = nextSpan;
+			++level;
+		}
+
+		if( level < 0)
+			result.merge( Entry{ raw(at), raw(at)});
+		else
+			result.merge( m_levels[level][at / span]);
+
+		at += span;
+	}
+
+	return result;
+}
+
 /**
 For use in LogicProbe: Every time the input changes state, the new input state
 is recorded in value, along with the simulator time that it occurs at.
@@ -80,6 +196,16 @@ class ProbeData : public QObject
 		 * @returns the colour that is used to display the probe in the oscilloscope
 		 */
 		QColor color() const { return m_color; }
+		/**
+		 * Set the name used to identify the probe in recorded traces.
+		 */
+		void setName( const QString & name) { m_name = name; }
+		QString name() const { return m_name; }
+		/**
+		 * Data points are also passed to the given trace writer (if not null)
+		 * as they are added, including those beyond what is kept in memory.
+		 */
+		void setTraceWriter( ProbeTraceWriter * writer) { m_pTraceWriter = writer; }
 // 		/**
 // 		 * Will not record any data when paused
 // 		 */
@@ -115,6 +241,8 @@ class ProbeData : public QObject
 		float m_drawPosition;
 		uint64_t m_resetTime;
 		QColor m_color;
+		QString m_name;
+		ProbeTraceWriter * m_pTraceWriter;
 };
 
 
@@ -138,9 +266,21 @@ class LogicProbeData : public ProbeData
 		uint64_t findPos( uint64_t time) const override;
 
 		bool isEmpty() const { return m_data->size() == 0; }
+		/**
+		 * @returns true if the samples [begin, end) contain both low and high
+		 * values. Used for drawing when many transitions share a pixel.
+		 */
+		bool hasTransition( uint64_t begin, uint64_t end) const;
+		/**
+		 * @returns the position of the first DataPoint recorded at or after
+		 * the given time, searching from position from onwards. Returns the
+		 * number of recorded DataPoints if there is none.
+		 */
+		uint64_t findPosAfter( uint64_t time, uint64_t from) const;
 
 	protected:
 		std::vector<LogicDataPoint> *m_data;
+		MinMaxPyramid<uint8_t> m_pyramid;
 		friend class OscilloscopeView;
 };
 
@@ -193,12 +333,20 @@ class FloatingProbeData : public ProbeData
 		uint64_t findPos( uint64_t time) const override;
 
 		bool isEmpty() const { return m_data->size() == 0; }
+		/**
+		 * @returns the min/max of the samples [begin, end), which must be a
+		 * non-empty range of recorded samples.
+		 */
+		MinMaxPyramid<float>::Entry range( uint64_t begin, uint64_t end) const;
 
 	protected:
 		Scaling m_scaling;
 		double m_upperAbsValue;
 		double m_lowerAbsValue;
 		std::vector<float> *m_data;
+		MinMaxPyramid<float> m_pyramid;
+		/// Number of data points added since the last reset (which may be more than are stored)
+		uint64_t m_samplesAdded;
 		friend class OscilloscopeView;
 };
 
@@ -0,0 +1,384 @@
+#include "probetracewriter.h"
+#include "simulator.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QMutexLocker>
+#include <QtEndian>
+
+#include <cstring>
+
+namespace {
+	static constexpr const char BinaryMagic[] = "KTLTRACE";
+	static constexpr const char IndexMagic[] = "KTLTRIDX";
+	static constexpr const uint32 BinaryVersion = 1;
+
+	static constexpr const uint8 ChunkTag = 'C';
+	static constexpr const uint8 IndexTag = 'I';
+
+	// Simulator time between two consecutive floating probe samples
+	static constexpr const uint64 FloatingSamplePeriod = LOGIC_UPDATE_PER_STEP;
+
+	static_assert(LOGIC_UPDATE_RATE == 1000000, "VCD timescale assumes a 1us logic tick");
+
+	template <typename T>
+	static void appendLE( QByteArray &out, T value ) {
+		const T le = qToLittleEndian(value);
+		out.append(reinterpret_cast<const char *>(&le), sizeof(T));
+	}
+
+	static void appendFloatLE( QByteArray &out, float value ) {
+		uint32 bits;
+		static_assert(sizeof(bits) == sizeof(value));
+		memcpy(&bits, &value, sizeof(bits));
+		appendLE<uint32>(out, bits);
+	}
+
+	static void appendVarint( QByteArray &out, uint64 value ) {
+		while (value >= 0x80) {
+			out.append(char(uint8(value) | 0x80));
+			value >>= 7;
+		}
+		out.append(char(value));
+	}
+
+	// VCD identifier codes use the printable characters '!' to '~'
+	static QByteArray vcdCode( uintsz index ) {
+		QByteArray code;
+		do {
+			code.append(char('!' + (index % 94)));
+			index /= 94;
+		} while (index != 0);
+		return code;
+	}
+
+	static QByteArray vcdName( const QString &name ) {
+		QByteArray result = name.toUtf8();
+		for (char &c : result) {
+			if (c == ' ' || c == '\t' || c == '$') {
+				c = '_';
+			}
+		}
+		return result.isEmpty() ? QByteArray("probe") : result;
+	}
+}
+
+//BEGIN class ProbeTraceWriter
+ProbeTraceWriter::ProbeTraceWriter( const QString &fileName, Format format ) :
+	m_file(fileName),
+	m_format(format)
+{
+	m_queue.reserve(QueueCapacity);
+}
+
+ProbeTraceWriter::~ProbeTraceWriter() {
+	finish();
+}
+
+ProbeTraceWriter::Format ProbeTraceWriter::formatForFile( const QString &fileName ) {
+	return fileName.endsWith(".vcd", Qt::CaseInsensitive) ? Format::VCD : Format::Binary;
+}
+
+void ProbeTraceWriter::addProbe( int id, ProbeKind kind, const QString &name ) {
+	if (m_open) {
+		qWarning() << Q_FUNC_INFO << "Cannot add probes once the trace has been opened.";
+		return;
+	}
+
+	ProbeInfo probe;
+	probe.id = id;
+	probe.kind = kind;
+	probe.name = name;
+	probe.vcdCode = vcdCode(m_probes.size());
+	m_probes.push_back(std::move(probe));
+}
+
+bool ProbeTraceWriter::open() {
+	if (m_open) {
+		return true;
+	}
+
+	if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qWarning() << Q_FUNC_INFO << "Could not open" << m_file.fileName() << "for writing.";
+		return false;
+	}
+
+	writeHeader();
+
+	m_open = true;
+	m_finishing = false;
+	start(QThread::LowPriority);
+	return true;
+}
+
+void ProbeTraceWriter::finish() {
+	{
+		QMutexLocker lock(&m_mutex);
+		if (!m_open) {
+			return;
+		}
+		m_finishing = true;
+		m_notEmpty.wakeAll();
+		m_notFull.wakeAll();
+	}
+
+	wait();
+
+	QMutexLocker lock(&m_mutex);
+	m_open = false;
+}
+
+void ProbeTraceWriter::addLogicSample( int id, uint64 time, bool value ) {
+	push(Sample{ time, value ? 1.0f : 0.0f, id });
+}
+
+void ProbeTraceWriter::addFloatingSample( int id, uint64 time, float value ) {
+	push(Sample{ time, value, id });
+}
+
+uint64 ProbeTraceWriter::bytesWritten() const {
+	QMutexLocker lock(&m_mutex);
+	return m_bytesWritten;
+}
+
+void ProbeTraceWriter::push( const Sample &sample ) {
+	QMutexLocker lock(&m_mutex);
+	if (!m_open || m_finishing) {
+		return;
+	}
+
+	while (m_queue.size() >= QueueCapacity && !m_finishing) {
+		m_notFull.wait(&m_mutex);
+	}
+
+	m_queue.push_back(sample);
+
+	// Let the queue fill up a bit so that the writer works on decent sized
+	// batches; it also wakes up by itself periodically for slow trickles.
+	if (m_queue.size() == QueueCapacity / 4) {
+		m_notEmpty.wakeOne();
+	}
+}
+
+ProbeTraceWriter::ProbeInfo * ProbeTraceWriter::probeInfo( int id ) {
+	for (ProbeInfo &probe : m_probes) {
+		if (probe.id == id) {
+			return &probe;
+		}
+	}
+	return nullptr;
+}
+
+void ProbeTraceWriter::run() {
+	std::vector<Sample> batch;
+	batch.reserve(QueueCapacity);
+
+	for (;;) {
+		{
+			QMutexLocker lock(&m_mutex);
+			if (m_queue.empty() && !m_finishing) {
+				m_notEmpty.wait(&m_mutex, 100);
+			}
+			batch.swap(m_queue);
+			m_notFull.wakeAll();
+
+			if (batch.empty() && m_finishing) {
+				break;
+			}
+		}
+
+		writeSamples(batch);
+		batch.clear();
+	}
+
+	if (m_format == Format::Binary) {
+		for (ProbeInfo &probe : m_probes) {
+			writeBinaryChunk(probe);
+		}
+		writeBinaryIndex();
+	}
+
+	m_file.close();
+}
+
+void ProbeTraceWriter::writeHeader() {
+	QByteArray out;
+
+	switch (m_format) {
+		case Format::Binary: {
+			out.append(BinaryMagic, 8);
+			appendLE<uint32>(out, BinaryVersion);
+			appendLE<uint32>(out, LOGIC_UPDATE_RATE);
+			appendLE<uint32>(out, LINEAR_UPDATE_RATE);
+			appendLE<uint32>(out, m_probes.size());
+			for (const ProbeInfo &probe : m_probes) {
+				const QByteArray name = probe.name.toUtf8();
+				appendLE<int32>(out, probe.id);
+				appendLE<uint8>(out, uint8(probe.kind));
+				appendLE<uint16>(out, name.size());
+				out.append(name);
+			}
+		} break;
+
+		case Format::VCD: {
+			out.append("$date\n\t");
+			out.append(QDateTime::currentDateTime().toString(Qt::ISODate).toUtf8());
+			out.append("\n$end\n");
+			out.append("$version\n\tKTechLab\n$end\n");
+			out.append("$timescale 1us $end\n");
+			out.append("$scope module ktechlab $end\n");
+			for (const ProbeInfo &probe : m_probes) {
+				out.append(probe.kind == ProbeKind::Logic ? "$var wire 1 " : "$var real 64 ");
+				out.append(probe.vcdCode);
+				out.append(' ');
+				out.append(vcdName(probe.name));
+				out.append(" $end\n");
+			}
+			out.append("$upscope $end\n");
+			out.append("$enddefinitions $end\n");
+		} break;
+	}
+
+	write(out);
+}
+
+void ProbeTraceWriter::writeSamples( const std::vector<Sample> &samples ) {
+	if (m_format == Format::VCD) {
+		for (const Sample &sample : samples) {
+			if (ProbeInfo *probe = probeInfo(sample.probe)) {
+				writeVCDSample(*probe, sample);
+			}
+		}
+		return;
+	}
+
+	for (const Sample &sample : samples) {
+		ProbeInfo *probe = probeInfo(sample.probe);
+		if (!probe) {
+			continue;
+		}
+
+		// Floating samples are stored without times, so a chunk must only hold
+		// evenly spaced samples (which they are unless the probe was reset).
+		if (
+			probe->kind == ProbeKind::Floating &&
+			!probe->pending.empty() &&
+			sample.time != probe->pending.back().time + FloatingSamplePeriod
+		) {
+			writeBinaryChunk(*probe);
+		}
+
+		probe->pending.push_back(sample);
+		if (probe->pending.size() >= ChunkSamples) {
+			writeBinaryChunk(*probe);
+		}
+	}
+}
+
+void ProbeTraceWriter::writeBinaryChunk( ProbeInfo &probe ) {
+	if (probe.pending.empty()) {
+		return;
+	}
+
+	QByteArray payload;
+	const uint64 firstTime = probe.pending.front().time;
+
+	if (probe.kind == ProbeKind::Logic) {
+		uint64 previousTime = firstTime;
+		for (const Sample &sample : probe.pending) {
+			const uint64 delta = (sample.time >= previousTime) ? (sample.time - previousTime) : 0;
+			appendVarint(payload, (delta << 1) | (sample.value != 0.0f ? 1 : 0));
+			previousTime = std::max(previousTime, sample.time);
+		}
+	}
+	else {
+		payload.reserve(probe.pending.size() * sizeof(float));
+		for (const Sample &sample : probe.pending) {
+			appendFloatLE(payload, sample.value);
+		}
+	}
+
+	m_chunkIndex.push_back(ChunkIndexEntry{
+		probe.id,
+		firstTime,
+		probe.pending.back().time,
+		uint64(m_file.pos())
+	});
+
+	QByteArray out;
+	appendLE<uint8>(out, ChunkTag);
+	appendLE<int32>(out, probe.id);
+	appendLE<uint64>(out, firstTime);
+	appendLE<uint32>(out, probe.pending.size());
+	appendLE<uint32>(out, payload.size());
+	out.append(payload);
+	write(out);
+
+	probe.pending.clear();
+}
+
+void ProbeTraceWriter::writeBinaryIndex() {
+	const uint64 indexOffset = m_file.pos();
+
+	QByteArray out;
+	appendLE<uint8>(out, IndexTag);
+	appendLE<uint32>(out, m_chunkIndex.size());
+	for (const ChunkIndexEntry &entry : m_chunkIndex) {
+		appendLE<int32>(out, entry.probe);
+		appendLE<uint64>(out, entry.firstTime);
+		appendLE<uint64>(out, entry.lastTime);
+		appendLE<uint64>(out, entry.offset);
+	}
+
+	// The trailer lets readers find the index from the end of the file
+	appendLE<uint64>(out, indexOffset);
+	out.append(IndexMagic, 8);
+	write(out);
+
+	m_chunkIndex.clear();
+}
+
+void ProbeTraceWriter::writeVCDSample( ProbeInfo &probe, const Sample &sample ) {
+	if (probe.hasLastValue && probe.lastValue == sample.value) {
+		return;
+	}
+	probe.lastValue = sample.value;
+	probe.hasLastValue = true;
+
+	QByteArray out;
+
+	// VCD times must not decrease, so late samples share the latest timestamp
+	if (!m_hasVCDTime || sample.time > m_lastVCDTime) {
+		m_lastVCDTime = sample.time;
+		m_hasVCDTime = true;
+		out.append('#');
+		out.append(QByteArray::number(qulonglong(m_lastVCDTime)));
+		out.append('\n');
+	}
+
+	if (probe.kind == ProbeKind::Logic) {
+		out.append(sample.value != 0.0f ? '1' : '0');
+	}
+	else {
+		out.append('r');
+		out.append(QByteArray::number(double(sample.value), 'g', 9));
+		out.append(' ');
+	}
+	out.append(probe.vcdCode);
+	out.append('\n');
+
+	write(out);
+}
+
+void ProbeTraceWriter::write( const QByteArray &data ) {
+	const qint64 written = m_file.write(data);
+	if (written != data.size()) {
+		qWarning() << Q_FUNC_INFO << "Failed writing to" << m_file.fileName() << ":" << m_file.errorString();
+	}
+
+	QMutexLocker lock(&m_mutex);
+	m_bytesWritten += std::max<qint64>(written, 0);
+}
+//END class ProbeTraceWriter
+
+#include "moc_probetracewriter.cpp"
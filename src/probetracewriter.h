@@ -0,0 +1,133 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <vector>
+
+/**
+@short Streams oscilloscope probe samples to disk on a background thread.
+
+Samples are pushed by the probes as the simulation runs into a bounded queue
+and written out by the thread, so a capture is limited by disk space rather
+than by the in-memory probe buffers (and survives an oscilloscope reset).
+
+Two formats are supported:
+- Format::Binary is a compact chunked trace. Samples are grouped per probe
+  into chunks (logic samples as delta-encoded varint times, floating samples
+  as raw floats), and an index of all chunks is appended when the capture is
+  stopped, so readers can seek to any probe and time range directly.
+- Format::VCD is a Value Change Dump for use with external waveform viewers.
+  Logic probes are written as wires and floating probes as reals.
+*/
+class ProbeTraceWriter final : public QThread {
+	Q_OBJECT
+
+	public:
+		enum class Format { Binary, VCD };
+
+		enum class ProbeKind : uint8 { Logic = 0, Floating = 1 };
+
+		/** Number of queued samples after which producers wait for the writer */
+		static constexpr const uintsz QueueCapacity = 1 << 16;
+		/** Samples per probe gathered into one chunk of the binary format */
+		static constexpr const uintsz ChunkSamples = 4096;
+
+		ProbeTraceWriter( const QString &fileName, Format format );
+		~ProbeTraceWriter() override;
+
+		/**
+		 * @returns the format guessed from the extension of fileName: ".vcd"
+		 * gives Format::VCD, anything else Format::Binary.
+		 */
+		static Format formatForFile( const QString &fileName );
+
+		/**
+		 * Declares a probe. All probes must be declared before start() is
+		 * called, as VCD files need the complete list of signals up front.
+		 */
+		void addProbe( int id, ProbeKind kind, const QString &name );
+		/**
+		 * Opens the file and starts the writer thread.
+		 * @return false if the file could not be opened.
+		 */
+		bool open();
+		/**
+		 * Flushes everything queued so far, finishes the file and stops the
+		 * thread. Called by the destructor if needed.
+		 */
+		void finish();
+
+		/**
+		 * Queue a sample. Probes that were not declared are ignored. If the
+		 * queue is full, waits for the writer thread to catch up.
+		 */
+		void addLogicSample( int id, uint64 time, bool value );
+		void addFloatingSample( int id, uint64 time, float value );
+
+		QString fileName() const { return m_file.fileName(); }
+		/**
+		 * @returns the number of bytes written to the file so far.
+		 */
+		uint64 bytesWritten() const;
+
+	protected:
+		void run() override;
+
+	private:
+		struct Sample {
+			uint64 time;
+			float value;
+			int probe;
+		};
+
+		struct ProbeInfo {
+			int id = 0;
+			ProbeKind kind = ProbeKind::Logic;
+			QString name;
+			QByteArray vcdCode;
+			/** Samples waiting to be written as a binary chunk */
+			std::vector<Sample> pending;
+			/** Last value written, for suppressing repeated VCD values */
+			float lastValue = 0.0f;
+			bool hasLastValue = false;
+		};
+
+		struct ChunkIndexEntry {
+			int probe;
+			uint64 firstTime;
+			uint64 lastTime;
+			uint64 offset;
+		};
+
+		void push( const Sample &sample );
+		ProbeInfo * probeInfo( int id );
+
+		void writeHeader();
+		void writeSamples( const std::vector<Sample> &samples );
+		void writeBinaryChunk( ProbeInfo &probe );
+		void writeBinaryIndex();
+		void writeVCDSample( ProbeInfo &probe, const Sample &sample );
+		void write( const QByteArray &data );
+
+		QFile m_file;
+		const Format m_format;
+
+		std::vector<ProbeInfo> m_probes;
+		std::vector<ChunkIndexEntry> m_chunkIndex;
+		uint64 m_lastVCDTime = 0;
+		bool m_hasVCDTime = false;
+
+		mutable QMutex m_mutex;
+		QWaitCondition m_notEmpty;
+		QWaitCondition m_notFull;
+		/** Filled by the producers, swapped out wholesale by the writer */
+		std::vector<Sample> m_queue;
+		uint64 m_bytesWritten = 0;
+		bool m_finishing = false;
+		bool m_open = false;
+};
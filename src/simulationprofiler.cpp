@@ -0,0 +1,121 @@
+#include "simulationprofiler.h"
+
+#include "circuit.h"
+#include "component.h"
+
+//BEGIN class SimulationProfiler
+SimulationProfiler::Counters & SimulationProfiler::Counters::operator+=( const Counters &other )
+{
+	nanoseconds += other.nanoseconds;
+	calls += other.calls;
+	iterations += other.iterations;
+	luCalls += other.luCalls;
+	return *this;
+}
+
+
+SimulationProfiler *SimulationProfiler::m_pSelf = nullptr;
+
+
+SimulationProfiler * SimulationProfiler::self()
+{
+	if ( !m_pSelf )
+		m_pSelf = new SimulationProfiler;
+	return m_pSelf;
+}
+
+
+void SimulationProfiler::forget( const Component *component )
+{
+	if ( m_pSelf )
+		m_pSelf->m_components.remove( component );
+}
+
+
+void SimulationProfiler::forget( const Circuit *circuit )
+{
+	if ( m_pSelf )
+		m_pSelf->m_circuits.remove( circuit );
+}
+
+
+void SimulationProfiler::forget( const Element *element )
+{
+	if ( m_pSelf )
+		m_pSelf->m_elements.remove( element );
+}
+
+
+void SimulationProfiler::setEnabled( bool enabled )
+{
+	if ( m_bEnabled == enabled )
+		return;
+
+	if ( enabled )
+	{
+		m_components.clear();
+		m_circuits.clear();
+		m_elements.clear();
+		m_stepCount = 0;
+		m_sampledSteps = 0;
+	}
+
+	m_bEnabled = enabled;
+	m_bSampling = false;
+	emit enabledChanged( enabled );
+}
+
+
+QHash<const Component *, SimulationProfiler::Counters> SimulationProfiler::componentTotals( const QPtrList<Component> &components, const QList<Circuit *> &circuits ) const
+{
+	QHash<const Component *, Counters> totals;
+	QHash<const Element *, const Component *> owners;
+
+	for ( const Component *component : components )
+	{
+		if ( !component )
+			continue;
+
+		Counters &total = totals[component];
+		total += m_components.value( component );
+
+		for ( const ElementMap &elementMap : component->elementMapList() )
+		{
+			if ( !elementMap.e )
+				continue;
+			owners[elementMap.e] = component;
+			total += m_elements.value( elementMap.e );
+		}
+	}
+
+	for ( const Circuit *circuit : circuits )
+	{
+		const auto it = m_circuits.find( circuit );
+		if ( !circuit || it == m_circuits.end() || circuit->elements().isEmpty() )
+			continue;
+
+		// Each component's share of the circuit is by element count
+		QHash<const Component *, int> elementCounts;
+		for ( const Element *element : circuit->elements() )
+		{
+			if ( const Component *owner = owners.value( element ) )
+				++elementCounts[owner];
+		}
+
+		const double elementCount = circuit->elements().size();
+		for ( auto count = elementCounts.begin(); count != elementCounts.end(); ++count )
+		{
+			const double share = count.value() / elementCount;
+			Counters &total = totals[count.key()];
+			total.nanoseconds += qint64( it->nanoseconds * share );
+			total.calls += quint64( it->calls * share );
+			total.iterations += quint64( it->iterations * share );
+			total.luCalls += quint64( it->luCalls * share );
+		}
+	}
+
+	return totals;
+}
+//END class SimulationProfiler
+
+#include "moc_simulationprofiler.cpp"
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+#include <chrono>
+
+class Circuit;
+class Component;
+class Element;
+
+/**
+@short Measures where the simulator spends its time
+
+While enabled, one in every sampleInterval linear steps of the Simulator is
+sampled: the component callbacks, stepNonLogic calls, circuit solves and logic
+callbacks made during it are timed and counted per component, circuit or
+element. The other steps only pay for checking whether they are sampled.
+
+The counters are keyed by pointer, so components, circuits and elements call
+forget when they are destroyed, so that a new object at the same address
+doesn't start with their counters.
+*/
+class SimulationProfiler : public QObject
+{
+	Q_OBJECT
+	public:
+		/// One in this many linear steps is sampled
+		static constexpr const int sampleInterval = 16;
+
+		struct Counters
+		{
+			/// Time spent in the sampled steps
+			qint64 nanoseconds = 0;
+			quint64 calls = 0;
+			/// Newton-Raphson iterations (for circuits with nonlinear elements)
+			quint64 iterations = 0;
+			/// LU decompositions of the circuit matrix
+			quint64 luCalls = 0;
+
+			Counters & operator+=( const Counters &other );
+		};
+
+		/**
+		 * Times the scope that it lives in, adding the time and a call to
+		 * the counters. Does nothing if counters is null, which is what the
+		 * counters functions return for steps that aren't sampled.
+		 */
+		class Scope final
+		{
+			public:
+				explicit Scope( Counters *counters ) : m_counters( counters )
+				{
+					if ( m_counters )
+						m_start = std::chrono::steady_clock::now();
+				}
+
+				~Scope()
+				{
+					if ( !m_counters )
+						return;
+					m_counters->nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - m_start ).count();
+					++m_counters->calls;
+				}
+
+				Scope( const Scope & ) = delete;
+				Scope & operator=( const Scope & ) = delete;
+
+			private:
+				Counters *m_counters;
+				std::chrono::steady_clock::time_point m_start;
+		};
+
+		static SimulationProfiler * self();
+		/**
+		 * Throws away the counters of an object that is being destroyed.
+		 */
+		static void forget( const Component *component );
+		static void forget( const Circuit *circuit );
+		static void forget( const Element *element );
+
+		bool isEnabled() const { return m_bEnabled; }
+		/**
+		 * Called by Simulator at the start of every linear step, to decide
+		 * whether the step is sampled.
+		 */
+		void beginStep()
+		{
+			m_bSampling = m_bEnabled && (++m_stepCount % sampleInterval) == 0;
+			if ( m_bSampling )
+				++m_sampledSteps;
+		}
+		quint64 sampledSteps() const { return m_sampledSteps; }
+
+		/**
+		 * @return the counters for the object, or null if the current step
+		 * isn't being sampled.
+		 */
+		Counters * counters( const Component *component ) { return m_bSampling ? &m_components[component] : nullptr; }
+		Counters * counters( const Circuit *circuit ) { return m_bSampling ? &m_circuits[circuit] : nullptr; }
+		Counters * counters( const Element *element ) { return m_bSampling ? &m_elements[element] : nullptr; }
+
+		/**
+		 * Adds up the counters for each of the components: its own, those of
+		 * its elements, and a share of those of each circuit its elements
+		 * are in (by how many of the circuit's elements are its).
+		 */
+		QHash<const Component *, Counters> componentTotals( const QPtrList<Component> &components, const QList<Circuit *> &circuits ) const;
+
+	public slots:
+		/**
+		 * Starts or stops profiling. The counters are cleared when starting.
+		 */
+		void setEnabled( bool enabled );
+
+	signals:
+		void enabledChanged( bool enabled );
+
+	private:
+		SimulationProfiler() = default;
+
+		static SimulationProfiler *m_pSelf;
+
+		QHash<const Component *, Counters> m_components;
+		QHash<const Circuit *, Counters> m_circuits;
+		QHash<const Element *, Counters> m_elements;
+		quint64 m_stepCount = 0;
+		quint64 m_sampledSteps = 0;
+		bool m_bEnabled = false;
+		bool m_bSampling = false;
+};
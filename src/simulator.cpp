@@ -11,6 +11,7 @@
 #include "component.h"
 #include "gpsimprocessor.h"
 #include "pin.h"
+#include "simulationprofiler.h"
 #include "simulator.h"
 #include "switch.h"
 
@@ -93,15 +94,19 @@ void Simulator::step() {
 	// to do.
 	const unsigned maxSteps = unsigned(LINEAR_UPDATE_RATE / SIMULATOR_STEP_INTERVAL_MS);
 
+	SimulationProfiler *profiler = SimulationProfiler::self();
+
 	for (unsigned i = 0; i < maxSteps; ++i) {
         // here starts 1 linear step
 		m_stepNumber++;
+		profiler->beginStep();
 
 		// Update the non-logic parts of the simulation
 		{
 			list<Component*>::iterator components_end = m_components->end();
 
 			for (list<Component*>::iterator component = m_components->begin(); component != components_end; component++) {
+				SimulationProfiler::Scope scope(profiler->counters(*component));
 				(*component)->stepNonLogic();
 			}
 		}
@@ -110,6 +115,7 @@ void Simulator::step() {
 			list<Circuit*>::iterator circuits_end = m_ordinaryCircuits->end();
 
 			for (list<Circuit*>::iterator circuit = m_ordinaryCircuits->begin(); circuit != circuits_end; circuit++) {
+				SimulationProfiler::Scope scope(profiler->counters(*circuit));
 				(*circuit)->doNonLogic();
 			}
 		}
@@ -124,6 +130,7 @@ void Simulator::step() {
 				list<ComponentCallback>::iterator callbacks_end = m_componentCallbacks->end();
 
 				for (list<ComponentCallback>::iterator callback = m_componentCallbacks->begin(); callback != callbacks_end; callback++) {
+					SimulationProfiler::Scope scope(profiler->counters(callback->component()));
 					callback->callback();
 				}
 			}
@@ -132,6 +139,7 @@ void Simulator::step() {
 				list<ComponentCallback*>::iterator callbacks_end = m_pStartStepCallback[m_llNumber]->end();
 
 				for (list<ComponentCallback*>::iterator callback = m_pStartStepCallback[m_llNumber]->begin(); callback != callbacks_end; callback++) {
+					SimulationProfiler::Scope scope(profiler->counters((*callback)->component()));
 					(*callback)->callback();
 					// should we delete the list entry? no
 				}
@@ -171,7 +179,10 @@ void Simulator::step() {
 				do {
 					Circuit *next = changed->nextChanged(prevChain);
 					changed->setNextChanged(0, prevChain);
-					changed->doLogic();
+					{
+						SimulationProfiler::Scope scope(profiler->counters(changed));
+						changed->doLogic();
+					}
 					changed = next;
 				} while (changed);
 			}
@@ -198,6 +209,7 @@ void Simulator::step() {
 					LogicIn *logicCallback = changed;
 
 					while (logicCallback) {
+						SimulationProfiler::Scope scope(profiler->counters(static_cast<const Element *>(logicCallback)));
 						logicCallback->callCallback();
 						logicCallback = logicCallback->nextLogic();
 					}
@@ -3,8 +3,11 @@
 
 #include "colorcombo.h"
 #include "cnitem.h"
+#include "item.h"
 
 #include <QDebug>
+#include <QHash>
+#include <QSet>
 #include <KLocalizedString>
 
 using namespace std;
@@ -12,64 +15,120 @@ using namespace std;
 // this value is taken from ColorCombo and should ideally be put somewhere...
 static constexpr const char DefaultColor[] = "#f62a2a";
 
-Variant::Variant(const QString &id, Type type) :
-	Super(),
-	m_id(id),
-	m_type(type),
-	m_colorScheme(ColorCombo::QtStandard)
+namespace {
+	// The schema shared by the property of the items of a type, by item type
+	// and property id. Only the first is kept: an item that sets up a
+	// property differently (e.g. from its own settings) keeps its own schema,
+	// so that these don't pile up for the whole session.
+	QHash<QString, QSharedDataPointer<Variant::Schema>> sharedSchemas;
+	QSet<QString> sharedIds;
+}
+
+Variant::Variant(Item *owner, const QString &id, Type type) :
+	m_schema(new Schema),
+	m_pOwner(owner)
 {
+	m_schema->id = id;
+	m_schema->type = type;
+	m_schema->colorScheme = ColorCombo::QtStandard;
+
 	if (type == Type::Color) {
-		m_value = m_defaultValue = DefaultColor;
+		m_value = m_schema->defaultValue = DefaultColor;
 	}
 }
 
-Variant::Variant(QString &&id, Type type) : Variant(id, type)
-{}
+VariantNotifier * Variant::notifier() {
+	if (!m_pNotifier) {
+		m_pNotifier = std::make_unique<VariantNotifier>();
+	}
+	return m_pNotifier.get();
+}
+
+bool Variant::Schema::operator==(const Schema &other) const {
+	return
+		type == other.type &&
+		id == other.id &&
+		bSetDefault == other.bSetDefault &&
+		defaultValue == other.defaultValue &&
+		unit == other.unit &&
+		toolbarCaption == other.toolbarCaption &&
+		editorCaption == other.editorCaption &&
+		filter == other.filter &&
+		minAbsValue == other.minAbsValue &&
+		minValue == other.minValue &&
+		maxValue == other.maxValue &&
+		colorScheme == other.colorScheme &&
+		bAdvanced == other.bAdvanced &&
+		bHidden == other.bHidden &&
+		allowed == other.allowed;
+}
+
+void Variant::shareSchema(const QString &itemType) {
+	const QString key = itemType + '/' + id();
+	const auto it = sharedSchemas.constFind(key);
+
+	if (it == sharedSchemas.constEnd()) {
+		sharedSchemas.insert(key, m_schema);
+	}
+	else if (it->constData() != m_schema.constData() && *it->constData() == schema()) {
+		m_schema = *it;
+	}
+}
+
+QString Variant::sharedId(const QString &id) {
+	auto it = sharedIds.constFind(id);
+	if (it == sharedIds.constEnd()) {
+		it = sharedIds.insert(id);
+	}
+	return *it;
+}
 
 void Variant::appendAllowed(const QString &id, const QString &i18nName) {
-	m_allowed[id] = i18nName;
+	if (schema().allowed.contains(id) && schema().allowed[id] == i18nName) return;
+	m_schema->allowed[id] = i18nName;
 }
 
 void Variant::appendAllowed(QString &&id, const QString &i18nName) {
-	m_allowed[id] = i18nName;
+	appendAllowed(id, i18nName);
 }
 
 void Variant::appendAllowed(const QString &id, QString &&i18nName) {
-	m_allowed[id] = i18nName;
+	appendAllowed(id, i18nName);
 }
 
 void Variant::appendAllowed(QString &&id, QString &&i18nName) {
-	m_allowed[id] = i18nName;
+	appendAllowed(id, i18nName);
 }
 
 void Variant::setAllowed(const QStringList &allowed) {
-	m_allowed.clear();
+	QStringMap allowedMap;
 	for (auto &&value : allowed) {
-		m_allowed[value] = value;
+		allowedMap[value] = value;
 	}
+	setAllowed(std::move(allowedMap));
 }
 
 void Variant::appendAllowed(const QString &allowed) {
-	m_allowed[allowed] = allowed;
+	appendAllowed(allowed, allowed);
 }
 
 void Variant::appendAllowed(QString &&allowed) {
-	m_allowed[allowed] = allowed;
+	appendAllowed(allowed, allowed);
 }
 
 void Variant::setMinValue(double value) {
-	m_minValue = value;
+	setSchema(&Schema::minValue, value);
 
 	if (value != 0.0) {
-		m_minAbsValue = std::min(m_minAbsValue, std::abs(value));
+		setSchema(&Schema::minAbsValue, std::min(minAbsValue(), std::abs(value)));
 	}
 }
 
 void Variant::setMaxValue(double value) {
-	m_maxValue = value;
+	setSchema(&Schema::maxValue, value);
 
 	if (value != 0.0) {
-		m_minAbsValue = std::min(m_minAbsValue, std::abs(value));
+		setSchema(&Schema::minAbsValue, std::min(minAbsValue(), std::abs(value)));
 	}
 }
 
@@ -77,17 +136,17 @@ QString Variant::displayString() const {
 	switch(type()) {
 		case Type::Double: {
 			auto numValue = m_value.toDouble();
-			return QString::number(numValue / CNItem::getMultiplier(numValue)) + " " + CNItem::getNumberMag(numValue) + m_unit;
+			return QString::number(numValue / CNItem::getMultiplier(numValue)) + " " + CNItem::getNumberMag(numValue) + unit();
 		}
 
 		case Type::Int:
-			return m_value.toString() + " " + m_unit;
+			return m_value.toString() + " " + unit();
 
 		case Type::Bool:
 			return i18n(m_value.toBool() ? "True" : "False");
 
 		case Type::Select:
-			return m_allowed[m_value.toString()];
+			return schema().allowed[m_value.toString()];
 
 		default:
 			return m_value.toString();
@@ -97,15 +156,16 @@ QString Variant::displayString() const {
 template <typename T>
 void Variant::_setValue(T val) {
 	qDebug() << Q_FUNC_INFO << "val=" << val << " old=" << m_value;
-	if (type() == Type::Select && !m_allowed.contains(val.toString())) {
+	const QStringMap &allowed = schema().allowed;
+	if (type() == Type::Select && !allowed.contains(val.toString())) {
 		// Our value is being set to an i18n name, not the actual string id.
 		// So change val to the id (if it exists)
 
 		auto i18nName = val.toString();
 
 		// Range-for on QMap gives you values, not key-value pairs. Frustrating.
-		const auto end = m_allowed.end();
-		for (auto it = m_allowed.begin(); it != end; ++it) {
+		const auto end = allowed.end();
+		for (auto it = allowed.begin(); it != end; ++it) {
 			if (it.value() == i18nName) {
 				val = it.key();
 				break;
@@ -113,9 +173,9 @@ void Variant::_setValue(T val) {
 		}
 	}
 
-	if (!m_bSetDefault) {
-		m_defaultValue = val;
-		m_bSetDefault = true;
+	if (!schema().bSetDefault) {
+		m_schema->defaultValue = val;
+		m_schema->bSetDefault = true;
 	}
 
 	if (m_value == val) {
@@ -124,7 +184,18 @@ void Variant::_setValue(T val) {
 
 	const QVariant old = std::move(m_value);
 	m_value = val;
-	emit(valueChanged(val, old));
+
+	if (m_pOwner) {
+		m_pOwner->propertyChangedInitial();
+	}
+
+	// Nothing can have connected to the signals if there is no notifier
+	VariantNotifier *notifier = m_pNotifier.get();
+	if (!notifier) {
+		return;
+	}
+
+	emit notifier->valueChanged(val, old);
 
 	switch (type()) {
 		case Type::String:
@@ -142,25 +213,25 @@ void Variant::_setValue(T val) {
 		case Type::RichText: {
 			auto dispString = displayString();
 			qDebug() << Q_FUNC_INFO << "dispString=" << dispString << " value=" << m_value;
-			emit valueChanged(dispString);
-			emit valueChangedStrAndTrue(dispString, true);
+			emit notifier->valueChanged(dispString);
+			emit notifier->valueChangedStrAndTrue(dispString, true);
 		}
 		break;
 
 		case Type::Int:
-			emit valueChanged(value().toInt());
+			emit notifier->valueChanged(value().toInt());
 			break;
 
 		case Type::Double:
-			emit valueChanged(value().toDouble());
+			emit notifier->valueChanged(value().toDouble());
 			break;
 
 		case Type::Color:
-			emit valueChanged(value().value<QColor>());
+			emit notifier->valueChanged(value().value<QColor>());
 			break;
 
 		case Type::Bool:
-			emit valueChanged(value().toBool());
+			emit notifier->valueChanged(value().toBool());
 			break;
 
 		case Type::Raw:
@@ -179,7 +250,7 @@ void Variant::setValue(QVariant &&val) {
 }
 
 void Variant::setMinAbsValue(double val) {
-	m_minAbsValue = val;
+	setSchema(&Schema::minAbsValue, val);
 }
 
 bool Variant::changed() const {
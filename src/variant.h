@@ -2,9 +2,11 @@
 
 #include "pch.hpp"
 
+#include <memory>
 #include <utility>
 
 #include <QObject>
+#include <QSharedData>
 #include <QVariant>
 #include <QStringList>
 
@@ -12,21 +14,74 @@
 class Variant;
 using Property = Variant;
 
+class Item;
 class QColor;
 class QString;
 
 using QStringMap = QMap<QString, QString>;
 
 /**
+Emits the signals of a Variant. It is only created once something wants to
+connect to them (see Variant::notifier), which is usually just the editors for
+the properties of the selected item.
+*/
+class VariantNotifier : public QObject {
+	Q_OBJECT
+	public:
+	VariantNotifier() = default;
+
+	signals:
+	/**
+	 * Emitted when the value changes.
+	 * NOTE: The order of data given is the new value, and then the old value
+	 * This is done so that slots that don't care about the old value don't
+	 * have to accept it
+	 */
+	void valueChanged(const QVariant &newValue, const QVariant &oldValue);
+	/**
+	 * Emitted for variants of string-like type.
+	 */
+	void valueChanged(const QString &newValue);
+	/**
+	 * Emitted for variants of string-like type.
+   * This signal is needed for updating values in KComboBox-es, see KComboBox::setCurrentItem(),
+	 * second bool parameter, insert.
+   */
+	void valueChangedStrAndTrue(const QString &newValue, bool trueBool);
+	/**
+	 * Emitted for variants of int-like type.
+	 */
+	void valueChanged(int newValue);
+	/**
+	 * Emitted for variants of double-like type.
+	 */
+	void valueChanged(double newValue);
+	/**
+	 * Emitted for variants of color-like type.
+	 */
+	void valueChanged(const QColor &newValue);
+	/**
+	 * Emitted for variants of bool-like type.
+	 */
+	void valueChanged(bool newValue);
+};
+
+/**
+A property of an Item: its value, and a schema shared with the same property
+of the other items of its type.
+
+Items have many properties, so this is kept small: it isn't a QObject, and the
+VariantNotifier that emits its signals is only created when something connects
+to them. The item that owns it keeps it in a slot (see Item::createProperty),
+and is told directly when the value changes.
+
 For information:
 QVariant::type() returns an enum for the current data type
 contained. e.g. returns QVariant::Color or QVariant::Rect
 @author Daniel Clarke
 @author David Saxton
 */
-class Variant : public QObject {
-	Q_OBJECT
-	using Super = QObject;
+class Variant final {
 	public:
 	enum class Type : uint {
 		None,
@@ -51,32 +106,82 @@ class Variant : public QObject {
 		KeyPad				// Pin Map for Keypad
 	};
 
-	Variant(const QString &id, Type type);
-	Variant(QString &&id, Type type);
-	~Variant() override = default;
+	/**
+	 * Everything about a Variant other than its value: captions, unit,
+	 * limits, allowed values and so on. These are the same for the property
+	 * of every item of a type, so Variants share them (copying on write)
+	 * once the item has been created; see shareSchema.
+	 */
+	struct Schema : public QSharedData {
+		bool operator==(const Schema &other) const;
 
-	const QString & id() const { return m_id; }
+		QStringMap allowed;
+		QVariant defaultValue;
+		QString unit;
+		QString id;
+		QString toolbarCaption;					// Short description shown in e.g. properties dialog
+		QString editorCaption;					// Text displayed before the data entry widget in the toolbar
+		QString filter;									// If type() == Type::FileName this is the filter used in file dialogs.
+		double minAbsValue = 1.0e-6;
+		double minValue = 1.0e-6;
+		double maxValue = 1.0e9;
+		Type type = Type::None;
+		int colorScheme = 0;
+		bool bAdvanced = false;					// If advanced, only display data in item editor
+		bool bHidden = false;						// If hidden, do not allow user to change data
+		bool bSetDefault = false;				// If false, then the default will be set to the first thing this variant is set to
+	};
+
+	/**
+	 * @param owner the item to tell when the value changes, if any.
+	 */
+	Variant(Item *owner, const QString &id, Type type);
+	~Variant() = default;
+
+	Variant(const Variant &) = delete;
+	Variant & operator=(const Variant &) = delete;
+
+	/**
+	 * @return the object that emits the signals for this variant, creating
+	 * it the first time that this is called.
+	 */
+	VariantNotifier * notifier();
+
+	const QString & id() const { return schema().id; }
+	/**
+	 * Switches to the schema of the first variant with our id of an item of
+	 * the given type if it is identical to ours, so that the metadata is only
+	 * stored once for all items of that type. Called when the item has
+	 * finished being created; changing the metadata afterwards copies it
+	 * again.
+	 */
+	void shareSchema(const QString &itemType);
+	/**
+	 * @return id, sharing its string data with every other property id
+	 * that has been passed to this.
+	 */
+	static QString sharedId(const QString &id);
 
 	/**
 	 * Returns the type of Variant (see Variant::Type)
 	 */
-	Type type() const { return m_type; }
+	Type type() const { return schema().type; }
 	/**
 	 * Sets the variant type
 	 */
-	void setType(Type type) { m_type = type; }
+	void setType(Type type) { setSchema(&Schema::type, type); }
 	/**
 	 * Returns the filter used for file dialogs (if this is of type Type::FileName)
 	 */
-	const QString & filter() const { return m_filter; }
-	void setFilter(const QString &filter) { m_filter = filter; }
+	const QString & filter() const { return schema().filter; }
+	void setFilter(const QString &filter) { setSchema(&Schema::filter, filter); }
 	/**
 	 * The selection of colours to be used in the combo box - e.g.
 	 * ColorCombo::LED.
 	 * @see ColorCombo::ColorScheme
 	 */
-	int colorScheme() const { return m_colorScheme; }
-	void setColorScheme(int colorScheme) { m_colorScheme = colorScheme; }
+	int colorScheme() const { return schema().colorScheme; }
+	void setColorScheme(int colorScheme) { setSchema(&Schema::colorScheme, colorScheme); }
 	/**
 	 * This function is for convenience; it sets both the toolbar and editor
 	 * caption.
@@ -88,52 +193,52 @@ class Variant : public QObject {
 	/**
 	 * This text is displayed to the left of the entry widget in the toolbar
 	 */
-	const QString & toolbarCaption() const { return m_toolbarCaption; }
-	void setToolbarCaption(const QString &caption) { m_toolbarCaption = caption; }
-	void setToolbarCaption(QString &&caption) { m_toolbarCaption = caption; }
+	const QString & toolbarCaption() const { return schema().toolbarCaption; }
+	void setToolbarCaption(const QString &caption) { setSchema(&Schema::toolbarCaption, caption); }
+	void setToolbarCaption(QString &&caption) { setSchema(&Schema::toolbarCaption, std::move(caption)); }
 	/**
 	 * This text is displayed to the left of the entry widget in the item editor
 	 */
-	const QString & editorCaption() const { return m_editorCaption; }
-	void setEditorCaption(const QString &caption) { m_editorCaption = caption; }
-	void setEditorCaption(QString &&caption) { m_editorCaption = caption; }
+	const QString & editorCaption() const { return schema().editorCaption; }
+	void setEditorCaption(const QString &caption) { setSchema(&Schema::editorCaption, caption); }
+	void setEditorCaption(QString &&caption) { setSchema(&Schema::editorCaption, std::move(caption)); }
 	/**
 	 * Unit of number, (e.g. V (volts) / F (farads))
 	 */
-	const QString & unit() const { return m_unit; }
-	void setUnit(const QString &unit) { m_unit = unit; }
-	void setUnit(QString &&unit) { m_unit = unit; }
+	const QString & unit() const { return schema().unit; }
+	void setUnit(const QString &unit) { setSchema(&Schema::unit, unit); }
+	void setUnit(QString &&unit) { setSchema(&Schema::unit, std::move(unit)); }
 	/**
 	 * The smallest (as in negative, not absoluteness) value that the user can
 	 * set this to.
 	 */
-	double minValue() const { return m_minValue; }
+	double minValue() const { return schema().minValue; }
 	void setMinValue(double value);
 	/**
 	 * The largest (as in positive, not absoluteness) value that the user can
 	 * set this to.
 	 */
-	double maxValue() const { return m_maxValue; }
+	double maxValue() const { return schema().maxValue; }
 	void setMaxValue(double value);
 	/**
 	 * The smallest absolute value that the user can set this to, before the
 	 * value is considered zero.
 	 */
-	double minAbsValue() const { return m_minAbsValue; }
+	double minAbsValue() const { return schema().minAbsValue; }
 	void setMinAbsValue(double val);
-	const QVariant & defaultValue() const { return m_defaultValue; }
+	const QVariant & defaultValue() const { return schema().defaultValue; }
 	/**
 	 * If this data is marked as advanced, it will only display in the item
 	 * editor (and not in the toolbar)
 	 */
-	bool isAdvanced() const { return m_bAdvanced; }
-	void setAdvanced(bool advanced) { m_bAdvanced = advanced; }
+	bool isAdvanced() const { return schema().bAdvanced; }
+	void setAdvanced(bool advanced) { setSchema(&Schema::bAdvanced, advanced); }
 	/**
 	 * If this data is marked as hidden, it will not be editable from anywhere
 	 * in the user interface
 	 */
-	bool isHidden() const { return m_bHidden; }
-	void setHidden(bool hidden) { m_bHidden = hidden; }
+	bool isHidden() const { return schema().bHidden; }
+	void setHidden(bool hidden) { setSchema(&Schema::bHidden, hidden); }
 	/**
 	 * Returns the best possible attempt at representing the data in a string
 	 * for display. Used by the properties list view.
@@ -143,12 +248,12 @@ class Variant : public QObject {
 	 * The list of values that the data is allowed to take (if it is string)
 	 * that is displayed to the user.
 	 */
-	QStringList allowed() const { return m_allowed.values(); }
+	QStringList allowed() const { return schema().allowed.values(); }
 	/**
 	 * @param allowed A list of pairs of (id, i18n-name) of allowed values.
 	 */
-	void setAllowed(const QStringMap &allowed) { m_allowed = allowed; }
-	void setAllowed(QStringMap &&allowed) { m_allowed = allowed; }
+	void setAllowed(const QStringMap &allowed) { setSchema(&Schema::allowed, allowed); }
+	void setAllowed(QStringMap &&allowed) { setSchema(&Schema::allowed, std::move(allowed)); }
 	void setAllowed(const QStringList &allowed);
 	void appendAllowed(const QString &id, const QString &i18nName);
 	void appendAllowed(QString &&id, const QString &i18nName);
@@ -171,58 +276,19 @@ class Variant : public QObject {
 	private:
 	template <typename T>
 	void _setValue(T val);
-	public:
-
-	signals:
-	/**
-	 * Emitted when the value changes.
-	 * NOTE: The order of data given is the new value, and then the old value
-	 * This is done so that slots that don't care about the old value don't
-	 * have to accept it
-	 */
-	void valueChanged(const QVariant &newValue, const QVariant &oldValue);
+	const Schema & schema() const { return *m_schema; }
 	/**
-	 * Emitted for variants of string-like type.
+	 * Sets a member of the schema, only making our own copy of it (if it is
+	 * shared) when the value actually changes.
 	 */
-	void valueChanged(const QString &newValue);
-	/**
-	 * Emitted for variants of string-like type.
-   * This signal is needed for updating values in KComboBox-es, see KComboBox::setCurrentItem(),
-	 * second bool parameter, insert.
-   */
-	void valueChangedStrAndTrue(const QString &newValue, bool trueBool);
-	/**
-	 * Emitted for variants of int-like type.
-	 */
-	void valueChanged(int newValue);
-	/**
-	 * Emitted for variants of double-like type.
-	 */
-	void valueChanged(double newValue);
-	/**
-	 * Emitted for variants of color-like type.
-	 */
-	void valueChanged(const QColor &newValue);
-	/**
-	 * Emitted for variants of bool-like type.
-	 */
-	void valueChanged(bool newValue);
+	template <typename T, typename V>
+	void setSchema(T Schema::*member, V &&value) {
+		if (schema().*member == value) return;
+		m_schema.data()->*member = std::forward<V>(value);
+	}
 
-	private:
-	QStringMap m_allowed;
 	QVariant m_value;									// the actual data
-	QVariant m_defaultValue;
-	QString m_unit;
-	const QString m_id;
-	QString m_toolbarCaption;					// Short description shown in e.g. properties dialog
-	QString m_editorCaption;					// Text displayed before the data entry widget in the toolbar
-	QString m_filter;									// If type() == Type::FileName this is the filter used in file dialogs.
-	double m_minAbsValue = 1.0e-6;
-	double m_minValue = 1.0e-6;
-	double m_maxValue = 1.0e9;
-	Type m_type = Type::None;
-	int m_colorScheme;
-	bool m_bAdvanced = false;					// If advanced, only display data in item editor
-	bool m_bHidden = false;						// If hidden, do not allow user to change data
-	bool m_bSetDefault = false;				// If false, then the default will be set to the first thing this variant is set to
+	QSharedDataPointer<Schema> m_schema;
+	Item * const m_pOwner;
+	std::unique_ptr<VariantNotifier> m_pNotifier;
 };
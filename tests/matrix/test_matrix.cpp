@@ -0,0 +1,259 @@
+/*
+ * KTechLab: An IDE for microcontrollers and electronics
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "matrix.h"
+
+#include <QPoint>
+#include <QTest>
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace {
+	/// Nodes and branches of the test circuit matrix, 9 rows in all so that
+	/// the kernels' unrolled loops have some left over
+	static constexpr const int nodes = 6;
+	static constexpr const int branches = 3;
+	static constexpr const int size = nodes + branches;
+
+	/// How far a solution may be from the expected one
+	static constexpr const double tolerance = 1e-9;
+
+	using Values = std::vector<std::vector<double>>;
+
+	/**
+	 * A diagonally dominant matrix, so that it can be decomposed without
+	 * pivoting, as Matrix does.
+	 */
+	Values testValues() {
+		Values values(size, std::vector<double>(size));
+		for (int i = 0; i < size; ++i) {
+			for (int j = 0; j < size; ++j) {
+				values[i][j] = (i == j) ? 10.0 + i : 0.5 * (((i * 7 + j * 3) % 5) - 2);
+			}
+		}
+		return values;
+	}
+
+	/// The solution that the tests look for, with no zeros in it
+	std::vector<double> knownSolution() {
+		std::vector<double> x(size);
+		for (int i = 0; i < size; ++i) {
+			x[i] = 0.25 * i * i - i - 3.5;
+		}
+		return x;
+	}
+
+	QuickVector rightSide(const Values &values, const std::vector<double> &x) {
+		QuickVector b(size);
+		for (int i = 0; i < size; ++i) {
+			double sum = 0.0;
+			for (int j = 0; j < size; ++j) {
+				sum += values[i][j] * x[j];
+			}
+			b[i] = sum;
+		}
+		return b;
+	}
+
+	void fill(Matrix &matrix, const Values &values) {
+		for (int i = 0; i < size; ++i) {
+			for (int j = 0; j < size; ++j) {
+				matrix.g(i, j) = values[i][j];
+			}
+		}
+	}
+
+	QuickVector solve(Matrix &matrix, const Values &values, const std::vector<double> &x) {
+		QuickVector solution(size);
+		matrix.performLU();
+		matrix.fbSub(rightSide(values, x), &solution);
+		return solution;
+	}
+
+	QuickMatrix testQuickMatrix() {
+		QuickMatrix matrix(4, 11);
+		for (int i = 0; i < matrix.numRows(); ++i) {
+			for (int j = 0; j < matrix.numColumns(); ++j) {
+				matrix.atPut(i, j, 0.5 * (i + 1) - 0.25 * j * (i % 2 ? -1 : 1));
+			}
+		}
+		return matrix;
+	}
+}
+
+class KtlTestsMatrixFixture final : public QObject {
+	Q_OBJECT
+
+	static void verifySolution(const QuickVector &solution, const std::vector<double> &expected) {
+		for (int i = 0; i < size; ++i) {
+			QVERIFY2(
+				std::abs(solution[i] - expected[i]) < tolerance,
+				qPrintable(QString("x[%1] is %2, expected %3").arg(i).arg(solution[i]).arg(expected[i]))
+			);
+		}
+	}
+
+private slots:
+	void testDotRow_data() {
+		QTest::addColumn<int>("from");
+		QTest::addColumn<int>("to");
+
+		QTest::newRow("empty") << 3 << 3;
+		QTest::newRow("fewer than four") << 0 << 3;
+		QTest::newRow("four") << 2 << 6;
+		QTest::newRow("whole row") << 0 << 11;
+		QTest::newRow("to the end") << 5 << 11;
+	}
+
+	void testDotRow() {
+		QFETCH(int, from);
+		QFETCH(int, to);
+
+		const QuickMatrix matrix = testQuickMatrix();
+		std::vector<double> vec(size_t(matrix.numColumns()));
+		for (size_t j = 0; j < vec.size(); ++j) {
+			vec[j] = 1.0 + 0.125 * double(j);
+		}
+
+		for (int row = 0; row < matrix.numRows(); ++row) {
+			double expected = 0.0;
+			for (int j = from; j < to; ++j) {
+				expected += matrix.at(row, j) * vec[size_t(j)];
+			}
+			QCOMPARE(matrix.dotRow(row, vec.data(), from, to) + 1.0, expected + 1.0);
+		}
+	}
+
+	void testPartialSAF_data() {
+		QTest::addColumn<int>("rowA");
+		QTest::addColumn<int>("rowB");
+		QTest::addColumn<int>("from");
+
+		QTest::newRow("whole row") << 0 << 1 << 0;
+		QTest::newRow("part of row") << 3 << 1 << 5;
+		QTest::newRow("last column") << 2 << 0 << 10;
+		QTest::newRow("same row") << 2 << 2 << 4;
+	}
+
+	void testPartialSAF() {
+		QFETCH(int, rowA);
+		QFETCH(int, rowB);
+		QFETCH(int, from);
+
+		const double scalor = -0.75;
+		const QuickMatrix before = testQuickMatrix();
+		QuickMatrix matrix = testQuickMatrix();
+		QVERIFY(matrix.partialSAF(rowA, rowB, from, scalor));
+
+		for (int i = 0; i < matrix.numRows(); ++i) {
+			for (int j = 0; j < matrix.numColumns(); ++j) {
+				double expected = before.at(i, j);
+				if (i == rowB && j >= from) {
+					expected += before.at(rowA, j) * scalor;
+				}
+				QCOMPARE(matrix.at(i, j) + 1.0, expected + 1.0);
+			}
+		}
+	}
+
+	void testSolve() {
+		const Values values = testValues();
+		const std::vector<double> x = knownSolution();
+
+		Matrix matrix(nodes, branches);
+		fill(matrix, values);
+		QVERIFY(matrix.isChanged());
+
+		verifySolution(solve(matrix, values, x), x);
+		QVERIFY(!matrix.isChanged());
+
+		// Solving in place gives the same
+		QuickVector inPlace = rightSide(values, x);
+		matrix.fbSub(&inPlace);
+		verifySolution(inPlace, x);
+	}
+
+	void testPartialLU_data() {
+		QTest::addColumn<QList<QPoint>>("changes");
+		QTest::addColumn<bool>("direct");
+
+		// Points are (column, row) of the entries that are changed
+		const QList<QPoint> lastEntry{QPoint{8, 8}};
+		const QList<QPoint> lowerRows{QPoint{5, 5}, QPoint{8, 6}, QPoint{6, 7}, QPoint{7, 8}};
+		const QList<QPoint> middle{QPoint{6, 4}};
+		const QList<QPoint> leftOfRow{QPoint{2, 7}};
+		const QList<QPoint> firstEntry{QPoint{0, 0}};
+
+		for (bool direct : {false, true}) {
+			const char *how = direct ? "through entry" : "through g";
+			QTest::newRow(qPrintable(QString("last entry, %1").arg(how))) << lastEntry << direct;
+			QTest::newRow(qPrintable(QString("lower rows, %1").arg(how))) << lowerRows << direct;
+			QTest::newRow(qPrintable(QString("middle, %1").arg(how))) << middle << direct;
+			QTest::newRow(qPrintable(QString("left of row, %1").arg(how))) << leftOfRow << direct;
+			QTest::newRow(qPrintable(QString("first entry, %1").arg(how))) << firstEntry << direct;
+		}
+	}
+
+	void testPartialLU() {
+		QFETCH(QList<QPoint>, changes);
+		QFETCH(bool, direct);
+
+		Values values = testValues();
+		const std::vector<double> x = knownSolution();
+
+		Matrix matrix(nodes, branches);
+		fill(matrix, values);
+		verifySolution(solve(matrix, values, x), x);
+
+		// Change some entries, as the nonlinear elements do between
+		// iterations, and only decompose again from where they are
+		for (const QPoint &change : std::as_const(changes)) {
+			const int i = change.y();
+			const int j = change.x();
+			const double delta = (i == j) ? 2.5 : -1.5;
+			values[i][j] += delta;
+
+			if (direct) {
+				*matrix.entry(i, j) += delta;
+				matrix.setChangedFrom(Matrix::changedFrom(i, j));
+			}
+			else {
+				matrix.g(i, j) += delta;
+			}
+		}
+		QVERIFY(matrix.isChanged());
+		const QuickVector partial = solve(matrix, values, x);
+
+		Matrix full(nodes, branches);
+		fill(full, values);
+		const QuickVector expected = solve(full, values, x);
+
+		for (int i = 0; i < size; ++i) {
+			QCOMPARE(partial[i], expected[i]);
+		}
+		verifySolution(partial, x);
+	}
+};
+
+QTEST_GUILESS_MAIN(KtlTestsMatrixFixture)
+#include "test_matrix.moc"
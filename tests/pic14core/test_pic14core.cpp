@@ -0,0 +1,433 @@
+/*
+ * KTechLab: An IDE for microcontrollers and electronics
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "pic14core.h"
+
+#include <QTest>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Instruction encodings, so that the programs below read like assembly
+namespace asm14 {
+	static constexpr const bool W = false;
+	static constexpr const bool F = true;
+
+	static inline uint16 byteOp( uint16 opcode, uint16 f, bool toFile ) {
+		return (opcode << 8) | (toFile ? 0x80 : 0) | (f & 0x7F);
+	}
+	static inline uint16 bitOp( uint16 opcode, uint16 f, int bit ) {
+		return (opcode << 10) | (uint16(bit) << 7) | (f & 0x7F);
+	}
+
+	static inline uint16 ADDWF( uint16 f, bool d ) { return byteOp(0x07, f, d); }
+	static inline uint16 CLRF( uint16 f ) { return byteOp(0x01, f, F); }
+	static inline uint16 DECFSZ( uint16 f, bool d ) { return byteOp(0x0B, f, d); }
+	static inline uint16 INCFSZ( uint16 f, bool d ) { return byteOp(0x0F, f, d); }
+	static inline uint16 MOVWF( uint16 f ) { return byteOp(0x00, f, F); }
+	static inline uint16 SUBWF( uint16 f, bool d ) { return byteOp(0x02, f, d); }
+	static inline uint16 BCF( uint16 f, int bit ) { return bitOp(0x4, f, bit); }
+	static inline uint16 BSF( uint16 f, int bit ) { return bitOp(0x5, f, bit); }
+	static inline uint16 CALL( uint16 k ) { return 0x2000 | (k & 0x7FF); }
+	static inline uint16 GOTO( uint16 k ) { return 0x2800 | (k & 0x7FF); }
+	static inline uint16 MOVLW( uint8 k ) { return 0x3000 | k; }
+	static constexpr const uint16 NOP = 0x0000;
+	static constexpr const uint16 RETURN = 0x0008;
+	static constexpr const uint16 SLEEP = 0x0063;
+}
+
+namespace {
+	/// A general purpose register in bank 0
+	static constexpr const uint16 scratch = 0x20;
+
+	bool flag( const Pic14Core &core, Pic14Core::StatusBit bit ) {
+		return (core.peekRegister(Pic14Core::STATUS) >> bit) & 1;
+	}
+
+	/**
+	 * Loads the program into the core, and clears the outputs changed by
+	 * the reset.
+	 */
+	void load( Pic14Core &core, const std::vector<uint16> &program ) {
+		core.setProgram(program);
+		core.takeOutputsChanged();
+	}
+
+	void stepTimes( Pic14Core &core, int count ) {
+		for (int i = 0; i < count; ++i) {
+			core.step();
+		}
+	}
+}
+
+class KtlTestsPic14CoreFixture final : public QObject {
+	Q_OBJECT
+
+private slots:
+	void testArithmeticFlags_data() {
+		QTest::addColumn<bool>("subtract");
+		QTest::addColumn<int>("f");
+		QTest::addColumn<int>("w");
+		QTest::addColumn<int>("result");
+		QTest::addColumn<bool>("carry");
+		QTest::addColumn<bool>("digitCarry");
+		QTest::addColumn<bool>("zero");
+
+		QTest::newRow("ADDWF 1 + 1") << false << 0x01 << 0x01 << 0x02 << false << false << false;
+		QTest::newRow("ADDWF digit carry") << false << 0x0F << 0x01 << 0x10 << false << true << false;
+		QTest::newRow("ADDWF carry") << false << 0xF0 << 0x20 << 0x10 << true << false << false;
+		QTest::newRow("ADDWF carry to zero") << false << 0xFF << 0x01 << 0x00 << true << true << true;
+		QTest::newRow("ADDWF 0x80 + 0x80") << false << 0x80 << 0x80 << 0x00 << true << false << true;
+		QTest::newRow("ADDWF 0 + 0") << false << 0x00 << 0x00 << 0x00 << false << false << true;
+
+		// C and DC are the inverse of borrow
+		QTest::newRow("SUBWF 5 - 3") << true << 0x05 << 0x03 << 0x02 << true << true << false;
+		QTest::newRow("SUBWF 5 - 5") << true << 0x05 << 0x05 << 0x00 << true << true << true;
+		QTest::newRow("SUBWF 3 - 5") << true << 0x03 << 0x05 << 0xFE << false << false << false;
+		QTest::newRow("SUBWF digit borrow") << true << 0x10 << 0x01 << 0x0F << true << false << false;
+		QTest::newRow("SUBWF 0 - 1") << true << 0x00 << 0x01 << 0xFF << false << false << false;
+	}
+
+	void testArithmeticFlags() {
+		using namespace asm14;
+
+		QFETCH(bool, subtract);
+		QFETCH(int, f);
+		QFETCH(int, w);
+		QFETCH(int, result);
+		QFETCH(bool, carry);
+		QFETCH(bool, digitCarry);
+		QFETCH(bool, zero);
+
+		for (bool d : {F, W}) {
+			Pic14Core core(Pic14Core::Config{});
+			load(core, {
+				MOVLW(f),
+				MOVWF(scratch),
+				MOVLW(w),
+				subtract ? SUBWF(scratch, d) : ADDWF(scratch, d)
+			});
+			stepTimes(core, 4);
+
+			if (d == F) {
+				QCOMPARE(int(core.peekRegister(scratch)), result);
+				QCOMPARE(int(core.w()), w);
+			}
+			else {
+				QCOMPARE(int(core.peekRegister(scratch)), f);
+				QCOMPARE(int(core.w()), result);
+			}
+			QCOMPARE(flag(core, Pic14Core::C), carry);
+			QCOMPARE(flag(core, Pic14Core::DC), digitCarry);
+			QCOMPARE(flag(core, Pic14Core::Z), zero);
+		}
+	}
+
+	void testSkips_data() {
+		QTest::addColumn<bool>("increment");
+		QTest::addColumn<int>("f");
+		QTest::addColumn<int>("result");
+		QTest::addColumn<bool>("skipped");
+
+		QTest::newRow("DECFSZ 2") << false << 0x02 << 0x01 << false;
+		QTest::newRow("DECFSZ 1") << false << 0x01 << 0x00 << true;
+		QTest::newRow("DECFSZ 0") << false << 0x00 << 0xFF << false;
+		QTest::newRow("INCFSZ 0xFE") << true << 0xFE << 0xFF << false;
+		QTest::newRow("INCFSZ 0xFF") << true << 0xFF << 0x00 << true;
+		QTest::newRow("INCFSZ 0") << true << 0x00 << 0x01 << false;
+	}
+
+	void testSkips() {
+		using namespace asm14;
+
+		QFETCH(bool, increment);
+		QFETCH(int, f);
+		QFETCH(int, result);
+		QFETCH(bool, skipped);
+
+		Pic14Core core(Pic14Core::Config{});
+		load(core, {
+			MOVLW(f),
+			MOVWF(scratch),
+			increment ? INCFSZ(scratch, F) : DECFSZ(scratch, F),
+			MOVLW(0xAA),
+			MOVLW(0x55)
+		});
+		stepTimes(core, 2);
+
+		// Skipping costs the extra cycle of the NOP executed in place of the
+		// skipped instruction
+		QCOMPARE(core.step(), skipped ? 2u : 1u);
+		QCOMPARE(int(core.pc()), skipped ? 4 : 3);
+		QCOMPARE(int(core.peekRegister(scratch)), result);
+		// The skip instructions don't affect the status flags
+		QCOMPARE(flag(core, Pic14Core::Z), false);
+
+		core.step();
+		QCOMPARE(int(core.w()), skipped ? 0x55 : 0xAA);
+	}
+
+	void testDelayLoop() {
+		using namespace asm14;
+
+		// A delay loop of n iterations takes 3n - 1 cycles, plus 2 to set it up
+		static constexpr const int iterations = 10;
+		Pic14Core core(Pic14Core::Config{});
+		load(core, {
+			MOVLW(iterations),
+			MOVWF(scratch),
+			DECFSZ(scratch, F),
+			GOTO(2),
+			SLEEP
+		});
+
+		while (core.pc() != 4) {
+			core.step();
+			QVERIFY(core.cycles() < 1000);
+		}
+		QCOMPARE(core.cycles(), uint64(2 + 3 * iterations - 1));
+		QCOMPARE(int(core.peekRegister(scratch)), 0);
+	}
+
+	void testBankSwitching_data() {
+		QTest::addColumn<QString>("id");
+		QTest::addColumn<int>("bank0");
+		QTest::addColumn<int>("bank1");
+		QTest::addColumn<int>("bank2");
+
+		// The 16F84 has only two banks, with the general purpose registers
+		// of bank 0 mirrored in bank 1
+		QTest::newRow("P16F84") << QString("P16F84") << 0x33 << 0x33 << 0x33;
+		QTest::newRow("P16F877") << QString("P16F877") << 0x11 << 0x22 << 0x33;
+	}
+
+	void testBankSwitching() {
+		using namespace asm14;
+
+		QFETCH(QString, id);
+		QFETCH(int, bank0);
+		QFETCH(int, bank1);
+		QFETCH(int, bank2);
+
+		Pic14Core core(Pic14Core::configFor(id));
+		load(core, {
+			MOVLW(0x11),
+			MOVWF(scratch),
+			BSF(Pic14Core::STATUS, Pic14Core::RP0),
+			MOVLW(0x22),
+			MOVWF(scratch),
+			BCF(Pic14Core::STATUS, Pic14Core::RP0),
+			BSF(Pic14Core::STATUS, Pic14Core::RP1),
+			MOVLW(0x33),
+			MOVWF(scratch),
+			// The shared registers at 0x70 are the same in every bank
+			MOVWF(0x70),
+			BCF(Pic14Core::STATUS, Pic14Core::RP1),
+			// TRISB in bank 1
+			BSF(Pic14Core::STATUS, Pic14Core::RP0),
+			CLRF(Pic14Core::PORTB),
+			BCF(Pic14Core::STATUS, Pic14Core::RP0),
+			MOVLW(0x0F),
+			MOVWF(Pic14Core::PORTB)
+		});
+		stepTimes(core, 16);
+
+		QCOMPARE(int(core.peekRegister(scratch)), bank0);
+		QCOMPARE(int(core.peekRegister(0x80 | scratch)), bank1);
+		QCOMPARE(int(core.peekRegister(0x100 | scratch)), bank2);
+		QCOMPARE(int(core.peekRegister(0x70)), 0x33);
+		QCOMPARE(int(core.portTris(1)), 0x00);
+		QCOMPARE(int(core.portLatch(1)), 0x0F);
+		QCOMPARE(int(core.peekRegister(Pic14Core::PORTB)), 0x0F);
+		QVERIFY(core.takeOutputsChanged());
+	}
+
+	void testStackWrap_data() {
+		QTest::addColumn<int>("depth");
+		QTest::addColumn<int>("returnAddress");
+
+		QTest::newRow("1 call") << 1 << 1;
+		QTest::newRow("8 calls") << 8 << 1;
+		// The ninth call overwrites the oldest return address, so the last
+		// return goes back to the return address of the ninth call
+		QTest::newRow("9 calls") << 9 << 0x1F;
+	}
+
+	void testStackWrap() {
+		using namespace asm14;
+
+		QFETCH(int, depth);
+		QFETCH(int, returnAddress);
+
+		// Subroutine k is at 0x10 + 2k and calls subroutine k + 1, apart
+		// from the last which just returns
+		std::vector<uint16> program(0x10 + 2 * depth, NOP);
+		program[0] = CALL(0x10);
+		program[1] = SLEEP;
+		for (int k = 0; k < depth; ++k) {
+			const uint16 address = 0x10 + 2 * k;
+			if (k < depth - 1) {
+				program[address] = CALL(address + 2);
+				program[address + 1] = RETURN;
+			}
+			else {
+				program[address] = RETURN;
+			}
+		}
+
+		Pic14Core core(Pic14Core::Config{});
+		load(core, program);
+		for (int i = 0; i < depth; ++i) {
+			QCOMPARE(core.step(), 2u);
+		}
+		for (int i = 0; i < depth; ++i) {
+			QCOMPARE(core.step(), 2u);
+		}
+
+		QCOMPARE(int(core.pc()), returnAddress);
+		QCOMPARE(core.cycles(), uint64(4 * depth));
+	}
+
+	void testRunBudget_data() {
+		QTest::addColumn<int>("budget");
+		QTest::addColumn<int>("cycles");
+
+		// The loop is NOP, NOP, GOTO: 4 cycles, of which the last two are
+		// one instruction. Run may overshoot by a cycle, never more
+		QTest::newRow("1") << 1 << 1;
+		QTest::newRow("2") << 2 << 2;
+		QTest::newRow("3") << 3 << 4;
+		QTest::newRow("4") << 4 << 4;
+		QTest::newRow("5") << 5 << 5;
+		QTest::newRow("1000") << 1000 << 1000;
+		QTest::newRow("1001") << 1001 << 1001;
+		QTest::newRow("1003") << 1003 << 1004;
+	}
+
+	void testRunBudget() {
+		using namespace asm14;
+
+		QFETCH(int, budget);
+		QFETCH(int, cycles);
+
+		Pic14Core core(Pic14Core::Config{});
+		load(core, { NOP, NOP, GOTO(0) });
+
+		QCOMPARE(core.run(uint64(budget)), uint64(cycles));
+		QCOMPARE(core.cycles(), uint64(cycles));
+		QVERIFY(!core.outputsChanged());
+	}
+
+	void testRunCarriesCycles() {
+		using namespace asm14;
+
+		// Runs as PIC14Component::stepLogic does, with budgets that don't
+		// fit the instructions: the cycles returned must add up to the
+		// cycles executed, and the overshoot is paid back next time
+		Pic14Core core(Pic14Core::Config{});
+		load(core, { NOP, GOTO(0) });
+
+		static constexpr const double cyclesPerUpdate = 2.5;
+		double budget = 0.0;
+		uint64 total = 0;
+		for (int update = 0; update < 1000; ++update) {
+			budget = std::min(budget, cyclesPerUpdate) + cyclesPerUpdate;
+			const uint64 taken = core.run(uint64(std::ceil(budget)));
+			QVERIFY(taken <= uint64(std::ceil(budget)) + 1);
+			budget -= double(taken);
+			total += taken;
+		}
+
+		QCOMPARE(core.cycles(), total);
+		QVERIFY(std::abs(double(total) - 1000 * cyclesPerUpdate) <= 2 * cyclesPerUpdate);
+	}
+
+	void testRunStopsOnOutputs() {
+		using namespace asm14;
+
+		Pic14Core core(Pic14Core::Config{});
+		load(core, {
+			BSF(Pic14Core::STATUS, Pic14Core::RP0),
+			CLRF(Pic14Core::PORTB),
+			BCF(Pic14Core::STATUS, Pic14Core::RP0),
+			NOP,
+			NOP,
+			MOVLW(0x01),
+			MOVWF(Pic14Core::PORTB),
+			GOTO(7)
+		});
+
+		// Stops after writing TRISB
+		QCOMPARE(core.run(100), uint64(2));
+		QVERIFY(core.takeOutputsChanged());
+		QCOMPARE(int(core.portTris(1)), 0x00);
+
+		// Stops after writing PORTB
+		QCOMPARE(core.run(100), uint64(5));
+		QVERIFY(core.takeOutputsChanged());
+		QCOMPARE(int(core.portLatch(1)), 0x01);
+
+		// Runs the whole budget in the GOTO loop
+		QCOMPARE(core.run(100), uint64(100));
+		QVERIFY(!core.takeOutputsChanged());
+		QCOMPARE(core.cycles(), uint64(107));
+	}
+
+	void testRunWhileSleeping() {
+		using namespace asm14;
+
+		Pic14Core core(Pic14Core::Config{});
+		load(core, { SLEEP, NOP });
+
+		// Sleeping uses up the budget exactly
+		QCOMPARE(core.run(1000), uint64(1000));
+		QVERIFY(core.isSleeping());
+		QCOMPARE(core.run(7), uint64(7));
+		QCOMPARE(core.cycles(), uint64(1007));
+		QCOMPARE(int(core.pc()), 1);
+	}
+
+	void testInterruptEntry() {
+		using namespace asm14;
+
+		Pic14Core core(Pic14Core::Config{});
+		load(core, {
+			MOVLW((1 << Pic14Core::GIE) | (1 << Pic14Core::INTE)),
+			MOVWF(Pic14Core::INTCON),
+			GOTO(2),
+			NOP,
+			GOTO(4)
+		});
+		stepTimes(core, 3);
+		QCOMPARE(core.cycles(), uint64(4));
+
+		// INTEDG is set after reset, so RB0/INT interrupts on a rising edge
+		core.setPinInput(1, 0, true);
+		QCOMPARE(core.step(), 2u);
+		QCOMPARE(int(core.pc()), int(Pic14Core::InterruptVector));
+		QCOMPARE(core.cycles(), uint64(6));
+		QCOMPARE(int(core.peekRegister(Pic14Core::INTCON)) & (1 << Pic14Core::GIE), 0);
+	}
+};
+
+QTEST_GUILESS_MAIN(KtlTestsPic14CoreFixture)
+#include "test_pic14core.moc"
@@ -0,0 +1,222 @@
+/*
+ * KTechLab: An IDE for microcontrollers and electronics
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "port.h"
+#include "serialportcomponent.h"
+#include "simulator.h"
+
+#include <QElapsedTimer>
+#include <QTest>
+#include <QThread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+	/// How long to wait for the port's I/O thread, in milliseconds
+	static constexpr const int timeout = 5000;
+
+	QByteArray testBytes() {
+		QByteArray bytes;
+		for (int i = 0; i < 256; ++i) {
+			bytes += char(i);
+		}
+		bytes += "\x55\xaa\x00\xff";
+		return bytes;
+	}
+
+	/**
+	 * Sends bytes through an encoder and a decoder one simulator tick at a
+	 * time, calling received for each byte decoded.
+	 */
+	template <typename Received>
+	void runLine(UartEncoder &encoder, UartDecoder &decoder, double bitPeriod, int byteCount, Received received) {
+		const long long end = (long long)((byteCount + 2) * 10 * bitPeriod) + 1;
+		for (long long time = 1; time <= end; ++time) {
+			const int byte = decoder.update(time, encoder.level(time));
+			if (byte != -1) {
+				received(uint8(byte));
+			}
+		}
+	}
+
+	QByteArray encodeAndDecode(const QByteArray &bytes, double txBitPeriod, double rxBitPeriod) {
+		UartEncoder encoder;
+		encoder.setBitPeriod(txBitPeriod);
+		UartDecoder decoder;
+		decoder.setBitPeriod(rxBitPeriod);
+
+		for (char byte : bytes) {
+			encoder.queue(uint8(byte));
+		}
+
+		QByteArray decoded;
+		runLine(encoder, decoder, txBitPeriod, bytes.size(), [&](uint8 byte) { decoded += char(byte); });
+		return decoded;
+	}
+}
+
+class KtlTestsSerialPortFixture final : public QObject {
+	Q_OBJECT
+
+	/// The master side of the pseudo-terminal; the port opens the slave side
+	int m_master = -1;
+	QString m_slaveName;
+
+	/**
+	 * Reads count bytes from the master side, or as many as arrive before
+	 * the timeout.
+	 */
+	QByteArray readMaster(int count) {
+		QByteArray bytes;
+		QElapsedTimer timer;
+		timer.start();
+		while (bytes.size() < count && timer.elapsed() < timeout) {
+			pollfd fd{m_master, POLLIN, 0};
+			if (poll(&fd, 1, 100) <= 0) continue;
+
+			char buffer[256];
+			const ssize_t read = ::read(m_master, buffer, sizeof(buffer));
+			if (read > 0) {
+				bytes.append(buffer, int(read));
+			}
+		}
+		return bytes;
+	}
+
+private slots:
+	void init() {
+		m_master = posix_openpt(O_RDWR | O_NOCTTY);
+		QVERIFY(m_master != -1);
+		QVERIFY(grantpt(m_master) == 0);
+		QVERIFY(unlockpt(m_master) == 0);
+		m_slaveName = QString::fromLocal8Bit(ptsname(m_master));
+		QVERIFY(!m_slaveName.isEmpty());
+	}
+
+	void cleanup() {
+		if (m_master != -1) {
+			close(m_master);
+		}
+		m_master = -1;
+	}
+
+	void testUartRoundTrip_data() {
+		QTest::addColumn<int>("baud");
+		QTest::addColumn<double>("rateMismatch");
+
+		for (int baud : {300, 9600, 115200}) {
+			QTest::newRow(qPrintable(QString("%1 baud").arg(baud))) << baud << 1.0;
+			QTest::newRow(qPrintable(QString("%1 baud, 1% fast").arg(baud))) << baud << 0.99;
+			QTest::newRow(qPrintable(QString("%1 baud, 1% slow").arg(baud))) << baud << 1.01;
+		}
+	}
+
+	void testUartRoundTrip() {
+		QFETCH(int, baud);
+		QFETCH(double, rateMismatch);
+
+		const double bitPeriod = double(LOGIC_UPDATE_RATE) / baud;
+		const QByteArray bytes = testBytes();
+		QCOMPARE(encodeAndDecode(bytes, bitPeriod * rateMismatch, bitPeriod), bytes);
+	}
+
+	void testPtyTransmit() {
+		SerialPort port;
+		QVERIFY(port.openPort(m_slaveName, B9600));
+
+		// Levels from the circuit, decoded and written to the port
+		const double bitPeriod = double(LOGIC_UPDATE_RATE) / 9600;
+		UartEncoder circuit;
+		circuit.setBitPeriod(bitPeriod);
+		UartDecoder decoder;
+		decoder.setBitPeriod(bitPeriod);
+
+		const QByteArray bytes = testBytes();
+		for (char byte : bytes) {
+			circuit.queue(uint8(byte));
+		}
+		runLine(circuit, decoder, bitPeriod, bytes.size(), [&](uint8 byte) { port.writeByte(byte); });
+
+		QCOMPARE(readMaster(bytes.size()), bytes);
+		port.closePort();
+	}
+
+	void testPtyReceive() {
+		SerialPort port;
+		QVERIFY(port.openPort(m_slaveName, B9600));
+
+		const QByteArray bytes = testBytes();
+		QCOMPARE(write(m_master, bytes.constData(), size_t(bytes.size())), ssize_t(bytes.size()));
+
+		// Bytes from the port, sent to the circuit and decoded again
+		const double bitPeriod = double(LOGIC_UPDATE_RATE) / 9600;
+		UartEncoder encoder;
+		encoder.setBitPeriod(bitPeriod);
+
+		int received = 0;
+		QElapsedTimer timer;
+		timer.start();
+		while (received < bytes.size() && timer.elapsed() < timeout) {
+			SerialPort::Event event;
+			if (!port.takeEvent(event)) {
+				QThread::msleep(1);
+				continue;
+			}
+			if (event.type == SerialPort::Event::ByteReceived) {
+				encoder.queue(event.byte);
+				++received;
+			}
+		}
+		QCOMPARE(received, bytes.size());
+		QCOMPARE(port.overruns(), uint64(0));
+
+		UartDecoder decoder;
+		decoder.setBitPeriod(bitPeriod);
+		QByteArray decoded;
+		runLine(encoder, decoder, bitPeriod, bytes.size(), [&](uint8 byte) { decoded += char(byte); });
+		QCOMPARE(decoded, bytes);
+
+		port.closePort();
+	}
+
+	void testPtyLinesNotWatched() {
+		// Pseudo-terminals have no modem lines; watching them must not stop
+		// bytes from getting through
+		SerialPort port;
+		QVERIFY(port.openPort(m_slaveName, B9600));
+		port.setWatchLines(true);
+
+		port.writeByte('k');
+		QCOMPARE(readMaster(1), QByteArray("k"));
+
+		port.setWatchLines(false);
+		port.writeByte('t');
+		QCOMPARE(readMaster(1), QByteArray("t"));
+
+		port.closePort();
+	}
+};
+
+QTEST_GUILESS_MAIN(KtlTestsSerialPortFixture)
+#include "test_serialport.moc"